@@ -18,6 +18,8 @@ LOCAL_SRC_FILES += datatop_str.c
 LOCAL_SRC_FILES += datatop_sys_snap.c
 LOCAL_SRC_FILES += datatop_value_only_poll.c
 LOCAL_SRC_FILES += datatop_ip_table_poll.c
+LOCAL_SRC_FILES += datatop_binary.c
+LOCAL_SRC_FILES += datatop_sched.c
 
 LOCAL_CFLAGS := -Wall -Wextra -Werror -pedantic -std=c99
 LOCAL_CFLAGS += -DVERSION="\"1.0.4"\"
@@ -32,3 +34,23 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_PROPRIETARY_MODULE := true
 
 include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := datatop_bin2csv.c
+LOCAL_SRC_FILES += datatop_binary.c
+LOCAL_SRC_FILES += datatop_helpers.c
+LOCAL_SRC_FILES += datatop_linked_list.c
+
+LOCAL_CFLAGS := -Wall -Wextra -Werror -pedantic -std=c99
+LOCAL_CFLAGS += -DHAVE_STRL_FUNCTIONS
+LOCAL_CFLAGS += -D _BSD_SOURCE
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)
+
+LOCAL_CLANG := true
+LOCAL_MODULE := datatop_bin2csv
+LOCAL_MODULE_TAGS := optional
+LOCAL_PROPRIETARY_MODULE := true
+
+include $(BUILD_EXECUTABLE)
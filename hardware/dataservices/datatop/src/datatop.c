@@ -40,6 +40,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <unistd.h>
@@ -53,10 +54,13 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "datatop_fileops.h"
 #include "datatop_polling.h"
 #include "datatop_gen_poll.h"
+#include "datatop_binary.h"
+#include "datatop_sched.h"
 
 
 #define DTOP_SEC_TO_USEC(x) ((x)*1000000)
 #define DTOP_USEC_TO_SEC(x) ((x)/1000000)
+#define DTOP_TS_TO_USEC(ts) ((int64_t)(ts).tv_sec*1000000+(ts).tv_nsec/1000)
 struct dtop_linked_list *first_dpg_list;
 struct cli_opts usr_cl_opts;
 
@@ -78,12 +82,111 @@ void dtop_print_terminal(struct dtop_linked_list *dpg_list)
 	}
 }
 
+/**
+ * @brief Prints the csv column headers for all datapoints.
+ *
+ * @param dpg_list A pointer to the first node of a linked list which contains
+ *                 all data_point_gatherer structs to print.
+ * @param fw A pointer to the file which will be printed to.
+ * @return FILE_ERROR - Writing to file was unsuccessful.
+ * @return FILE_SUCCESS - Writing to file was successful.
+ */
+static int dtop_print_csv_header(struct dtop_linked_list *dpg_list, FILE *fw)
+{
+	struct dtop_linked_list *curr_ptr = dpg_list;
+	struct dtop_data_point_gatherer *dpset;
+
+	if (fprintf(fw, "\"Time\",") < 0)
+		return FILE_ERROR;
+
+	if (fprintf(fw, "\"datatop::poll_wall_us\",") < 0 ||
+	    fprintf(fw, "\"datatop::poll_cpu_us\",") < 0)
+		return FILE_ERROR;
+
+	while (curr_ptr) {
+		dpset = (struct dtop_data_point_gatherer *) curr_ptr->data;
+		if (dtop_print_dpg_names_csv(dpset, fw) == FILE_ERROR)
+			return FILE_ERROR;
+		curr_ptr = curr_ptr->next_ptr;
+	}
+	if (fprintf(fw, "\n") < 0)
+		return FILE_ERROR;
+
+	return FILE_SUCCESS;
+}
+
+/**
+ * @brief Starts a binary capture described by the csv column headers.
+ *
+ * @param dpg_list A pointer to the first node of a linked list which contains
+ *                 all data_point_gatherer structs to capture.
+ * @param fw A pointer to the file which will be written to.
+ * @return The binary writer, NULL on failure.
+ */
+static struct dtop_bin_writer *dtop_open_binary_output(
+			struct dtop_linked_list *dpg_list, FILE *fw)
+{
+	struct dtop_bin_writer *bw = NULL;
+	char *names = NULL;
+	size_t names_len = 0;
+	FILE *mem;
+
+	mem = open_memstream(&names, &names_len);
+	if (!mem)
+		return NULL;
+
+	if (dtop_print_csv_header(dpg_list, mem) == FILE_ERROR) {
+		fclose(mem);
+		free(names);
+		return NULL;
+	}
+	fclose(mem);
+
+	bw = dtop_bin_open(fw, dpg_list, names, names_len);
+	free(names);
+	return bw;
+}
+
+/**
+ * @brief Writes the values of one poll in the selected output format.
+ *
+ * @param dpg_list A pointer to the first node of a linked list which contains
+ *                 all data_point_gatherer structs to print.
+ * @param fw A pointer to the file which will be printed to.
+ * @param bw Binary writer, NULL for csv output.
+ * @param wall_us Wall clock time the poll took.
+ * @param cpu_us CPU time the poll took.
+ * @return FILE_ERROR - Writing to file was unsuccessful.
+ * @return FILE_SUCCESS - Writing to file was successful.
+ */
+static int dtop_write_poll(struct dtop_linked_list *dpg_list, FILE *fw,
+			   struct dtop_bin_writer *bw,
+			   int64_t wall_us, int64_t cpu_us)
+{
+	struct timeval tv;
+
+	if (bw) {
+		gettimeofday(&tv, NULL);
+		return dtop_bin_write_poll(bw, dpg_list, &tv, wall_us, cpu_us);
+	}
+
+	if (dtop_print_time_at_poll(fw) == FILE_ERROR)
+		return FILE_ERROR;
+
+	if (fprintf(fw, "%" PRId64 ",%" PRId64 ",", wall_us, cpu_us) < 0)
+		return FILE_ERROR;
+
+	return dtop_write_pollingdata_csv(dpg_list, fw);
+}
+
 /**
  * @brief Polls the data periodically and prints to file specified by the user.
  *
- * Polls the data as often as specified by the user in their CLI arguments
- * and outputs the data to a file also specified in CLI arguments. Then prints
- * a snapshot of delta(dp_value) to the terminal.
+ * Writes a row at the period of the fastest polling group, holding the
+ * latest values of every group, to a file specified in CLI arguments. The
+ * groups and their periods come from the -i and -R CLI arguments. Then prints
+ * a snapshot of delta(dp_value) to the terminal, along with the size of the
+ * output and the CPU time spent writing it.
  *
  * @param dpg_list A pointer to the first node of a linked list which contains
  *                 all data_point_gatherer structs to poll and print.
@@ -97,45 +200,51 @@ int dtop_poll_periodically(struct dtop_linked_list *dpg_list, FILE *fw)
 	fd_set rfds;
 	time_t curtime, endtime;
 	int inp, quit = 0;
-	struct dtop_linked_list *curr_ptr = dpg_list;
-	struct dtop_data_point_gatherer *dpset;
+	int ret = FILE_SUCCESS;
 	struct timeval ftime, itime, polltime;
+	struct timespec start, end, cpu_start, cpu_end;
+	struct dtop_bin_writer *bw = NULL;
+	int64_t wall_us, cpu_us;
+	int64_t out_cpu_us = 0;
+	long polls = 0;
+	uint64_t bytes = 0;
+	double secs;
 
 	gettimeofday(&tv, NULL);
 	curtime = DTOP_SEC_TO_USEC(tv.tv_sec)+tv.tv_usec;
 	endtime = DTOP_SEC_TO_USEC(tv.tv_sec)+ DTOP_SEC_TO_USEC(usr_cl_opts.poll_time);
 
-	/* print all of our datapoint names as column headers in csv format */
-	if (fprintf(fw, "\"Time\",") < 0)
-		return FILE_ERROR;
-
-	while (curr_ptr) {
-		dpset = (struct dtop_data_point_gatherer *) curr_ptr->data;
-		if (dtop_print_dpg_names_csv(dpset, fw) == FILE_ERROR)
+	/* print all of our datapoint names as column headers */
+	if (usr_cl_opts.binary_out == OPT_CHOSE) {
+		bw = dtop_open_binary_output(dpg_list, fw);
+		if (!bw)
 			return FILE_ERROR;
-		curr_ptr = curr_ptr->next_ptr;
-	}
-	if (fprintf(fw, "\n") < 0)
+	} else if (dtop_print_csv_header(dpg_list, fw) == FILE_ERROR) {
 		return FILE_ERROR;
+	}
 
 	dtop_print_interactive_opts();
+	clock_gettime(CLOCK_MONOTONIC, &start);
 	gettimeofday(&itime, NULL);
 	/* periodically poll the datapoints and print in csv format */
 	while (curtime < endtime
 		|| usr_cl_opts.poll_time == POLL_NOT_SPECIFIED) {
 		FD_ZERO(&rfds);
 		FD_SET(0, &rfds);
-		timeout.tv_sec = DTOP_USEC_TO_SEC(usr_cl_opts.poll_per);
-		timeout.tv_usec = (usr_cl_opts.poll_per%1000000);
+		timeout.tv_sec = DTOP_USEC_TO_SEC(dtop_sched_tick());
+		timeout.tv_usec = (dtop_sched_tick()%1000000);
 		//ftime is right before timeout calculations for most acurate calculations
 		gettimeofday(&ftime, NULL);
 		timersub(&ftime, &itime, &polltime);
 		timersub(&timeout,&polltime, &timeout);
+		/* A poll that overran the period starts the next one at once */
+		if (timeout.tv_sec < 0)
+			timerclear(&timeout);
 		inp = select(1, &rfds, NULL, NULL, &timeout);
 		gettimeofday(&itime, NULL);
-		if (inp) {
-			char s[4];
-			scanf("%s", s);
+		if (inp > 0) {
+			char s[5];
+			scanf("%4s", s);
 			if (strcmp(s, "quit") == 0
 			    || strcmp(s, "q") == 0) {
 				quit = QUIT;
@@ -150,13 +259,34 @@ int dtop_poll_periodically(struct dtop_linked_list *dpg_list, FILE *fw)
 		}
 		gettimeofday(&tv, NULL);
 		curtime = DTOP_SEC_TO_USEC(tv.tv_sec)+tv.tv_usec;
-		dtop_poll(dpg_list);
-		if (dtop_print_time_at_poll(fw) == FILE_ERROR)
-			return FILE_ERROR;
-		if (dtop_write_pollingdata_csv(dpg_list, fw) == FILE_ERROR)
-		        return FILE_ERROR;
-		        
+		dtop_sched_poll(&wall_us, &cpu_us);
+
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+		ret = dtop_write_poll(dpg_list, fw, bw, wall_us, cpu_us);
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+		if (ret == FILE_ERROR)
+			break;
+		out_cpu_us += DTOP_TS_TO_USEC(cpu_end)
+			- DTOP_TS_TO_USEC(cpu_start);
+		polls++;
+	}
+	dtop_sched_stop();
+
+	if (bw) {
+		if (dtop_bin_close(bw, &bytes) == FILE_ERROR)
+			ret = FILE_ERROR;
+	} else {
+		bytes = ftell(fw);
 	}
+	if (ret == FILE_ERROR)
+		return FILE_ERROR;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	secs = (DTOP_TS_TO_USEC(end) - DTOP_TS_TO_USEC(start)) / 1e6;
+	printf("\n%s output: %" PRIu64 " bytes, %.0f bytes/sec, ",
+	       usr_cl_opts.binary_out == OPT_CHOSE ? "Binary" : "CSV", bytes, secs > 0 ? bytes / secs : 0);
+	printf("%.1f us CPU per poll\n",
+	       polls ? (double)out_cpu_us / polls : 0);
 
 	if (quit != QUIT)
 		dtop_print_snapshot_diff(dpg_list);
@@ -176,6 +306,25 @@ static void dtop_set_niceness(int niceness)
 	printf("Running with nice %d.\n", rc);
 }
 
+/**
+ * @brief Raises the open file limit as far as allowed.
+ *
+ * Every polled file is kept open between polls, and /proc/sys/net alone
+ * holds several hundred of them. Files that do not fit under the limit
+ * fall back to being opened on each poll.
+ */
+static void dtop_raise_fd_limit(void)
+{
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == rl.rlim_max)
+		return;
+
+	rl.rlim_cur = rl.rlim_max;
+	if (setrlimit(RLIMIT_NOFILE, &rl) != 0)
+		fprintf(stderr, "Error raising open file limit [%d]\n", errno);
+}
+
 int main(int argc, char **argv)
 {
 	int parse_status;
@@ -189,6 +338,7 @@ int main(int argc, char **argv)
 	switch (parse_status) {
 	case PARSE_SUCCESS:
 		dtop_set_niceness(usr_cl_opts.priority);
+		dtop_raise_fd_limit();
 	break;
 
 	case PARSE_FORCE_EXIT:
@@ -247,6 +397,7 @@ int main(int argc, char **argv)
 						&to_file)) == VALID) {
 			printf("\nData being polled for %ld seconds.\n",
 						usr_cl_opts.poll_time);
+			dtop_sched_init(first_dpg_list, usr_cl_opts.poll_per);
 			if (dtop_poll_periodically(first_dpg_list, to_file)
 			    == FILE_ERROR) {
 				fprintf(stderr, "err=%d: %s\n", errno,
@@ -0,0 +1,122 @@
+/************************************************************************
+Copyright (c) 2015, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************/
+
+/**
+ * @file datatop_bin2csv.c
+ * @brief Converts a binary datatop capture (datatop -b) to CSV.
+ *
+ * The output has the same layout as a capture written with -w alone. The
+ * values are printed by the same helpers datatop uses for its CSV output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "datatop_interface.h"
+#include "datatop_linked_list.h"
+#include "datatop_binary.h"
+
+/**
+ * @brief Converts all polls of a capture.
+ *
+ * @param br Reader set up by dtop_bin_read_header().
+ * @param fw File the CSV is written to.
+ * @return FILE_ERROR - Conversion was unsuccessful.
+ * @return FILE_SUCCESS - Conversion was successful.
+ */
+static int dtop_bin2csv(struct dtop_bin_reader *br, FILE *fw)
+{
+	struct dtop_data_point_gatherer dpg;
+	struct dtop_linked_list node;
+	int rc;
+
+	memset(&dpg, 0, sizeof(dpg));
+	dpg.data_points = br->data_points;
+	dpg.data_points_len = br->columns;
+	node.data = &dpg;
+	node.next_ptr = NULL;
+
+	if (fputs(br->names, fw) < 0)
+		return FILE_ERROR;
+
+	while ((rc = dtop_bin_read_poll(br)) == DTOP_BIN_REC_READY) {
+		if (fprintf(fw, "%10" PRId64 ".%06" PRId64 ",",
+			    br->time_us / 1000000, br->time_us % 1000000) < 0)
+			return FILE_ERROR;
+		if (fprintf(fw, "%" PRId64 ",%" PRId64 ",",
+			    br->poll_wall_us, br->poll_cpu_us) < 0)
+			return FILE_ERROR;
+		if (dtop_write_pollingdata_csv(&node, fw) == FILE_ERROR)
+			return FILE_ERROR;
+	}
+
+	return rc == DTOP_BIN_REC_NONE ? FILE_SUCCESS : FILE_ERROR;
+}
+
+int main(int argc, char **argv)
+{
+	struct dtop_bin_reader br;
+	FILE *fr, *fw = stdout;
+	int rc;
+
+	if (argc < 2 || argc > 3) {
+		printf("Usage: %s capture [file.csv]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fr = fopen(argv[1], "rb");
+	if (!fr) {
+		fprintf(stderr, "Could not open %s: %s\n", argv[1],
+			strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	if (argc == 3) {
+		fw = fopen(argv[2], "w");
+		if (!fw) {
+			fprintf(stderr, "Could not open %s: %s\n", argv[2],
+				strerror(errno));
+			fclose(fr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	rc = dtop_bin_read_header(&br, fr);
+	if (rc == FILE_SUCCESS)
+		rc = dtop_bin2csv(&br, fw);
+
+	dtop_bin_reader_free(&br);
+	fclose(fr);
+	if (fw != stdout && fclose(fw) != 0)
+		rc = FILE_ERROR;
+
+	return rc == FILE_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
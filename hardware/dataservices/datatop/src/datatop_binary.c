@@ -0,0 +1,624 @@
+/************************************************************************
+Copyright (c) 2015, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************/
+
+/**
+ * @file datatop_binary.c
+ * @brief Writes and reads binary datatop captures.
+ *
+ * The writer encodes each poll into one of two buffers. Once a buffer is
+ * full it is handed to a flush thread and polling continues into the other
+ * one, so the poll loop never waits for storage unless both are full.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include "datatop_interface.h"
+#include "datatop_linked_list.h"
+#include "datatop_binary.h"
+
+/**
+ * @struct dtop_bin_writer
+ * @brief State of a binary capture being written.
+ *
+ * @var dtop_bin_writer::fd
+ * Descriptor of the capture file.
+ * @var dtop_bin_writer::columns
+ * Number of dp columns in each poll.
+ * @var dtop_bin_writer::bitmap_len
+ * Size of the changed column bitmap of a poll record.
+ * @var dtop_bin_writer::types
+ * Type last written for each column.
+ * @var dtop_bin_writer::prev
+ * Value last written for each column.
+ * @var dtop_bin_writer::buf
+ * The two blocks records are encoded into.
+ * @var dtop_bin_writer::len
+ * Bytes used in each block.
+ * @var dtop_bin_writer::max_record
+ * Largest size a poll, with its type records, can encode to.
+ * @var dtop_bin_writer::block_size
+ * Size of each block.
+ * @var dtop_bin_writer::active
+ * Block records are currently encoded into.
+ * @var dtop_bin_writer::flushing
+ * Block handed to the flush thread, -1 if none.
+ * @var dtop_bin_writer::quit
+ * Set to stop the flush thread once it has nothing left to write.
+ * @var dtop_bin_writer::error
+ * Set if the flush thread failed to write a block.
+ * @var dtop_bin_writer::bytes
+ * Bytes written to the capture so far.
+ */
+struct dtop_bin_writer {
+	int fd;
+	uint32_t columns;
+	uint32_t bitmap_len;
+	uint8_t *types;
+	union dtop_data_union *prev;
+	char *buf[2];
+	size_t len[2];
+	size_t max_record;
+	size_t block_size;
+	int active;
+	int flushing;
+	int quit;
+	int error;
+	uint64_t bytes;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/**
+ * @brief Returns the numeric value of a dp as 64 raw bits.
+ *
+ * @param dp Dp to get the value of.
+ * @return Value of the dp, sign extended for signed types.
+ */
+static uint64_t dtop_bin_raw_value(const struct dtop_data_point *dp)
+{
+	switch (dp->type) {
+	case DTOP_ULONG:
+		return dp->data.d_ulong;
+	case DTOP_LONG:
+		return (uint64_t)dp->data.d_long;
+	case DTOP_UINT:
+		return dp->data.d_uint;
+	case DTOP_INT:
+		return (uint64_t)(int64_t)dp->data.d_int;
+	case DTOP_UCHAR:
+		return dp->data.d_uchar;
+	case DTOP_CHAR:
+		return (uint64_t)(int64_t)dp->data.d_char;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Stores 64 raw bits as the numeric value of a dp.
+ *
+ * @param dp Dp to store the value in.
+ * @param raw Value as returned by dtop_bin_raw_value().
+ */
+static void dtop_bin_set_raw_value(struct dtop_data_point *dp, uint64_t raw)
+{
+	switch (dp->type) {
+	case DTOP_ULONG:
+		dp->data.d_ulong = raw;
+	break;
+	case DTOP_LONG:
+		dp->data.d_long = (int64_t)raw;
+	break;
+	case DTOP_UINT:
+		dp->data.d_uint = (uint32_t)raw;
+	break;
+	case DTOP_INT:
+		dp->data.d_int = (int32_t)raw;
+	break;
+	case DTOP_UCHAR:
+		dp->data.d_uchar = (uint8_t)raw;
+	break;
+	case DTOP_CHAR:
+		dp->data.d_char = (int8_t)raw;
+	break;
+	default:
+	break;
+	}
+}
+
+/**
+ * @brief Writes a whole buffer to a descriptor.
+ *
+ * @param fd Descriptor to write to.
+ * @param buf Data to write.
+ * @param len Number of bytes to write.
+ * @return FILE_SUCCESS - All data was written.
+ * @return FILE_ERROR - Writing failed.
+ */
+static int dtop_bin_write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t rc;
+
+	while (len > 0) {
+		rc = write(fd, buf, len);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return FILE_ERROR;
+		buf += rc;
+		len -= rc;
+	}
+	return FILE_SUCCESS;
+}
+
+/**
+ * @brief Writes out the blocks handed over by the poll loop.
+ *
+ * @param arg The dtop_bin_writer.
+ */
+static void *dtop_bin_flush_thread(void *arg)
+{
+	struct dtop_bin_writer *bw = arg;
+	int idx, rc;
+
+	pthread_mutex_lock(&bw->lock);
+	while (1) {
+		while (bw->flushing < 0 && !bw->quit)
+			pthread_cond_wait(&bw->cond, &bw->lock);
+		if (bw->flushing < 0)
+			break;
+
+		idx = bw->flushing;
+		pthread_mutex_unlock(&bw->lock);
+		rc = dtop_bin_write_all(bw->fd, bw->buf[idx], bw->len[idx]);
+		pthread_mutex_lock(&bw->lock);
+
+		if (rc == FILE_ERROR)
+			bw->error = 1;
+		else
+			bw->bytes += bw->len[idx];
+		bw->len[idx] = 0;
+		bw->flushing = -1;
+		pthread_cond_broadcast(&bw->cond);
+	}
+	pthread_mutex_unlock(&bw->lock);
+	return NULL;
+}
+
+/**
+ * @brief Hands the active block to the flush thread and switches blocks.
+ *
+ * Only waits if the other block is still being written out.
+ *
+ * @param bw Writer to switch blocks of.
+ * @return FILE_SUCCESS - Blocks were switched.
+ * @return FILE_ERROR - An earlier block could not be written.
+ */
+static int dtop_bin_swap(struct dtop_bin_writer *bw)
+{
+	int error;
+
+	pthread_mutex_lock(&bw->lock);
+	while (bw->flushing >= 0)
+		pthread_cond_wait(&bw->cond, &bw->lock);
+	bw->flushing = bw->active;
+	bw->active ^= 1;
+	error = bw->error;
+	pthread_cond_broadcast(&bw->cond);
+	pthread_mutex_unlock(&bw->lock);
+
+	return error ? FILE_ERROR : FILE_SUCCESS;
+}
+
+/**
+ * @brief Appends a field to a record being encoded.
+ *
+ * @param pos Position in the block, advanced past the field.
+ * @param data Field to append.
+ * @param len Size of the field.
+ */
+static void dtop_bin_put(char **pos, const void *data, size_t len)
+{
+	memcpy(*pos, data, len);
+	*pos += len;
+}
+
+/**
+ * @brief Starts a binary capture.
+ *
+ * Writes the header and starts the flush thread. The column layout is taken
+ * from dpg_list and must not change while the capture is written.
+ *
+ * @param fw File the capture is written to, must not be written otherwise.
+ * @param dpg_list Pointer to first node of linked list which contains all dpgs.
+ * @param names CSV header line describing the columns.
+ * @param names_len Length of names.
+ * @return The writer, NULL if the capture could not be started.
+ */
+struct dtop_bin_writer *dtop_bin_open(FILE *fw,
+				      struct dtop_linked_list *dpg_list,
+				      const char *names, size_t names_len)
+{
+	struct dtop_linked_list *curr_ptr;
+	struct dtop_data_point_gatherer *dpset;
+	struct dtop_bin_writer *bw;
+	char magic[DTOP_BIN_MAGIC_LEN] = DTOP_BIN_MAGIC;
+	uint32_t version = DTOP_BIN_VERSION;
+	uint32_t byte_order = DTOP_BIN_BYTE_ORDER;
+	uint32_t len = names_len;
+	uint32_t col = 0;
+	char *header, *pos;
+	size_t header_len;
+	int i, rc;
+
+	bw = calloc(1, sizeof(*bw));
+	if (!bw)
+		return NULL;
+	bw->fd = fileno(fw);
+	bw->flushing = -1;
+
+	for (curr_ptr = dpg_list; curr_ptr; curr_ptr = curr_ptr->next_ptr) {
+		dpset = (struct dtop_data_point_gatherer *) curr_ptr->data;
+		bw->columns += dpset->data_points_len;
+	}
+	bw->bitmap_len = (bw->columns + 7) / 8;
+	bw->max_record = 1 + 3 * sizeof(int64_t) + bw->bitmap_len
+		+ (size_t)bw->columns * (DTOP_BIN_STR_WIDTH + 1
+		+ sizeof(uint32_t) + 1);
+	bw->block_size = DTOP_BIN_BLOCK_SIZE;
+	if (bw->block_size < 2 * bw->max_record)
+		bw->block_size = 2 * bw->max_record;
+
+	bw->types = malloc(bw->columns + 1);
+	bw->prev = calloc(bw->columns + 1, sizeof(*bw->prev));
+	bw->buf[0] = malloc(bw->block_size);
+	bw->buf[1] = malloc(bw->block_size);
+	header_len = DTOP_BIN_MAGIC_LEN + 4 * sizeof(uint32_t) + names_len
+		+ bw->columns;
+	header = malloc(header_len);
+	if (!bw->types || !bw->prev || !bw->buf[0] || !bw->buf[1] || !header) {
+		fprintf(stderr, "%s(): malloc failed\n", __func__);
+		goto err;
+	}
+
+	pos = header;
+	dtop_bin_put(&pos, magic, DTOP_BIN_MAGIC_LEN);
+	dtop_bin_put(&pos, &version, sizeof(version));
+	dtop_bin_put(&pos, &byte_order, sizeof(byte_order));
+	dtop_bin_put(&pos, &bw->columns, sizeof(bw->columns));
+	dtop_bin_put(&pos, &len, sizeof(len));
+	dtop_bin_put(&pos, names, names_len);
+	for (curr_ptr = dpg_list; curr_ptr; curr_ptr = curr_ptr->next_ptr) {
+		dpset = (struct dtop_data_point_gatherer *) curr_ptr->data;
+		for (i = 0; i < dpset->data_points_len; i++, col++) {
+			bw->types[col] = dpset->data_points[i].type;
+			*pos++ = bw->types[col];
+		}
+	}
+
+	rc = dtop_bin_write_all(bw->fd, header, header_len);
+	free(header);
+	header = NULL;
+	if (rc == FILE_ERROR)
+		goto err;
+	bw->bytes = header_len;
+
+	pthread_mutex_init(&bw->lock, NULL);
+	pthread_cond_init(&bw->cond, NULL);
+	if (pthread_create(&bw->thread, NULL, dtop_bin_flush_thread, bw)) {
+		fprintf(stderr, "%s(): Unable to create flush thread\n",
+			__func__);
+		pthread_cond_destroy(&bw->cond);
+		pthread_mutex_destroy(&bw->lock);
+		goto err;
+	}
+
+	return bw;
+
+err:
+	free(header);
+	free(bw->buf[0]);
+	free(bw->buf[1]);
+	free(bw->prev);
+	free(bw->types);
+	free(bw);
+	return NULL;
+}
+
+/**
+ * @brief Encodes the current values of all dps as one poll record.
+ *
+ * @param bw Writer returned by dtop_bin_open().
+ * @param dpg_list Pointer to first node of linked list which contains all dpgs.
+ * @param tv Time of the poll.
+ * @param poll_wall_us Wall clock time the poll took.
+ * @param poll_cpu_us CPU time the poll took.
+ * @return FILE_ERROR - Writing to file was unsuccessful.
+ * @return FILE_SUCCESS - Writing to file was successful.
+ */
+int dtop_bin_write_poll(struct dtop_bin_writer *bw,
+			struct dtop_linked_list *dpg_list,
+			const struct timeval *tv,
+			int64_t poll_wall_us, int64_t poll_cpu_us)
+{
+	struct dtop_linked_list *curr_ptr;
+	struct dtop_data_point_gatherer *dpset;
+	struct dtop_data_point *dp;
+	int64_t time_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+	uint8_t *bitmap;
+	uint64_t raw, delta;
+	uint32_t col;
+	char *pos;
+	int i;
+
+	if (bw->len[bw->active] + bw->max_record > bw->block_size &&
+	    dtop_bin_swap(bw) == FILE_ERROR)
+		return FILE_ERROR;
+	pos = bw->buf[bw->active] + bw->len[bw->active];
+
+	/* Type records go first, gen dpgs switch to DTOP_LONG on the fly */
+	col = 0;
+	for (curr_ptr = dpg_list; curr_ptr; curr_ptr = curr_ptr->next_ptr) {
+		dpset = (struct dtop_data_point_gatherer *) curr_ptr->data;
+		for (i = 0; i < dpset->data_points_len; i++, col++) {
+			dp = &dpset->data_points[i];
+			if (bw->types[col] == (uint8_t)dp->type)
+				continue;
+			bw->types[col] = dp->type;
+			memset(&bw->prev[col], 0, sizeof(bw->prev[col]));
+			*pos++ = DTOP_BIN_REC_TYPE;
+			dtop_bin_put(&pos, &col, sizeof(col));
+			*pos++ = bw->types[col];
+		}
+	}
+
+	*pos++ = DTOP_BIN_REC_POLL;
+	dtop_bin_put(&pos, &time_us, sizeof(time_us));
+	dtop_bin_put(&pos, &poll_wall_us, sizeof(poll_wall_us));
+	dtop_bin_put(&pos, &poll_cpu_us, sizeof(poll_cpu_us));
+	bitmap = (uint8_t *)pos;
+	memset(bitmap, 0, bw->bitmap_len);
+	pos += bw->bitmap_len;
+
+	col = 0;
+	for (curr_ptr = dpg_list; curr_ptr; curr_ptr = curr_ptr->next_ptr) {
+		dpset = (struct dtop_data_point_gatherer *) curr_ptr->data;
+		for (i = 0; i < dpset->data_points_len; i++, col++) {
+			dp = &dpset->data_points[i];
+			if (dp->type == DTOP_STR) {
+				if (!memcmp(bw->prev[col].d_str, dp->data.d_str,
+					    DTOP_BIN_STR_WIDTH))
+					continue;
+				memcpy(bw->prev[col].d_str, dp->data.d_str,
+				       DTOP_BIN_STR_WIDTH);
+				dtop_bin_put(&pos, dp->data.d_str,
+					     DTOP_BIN_STR_WIDTH);
+			} else {
+				raw = dtop_bin_raw_value(dp);
+				delta = raw - bw->prev[col].d_ulong;
+				if (!delta)
+					continue;
+				bw->prev[col].d_ulong = raw;
+				dtop_bin_put(&pos, &delta, DTOP_BIN_NUM_WIDTH);
+			}
+			bitmap[col / 8] |= 1 << (col % 8);
+		}
+	}
+
+	bw->len[bw->active] = pos - bw->buf[bw->active];
+	return FILE_SUCCESS;
+}
+
+/**
+ * @brief Flushes and finishes a binary capture.
+ *
+ * The file itself is left open for the caller to close.
+ *
+ * @param bw Writer returned by dtop_bin_open(), freed by this call.
+ * @param bytes If not NULL, set to the size of the capture.
+ * @return FILE_ERROR - Writing to file was unsuccessful.
+ * @return FILE_SUCCESS - Writing to file was successful.
+ */
+int dtop_bin_close(struct dtop_bin_writer *bw, uint64_t *bytes)
+{
+	int error = 0;
+
+	if (bw->len[bw->active] > 0 && dtop_bin_swap(bw) == FILE_ERROR)
+		error = 1;
+
+	pthread_mutex_lock(&bw->lock);
+	bw->quit = 1;
+	pthread_cond_broadcast(&bw->cond);
+	pthread_mutex_unlock(&bw->lock);
+	pthread_join(bw->thread, NULL);
+
+	error |= bw->error;
+	if (bytes)
+		*bytes = bw->bytes;
+
+	pthread_cond_destroy(&bw->cond);
+	pthread_mutex_destroy(&bw->lock);
+	free(bw->buf[0]);
+	free(bw->buf[1]);
+	free(bw->prev);
+	free(bw->types);
+	free(bw);
+
+	return error ? FILE_ERROR : FILE_SUCCESS;
+}
+
+/**
+ * @brief Reads the header of a binary capture.
+ *
+ * @param br Reader to set up.
+ * @param fr Capture to read.
+ * @return FILE_SUCCESS - Header read, polls can be read.
+ * @return FILE_ERROR - Not a readable capture.
+ */
+int dtop_bin_read_header(struct dtop_bin_reader *br, FILE *fr)
+{
+	char magic[DTOP_BIN_MAGIC_LEN];
+	uint32_t version, byte_order, names_len;
+	uint8_t type;
+	uint32_t i;
+
+	memset(br, 0, sizeof(*br));
+	br->fr = fr;
+
+	if (fread(magic, sizeof(magic), 1, fr) != 1 ||
+	    memcmp(magic, DTOP_BIN_MAGIC, DTOP_BIN_MAGIC_LEN) ||
+	    fread(&version, sizeof(version), 1, fr) != 1 ||
+	    fread(&byte_order, sizeof(byte_order), 1, fr) != 1 ||
+	    fread(&br->columns, sizeof(br->columns), 1, fr) != 1 ||
+	    fread(&names_len, sizeof(names_len), 1, fr) != 1) {
+		fprintf(stderr, "Not a datatop binary capture\n");
+		return FILE_ERROR;
+	}
+
+	if (version != DTOP_BIN_VERSION) {
+		fprintf(stderr, "Unsupported capture version %u\n", version);
+		return FILE_ERROR;
+	}
+
+	if (byte_order != DTOP_BIN_BYTE_ORDER) {
+		fprintf(stderr, "Capture was written on a host with ");
+		fprintf(stderr, "different byte order\n");
+		return FILE_ERROR;
+	}
+
+	br->names = malloc(names_len + 1);
+	br->data_points = calloc(br->columns + 1, sizeof(*br->data_points));
+	br->changed = malloc(br->columns / 8 + 1);
+	if (!br->names || !br->data_points || !br->changed) {
+		fprintf(stderr, "%s(): malloc failed\n", __func__);
+		return FILE_ERROR;
+	}
+
+	if (fread(br->names, 1, names_len, fr) != names_len) {
+		fprintf(stderr, "Truncated capture header\n");
+		return FILE_ERROR;
+	}
+	br->names[names_len] = 0;
+
+	for (i = 0; i < br->columns; i++) {
+		if (fread(&type, 1, 1, fr) != 1) {
+			fprintf(stderr, "Truncated capture header\n");
+			return FILE_ERROR;
+		}
+		br->data_points[i].type = type;
+		br->data_points[i].name = "";
+		br->data_points[i].initial_data_populated = NOT_POPULATED;
+	}
+
+	return FILE_SUCCESS;
+}
+
+/**
+ * @brief Reads the next poll of a binary capture.
+ *
+ * Applies any type records and the deltas of the poll to br->data_points.
+ *
+ * @param br Reader set up by dtop_bin_read_header().
+ * @return DTOP_BIN_REC_READY - br holds the values of the next poll.
+ * @return DTOP_BIN_REC_NONE - End of capture.
+ * @return FILE_ERROR - Capture is corrupt or truncated.
+ */
+int dtop_bin_read_poll(struct dtop_bin_reader *br)
+{
+	struct dtop_data_point *dp;
+	uint32_t bitmap_len = (br->columns + 7) / 8;
+	uint64_t delta;
+	uint32_t col;
+	uint8_t type;
+	int kind;
+
+	while ((kind = fgetc(br->fr)) == DTOP_BIN_REC_TYPE) {
+		if (fread(&col, sizeof(col), 1, br->fr) != 1 ||
+		    fread(&type, 1, 1, br->fr) != 1 || col >= br->columns)
+			goto corrupt;
+		dp = &br->data_points[col];
+		dp->type = type;
+		memset(&dp->data, 0, sizeof(dp->data));
+	}
+
+	if (kind == EOF)
+		return DTOP_BIN_REC_NONE;
+	if (kind != DTOP_BIN_REC_POLL)
+		goto corrupt;
+
+	if (fread(&br->time_us, sizeof(br->time_us), 1, br->fr) != 1 ||
+	    fread(&br->poll_wall_us, sizeof(br->poll_wall_us), 1,
+		  br->fr) != 1 ||
+	    fread(&br->poll_cpu_us, sizeof(br->poll_cpu_us), 1,
+		  br->fr) != 1 ||
+	    fread(br->changed, 1, bitmap_len, br->fr) != bitmap_len)
+		goto corrupt;
+
+	for (col = 0; col < br->columns; col++) {
+		if (!(br->changed[col / 8] & (1 << (col % 8))))
+			continue;
+		dp = &br->data_points[col];
+		if (dp->type == DTOP_STR) {
+			if (fread(dp->data.d_str, DTOP_BIN_STR_WIDTH, 1,
+				  br->fr) != 1)
+				goto corrupt;
+		} else {
+			if (fread(&delta, DTOP_BIN_NUM_WIDTH, 1, br->fr) != 1)
+				goto corrupt;
+			dtop_bin_set_raw_value(dp,
+					dtop_bin_raw_value(dp) + delta);
+		}
+	}
+
+	return DTOP_BIN_REC_READY;
+
+corrupt:
+	fprintf(stderr, "Capture is corrupt or truncated\n");
+	return FILE_ERROR;
+}
+
+/**
+ * @brief Frees memory allocated by dtop_bin_read_header().
+ *
+ * @param br Reader to free the state of. The file is not closed.
+ */
+void dtop_bin_reader_free(struct dtop_bin_reader *br)
+{
+	free(br->names);
+	free(br->data_points);
+	free(br->changed);
+	br->names = NULL;
+	br->data_points = NULL;
+	br->changed = NULL;
+}
@@ -0,0 +1,119 @@
+/************************************************************************
+Copyright (c) 2015, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************/
+
+/**
+ * @file datatop_binary.h
+ * @brief Declares the binary capture writer and reader.
+ *
+ * A binary capture starts with a header holding the CSV header line and
+ * the type of every column. Each poll is then stored as a record with a
+ * bitmap of the columns that changed, followed by a fixed-width delta for
+ * each of them.
+ *
+ * Header:  magic[8] version:u32 byte_order:u32 columns:u32
+ *          names_len:u32 names[names_len] types[columns]:u8
+ * Poll:    'P' time_us:i64 poll_wall_us:i64 poll_cpu_us:i64
+ *          changed[(columns + 7) / 8]:u8 then per changed column either
+ *          a u64 delta or, for DTOP_STR columns, the new string
+ * Type:    'T' column:u32 type:u8, precedes the poll it applies to
+ *
+ * All fields are in host byte order, byte_order tells a reader on a
+ * different host that the capture is not readable as is.
+ */
+
+#ifndef DATATOP_BINARY_H
+#define DATATOP_BINARY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "datatop_interface.h"
+#include "datatop_linked_list.h"
+
+#define DTOP_BIN_MAGIC       "DTOPBIN"
+#define DTOP_BIN_MAGIC_LEN   8
+#define DTOP_BIN_VERSION     1
+#define DTOP_BIN_BYTE_ORDER  0x01020304
+#define DTOP_BIN_REC_POLL    'P'
+#define DTOP_BIN_REC_TYPE    'T'
+#define DTOP_BIN_NUM_WIDTH   8
+#define DTOP_BIN_STR_WIDTH   DTOP_DP_MAX_STR_LEN
+#define DTOP_BIN_BLOCK_SIZE  (256 * 1024)
+
+#define DTOP_BIN_REC_NONE    0
+#define DTOP_BIN_REC_READY   1
+
+struct dtop_bin_writer;
+
+/**
+ * @struct dtop_bin_reader
+ * @brief State of a binary capture being read back.
+ *
+ * @var dtop_bin_reader::fr
+ * Capture being read.
+ * @var dtop_bin_reader::names
+ * CSV header line stored in the capture, null terminated.
+ * @var dtop_bin_reader::columns
+ * Number of dp columns in each poll.
+ * @var dtop_bin_reader::data_points
+ * One dp per column, holding the values of the last poll read.
+ * @var dtop_bin_reader::changed
+ * Bitmap of the columns changed by the last poll read.
+ * @var dtop_bin_reader::time_us
+ * Time of the last poll read, in microseconds since the epoch.
+ * @var dtop_bin_reader::poll_wall_us
+ * Wall clock time spent in the last poll read.
+ * @var dtop_bin_reader::poll_cpu_us
+ * CPU time spent in the last poll read.
+ */
+struct dtop_bin_reader {
+	FILE *fr;
+	char *names;
+	uint32_t columns;
+	struct dtop_data_point *data_points;
+	uint8_t *changed;
+	int64_t time_us;
+	int64_t poll_wall_us;
+	int64_t poll_cpu_us;
+};
+
+struct dtop_bin_writer *dtop_bin_open(FILE *fw,
+				      struct dtop_linked_list *dpg_list,
+				      const char *names, size_t names_len);
+int dtop_bin_write_poll(struct dtop_bin_writer *bw,
+			struct dtop_linked_list *dpg_list,
+			const struct timeval *tv,
+			int64_t poll_wall_us, int64_t poll_cpu_us);
+int dtop_bin_close(struct dtop_bin_writer *bw, uint64_t *bytes);
+
+int dtop_bin_read_header(struct dtop_bin_reader *br, FILE *fr);
+int dtop_bin_read_poll(struct dtop_bin_reader *br);
+void dtop_bin_reader_free(struct dtop_bin_reader *br);
+
+#endif /* DATATOP_BINARY_H */
@@ -132,6 +132,7 @@ static void construct_cpu_stat_dpg(char *name)
 	dpg->data_points = dp;
 	dpg->data_points_len = 1;
 	dpg->deconstruct = dtop_value_only_dpg_deconstructor;
+	dt_file_open(&dpg->source, file, DTOP_GEN_LINE);
 
 	dtop_register(dpg);
 }
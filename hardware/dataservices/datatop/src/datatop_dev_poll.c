@@ -36,6 +36,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include "datatop_interface.h"
@@ -44,6 +45,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define DTOP_DEV_SIZE 8192
 #define DTOP_DEV_LINE (DTOP_DEV_SIZE>>2)
+#define DTOP_DEV_VALUES 16
 
 /**
 * @struct dtop_dev_vars
@@ -99,68 +101,75 @@ static void dt_dev_parse(char *line1, int len1,
 	}
 }
 
+/**
+ * @brief Finds the first dp of the interface a "/proc/net/dev" line is for.
+ *
+ * @param dpg Dpg holding the dps of the file.
+ * @param line Line whose interface name is looked up.
+ * @param key_len Length of the "name:" key at the start of line.
+ * @param hint Index of the interface expected for this line.
+ * @return Index of the first of the interface's dps, -1 if unknown.
+ */
+static int dt_dev_find_dp(struct dtop_data_point_gatherer *dpg,
+			  const char *line, int key_len, int hint)
+{
+	int i;
+
+	if (hint < dpg->data_points_len &&
+	    dt_match_key(dpg->data_points[hint].name, line, key_len))
+		return hint;
+
+	for (i = 0; i < dpg->data_points_len; i += DTOP_DEV_VALUES)
+		if (dt_match_key(dpg->data_points[i].name, line, key_len))
+			return i;
+	return -1;
+}
+
 /**
  * @brief Stores the data collected from "/proc/net/dev"
  *
+ * Tokenizes the file in place. Rows are matched to their dps by interface
+ * name, so interfaces coming and going do not shift other rows.
+ *
  * @param dpg Struct that polled data is added to.
  * @return DTOP_POLL_IO_ERR - Poll of dpg unsuccessful.
  * @return DTOP_POLL_OK - Poll of dpg successful.
  */
 int dtop_dev_poll(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
-	int *line_len = malloc(sizeof(int) *
-			((struct dtop_dev_vars *)
-			(dpg->priv))->line_count);
-	int read;
-	struct dt_procdict *dict = malloc(sizeof(struct dt_procdict)
-					*((struct dtop_dev_vars *)
-					(dpg->priv))->line_count-2);
-	int j, n, sum;
-	int index = 0;
-	int dp = 0;
+	char *pos = dpg->source.buf;
+	char *line;
+	const char *p;
+	uint64_t val;
+	int j, dp, key_len;
+	int n = 0;
+	int next = 0;
 
-	read = dt_read_file(dpg->file, &data, DTOP_DEV_SIZE);
-	if (read == 0 || data == 0)
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
 		return DTOP_POLL_IO_ERR;
 
-	sum = 0;
-	/* Assigns each line read from the file, a length */
-	for (n = 0; n < ((struct dtop_dev_vars *)
-				(dpg->priv))->line_count; n++) {
-		line_len[n] = dt_read_line(((struct dtop_dev_vars *)
-					(dpg->priv))->line[n],
-					   DTOP_DEV_LINE, data,
-					   DTOP_DEV_SIZE, sum);
-		if (n <= (((struct dtop_dev_vars *)
-			(dpg->priv))->line_count - 1)) {
-			sum += (line_len[n] + 1);
-		}
-
-	}
+	while (dt_next_line(&pos, &line) >= 0) {
+		/* The first two lines are column headers */
+		if (n++ < 2)
+			continue;
 
-	for (n = 2; n < ((struct dtop_dev_vars *)
-			(dpg->priv))->line_count; n++) {
-		dt_dev_parse(((struct dtop_dev_vars *)
-				(dpg->priv))->line[n], line_len[n],
-					index, &dict[index]);
-		index++;
-	}
+		while (*line == ' ' || *line == '	')
+			line++;
+		p = strchr(line, ':');
+		if (!p)
+			continue;
+		key_len = p - line + 1;
 
+		dp = dt_dev_find_dp(dpg, line, key_len, next);
+		if (dp < 0)
+			continue;
+		next = dp + DTOP_DEV_VALUES;
 
-	/* Assigns the dp value to the dp struct */
-	for (n = 2; n < ((struct dtop_dev_vars *)
-			(dpg->priv))->line_count; n++) {
-		for (j = 0; j < 16; j++) {
-			dtop_store_dp(&(dpg->data_points[dp]),
-						dict[n-2].val[j]);
-			dp++;
-		}
+		p = line + key_len;
+		for (j = 0; j < DTOP_DEV_VALUES && dt_next_u64(&p, &val); j++)
+			dtop_store_dp_ulong(&(dpg->data_points[dp + j]), val);
 	}
 
-	dt_free(&data);
-	free(line_len);
-	free(dict);
 	return DTOP_POLL_OK;
 }
 
@@ -190,6 +199,7 @@ static void dtop_dev_dpg_deconstructor
 		free(((struct dtop_dev_vars *)(dpset->priv))->line[i]);
 	free(((struct dtop_dev_vars *)(dpset->priv))->line);
 	free(((struct dtop_dev_vars *)(dpset->priv)));
+	dt_file_close(&dpset->source);
 	free(dpset);
 }
 
@@ -215,6 +225,7 @@ static void construct_dev_file_dpg(struct dtop_dev_vars *storage,
 	dpg->priv = (struct dtop_dev_vars *)storage;
 	dpg->data_points_len = dp_count;
 	dpg->deconstruct = dtop_dev_dpg_deconstructor;
+	dt_file_open(&dpg->source, "/proc/net/dev", DTOP_DEV_SIZE);
 
 	dtop_register(dpg);
 }
@@ -56,11 +56,17 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 * Array of strings where necessary dp names and values are held.
 * @var dtop_dual_line_vars::line_count
 * Number of lines the file is that the dpg represents.
+* @var dtop_dual_line_vars::dict
+* One dictionary per pair of lines, reused on every poll.
+* @var dtop_dual_line_vars::prefix
+* Prefix of each pair of lines, pointing into the dpg read buffer.
 */
 struct dtop_dual_line_vars {
 	char **line;
 	char **line2;
 	int line_count;
+	struct dt_procdict *dict;
+	char **prefix;
 };
 
 /**
@@ -72,86 +78,48 @@ struct dtop_dual_line_vars {
  */
 int dtop_dual_line_poll(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
-	int *line_len = malloc(sizeof(int) *
-			((struct dtop_dual_line_vars *)
-			(dpg->priv))->line_count);
-	int *line_len2 = malloc(sizeof(int) *
-			((struct dtop_dual_line_vars *)
-			(dpg->priv))->line_count);
-	int read;
-
-	struct dt_procdict *dict = malloc(sizeof(struct dt_procdict)
-					* (((struct dtop_dual_line_vars *)
-					(dpg->priv))->line_count/2));
-	struct dt_procdict *prefix_dict = malloc(sizeof(struct dt_procdict)
-					* (((struct dtop_dual_line_vars *)
-					(dpg->priv))->line_count/2));
-	int i, j, k, n, sum, sum2;
-
-	read = dt_read_file(dpg->file, &data, DTOP_DUAL_SIZE);
-	if (read == 0 || data == 0)
+	struct dtop_dual_line_vars *storage = dpg->priv;
+	struct dt_procdict *dict = storage->dict;
+	char *pos = dpg->source.buf;
+	char *key_line, *val_line, *colon;
+	int key_len, val_len;
+	int i, j, k, pairs;
+
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
 		return DTOP_POLL_IO_ERR;
 
-	sum = 0;
-	sum2 = 0;
-	/* Assigns each line read from the file, a length */
-	for (n = 0; n < ((struct dtop_dual_line_vars *)
-				(dpg->priv))->line_count; n++) {
-		line_len[n] = dt_read_line(((struct dtop_dual_line_vars *)
-					(dpg->priv))->line[n],
-					   DTOP_DUAL_LINE, data,
-					   DTOP_DUAL_SIZE, sum);
-		line_len2[n] = dt_read_line(((struct dtop_dual_line_vars *)
-					(dpg->priv))->line2[n],
-					    DTOP_DUAL_LINE, data,
-					    DTOP_DUAL_SIZE, sum2);
-		if (n <= (((struct dtop_dual_line_vars *)
-				(dpg->priv))->line_count-2)) {
-			sum += (line_len[n] + 1);
-			sum2 += (line_len2[n] + 1);
-		}
-
-	}
-
 	/* Stores dp names and values in dictionary */
-	for (i = 0; i < (((struct dtop_dual_line_vars *)
-				(dpg->priv))->line_count/2); i++)
-		dt_parse_proc_dictionary(((struct dtop_dual_line_vars *)
-					(dpg->priv))->line[2*i],
-					  line_len[2*i],
-					  ((struct dtop_dual_line_vars *)
-					  (dpg->priv))->line[(2*i)+1],
-					  line_len[(2*i)+1],
-					  &dict[i]);
-
-	/* Stores dp prefices in dictionary */
-	for (i = 0; i < (((struct dtop_dual_line_vars *)
-				(dpg->priv))->line_count/2); i++)
-		dt_parse_for_prefix(((struct dtop_dual_line_vars *)
-				(dpg->priv))->line2[2*i], line_len2[2*i],
-				    &prefix_dict[i]);
+	pairs = 0;
+	while (pairs < storage->line_count/2) {
+		key_len = dt_next_line(&pos, &key_line);
+		val_len = dt_next_line(&pos, &val_line);
+		if (key_len < 0 || val_len < 0)
+			break;
+		dict[pairs].max = 0;
+		dt_parse_proc_dictionary(key_line, key_len, val_line, val_len,
+					 &dict[pairs]);
+		/* Key line now starts with the null terminated "Prefix:" */
+		colon = strchr(key_line, ':');
+		if (colon)
+			*colon = 0;
+		storage->prefix[pairs] = key_line;
+		pairs++;
+	}
 
 	/* Assigns a dp value to each dp struct */
-	for (k = 0; k < (((struct dtop_dual_line_vars *)
-				(dpg->priv))->line_count/2); k++) {
+	for (k = 0; k < pairs; k++) {
 		for (j = 0; j < dpg->data_points_len; j++) {
-			i =  dt_find_dict_idx(dpg->data_points[j].name,
-					      &dict[k]);
-			if (i >= 0 && i < dict[k].max &&
-				(strcmp(dpg->data_points[j].prefix,
-				prefix_dict[k].val[i]) == 0))
-
+			if (strcmp(dpg->data_points[j].prefix,
+				   storage->prefix[k]) != 0)
+				continue;
+			i = dt_find_dict_idx(dpg->data_points[j].name,
+					     &dict[k]);
+			if (i >= 0 && i < dict[k].max)
 				dtop_store_dp(&(dpg->data_points[j]),
 					      dict[k].val[i]);
 		}
 	}
 
-	dt_free(&data);
-	free(line_len);
-	free(line_len2);
-	free(dict);
-	free(prefix_dict);
 	return DTOP_POLL_OK;
 }
 
@@ -175,7 +143,10 @@ static void dtop_dual_line_dpg_deconstructor
 	}
 	free(((struct dtop_dual_line_vars *)(dpset->priv))->line);
 	free(((struct dtop_dual_line_vars *)(dpset->priv))->line2);
+	free(((struct dtop_dual_line_vars *)(dpset->priv))->dict);
+	free(((struct dtop_dual_line_vars *)(dpset->priv))->prefix);
 	free(((struct dtop_dual_line_vars *)(dpset->priv)));
+	dt_file_close(&dpset->source);
 	free(dpset);
 }
 
@@ -202,6 +173,7 @@ static void construct_dual_line_file_dpg(char *name, struct dtop_data_point
 	dpg->priv = (struct dtop_dual_line_vars *)storage;
 	dpg->data_points_len = dp_count;
 	dpg->deconstruct = dtop_dual_line_dpg_deconstructor;
+	dt_file_open(&dpg->source, name, DTOP_DUAL_SIZE);
 
 	dtop_register(dpg);
 }
@@ -289,12 +261,15 @@ int dtop_dual_line_search(char *name, struct dtop_dual_line_vars *storage)
 			k++;
 		}
 
+	/* The dictionaries are reused by every poll */
+	storage->dict = dict;
+	storage->prefix = malloc(sizeof(char *) * (storage->line_count/2));
+
 	/* Calls dpg constructor, dpg will point to the dp struct */
 	construct_dual_line_file_dpg(name, data_points, storage, dp_count);
 
 	free(line_len);
 	free(line_len2);
-	free(dict);
 	free(prefix_dict);
 	dt_free(&data);
 
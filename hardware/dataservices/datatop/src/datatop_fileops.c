@@ -40,7 +40,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include "datatop_interface.h"
 #include "datatop_linked_list.h"
 #include "datatop_opt.h"
@@ -92,6 +94,140 @@ void dt_free(char **buffer)
 	*buffer = 0;
 }
 
+/* Descriptors left free for output files, popen() and directory scans */
+#define DT_FILE_FD_RESERVE 64
+
+/**
+ * @brief Reports a failure on a polled file once.
+ *
+ * Missing files (e.g. cpufreq nodes of an offline CPU) are expected and
+ * are not reported.
+ *
+ * @param f File the error happened on.
+ * @param file Path of the file.
+ * @param what Operation that failed.
+ */
+static void dt_file_report(struct dt_file *f, const char *file,
+			   const char *what)
+{
+	if (f->reported || errno == ENOENT || errno == ENODEV)
+		return;
+	fprintf(stderr, "Failed to %s %s: %s\n", what, file, strerror(errno));
+	f->reported = 1;
+}
+
+/**
+ * @brief Opens a file which is polled and allocates its read buffer.
+ *
+ * The descriptor is kept open so that every poll is a single pread()
+ * into the same buffer. If the file can not be opened now it will be
+ * retried on the next dt_file_read(). Once the open file limit is close,
+ * files are opened on every poll instead of being held open.
+ *
+ * @param f Handle to initialize.
+ * @param file Path of the file.
+ * @param len Size of the read buffer.
+ * @return FILE_SUCCESS - Buffer allocated.
+ * @return FILE_ERROR - Buffer could not be allocated.
+ */
+int dt_file_open(struct dt_file *f, const char *file, int len)
+{
+	struct rlimit rl;
+
+	f->persist = 1;
+	f->reported = 0;
+	f->size = len;
+	f->buf = malloc(len);
+	if (!f->buf) {
+		fprintf(stderr, "%s(): malloc(%d) failed\n", __func__, len);
+		f->fd = -1;
+		return FILE_ERROR;
+	}
+	f->buf[0] = 0;
+
+	f->fd = open(file, O_RDONLY | O_CLOEXEC);
+	if (f->fd < 0) {
+		if (errno == EMFILE)
+			f->persist = 0;
+	} else if (getrlimit(RLIMIT_NOFILE, &rl) == 0 &&
+		   rl.rlim_cur != RLIM_INFINITY &&
+		   (rlim_t)f->fd + DT_FILE_FD_RESERVE >= rl.rlim_cur) {
+		close(f->fd);
+		f->fd = -1;
+		f->persist = 0;
+	}
+
+	return FILE_SUCCESS;
+}
+
+/**
+ * @brief Re-reads a polled file from the start into its buffer.
+ *
+ * The buffer is always null terminated. On a read error the descriptor
+ * is dropped and the file is reopened on the next poll, which covers
+ * sysfs nodes that are removed and recreated on CPU hotplug.
+ *
+ * @param f Handle set up by dt_file_open().
+ * @param file Path of the file, used to (re)open it.
+ * @return Number of bytes placed in f->buf.
+ */
+int dt_file_read(struct dt_file *f, const char *file)
+{
+	int fd = f->fd;
+	int len = 0;
+	ssize_t rc = 0;
+
+	if (!f->buf)
+		return 0;
+
+	if (fd < 0) {
+		fd = open(file, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			dt_file_report(f, file, "open");
+			f->buf[0] = 0;
+			return 0;
+		}
+		if (f->persist)
+			f->fd = fd;
+	}
+
+	while (len < f->size - 1) {
+		rc = pread(fd, f->buf + len, f->size - 1 - len, len);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			break;
+		len += rc;
+	}
+	f->buf[len] = 0;
+
+	if (rc < 0) {
+		dt_file_report(f, file, "read");
+		close(fd);
+		f->fd = -1;
+		return 0;
+	}
+
+	if (f->fd != fd)
+		close(fd);
+
+	return len;
+}
+
+/**
+ * @brief Closes a polled file and frees its read buffer.
+ *
+ * @param f Handle set up by dt_file_open().
+ */
+void dt_file_close(struct dt_file *f)
+{
+	if (f->fd >= 0)
+		close(f->fd);
+	f->fd = -1;
+	free(f->buf);
+	f->buf = 0;
+}
+
 /**
  * @brief Checks for access to a file for writing.
  *
@@ -191,6 +327,8 @@ int dtop_get_file_line_amount(char *name)
 	signed char rc = 0;
 	int line_count = 0;
 	FILE *file = fopen(name, "r");
+	if (!file)
+		return 0;
 	while (rc != EOF) {
 		if (rc == '\n')
 			line_count++;
@@ -41,6 +41,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 int dt_read_file(const char *file, char **buffer, int len);
 void dt_free(char **buffer);
+int dt_file_open(struct dt_file *f, const char *file, int len);
+int dt_file_read(struct dt_file *f, const char *file);
+void dt_file_close(struct dt_file *f);
 int dtop_check_writefile_access(char *fw);
 int dtop_check_out_dir_presence(char *fw);
 int dtop_create_dir(char *full_path);
@@ -60,23 +60,17 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 static int get_number_of_values(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
-	int read;
-	char line[DTOP_GEN_LINE];
+	char *pos = dpg->source.buf;
+	char *line;
 	int line_len;
 	int i, num;
 
-	read = dt_read_file(dpg->file, &data, DTOP_GEN_SIZE);
-	line_len = dt_read_line(line, DTOP_GEN_LINE, data, DTOP_GEN_SIZE, 0);
-
-	if (read == 0) {
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
 		return 0;
-	}
 
-	if (line_len < 1) {
-		dt_free(&data);
+	line_len = dt_next_line(&pos, &line);
+	if (line_len < 1)
 		return 0;
-	}
 
 	num = 1;
 	for (i = 0; i < line_len; i++) {
@@ -85,7 +79,6 @@ static int get_number_of_values(struct dtop_data_point_gatherer *dpg)
 			num++;
 	}
 
-	dt_free(&data);
 	return num;
 }
 
@@ -98,28 +91,27 @@ static int get_number_of_values(struct dtop_data_point_gatherer *dpg)
  */
 int dtop_gen_poll(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
-	int read;
-	char line[DTOP_GEN_LINE];
+	char *pos = dpg->source.buf;
+	char *line;
 	int line_len;
 	struct dt_procdict dict;
 	int i;
 
-	read = dt_read_file(dpg->file, &data, DTOP_GEN_SIZE);
-	line_len = dt_read_line(line, DTOP_GEN_LINE, data, DTOP_GEN_SIZE, 0);
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
+		return DTOP_POLL_IO_ERR;
 
-	if (read == 0 || data == 0)
+	line_len = dt_next_line(&pos, &line);
+	if (line_len < 0)
 		return DTOP_POLL_IO_ERR;
 
 	dt_single_line_parse(line, line_len, &dict);
 
-	for (i = 0; i < dpg->data_points_len; i++) {
+	for (i = 0; i < dpg->data_points_len && i < dict.max; i++) {
 		if (dict.val[i][0] == '-')
 			dpg->data_points[i].type = DTOP_LONG;
 		dtop_store_dp(&(dpg->data_points[i]), dict.val[i]);
 	}
 
-	dt_free(&data);
 	return DTOP_POLL_OK;
 }
 
@@ -137,6 +129,7 @@ static void dtop_gen_dpg_deconstructor(struct dtop_data_point_gatherer *dpset)
 	for (i = 0; i < dpset->data_points_len; i++)
 		free(dpset->data_points[i].name);
 	free(dpset->data_points);
+	dt_file_close(&dpset->source);
 	free(dpset->file);
 	free(dpset->prefix);
 	free(dpset);
@@ -169,6 +162,7 @@ static void dpg_construction(char *dir, char *name)
 	dpg->file = both;
 	dpg->poll = dtop_gen_poll;
 	dpg->deconstruct = dtop_gen_dpg_deconstructor;
+	dt_file_open(&dpg->source, dpg->file, DTOP_GEN_LINE);
 	num = get_number_of_values(dpg);
 
 	if (num != 0) {
@@ -204,6 +198,7 @@ static void dpg_construction(char *dir, char *name)
 
 		dtop_register(dpg);
 	} else {
+		dt_file_close(&dpg->source);
 		free(dpg->prefix);
 		free(dpg->file);
 		free(dpg);
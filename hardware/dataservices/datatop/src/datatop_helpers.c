@@ -371,6 +371,21 @@ void dtop_store_dp(struct dtop_data_point *dp, const char *str)
 	}
 }
 
+/**
+ * @brief Stores an already parsed value for a DTOP_ULONG datapoint.
+ *
+ * @param dp A datapoint whose value will be stored.
+ * @param val Value of the dp.
+ */
+void dtop_store_dp_ulong(struct dtop_data_point *dp, uint64_t val)
+{
+	dp->data.d_ulong = val;
+	if (dp->initial_data_populated == NOT_POPULATED) {
+		dp->initial_data.d_ulong = val;
+		dp->initial_data_populated = POPULATED;
+	}
+}
+
 /**
  * @brief Responsible for calculating and printing current time to file.
  *
@@ -114,6 +114,30 @@ struct dtop_data_point {
 	char skip;
 };
 
+/**
+ * @struct dt_file
+ * @brief Source file of a dpg that is kept open between polls.
+ *
+ * @var dt_file::fd
+ * Descriptor held open across polls, -1 when not currently open.
+ * @var dt_file::persist
+ * Zero if the descriptor could not be held open (e.g. EMFILE) and the
+ * file has to be opened on every poll instead.
+ * @var dt_file::reported
+ * Set once an error for this file has been printed.
+ * @var dt_file::buf
+ * Buffer the file is read into, allocated once when the dpg is created.
+ * @var dt_file::size
+ * Size of buf in bytes, including room for the terminating null.
+ */
+struct dt_file {
+	int fd;
+	int persist;
+	int reported;
+	char *buf;
+	int size;
+};
+
 /**
  * @struct dtop_data_point_gatherer
  * @brief Struct used to hold data about a set of collected data.
@@ -130,6 +154,8 @@ struct dtop_data_point {
  * Pointer to a dtop_data_point struct (dp).
  * @var dtop_data_point_gatherer::data_points_len
  * Number of elements in the array of dp's the dpg accesses.
+ * @var dtop_data_point_gatherer::source
+ * Persistent handle and read buffer for file.
  */
 struct dtop_data_point_gatherer {
 	char *prefix;
@@ -140,12 +166,15 @@ struct dtop_data_point_gatherer {
 	struct dtop_data_point *data_points;
 	int data_points_len;
 
+	struct dt_file source;
+
 	/* Private data */
 	void *priv;
 };
 
 void dtop_register(struct dtop_data_point_gatherer *dpg);
 void dtop_store_dp(struct dtop_data_point *dp, const char *str);
+void dtop_store_dp_ulong(struct dtop_data_point *dp, uint64_t val);
 void dtop_print_dpg(struct dtop_data_point_gatherer *dpg);
 void get_snapshot_diff(struct dtop_linked_list *dpg_list);
 void dtop_print_snapshot_diff(struct dtop_linked_list *dpg_list);
@@ -33,6 +33,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
           Unlike other polls, this is intended for running as a separate
           thread as it can cause delays of > 3sec per poll
  *
+ * The iptables and ip6tables counters are read straight from the kernel
+ * with the x_tables getsockopt interface and files are copied directly,
+ * so only the ip commands still fork a shell on every poll.
  */
 
 #include <stdio.h>
@@ -40,13 +43,21 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
+#include <errno.h>
 #include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/netfilter_ipv4/ip_tables.h>
+#include <linux/netfilter_ipv6/ip6_tables.h>
 #include "datatop_interface.h"
 #include "datatop_fileops.h"
 #include "datatop_str.h"
 #include "datatop_polling.h"
 
 #define DTOP_IPTRR_POLL_PERIOD  5.00
+#define DTOP_NF_ADDR_LEN        (INET6_ADDRSTRLEN + 5)
+#define DTOP_NF_MATCH_LEN       128
 
 /**
 * @struct dtop_ip_table_vars
@@ -65,6 +76,367 @@ struct dtop_linked_list *ip_dpg_list = NULL;
 
 pthread_mutex_t dtop_ip_table_lock;
 
+/**
+ * @struct dtop_nf_table
+ * @brief Rules of an x_tables table as read from the kernel.
+ *
+ * @var dtop_nf_table::ipv6
+ * Set for an ip6tables table.
+ * @var dtop_nf_table::entries
+ * Rule entries, each followed by its matches and target.
+ * @var dtop_nf_table::size
+ * Size of entries in bytes.
+ * @var dtop_nf_table::valid_hooks
+ * Bitmap of the built in chains of the table.
+ * @var dtop_nf_table::hook_entry
+ * Offset of the first rule of each built in chain.
+ * @var dtop_nf_table::underflow
+ * Offset of the policy rule of each built in chain.
+ */
+struct dtop_nf_table {
+	int ipv6;
+	char *entries;
+	unsigned int size;
+	unsigned int valid_hooks;
+	unsigned int hook_entry[NF_INET_NUMHOOKS];
+	unsigned int underflow[NF_INET_NUMHOOKS];
+};
+
+/**
+ * @struct dtop_nf_rule
+ * @brief Family independent view of one rule entry.
+ */
+struct dtop_nf_rule {
+	const struct xt_counters *counters;
+	const struct xt_entry_target *target;
+	const char *matches;
+	const char *matches_end;
+	unsigned int next_offset;
+	const char *in;
+	const char *out;
+	unsigned int proto;
+	unsigned int invflags;
+	char src[DTOP_NF_ADDR_LEN];
+	char dst[DTOP_NF_ADDR_LEN];
+};
+
+static const char *dtop_nf_hook_names[NF_INET_NUMHOOKS] = {
+	"PREROUTING", "INPUT", "FORWARD", "OUTPUT", "POSTROUTING"
+};
+
+/**
+ * @brief Reads the rules and counters of a table.
+ *
+ * The ip6t_getinfo and ip6t_get_entries structs share the layout of their
+ * ipt counterparts, only the socket family and option level differ.
+ *
+ * @param ipv6 Set to read an ip6tables table.
+ * @param name Name of the table.
+ * @param table Filled in with the rules, entries has to be freed.
+ * @return 0 on success, -1 with errno set on failure.
+ */
+static int dtop_nf_read_table(int ipv6, const char *name,
+			      struct dtop_nf_table *table)
+{
+	struct ipt_getinfo info;
+	struct ipt_get_entries *entries;
+	int level = ipv6 ? IPPROTO_IPV6 : IPPROTO_IP;
+	socklen_t len;
+	int fd, err;
+
+	fd = socket(ipv6 ? AF_INET6 : AF_INET, SOCK_RAW, IPPROTO_RAW);
+	if (fd < 0)
+		return -1;
+
+	memset(&info, 0, sizeof(info));
+	strlcpy(info.name, name, sizeof(info.name));
+	len = sizeof(info);
+	if (getsockopt(fd, level, IPT_SO_GET_INFO, &info, &len) != 0)
+		goto error;
+
+	len = sizeof(*entries) + info.size;
+	entries = calloc(1, len);
+	if (!entries)
+		goto error;
+	strlcpy(entries->name, name, sizeof(entries->name));
+	entries->size = info.size;
+	if (getsockopt(fd, level, IPT_SO_GET_ENTRIES, entries, &len) != 0) {
+		err = errno;
+		free(entries);
+		errno = err;
+		goto error;
+	}
+	close(fd);
+
+	/* The blob is kept whole, entries points at its rule table */
+	table->ipv6 = ipv6;
+	table->entries = (char *)entries;
+	table->size = info.size;
+	table->valid_hooks = info.valid_hooks;
+	memcpy(table->hook_entry, info.hook_entry, sizeof(table->hook_entry));
+	memcpy(table->underflow, info.underflow, sizeof(table->underflow));
+	return 0;
+
+error:
+	err = errno;
+	close(fd);
+	errno = err;
+	return -1;
+}
+
+static const char *dtop_nf_rules(const struct dtop_nf_table *table)
+{
+	return (const char *)((struct ipt_get_entries *)table->entries)
+		->entrytable;
+}
+
+/**
+ * @brief Formats an address and mask as address/prefix length.
+ */
+static void dtop_nf_format_addr(int af, const void *addr, const void *mask,
+				int len, char *buf)
+{
+	const unsigned char *m = mask;
+	int i, bits = 0;
+
+	for (i = 0; i < len; i++)
+		bits += __builtin_popcount(m[i]);
+
+	if (!inet_ntop(af, addr, buf, INET6_ADDRSTRLEN))
+		strlcpy(buf, "?", DTOP_NF_ADDR_LEN);
+	snprintf(buf + strlen(buf), DTOP_NF_ADDR_LEN - strlen(buf), "/%d",
+		 bits);
+}
+
+/**
+ * @brief Decodes the rule entry at an offset of the table.
+ */
+static void dtop_nf_decode(const struct dtop_nf_table *table,
+			   unsigned int offset, struct dtop_nf_rule *rule)
+{
+	const char *e = dtop_nf_rules(table) + offset;
+	const struct ipt_entry *e4 = (const struct ipt_entry *)e;
+	const struct ip6t_entry *e6 = (const struct ip6t_entry *)e;
+
+	if (!table->ipv6) {
+		rule->counters = &e4->counters;
+		rule->target = (const void *)(e + e4->target_offset);
+		rule->matches = e + sizeof(*e4);
+		rule->matches_end = e + e4->target_offset;
+		rule->next_offset = e4->next_offset;
+		rule->in = e4->ip.iniface;
+		rule->out = e4->ip.outiface;
+		rule->proto = e4->ip.proto;
+		rule->invflags = e4->ip.invflags;
+		dtop_nf_format_addr(AF_INET, &e4->ip.src, &e4->ip.smsk,
+				    sizeof(e4->ip.smsk), rule->src);
+		dtop_nf_format_addr(AF_INET, &e4->ip.dst, &e4->ip.dmsk,
+				    sizeof(e4->ip.dmsk), rule->dst);
+	} else {
+		rule->counters = &e6->counters;
+		rule->target = (const void *)(e + e6->target_offset);
+		rule->matches = e + sizeof(*e6);
+		rule->matches_end = e + e6->target_offset;
+		rule->next_offset = e6->next_offset;
+		rule->in = e6->ipv6.iniface;
+		rule->out = e6->ipv6.outiface;
+		rule->proto = e6->ipv6.proto;
+		rule->invflags = e6->ipv6.invflags;
+		dtop_nf_format_addr(AF_INET6, &e6->ipv6.src, &e6->ipv6.smsk,
+				    sizeof(e6->ipv6.smsk), rule->src);
+		dtop_nf_format_addr(AF_INET6, &e6->ipv6.dst, &e6->ipv6.dmsk,
+				    sizeof(e6->ipv6.dmsk), rule->dst);
+	}
+}
+
+static int dtop_nf_is_error(const struct dtop_nf_rule *rule)
+{
+	return strcmp(rule->target->u.user.name, XT_ERROR_TARGET) == 0;
+}
+
+static int dtop_nf_verdict(const struct dtop_nf_rule *rule)
+{
+	return ((const struct xt_standard_target *)rule->target)->verdict;
+}
+
+static int dtop_nf_is_standard(const struct dtop_nf_rule *rule)
+{
+	return strcmp(rule->target->u.user.name, XT_STANDARD_TARGET) == 0;
+}
+
+/**
+ * @brief Names the target of a rule the way iptables -L does.
+ *
+ * Jumps are resolved to the user chain starting at the jump offset, whose
+ * name is held by the error entry right before it.
+ */
+static const char *dtop_nf_target_name(const struct dtop_nf_table *table,
+				       const struct dtop_nf_rule *rule)
+{
+	struct dtop_nf_rule prev;
+	unsigned int offset;
+	int verdict;
+
+	if (!dtop_nf_is_standard(rule))
+		return rule->target->u.user.name;
+
+	verdict = dtop_nf_verdict(rule);
+	if (verdict == XT_RETURN)
+		return "RETURN";
+	if (verdict == -NF_ACCEPT - 1)
+		return "ACCEPT";
+	if (verdict == -NF_DROP - 1)
+		return "DROP";
+	if (verdict == -NF_QUEUE - 1)
+		return "QUEUE";
+	if (verdict < 0)
+		return "?";
+
+	for (offset = 0; offset < table->size; offset += prev.next_offset) {
+		dtop_nf_decode(table, offset, &prev);
+		if (!prev.next_offset)
+			break;
+		if (offset + prev.next_offset == (unsigned int)verdict &&
+		    dtop_nf_is_error(&prev))
+			return (const char *)prev.target->data;
+	}
+	return "?";
+}
+
+static const char *dtop_nf_proto_name(unsigned int proto)
+{
+	switch (proto) {
+	case 0:
+		return "all";
+	case IPPROTO_ICMP:
+		return "icmp";
+	case IPPROTO_TCP:
+		return "tcp";
+	case IPPROTO_UDP:
+		return "udp";
+	case IPPROTO_ICMPV6:
+		return "ipv6-icmp";
+	default:
+		return NULL;
+	}
+}
+
+static void dtop_nf_print_chain_header(FILE *fo)
+{
+	fprintf(fo, "%10s %12s %-16s  %-8s  %-11s  %-11s  %-23s  %-23s %s\n",
+		"pkts", "bytes", "target", "prot", "in", "out", "source",
+		"destination", "matches");
+}
+
+/**
+ * @brief Prints a rule in the columns of iptables -L -n -v -x.
+ */
+static void dtop_nf_print_rule(FILE *fo, const struct dtop_nf_table *table,
+			       const struct dtop_nf_rule *rule)
+{
+	const struct xt_entry_match *m;
+	const char *p, *proto = dtop_nf_proto_name(rule->proto);
+	char proto_buf[16], matches[DTOP_NF_MATCH_LEN] = "";
+
+	if (!proto) {
+		snprintf(proto_buf, sizeof(proto_buf), "%u", rule->proto);
+		proto = proto_buf;
+	}
+
+	for (p = rule->matches; p < rule->matches_end; p += m->u.match_size) {
+		m = (const struct xt_entry_match *)p;
+		if (!m->u.match_size)
+			break;
+		if (matches[0])
+			strlcat(matches, " ", sizeof(matches));
+		strlcat(matches, m->u.user.name, sizeof(matches));
+	}
+
+	fprintf(fo, "%10" PRIu64 " %12" PRIu64 " %-16s %s%-8s %s%-11s %s%-11s "
+		"%s%-23s %s%-23s %s\n",
+		(uint64_t)rule->counters->pcnt, (uint64_t)rule->counters->bcnt,
+		dtop_nf_target_name(table, rule),
+		rule->invflags & XT_INV_PROTO ? "!" : " ", proto,
+		rule->invflags & IPT_INV_VIA_IN ? "!" : " ",
+		rule->in[0] ? rule->in : "*",
+		rule->invflags & IPT_INV_VIA_OUT ? "!" : " ",
+		rule->out[0] ? rule->out : "*",
+		rule->invflags & IPT_INV_SRCIP ? "!" : " ", rule->src,
+		rule->invflags & IPT_INV_DSTIP ? "!" : " ", rule->dst,
+		matches);
+}
+
+/**
+ * @brief Prints every chain of a table with its rule counters.
+ *
+ * The policy rules closing the built in chains are shown in the chain
+ * header and the return rules closing user chains are left out, as
+ * iptables -L does.
+ */
+static void dtop_nf_print_table(FILE *fo, const struct dtop_nf_table *table)
+{
+	struct dtop_nf_rule rule, next, policy;
+	unsigned int offset, h;
+	int skip;
+
+	for (offset = 0; offset < table->size; offset += rule.next_offset) {
+		dtop_nf_decode(table, offset, &rule);
+		if (!rule.next_offset)
+			break;
+
+		skip = 0;
+		for (h = 0; h < NF_INET_NUMHOOKS; h++) {
+			if (!(table->valid_hooks & (1 << h)))
+				continue;
+			if (table->hook_entry[h] == offset) {
+				dtop_nf_decode(table, table->underflow[h],
+					       &policy);
+				fprintf(fo, "\nChain %s (policy %s %" PRIu64
+					" packets, %" PRIu64 " bytes)\n",
+					dtop_nf_hook_names[h],
+					dtop_nf_target_name(table, &policy),
+					(uint64_t)policy.counters->pcnt,
+					(uint64_t)policy.counters->bcnt);
+				dtop_nf_print_chain_header(fo);
+			}
+			if (table->underflow[h] == offset)
+				skip = 1;
+		}
+
+		if (dtop_nf_is_error(&rule)) {
+			if (strcmp((const char *)rule.target->data,
+				   XT_ERROR_TARGET) != 0) {
+				fprintf(fo, "\nChain %s\n",
+					(const char *)rule.target->data);
+				dtop_nf_print_chain_header(fo);
+			}
+			continue;
+		}
+
+		if (!skip && dtop_nf_is_standard(&rule) &&
+		    dtop_nf_verdict(&rule) == XT_RETURN &&
+		    offset + rule.next_offset < table->size) {
+			dtop_nf_decode(table, offset + rule.next_offset, &next);
+			skip = dtop_nf_is_error(&next);
+		}
+
+		if (!skip)
+			dtop_nf_print_rule(fo, table, &rule);
+	}
+}
+
+static void dtop_ip_table_print_start(FILE *fo, struct tm *timeinfo)
+{
+  fprintf ( fo, "============\nStart: %s==========\n", asctime (timeinfo) );
+  fflush(fo);
+}
+
+static void dtop_ip_table_print_end(FILE *fo, struct tm *timeinfo)
+{
+  fprintf ( fo, "============\nEnd: %s==========\n\n", asctime (timeinfo) );
+  fflush(fo);
+}
+
 /**
  * @brief Perform IP table command and store it in a file
  *
@@ -83,15 +455,14 @@ int dtop_ip_table_poll(struct dtop_data_point_gatherer *dpg)
 
   if(fo == NULL)
   {
-    fprintf(stderr, "Could not fopen: %s\n", dpg->file);
+    fprintf(stderr, "Could not fopen: %s\n", dpg->prefix);
 	  return DTOP_POLL_IO_ERR;
   }
 
   time ( &rawtime );
   timeinfo = gmtime ( &rawtime );
 
-  fprintf ( fo, "============\nStart: %s==========\n", asctime (timeinfo) );
-  fflush(fo);
+  dtop_ip_table_print_start(fo, timeinfo);
 
   /* redirect stderr to output file */
   dup2(fileno(fo), 2);
@@ -108,12 +479,98 @@ int dtop_ip_table_poll(struct dtop_data_point_gatherer *dpg)
     fputs(buf, fo);
   }
 
-  fprintf ( fo, "============\nEnd: %s==========\n\n", asctime (timeinfo) );
-  fflush(fo);
+  dtop_ip_table_print_end(fo, timeinfo);
   pclose(fd);
 	return DTOP_POLL_OK;
 }
 
+/**
+ * @brief Stores the rule counters of an iptables or ip6tables table.
+ *
+ * Reads the table named by the -t argument of the command from the kernel.
+ * When that is not possible, for instance without CAP_NET_ADMIN, the dpg
+ * falls back to running the command from then on.
+ *
+ * @param dpg Struct that polled data is added to.
+ * @return DTOP_POLL_IO_ERR - Poll of dpg unsuccessful.
+ * @return DTOP_POLL_OK - Poll of dpg successful.
+ */
+static int dtop_ip_table_nf_poll(struct dtop_data_point_gatherer *dpg)
+{
+	const char *command = dpg->priv;
+	const char *table_arg = strstr(command, "-t ");
+	FILE *fo = (FILE *)dpg->file;
+	char name[XT_TABLE_MAXNAMELEN] = "filter";
+	struct dtop_nf_table table;
+	struct tm *timeinfo;
+	time_t rawtime;
+	size_t len;
+
+	if (!fo)
+		return dtop_ip_table_poll(dpg);
+
+	if (table_arg) {
+		table_arg += strlen("-t ");
+		len = strcspn(table_arg, " ");
+		if (len >= sizeof(name))
+			len = sizeof(name) - 1;
+		memcpy(name, table_arg, len);
+		name[len] = '\0';
+	}
+
+	if (dtop_nf_read_table(!strncmp(command, "ip6tables", 9), name,
+			       &table) != 0) {
+		fprintf(stderr, "Could not read %s counters: %s, running %s\n",
+			name, strerror(errno), command);
+		dpg->poll = dtop_ip_table_poll;
+		return dtop_ip_table_poll(dpg);
+	}
+
+	time(&rawtime);
+	timeinfo = gmtime(&rawtime);
+	dtop_ip_table_print_start(fo, timeinfo);
+	dtop_nf_print_table(fo, &table);
+	dtop_ip_table_print_end(fo, timeinfo);
+	free(table.entries);
+	return DTOP_POLL_OK;
+}
+
+/**
+ * @brief Copies the file named by a cat command to the output file.
+ *
+ * @param dpg Struct that polled data is added to.
+ * @return DTOP_POLL_IO_ERR - Poll of dpg unsuccessful.
+ * @return DTOP_POLL_OK - Poll of dpg successful.
+ */
+static int dtop_ip_table_cat_poll(struct dtop_data_point_gatherer *dpg)
+{
+	const char *path = (char *)dpg->priv + strlen("cat ");
+	FILE *fo = (FILE *)dpg->file;
+	FILE *fi;
+	char buf[1001];
+	struct tm *timeinfo;
+	time_t rawtime;
+
+	if (!fo)
+		return dtop_ip_table_poll(dpg);
+
+	time(&rawtime);
+	timeinfo = gmtime(&rawtime);
+	dtop_ip_table_print_start(fo, timeinfo);
+
+	fi = fopen(path, "r");
+	if (!fi) {
+		fprintf(fo, "%s: %s\n", path, strerror(errno));
+	} else {
+		while (fgets(buf, sizeof(buf), fi) != NULL)
+			fputs(buf, fo);
+		fclose(fi);
+	}
+
+	dtop_ip_table_print_end(fo, timeinfo);
+	return DTOP_POLL_OK;
+}
+
 /**
  * @brief Frees dynamically allocated IP table dpg.
  *
@@ -273,7 +730,13 @@ static void construct_ip_table_dpg(char *command)
   }
 
 	dpg->prefix = file_name;
-	dpg->poll = dtop_ip_table_poll;
+	if (!strncmp(command, "iptables ", 9) ||
+	    !strncmp(command, "ip6tables ", 10))
+		dpg->poll = dtop_ip_table_nf_poll;
+	else if (!strncmp(command, "cat ", 4))
+		dpg->poll = dtop_ip_table_cat_poll;
+	else
+		dpg->poll = dtop_ip_table_poll;
 	dpg->priv = (char *)command;
   dpg->file = NULL;
 	dpg->deconstruct = dtop_ip_table_dpg_deconstructor;
@@ -62,103 +62,66 @@ struct dtop_meminfo_vars {
 };
 
 /**
- * @brief Parses lines with data in "/proc/meminfo"
+ * @brief Finds the dp a "/proc/meminfo" line belongs to.
  *
- * @param line1 Line to parse to find datapoint names and values.
- * @param len1 Length of line1.
- * @param l Index in the dictionary the key/value pair is added to.
- * @param dict Dictionary the keys and values are added to.
+ * @param dpg Dpg holding the dps of the file.
+ * @param line Line whose key is looked up.
+ * @param key_len Length of the key at the start of line.
+ * @param hint Index of the dp expected for this line.
+ * @return Index of the dp, -1 if the key is unknown.
  */
-int dt_meminfo_parse(char *line1, int len1,
-			int l, struct dt_procdict *dict)
+static int dt_meminfo_find_dp(struct dtop_data_point_gatherer *dpg,
+			      const char *line, int key_len, int hint)
 {
-	int i, k, n;
-	if (len1 < 1)
-		return 0;
+	int i;
 
-	if (line1 == 0 || dict == 0)
-		return 0;
+	if (hint < dpg->data_points_len &&
+	    dt_match_key(dpg->data_points[hint].name, line, key_len))
+		return hint;
 
-	k = l;
-	dict->key[k] = &line1[0];
-	for (i = 0; i < len1 && k < DTOP_DICT_SIZE; i++) {
-		if (line1[i] == ' ' || line1[i] == '	') {
-			line1[i] = 0;
-			n = i+1;
-			while (line1[n] == '	' || line1[n] == ' ')
-				n++;
-			dict->val[k] = &line1[n];
-			while (line1[n] != ' ')
-				n++;
-			line1[n] = 0;
-			break;
-		}
-	}
-	k++;
-	dict->max = k;
-	return k;
+	for (i = 0; i < dpg->data_points_len; i++)
+		if (dt_match_key(dpg->data_points[i].name, line, key_len))
+			return i;
+	return -1;
 }
 
 /**
  * @brief Stores the data collected from a "/proc/meminfo"
  *
+ * Tokenizes the "Key: value [kB]" lines in place. Values given in kB are
+ * stored in bytes, the page counts of the HugePages_ lines are stored as is.
+ *
  * @param dpg Struct that polled data is added to.
  * @return DTOP_POLL_IO_ERR - Poll of dpg unsuccessful.
  * @return DTOP_POLL_OK - Poll of dpg successful.
  */
 int dtop_meminfo_poll(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
-	int *line_len = malloc(sizeof(int) *
-			((struct dtop_meminfo_vars *)
-			(dpg->priv))->line_count);
-	int read;
-	struct dt_procdict dict;
-	int i, j, n, sum;
-
-	read = dt_read_file(dpg->file, &data, DTOP_MEM_SIZE);
-	if (read == 0 || data == 0)
+	char *pos = dpg->source.buf;
+	char *line;
+	const char *p;
+	uint64_t val;
+	int i, key_len;
+	int next = 0;
+
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
 		return DTOP_POLL_IO_ERR;
 
-	sum = 0;
-	/* Assigns each line read from the file, a length */
-	for (n = 0; n < ((struct dtop_meminfo_vars *)
-				(dpg->priv))->line_count; n++) {
-		line_len[n] = dt_read_line(((struct dtop_meminfo_vars *)
-					(dpg->priv))->line[n],
-					   DTOP_MEM_LINE, data,
-					   DTOP_MEM_SIZE, sum);
-		if (n <= (((struct dtop_meminfo_vars *)
-			(dpg->priv))->line_count - 1)) {
-			sum += (line_len[n] + 1);
-		}
-
-	}
-
-	/* Stores dp names and values in dictionary */
-	for (i = 0; i < dpg->data_points_len; i++)
-		dt_meminfo_parse(((struct dtop_meminfo_vars *)
-			(dpg->priv))->line[i], line_len[i], i, &dict);
-
-	/* Assigns the dp value to the dp struct */
-	for (j = 0; j < dpg->data_points_len; j++) {
-		i = dt_find_dict_idx(dpg->data_points[j].name, &dict);
-		if (i >= 0 && i < dict.max) {
-			sscanf(dict.val[i], "%" PRIu64,
-			       &(dpg->data_points[i].data.d_ulong));
-			dpg->data_points[i].data.d_ulong *= 1024;
-			if (dpg->data_points[i].
-				initial_data_populated == NOT_POPULATED) {
-				dpg->data_points[i].initial_data.d_ulong
-					= dpg->data_points[i].data.d_ulong;
-				dpg->data_points[i].initial_data_populated
-					= POPULATED;
-			}
-		}
+	while (dt_next_line(&pos, &line) >= 0) {
+		key_len = strcspn(line, " ");
+		i = dt_meminfo_find_dp(dpg, line, key_len, next);
+		if (i < 0)
+			continue;
+		next = i + 1;
+
+		p = line + key_len;
+		if (!dt_next_u64(&p, &val))
+			continue;
+		if (!strncmp(p, " kB", 3))
+			val *= 1024;
+		dtop_store_dp_ulong(&(dpg->data_points[i]), val);
 	}
 
-	dt_free(&data);
-	free(line_len);
 	return DTOP_POLL_OK;
 }
 
@@ -180,6 +143,7 @@ static void dtop_meminfo_dpg_deconstructor
 		free(((struct dtop_meminfo_vars *)(dpset->priv))->line[i]);
 	free(((struct dtop_meminfo_vars *)(dpset->priv))->line);
 	free(((struct dtop_meminfo_vars *)(dpset->priv)));
+	dt_file_close(&dpset->source);
 	free(dpset);
 }
 
@@ -204,6 +168,7 @@ static void construct_meminfo_file_dpg(struct dtop_data_point
 	dpg->priv = (struct dtop_meminfo_vars *)storage;
 	dpg->data_points_len = storage->line_count;
 	dpg->deconstruct = dtop_meminfo_dpg_deconstructor;
+	dt_file_open(&dpg->source, "/proc/meminfo", DTOP_MEM_SIZE);
 
 	dtop_register(dpg);
 }
@@ -258,6 +223,8 @@ int dtop_meminfo_search(struct dtop_meminfo_vars *storage)
 		data_points[i].name = dict.key[i];
 		data_points[i].prefix = NULL;
 		data_points[i].type = DTOP_ULONG;
+		data_points[i].skip = DO_NOT_SKIP;
+		data_points[i].initial_data_populated = NOT_POPULATED;
 		k++;
 	}
 
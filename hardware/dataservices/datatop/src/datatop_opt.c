@@ -47,6 +47,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "datatop_interface.h"
 #include "datatop_linked_list.h"
 #include "datatop_fileops.h"
+#include "datatop_sched.h"
 
 /**
  * @brief Populate the comand line options with sane defaults
@@ -86,7 +87,7 @@ int dtop_parse_cli_opts(struct cli_opts *clopts, int argc, char **argv)
 		goto error;
 	}
 
-	while ((option = getopt(argc, argv, "phri:t:w:o:s:n:")) != -1) {
+	while ((option = getopt(argc, argv, "phrbi:t:w:o:s:n:R:")) != -1) {
 		switch (option) {
 		case 'p':
 			clopts->print_cl = OPT_CHOSE;
@@ -108,9 +109,9 @@ int dtop_parse_cli_opts(struct cli_opts *clopts, int argc, char **argv)
 
 		case 'i':
 			clopts->poll_per = strtol(optarg, 0, 10);
-			if (clopts->poll_per < 200000) {
+			if (clopts->poll_per < MIN_POLL_INTERVAL) {
 				printf("Argument for -i is not valid. ");
-				printf("Must be atleast 200000\n");
+				printf("Must be atleast %d\n", MIN_POLL_INTERVAL);
 				goto error;
 			}
 		break;
@@ -162,12 +163,26 @@ int dtop_parse_cli_opts(struct cli_opts *clopts, int argc, char **argv)
 			clopts->iptables_rules_routes = OPT_CHOSE;
 		break;
 
+		case 'b':
+			clopts->binary_out = OPT_CHOSE;
+		break;
+
+		case 'R':
+			if (dtop_sched_add_rule(optarg) != VALID)
+				goto error;
+		break;
+
 		case '?':
 		default:
 			goto error;
 		}
 	}
 
+	if (clopts->binary_out == OPT_CHOSE && clopts->print_csv != OPT_CHOSE) {
+		printf("Option -b requires -w\n");
+		goto error;
+	}
+
 	if (clopts->poll_time == 0) {
 		if (clopts->print_csv == 1)
 			clopts->poll_time = POLL_NOT_SPECIFIED;
@@ -194,6 +209,11 @@ void dtop_print_help_opts(void)
 	printf("\t-i , u-seconds\t\tSpecify polling period \n");
 	printf("\t-t , seconds\t\tSpecify polling duration\n");
 	printf("\t-w , file name (.csv)\tWrite output to a file\n");
+	printf("\t-b\t\t\tWrite -w output in binary format,\n");
+	printf("\t\t\t\tconvert with datatop_bin2csv\n");
+	printf("\t-R , path=u-seconds\tPoll files under path at their own\n");
+	printf("\t\t\t\tperiod with -w, may be repeated, e.g.\n");
+	printf("\t\t\t\t-R /sys/devices/system/cpu/=20000\n");
 	printf("\t-s , file name\t\tPrint system snapshot to a file\n");
 	printf("\t-n , nice value\t\tSet niceness (default 19)\n");
 	printf("\t-r , \t\t\tCapture IPTables, Rules and Routes\n");
@@ -40,6 +40,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define OPT_CHOSE             1
 #define OPT_NOT_CHOSE         0
 #define DEFAULT_POLL_INTERVAL 1000000
+#define MIN_POLL_INTERVAL     20000
 #define POLL_NOT_SPECIFIED   -1
 #define POLL_TIME_DEFAULT     30
 #define POLL_TIME_SELECTED     1
@@ -67,6 +68,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * File name argument.
  * @var cli_opts::print_csv
  * Represents -w argument.
+ * @var cli_opts::binary_out
+ * Represents -b argument.
  */
 struct cli_opts {
 	int print_cl;                   /* -p option */
@@ -80,6 +83,7 @@ struct cli_opts {
 	int print_csv;
 	int poll_time_selected;
 	int priority;                   /* -n option (niceness) */
+	int binary_out;                 /* -b option */
 };
 
 int dtop_parse_cli_opts(struct cli_opts *clopts, int argc, char **argv);
@@ -0,0 +1,587 @@
+/************************************************************************
+Copyright (c) 2015, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************/
+
+/**
+ * @file datatop_sched.c
+ * @brief Polls groups of dpgs at their own periods.
+ *
+ * Every dpg belongs to the group of the longest -R path its source file
+ * starts with, or to the default group polled at the -i period. Groups
+ * polled at the period of the fastest group are polled inline before each
+ * row is written. Slower groups are handed to a small pool of worker
+ * threads so that a long poll, such as the several hundred files under
+ * /proc/sys/net, never holds up the fast ones.
+ *
+ * A worker polls into a private copy of the dps of each dpg. The values are
+ * copied into the dps read by the writers on the main thread once the poll
+ * has finished, so a row never holds a half polled group and the writers
+ * need no locking.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "datatop_interface.h"
+#include "datatop_linked_list.h"
+#include "datatop_opt.h"
+#include "datatop_sched.h"
+
+#define DTOP_TS_TO_USEC(ts) ((int64_t)(ts).tv_sec*1000000+(ts).tv_nsec/1000)
+
+#define DTOP_GROUP_IDLE   0
+#define DTOP_GROUP_QUEUED 1
+#define DTOP_GROUP_DONE   2
+
+/**
+ * @struct dtop_sched_rule
+ * @brief Polling period given with -R for the files under a path.
+ *
+ * @var dtop_sched_rule::path
+ * Path prefix, points into the -R argument and is not null terminated.
+ * @var dtop_sched_rule::path_len
+ * Length of path.
+ * @var dtop_sched_rule::period
+ * Polling period in microseconds.
+ */
+struct dtop_sched_rule {
+	const char *path;
+	size_t path_len;
+	long period;
+};
+
+/**
+ * @struct dtop_sched_group
+ * @brief Set of dpgs polled together at the same period.
+ *
+ * @var dtop_sched_group::name
+ * Path of the rule the group was created for, or "default".
+ * @var dtop_sched_group::period
+ * Polling period in microseconds.
+ * @var dtop_sched_group::next_us
+ * Monotonic time the group is next due to be polled.
+ * @var dtop_sched_group::worker
+ * Set if the group is polled by the worker threads.
+ * @var dtop_sched_group::state
+ * DTOP_GROUP_IDLE, or DTOP_GROUP_QUEUED while a worker owns the shadow
+ * dps, or DTOP_GROUP_DONE once their values are ready to be copied.
+ * @var dtop_sched_group::dpgs
+ * Dpgs in the group.
+ * @var dtop_sched_group::shadow
+ * Per dpg copy of its dps that a worker polls into.
+ * @var dtop_sched_group::dpg_count
+ * Number of dpgs in the group.
+ * @var dtop_sched_group::sample_us
+ * Time the last poll of the group started, in microseconds since the epoch.
+ * @var dtop_sched_group::sample_dp
+ * Dp that sample_us is published in.
+ */
+struct dtop_sched_group {
+	char *name;
+	long period;
+	int64_t next_us;
+	int worker;
+	int state;
+	struct dtop_data_point_gatherer **dpgs;
+	struct dtop_data_point **shadow;
+	int dpg_count;
+	int64_t sample_us;
+	struct dtop_data_point *sample_dp;
+};
+
+static struct dtop_sched_rule dtop_sched_rules[DTOP_SCHED_MAX_RULES];
+static int dtop_sched_rule_count;
+
+static struct dtop_sched_group *dtop_sched_groups;
+static int dtop_sched_group_count;
+static long dtop_sched_tick_us;
+
+static pthread_t dtop_sched_workers[DTOP_SCHED_WORKERS];
+static int dtop_sched_worker_count;
+static pthread_mutex_t dtop_sched_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dtop_sched_cond = PTHREAD_COND_INITIALIZER;
+static struct dtop_sched_group **dtop_sched_queue;
+static int dtop_sched_queue_head;
+static int dtop_sched_queue_len;
+static int dtop_sched_quit;
+
+/**
+ * @brief Adds a polling period for the files under a path.
+ *
+ * @param arg Argument of -R in the form path=microseconds.
+ * @return VALID - Rule was added.
+ * @return INVALID - Argument is malformed or there are too many rules.
+ */
+int dtop_sched_add_rule(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	char *end;
+	long period;
+
+	if (!eq || eq == arg) {
+		printf("Argument for -R must be path=u-seconds\n");
+		return INVALID;
+	}
+
+	period = strtol(eq + 1, &end, 10);
+	if (end == eq + 1 || *end != '\0' || period < MIN_POLL_INTERVAL) {
+		printf("Period for -R must be atleast %d\n",
+		       MIN_POLL_INTERVAL);
+		return INVALID;
+	}
+
+	if (dtop_sched_rule_count == DTOP_SCHED_MAX_RULES) {
+		printf("At most %d -R options are supported\n",
+		       DTOP_SCHED_MAX_RULES);
+		return INVALID;
+	}
+
+	dtop_sched_rules[dtop_sched_rule_count].path = arg;
+	dtop_sched_rules[dtop_sched_rule_count].path_len = eq - arg;
+	dtop_sched_rules[dtop_sched_rule_count].period = period;
+	dtop_sched_rule_count++;
+	return VALID;
+}
+
+/**
+ * @brief Finds the group a dpg is polled in.
+ *
+ * @param dpg Dpg to look up.
+ * @return Index of the group, dtop_sched_rule_count for the default group.
+ */
+static int dtop_sched_match(struct dtop_data_point_gatherer *dpg)
+{
+	const char *path = dpg->file ? dpg->file : dpg->prefix;
+	size_t best_len = 0;
+	int i, best = dtop_sched_rule_count;
+
+	for (i = 0; i < dtop_sched_rule_count; i++) {
+		if (dtop_sched_rules[i].path_len > best_len &&
+		    strncmp(path, dtop_sched_rules[i].path,
+			    dtop_sched_rules[i].path_len) == 0) {
+			best = i;
+			best_len = dtop_sched_rules[i].path_len;
+		}
+	}
+	return best;
+}
+
+static void *dtop_sched_alloc(size_t size)
+{
+	void *p = calloc(1, size);
+
+	if (!p) {
+		fprintf(stderr, "failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+/**
+ * @brief Polls every dpg of a group.
+ *
+ * Worker groups are polled into their shadow dps. The dpg itself is only
+ * read, apart from its source which no other thread touches.
+ *
+ * @param group Group to poll.
+ */
+static void dtop_sched_poll_group(struct dtop_sched_group *group)
+{
+	struct dtop_data_point_gatherer shadow_dpg;
+	struct timeval tv;
+	int i;
+
+	gettimeofday(&tv, NULL);
+	group->sample_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+	for (i = 0; i < group->dpg_count; i++) {
+		if (!group->worker) {
+			group->dpgs[i]->poll(group->dpgs[i]);
+			continue;
+		}
+		shadow_dpg = *group->dpgs[i];
+		shadow_dpg.data_points = group->shadow[i];
+		shadow_dpg.poll(&shadow_dpg);
+		group->dpgs[i]->source = shadow_dpg.source;
+	}
+}
+
+/**
+ * @brief Copies the values a worker polled into the dps of a group.
+ *
+ * @param group Group whose poll has finished.
+ */
+static void dtop_sched_commit(struct dtop_sched_group *group)
+{
+	struct dtop_data_point *live, *shadow;
+	int i, j;
+
+	for (i = 0; i < group->dpg_count; i++) {
+		live = group->dpgs[i]->data_points;
+		shadow = group->shadow[i];
+		for (j = 0; j < group->dpgs[i]->data_points_len; j++) {
+			if (shadow[j].initial_data_populated == NOT_POPULATED)
+				continue;
+			live[j].type = shadow[j].type;
+			live[j].data = shadow[j].data;
+			if (live[j].initial_data_populated == NOT_POPULATED) {
+				live[j].initial_data = shadow[j].data;
+				live[j].initial_data_populated = POPULATED;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Worker thread, polls the groups queued by dtop_sched_poll.
+ *
+ * @param arg Unused.
+ */
+static void *dtop_sched_worker(void *arg)
+{
+	struct dtop_sched_group *group;
+
+	(void) arg;
+
+	pthread_mutex_lock(&dtop_sched_lock);
+	while (1) {
+		while (!dtop_sched_quit && !dtop_sched_queue_len)
+			pthread_cond_wait(&dtop_sched_cond, &dtop_sched_lock);
+		if (dtop_sched_quit)
+			break;
+
+		group = dtop_sched_queue[dtop_sched_queue_head];
+		dtop_sched_queue_head = (dtop_sched_queue_head + 1)
+					% dtop_sched_group_count;
+		dtop_sched_queue_len--;
+		pthread_mutex_unlock(&dtop_sched_lock);
+
+		dtop_sched_poll_group(group);
+
+		pthread_mutex_lock(&dtop_sched_lock);
+		group->state = DTOP_GROUP_DONE;
+	}
+	pthread_mutex_unlock(&dtop_sched_lock);
+	return NULL;
+}
+
+static int dtop_sched_no_poll(struct dtop_data_point_gatherer *dpg)
+{
+	(void) dpg;
+	return DTOP_POLL_OK;
+}
+
+static void dtop_sched_dpg_deconstructor(struct dtop_data_point_gatherer *dpg)
+{
+	int i;
+
+	for (i = 0; i < dpg->data_points_len; i++)
+		free(dpg->data_points[i].name);
+	free(dpg->data_points);
+	free(dpg);
+}
+
+/**
+ * @brief Registers the dpg holding the sample time of each group.
+ */
+static void dtop_sched_register_samples(void)
+{
+	struct dtop_data_point_gatherer *dpg;
+	struct dtop_data_point *dp;
+	size_t len;
+	int i;
+
+	dpg = dtop_sched_alloc(sizeof(*dpg));
+	dp = dtop_sched_alloc(dtop_sched_group_count * sizeof(*dp));
+
+	for (i = 0; i < dtop_sched_group_count; i++) {
+		len = strlen("sample_us:") + strlen(dtop_sched_groups[i].name)
+		      + 1;
+		dp[i].name = dtop_sched_alloc(len);
+		snprintf(dp[i].name, len, "sample_us:%s",
+			 dtop_sched_groups[i].name);
+		dp[i].prefix = NULL;
+		dp[i].type = DTOP_ULONG;
+		dp[i].initial_data_populated = NOT_POPULATED;
+		dp[i].skip = DO_NOT_SKIP;
+		dtop_sched_groups[i].sample_dp = &dp[i];
+	}
+
+	dpg->prefix = DTOP_SCHED_PREFIX;
+	dpg->file = NULL;
+	dpg->poll = dtop_sched_no_poll;
+	dpg->deconstruct = dtop_sched_dpg_deconstructor;
+	dpg->data_points = dp;
+	dpg->data_points_len = dtop_sched_group_count;
+	dpg->source.fd = -1;
+
+	dtop_register(dpg);
+}
+
+/**
+ * @brief Splits the dpgs into groups and starts the worker threads.
+ *
+ * Registers a dpg holding the sample time of each group, so it has to be
+ * called before the column headers are printed.
+ *
+ * @param dpg_list Pointer to first node of linked list which contains all dpgs.
+ * @param default_per Period of the dpgs not matched by any -R path.
+ */
+void dtop_sched_init(struct dtop_linked_list *dpg_list, long default_per)
+{
+	struct dtop_linked_list *curr_ptr;
+	struct dtop_data_point_gatherer *dpg;
+	struct dtop_sched_group *group;
+	struct timespec now;
+	const char *name;
+	int *count, *index;
+	int i, j, n, workers = 0;
+	size_t len;
+
+	n = dtop_sched_rule_count + 1;
+	count = dtop_sched_alloc(n * sizeof(*count));
+	index = dtop_sched_alloc(n * sizeof(*index));
+
+	for (curr_ptr = dpg_list; curr_ptr; curr_ptr = curr_ptr->next_ptr)
+		count[dtop_sched_match(curr_ptr->data)]++;
+
+	/* Groups without any dpg are dropped, the default one is kept */
+	dtop_sched_groups = dtop_sched_alloc(n * sizeof(*dtop_sched_groups));
+	for (i = 0; i < n; i++) {
+		if (!count[i] && i != dtop_sched_rule_count) {
+			printf("No datapoints under %.*s\n",
+			       (int)dtop_sched_rules[i].path_len,
+			       dtop_sched_rules[i].path);
+			index[i] = -1;
+			continue;
+		}
+		group = &dtop_sched_groups[dtop_sched_group_count];
+		if (i == dtop_sched_rule_count) {
+			name = DTOP_SCHED_DEFAULT;
+			len = strlen(name);
+			group->period = default_per;
+		} else {
+			name = dtop_sched_rules[i].path;
+			len = dtop_sched_rules[i].path_len;
+			group->period = dtop_sched_rules[i].period;
+		}
+		group->name = dtop_sched_alloc(len + 1);
+		memcpy(group->name, name, len);
+		group->dpgs = dtop_sched_alloc((count[i] + 1)
+					       * sizeof(*group->dpgs));
+		index[i] = dtop_sched_group_count++;
+	}
+
+	for (curr_ptr = dpg_list; curr_ptr; curr_ptr = curr_ptr->next_ptr) {
+		dpg = curr_ptr->data;
+		group = &dtop_sched_groups[index[dtop_sched_match(dpg)]];
+		group->dpgs[group->dpg_count++] = dpg;
+	}
+	free(count);
+	free(index);
+
+	dtop_sched_tick_us = default_per;
+	for (i = 0; i < dtop_sched_group_count; i++) {
+		group = &dtop_sched_groups[i];
+		if (group->dpg_count && group->period < dtop_sched_tick_us)
+			dtop_sched_tick_us = group->period;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (i = 0; i < dtop_sched_group_count; i++) {
+		group = &dtop_sched_groups[i];
+		group->next_us = DTOP_TS_TO_USEC(now);
+		if (group->period <= dtop_sched_tick_us)
+			continue;
+
+		group->worker = 1;
+		group->shadow = dtop_sched_alloc(group->dpg_count
+						 * sizeof(*group->shadow));
+		for (j = 0; j < group->dpg_count; j++) {
+			dpg = group->dpgs[j];
+			group->shadow[j] = dtop_sched_alloc(
+				(dpg->data_points_len + 1)
+				* sizeof(struct dtop_data_point));
+			memcpy(group->shadow[j], dpg->data_points,
+			       dpg->data_points_len
+			       * sizeof(struct dtop_data_point));
+		}
+		workers++;
+	}
+
+	dtop_sched_register_samples();
+
+	if (!workers)
+		return;
+
+	dtop_sched_queue = dtop_sched_alloc(dtop_sched_group_count
+					    * sizeof(*dtop_sched_queue));
+	if (workers > DTOP_SCHED_WORKERS)
+		workers = DTOP_SCHED_WORKERS;
+	for (i = 0; i < workers; i++) {
+		if (pthread_create(&dtop_sched_workers[i], NULL,
+				   dtop_sched_worker, NULL) != 0)
+			break;
+		dtop_sched_worker_count++;
+	}
+
+	/* Without any worker every group is polled inline */
+	if (!dtop_sched_worker_count) {
+		fprintf(stderr, "Unable to create poll worker threads\n");
+		for (i = 0; i < dtop_sched_group_count; i++)
+			dtop_sched_groups[i].worker = 0;
+	}
+}
+
+/**
+ * @brief Returns the period rows are written at.
+ *
+ * @return Period of the fastest group in microseconds.
+ */
+long dtop_sched_tick(void)
+{
+	return dtop_sched_tick_us;
+}
+
+/**
+ * @brief Advances a group to its next due time.
+ *
+ * A group that fell behind is not polled repeatedly to catch up.
+ *
+ * @param group Group that was just polled or queued.
+ * @param now_us Current monotonic time.
+ */
+static void dtop_sched_advance(struct dtop_sched_group *group, int64_t now_us)
+{
+	group->next_us += group->period;
+	if (group->next_us <= now_us)
+		group->next_us = now_us + group->period;
+}
+
+/**
+ * @brief Polls the groups that are due before a row is written.
+ *
+ * Publishes the groups finished by the workers since the last row, queues
+ * the worker groups that are due and polls the inline groups that are due.
+ *
+ * @param wall_us Set to the wall clock time spent on the calling thread.
+ * @param cpu_us Set to the CPU time spent on the calling thread.
+ */
+void dtop_sched_poll(int64_t *wall_us, int64_t *cpu_us)
+{
+	struct timespec wall_start, wall_end, cpu_start, cpu_end;
+	struct dtop_sched_group *group;
+	int64_t now_us, slack = dtop_sched_tick_us / 2;
+	int i, queued = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+	now_us = DTOP_TS_TO_USEC(wall_start);
+
+	if (dtop_sched_worker_count) {
+		pthread_mutex_lock(&dtop_sched_lock);
+		for (i = 0; i < dtop_sched_group_count; i++) {
+			group = &dtop_sched_groups[i];
+			if (!group->worker)
+				continue;
+			if (group->state == DTOP_GROUP_DONE) {
+				dtop_sched_commit(group);
+				dtop_store_dp_ulong(group->sample_dp,
+						    group->sample_us);
+				group->state = DTOP_GROUP_IDLE;
+			}
+			if (group->state != DTOP_GROUP_IDLE ||
+			    now_us + slack < group->next_us)
+				continue;
+
+			dtop_sched_queue[(dtop_sched_queue_head
+					  + dtop_sched_queue_len)
+					 % dtop_sched_group_count] = group;
+			dtop_sched_queue_len++;
+			group->state = DTOP_GROUP_QUEUED;
+			dtop_sched_advance(group, now_us);
+			queued = 1;
+		}
+		if (queued)
+			pthread_cond_broadcast(&dtop_sched_cond);
+		pthread_mutex_unlock(&dtop_sched_lock);
+	}
+
+	for (i = 0; i < dtop_sched_group_count; i++) {
+		group = &dtop_sched_groups[i];
+		if (group->worker || now_us + slack < group->next_us)
+			continue;
+		dtop_sched_poll_group(group);
+		dtop_store_dp_ulong(group->sample_dp, group->sample_us);
+		dtop_sched_advance(group, now_us);
+	}
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+	*wall_us = DTOP_TS_TO_USEC(wall_end) - DTOP_TS_TO_USEC(wall_start);
+	*cpu_us = DTOP_TS_TO_USEC(cpu_end) - DTOP_TS_TO_USEC(cpu_start);
+}
+
+/**
+ * @brief Stops the worker threads and frees the groups.
+ *
+ * Polls still running are waited for. The dpg holding the sample times
+ * stays registered and is freed along with the other dpgs.
+ */
+void dtop_sched_stop(void)
+{
+	struct dtop_sched_group *group;
+	int i, j;
+
+	pthread_mutex_lock(&dtop_sched_lock);
+	dtop_sched_quit = 1;
+	pthread_cond_broadcast(&dtop_sched_cond);
+	pthread_mutex_unlock(&dtop_sched_lock);
+
+	for (i = 0; i < dtop_sched_worker_count; i++)
+		pthread_join(dtop_sched_workers[i], NULL);
+	dtop_sched_worker_count = 0;
+
+	for (i = 0; i < dtop_sched_group_count; i++) {
+		group = &dtop_sched_groups[i];
+		if (group->shadow)
+			for (j = 0; j < group->dpg_count; j++)
+				free(group->shadow[j]);
+		free(group->shadow);
+		free(group->dpgs);
+		free(group->name);
+	}
+	free(dtop_sched_groups);
+	free(dtop_sched_queue);
+	dtop_sched_groups = NULL;
+	dtop_sched_queue = NULL;
+	dtop_sched_group_count = 0;
+}
@@ -0,0 +1,58 @@
+/************************************************************************
+Copyright (c) 2015, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************/
+
+/**
+ * @file datatop_sched.h
+ * @brief Declares methods held in datatop_sched.c
+ *
+ * Dpgs are split into groups by the path of their source file, each group
+ * being polled at its own period. A row is written at the period of the
+ * fastest group and carries the latest values of every group along with
+ * the time each group was last sampled.
+ */
+
+#ifndef DATATOP_SCHED_H
+#define DATATOP_SCHED_H
+
+#include <stdint.h>
+#include "datatop_interface.h"
+#include "datatop_linked_list.h"
+
+#define DTOP_SCHED_MAX_RULES  16
+#define DTOP_SCHED_WORKERS    2
+#define DTOP_SCHED_PREFIX     "datatop"
+#define DTOP_SCHED_DEFAULT    "default"
+
+int dtop_sched_add_rule(const char *arg);
+void dtop_sched_init(struct dtop_linked_list *dpg_list, long default_per);
+long dtop_sched_tick(void);
+void dtop_sched_poll(int64_t *wall_us, int64_t *cpu_us);
+void dtop_sched_stop(void);
+
+#endif /* DATATOP_SCHED_H */
@@ -69,49 +69,34 @@ struct dtop_single_line_vars {
  */
 int dtop_single_line_poll(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
-	int *line_len = malloc(sizeof(int) *
-			((struct dtop_single_line_vars *)
-			(dpg->priv))->line_count);
-	int read;
+	char *pos = dpg->source.buf;
+	char *line;
+	int line_len;
 	struct dt_procdict dict;
-	int i, j, n, sum;
+	int i, j;
 
-	read = dt_read_file(dpg->file, &data, DTOP_SINGLE_SIZE);
-	if (read == 0 || data == 0)
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
 		return DTOP_POLL_IO_ERR;
 
-	sum = 0;
-	/* Assigns each line read from the file, a length */
-	for (n = 0; n < ((struct dtop_single_line_vars *)
-				(dpg->priv))->line_count; n++) {
-		line_len[n] = dt_read_line(((struct dtop_single_line_vars *)
-					(dpg->priv))->line[n],
-					   DTOP_SINGLE_LINE, data,
-					   DTOP_SINGLE_SIZE, sum);
-		if (n <= (((struct dtop_single_line_vars *)
-			(dpg->priv))->line_count - 1)) {
-			sum += (line_len[n] + 1);
-		}
-
-	}
-
 	/* Stores dp names and values in dictionary */
-	for (i = 0; i < dpg->data_points_len; i++)
-		dt_parse_proc_same_line_key_and_val((
-			(struct dtop_single_line_vars *)
-			(dpg->priv))->line[i], line_len[i], i, &dict);
+	dict.max = 0;
+	for (i = 0; i < dpg->data_points_len &&
+	     (line_len = dt_next_line(&pos, &line)) >= 0; i++) {
+		dict.key[i] = 0;
+		dt_parse_proc_same_line_key_and_val(line, line_len, i, &dict);
+	}
 
-	/* Assigns the dp value to the dp struct */
+	/* Assigns the dp value to the dp struct, lines rarely move */
 	for (j = 0; j < dpg->data_points_len; j++) {
-		i = dt_find_dict_idx(dpg->data_points[j].name, &dict);
+		i = j;
+		if (i >= dict.max || !dict.key[i] ||
+		    strcmp(dpg->data_points[j].name, dict.key[i]))
+			i = dt_find_dict_idx(dpg->data_points[j].name, &dict);
 		if (i >= 0 && i < dict.max)
 			dtop_store_dp(&(dpg->data_points[j]),
 				      dict.val[i]);
 	}
 
-	dt_free(&data);
-	free(line_len);
 	return DTOP_POLL_OK;
 }
 
@@ -133,6 +118,7 @@ static void dtop_single_line_dpg_deconstructor
 		free(((struct dtop_single_line_vars *)(dpset->priv))->line[i]);
 	free(((struct dtop_single_line_vars *)(dpset->priv))->line);
 	free(((struct dtop_single_line_vars *)(dpset->priv)));
+	dt_file_close(&dpset->source);
 	free(dpset);
 }
 
@@ -158,6 +144,7 @@ static void construct_single_line_file_dpg(char *name, struct dtop_data_point
 	dpg->priv = (struct dtop_single_line_vars *)storage;
 	dpg->data_points_len = storage->line_count;
 	dpg->deconstruct = dtop_single_line_dpg_deconstructor;
+	dt_file_open(&dpg->source, name, DTOP_SINGLE_SIZE);
 
 	dtop_register(dpg);
 }
@@ -216,6 +203,8 @@ int dtop_single_line_search(char *name, struct dtop_single_line_vars *storage)
 			data_points[k].type = DTOP_ULONG;
 		data_points[i].name = dict.key[i];
 		data_points[i].prefix = NULL;
+		data_points[i].skip = DO_NOT_SKIP;
+		data_points[i].initial_data_populated = NOT_POPULATED;
 		k++;
 	}
 
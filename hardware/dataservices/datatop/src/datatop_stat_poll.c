@@ -36,6 +36,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include "datatop_interface.h"
@@ -53,10 +54,19 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 * Array of strings where necessary dp names and values are held.
 * @var dtop_stat_vars::line_count
 * Number of lines the file is that the dpg represents.
+* @var dtop_stat_vars::key
+* Key (first token) of each line.
+* @var dtop_stat_vars::first_dp
+* Index of the first dp holding a value of each line.
+* @var dtop_stat_vars::dp_per_line
+* Number of dps holding values of each line.
 */
 struct dtop_stat_vars {
 	char **line;
 	int line_count;
+	char **key;
+	int *first_dp;
+	int *dp_per_line;
 };
 
 /**
@@ -109,53 +119,52 @@ static int dt_stat_parse(char *line1, int len1,
 /**
  * @brief Stores the data collected from "/proc/stat"
  *
+ * Tokenizes the file in place. Each line is matched to the dps created for
+ * it by its key, so lines of CPUs that were hotplugged since the search
+ * do not shift the values of the lines after them.
+ *
  * @param dpg Struct that polled data is added to.
  * @return DTOP_POLL_IO_ERR - Poll of dpg unsuccessful.
  * @return DTOP_POLL_OK - Poll of dpg successful.
  */
 int dtop_stat_poll(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
-	int *line_len = malloc(sizeof(int) *
-			((struct dtop_stat_vars *)
-			(dpg->priv))->line_count);
-	int read;
-	struct dt_procdict dict;
-	int i, n, sum;
-	int dp_count = 0;
-
-	read = dt_read_file(dpg->file, &data, DTOP_STAT_SIZE);
-	if (read == 0 || data == 0)
+	struct dtop_stat_vars *storage = dpg->priv;
+	char *pos = dpg->source.buf;
+	char *line;
+	const char *p;
+	uint64_t val;
+	int i, n, key_len, first;
+	int next = 0;
+
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
 		return DTOP_POLL_IO_ERR;
 
-	sum = 0;
-	/* Assigns each line read from the file, a length */
-	for (n = 0; n < ((struct dtop_stat_vars *)
-				(dpg->priv))->line_count; n++) {
-		line_len[n] = dt_read_line(((struct dtop_stat_vars *)
-					(dpg->priv))->line[n],
-					   DTOP_STAT_LINE, data,
-					   DTOP_STAT_SIZE, sum);
-		if (n <= (((struct dtop_stat_vars *)
-			(dpg->priv))->line_count - 1)) {
-			sum += (line_len[n] + 1);
+	while (dt_next_line(&pos, &line) >= 0) {
+		key_len = strcspn(line, " ");
+
+		/* Lines keep their order, so search forward first */
+		for (i = next; i < storage->line_count; i++)
+			if (dt_match_key(storage->key[i], line, key_len))
+				break;
+		if (i == storage->line_count) {
+			for (i = 0; i < next; i++)
+				if (dt_match_key(storage->key[i], line,
+						 key_len))
+					break;
+			if (i == next)
+				continue;
 		}
-
+		next = i + 1;
+
+		p = line + key_len;
+		first = storage->first_dp[i];
+		for (n = 0; n < storage->dp_per_line[i] &&
+		     dt_next_u64(&p, &val); n++)
+			dtop_store_dp_ulong(&(dpg->data_points[first + n]),
+					    val);
 	}
 
-	/* Stores dp names and values in dictionary */
-	for (i = 0; i < ((struct dtop_stat_vars *)(dpg->priv))->line_count; i++)
-		dp_count = dt_stat_parse(((struct dtop_stat_vars *)
-			(dpg->priv))->line[i], line_len[i], i, dp_count, &dict);
-
-	/* Assigns the dp value to the dp struct */
-	for (n = 0; n < dp_count; n++) {
-		dtop_store_dp(&(dpg->data_points[n]),
-				dict.val[n]);
-	}
-
-	dt_free(&data);
-	free(line_len);
 	return DTOP_POLL_OK;
 }
 
@@ -178,7 +187,11 @@ static void dtop_stat_dpg_deconstructor
 				(dpset->priv))->line_count; i++)
 		free(((struct dtop_stat_vars *)(dpset->priv))->line[i]);
 	free(((struct dtop_stat_vars *)(dpset->priv))->line);
+	free(((struct dtop_stat_vars *)(dpset->priv))->key);
+	free(((struct dtop_stat_vars *)(dpset->priv))->first_dp);
+	free(((struct dtop_stat_vars *)(dpset->priv))->dp_per_line);
 	free(((struct dtop_stat_vars *)(dpset->priv)));
+	dt_file_close(&dpset->source);
 
 	free(dpset);
 }
@@ -205,6 +218,7 @@ static void construct_stat_file_dpg(struct dtop_data_point
 	dpg->priv = (struct dtop_stat_vars *)storage;
 	dpg->data_points_len = dp_count;
 	dpg->deconstruct = dtop_stat_dpg_deconstructor;
+	dt_file_open(&dpg->source, "/proc/stat", DTOP_STAT_SIZE);
 
 	dtop_register(dpg);
 }
@@ -250,6 +264,8 @@ int dtop_stat_search(struct dtop_stat_vars *storage)
 	}
 
 	dp_per_line = malloc(sizeof(int) * (storage->line_count));
+	storage->key = malloc(sizeof(char *) * (storage->line_count));
+	storage->first_dp = malloc(sizeof(int) * (storage->line_count));
 	/* Stores dp names in dictionary */
 
 	for (i = 0; i < (storage->line_count); i++) {
@@ -257,6 +273,8 @@ int dtop_stat_search(struct dtop_stat_vars *storage)
 		dp_count = dt_stat_parse(storage->line[i],
 				line_len[i], i, dp_count, &dict);
 		dp_per_line[i] = (dp_count - end);
+		storage->first_dp[i] = end;
+		storage->key[i] = dp_per_line[i] ? dict.key[i] : NULL;
 	}
 
 	data_points = malloc(dp_count * sizeof(struct dtop_data_point));
@@ -299,8 +317,8 @@ int dtop_stat_search(struct dtop_stat_vars *storage)
 	}
 
 	/* Calls dpg constructor, dpg will point to the dp struct */
+	storage->dp_per_line = dp_per_line;
 	construct_stat_file_dpg(data_points, storage, dp_count);
-	free(dp_per_line);
 	free(line_len);
 	dt_free(&data);
 
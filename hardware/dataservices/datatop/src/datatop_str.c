@@ -258,3 +258,74 @@ int dt_single_line_parse(char *line1, int len1, struct dt_procdict *dict)
 	dict->max = k;
 	return k;
 }
+
+/**
+ * @brief Splits the next line off a null terminated buffer in place.
+ *
+ * The newline ending the line is replaced by a null and *pos is advanced
+ * past it, so lines can be tokenized without copying them out first.
+ *
+ * @param pos Current position in the buffer, advanced to the next line.
+ * @param line Set to the start of the line.
+ * @return Length of line (of chars), or -1 once the buffer is exhausted.
+ */
+int dt_next_line(char **pos, char **line)
+{
+	char *end;
+
+	if (**pos == 0)
+		return -1;
+
+	*line = *pos;
+	end = strchr(*pos, '\n');
+	if (end) {
+		*end = 0;
+		*pos = end + 1;
+	} else {
+		end = *pos + strlen(*pos);
+		*pos = end;
+	}
+	return end - *line;
+}
+
+/**
+ * @brief Parses the next unsigned decimal value of a line.
+ *
+ * Skips leading spaces and tabs, then accumulates digits up to the first
+ * non-digit. Used by the tokenizers of the large /proc files in place of
+ * sscanf().
+ *
+ * @param pos Current position in the line, advanced past the value.
+ * @param val Parsed value.
+ * @return 1 if a value was parsed, 0 if the next token is not a number.
+ */
+int dt_next_u64(const char **pos, uint64_t *val)
+{
+	const char *p = *pos;
+	uint64_t v = 0;
+
+	while (*p == ' ' || *p == '	')
+		p++;
+	if (*p < '0' || *p > '9')
+		return 0;
+
+	while (*p >= '0' && *p <= '9')
+		v = v * 10 + (*p++ - '0');
+
+	*val = v;
+	*pos = p;
+	return 1;
+}
+
+/**
+ * @brief Compares a datapoint name against a key that is not null terminated.
+ *
+ * @param key Null terminated key, usually a dp name.
+ * @param str Start of the key in the buffer being tokenized.
+ * @param len Length of the key in str.
+ * @return 1 if key and str match, 0 otherwise.
+ */
+int dt_match_key(const char *key, const char *str, int len)
+{
+	return key && !strncmp(key, str, len) && key[len] == 0;
+}
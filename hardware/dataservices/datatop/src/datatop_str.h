@@ -35,6 +35,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef DATATOP_STR_H
 #define DATATOP_STR_H
 
+#include <stdint.h>
+
 #define DTOP_DICT_SIZE 2048
 
 /**
@@ -67,4 +69,10 @@ int dt_parse_proc_same_line_key_and_val(char *line1, int len1, int l,
 void dt_parse_for_prefix(char *line1, int len1, struct dt_procdict *dict);
 
 int dt_single_line_parse(char *line1, int len1, struct dt_procdict *dict);
+
+int dt_next_line(char **pos, char **line);
+
+int dt_next_u64(const char **pos, uint64_t *val);
+
+int dt_match_key(const char *key, const char *str, int len);
 #endif /* DATATOP_STR_H */
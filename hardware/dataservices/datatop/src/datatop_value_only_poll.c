@@ -55,34 +55,26 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 int dtop_value_only_poll(struct dtop_data_point_gatherer *dpg)
 {
-	char *data;
+	char *pos = dpg->source.buf;
+	char *line;
 	int line_len;
-	char line[DTOP_SINGLE_LINE];
-	int read;
 	struct dt_procdict dict;
 	int j;
-	FILE *check = fopen(dpg->file, "r");
-	if (check) {
-		fclose(check);
-		read = dt_read_file(dpg->file, &data, DTOP_SINGLE_SIZE);
-	} else {
-		return DTOP_POLL_IO_ERR;
-	}
 
-	if (read == 0 || data == 0)
+	if (dt_file_read(&dpg->source, dpg->file) == 0)
 		return DTOP_POLL_IO_ERR;
 
-	line_len = dt_read_line(line, DTOP_SINGLE_LINE, data,
-					   DTOP_SINGLE_SIZE, 0);
+	line_len = dt_next_line(&pos, &line);
+	if (line_len < 0)
+		return DTOP_POLL_IO_ERR;
 
 	/* Stores dp values in dictionary */
 	dt_single_line_parse(line, line_len, &dict);
 
 	/* Assigns the dp value to the dp struct */
-	for (j = 0; j < dpg->data_points_len; j++)
+	for (j = 0; j < dpg->data_points_len && j < dict.max; j++)
 		dtop_store_dp(&(dpg->data_points[j]), dict.val[j]);
 
-	dt_free(&data);
 	return DTOP_POLL_OK;
 }
 
@@ -101,6 +93,7 @@ void dtop_value_only_dpg_deconstructor
 	for (i = 0; i < dpset->data_points_len; i++)
 		free(dpset->data_points[i].name);
 	free(dpset->data_points);
+	dt_file_close(&dpset->source);
 	free(dpset->file);
 	free(dpset);
 }
@@ -126,6 +119,7 @@ static void construct_value_only_dpg(char *name, struct dtop_data_point
 	dpg->data_points = data_points;
 	dpg->data_points_len = dp_count;
 	dpg->deconstruct = dtop_value_only_dpg_deconstructor;
+	dt_file_open(&dpg->source, name, DTOP_SINGLE_LINE);
 
 	dtop_register(dpg);
 }
@@ -47,12 +47,16 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ===========================================================================*/
 
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <stdint.h>
 #include <linux/netlink.h>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <errno.h>
 #include "rmnetcli.h"
 #include "librmnetctl.h"
 
@@ -71,6 +75,14 @@ print_rmnet_api_status(RMNETCTL_INVALID_ARG, RMNETCTL_CFG_FAILURE_NO_COMMAND); \
 #define _5TABS 		"\n\t\t\t\t\t"
 #define _2TABS 		"\n\t\t"
 
+/* Device and vnd the async test requests name, the mock peer ignores them */
+#define RMNET_ASYNC_TEST_DEV "lo"
+#define RMNET_ASYNC_TEST_VND "rmnet_data0"
+/* Longest wait for an ack from the mock peer */
+#define RMNET_ASYNC_TEST_TIMEOUT_MS 1000
+/* Room for a multipart message of a whole batch window */
+#define RMNET_MOCK_PEER_BUF_SIZE 65536
+
 /*!
 * @brief Contains a list of error message from CLI
 */
@@ -246,7 +258,20 @@ static void rmnet_api_usage(void)
 	printf(_2TABS" <iface_id>              int - iface id\n\n");
 	printf(_2TABS" <flags>                 int - flags\n\n");
 	printf("rmnetcli -n systemdown    <real dev> <vnd name> <instance>\n\n ");
-
+	printf("**************************\n");
+	printf("rmnetcli -a <count> [reject_every]       Sends count");
+	printf(_5TABS" flowcontrol requests on an");
+	printf(_5TABS" async handle to a mock");
+	printf(_5TABS" netlink peer, which rejects");
+	printf(_5TABS" every reject_every-th");
+	printf(_5TABS" request with ENODEV.");
+	printf(_5TABS" Returns the status code\n\n");
+	printf("rmnetcli -b <count>                      Sends count");
+	printf(_5TABS" flowcontrol requests to a");
+	printf(_5TABS" mock netlink peer one at a");
+	printf(_5TABS" time and then batched, and");
+	printf(_5TABS" prints the requests per");
+	printf(_5TABS" second of each\n\n");
 
 }
 
@@ -288,6 +313,318 @@ static void print_rmnet_api_status(int return_code, uint16_t error_number)
 		printf("INVALID_ARG\n");
 }
 
+/*!
+* @brief Acks of the async test, counted by the completion callback
+*/
+struct rmnet_async_test_s {
+	uint32_t acked;
+	uint32_t rejected;
+	uint32_t lost;
+};
+
+/*!
+* @brief Method standing in for the kernel in the async test
+* @details Acks every request read from fd, rejecting the ones whose
+* sequence number + 1 is a multiple of reject_every with ENODEV, until the
+* other end is closed
+* @param fd Socket the handle sends its requests to
+* @param reject_every Period of the rejected requests, 0 for none
+* @return void
+*/
+static void rmnet_async_mock_peer(int fd, uint32_t reject_every)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct nlmsgerr err;
+	} ack;
+	struct nlmsghdr *nlh;
+	char buf[RMNET_MOCK_PEER_BUF_SIZE];
+	int len;
+
+	while ((len = recv(fd, buf, sizeof(buf), 0)) > 0) {
+		for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+		     nlh = NLMSG_NEXT(nlh, len)) {
+			memset(&ack, 0, sizeof(ack));
+			ack.nlh.nlmsg_len = sizeof(ack);
+			ack.nlh.nlmsg_type = NLMSG_ERROR;
+			ack.nlh.nlmsg_seq = nlh->nlmsg_seq;
+			if (reject_every &&
+			    (nlh->nlmsg_seq + 1) % reject_every == 0)
+				ack.err.error = -ENODEV;
+			ack.err.msg = *nlh;
+			if (send(fd, &ack, sizeof(ack), 0) < 0)
+				return;
+		}
+	}
+}
+
+/*!
+* @brief Method to put a mock netlink peer behind the socket of a handle
+* @details Forks a process running rmnet_async_mock_peer on one end of a
+* socketpair and dup2()s the other end over the handle's socket. Closing
+* the handle's socket ends the peer.
+* @param handle RmNet handle the peer answers
+* @param reject_every Period of the rejected requests, 0 for none
+* @param peer Set to the pid of the peer
+* @param error_number Error code if the peer could not be started
+* @return RMNETCTL_SUCCESS if the peer is running
+* @return RMNETCTL_LIB_ERR if there was a library error
+*/
+static int rmnet_mock_peer_start(struct rmnetctl_hndl_s *handle,
+				 uint32_t reject_every, pid_t *peer,
+				 uint16_t *error_number)
+{
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+		*error_number = RMNETCTL_INIT_ERR_NETLINK_FD;
+		return RMNETCTL_LIB_ERR;
+	}
+	*peer = fork();
+	if (*peer < 0) {
+		close(sv[0]);
+		close(sv[1]);
+		*error_number = RMNETCTL_INIT_ERR_PROCESS_ID;
+		return RMNETCTL_LIB_ERR;
+	}
+	if (!*peer) {
+		close(sv[0]);
+		rmnet_async_mock_peer(sv[1], reject_every);
+		_exit(0);
+	}
+	close(sv[1]);
+	if (dup2(sv[0], rtrmnet_ctl_get_fd(handle)) < 0) {
+		close(sv[0]);
+		*error_number = RMNETCTL_INIT_ERR_NETLINK_FD;
+		return RMNETCTL_LIB_ERR;
+	}
+	close(sv[0]);
+	return RMNETCTL_SUCCESS;
+}
+
+/*!
+* @brief Completion callback of the async test
+* @param hndl RmNet handle the request was sent on
+* @param return_code Return code of the request
+* @param error_code Status code of the request
+* @param cookie Counters of the test
+* @return void
+*/
+static void rmnet_async_test_done(rmnetctl_hndl_t *hndl, int return_code,
+				  uint16_t *error_code, void *cookie)
+{
+	struct rmnet_async_test_s *test = cookie;
+
+	(void)hndl;
+	(void)error_code;
+	test->acked++;
+	if (return_code == RMNETCTL_KERNEL_ERR)
+		test->rejected++;
+	else if (return_code != RMNETCTL_SUCCESS)
+		test->lost++;
+}
+
+/*!
+* @brief Method to exercise an async handle against a mock netlink peer
+* @details A forked process takes the place of the kernel behind the
+* netlink socket of the handle, which is driven from an epoll loop the way
+* a daemon would
+* @param argc Number of arguments
+* @param argv count and optional reject_every
+* @return RMNETCTL_SUCCESS if every request completed as the mock peer
+* acked it
+* @return RMNETCTL_LIB_ERR if there was a library error
+* @return RMNETCTL_INVALID_ARG if invalid arguments were passed
+*/
+static int rmnet_async_test(int argc, char *argv[])
+{
+	struct rmnetctl_hndl_s *handle = NULL;
+	struct rmnet_async_test_s test;
+	struct epoll_event ev;
+	uint16_t error_number = RMNETCTL_CFG_FAILURE_NO_COMMAND;
+	uint16_t *codes = NULL;
+	uint32_t count, reject_every = 0, sent = 0, pending = 0, i;
+	int return_code = RMNETCTL_LIB_ERR;
+	int epfd = -1, ready;
+	pid_t peer = -1;
+
+	if (argc < 2 || !argv[1]) {
+		print_rmnet_api_status(RMNETCTL_LIB_ERR,
+		RMNETCTL_CFG_FAILURE_NO_COMMAND);
+		return RMNETCTL_INVALID_ARG;
+	}
+	count = _STRTOUI32(argv[1]);
+	if (argc > 2 && argv[2])
+		reject_every = _STRTOUI32(argv[2]);
+
+	memset(&test, 0, sizeof(test));
+	codes = calloc(count ? count : 1, sizeof(*codes));
+	if (!codes)
+		return RMNETCTL_LIB_ERR;
+
+	return_code = rtrmnet_ctl_init(&handle, &error_number);
+	if (return_code != RMNETCTL_SUCCESS)
+		goto end;
+	return_code = RMNETCTL_LIB_ERR;
+
+	return_code = rmnet_mock_peer_start(handle, reject_every, &peer,
+					    &error_number);
+	if (return_code != RMNETCTL_SUCCESS)
+		goto end;
+	return_code = RMNETCTL_LIB_ERR;
+
+	return_code = rtrmnet_ctl_async_enable(handle, rmnet_async_test_done,
+					       &test, &error_number);
+	if (return_code != RMNETCTL_SUCCESS)
+		goto end;
+	return_code = RMNETCTL_LIB_ERR;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	if (epfd < 0 ||
+	    epoll_ctl(epfd, EPOLL_CTL_ADD, rtrmnet_ctl_get_fd(handle), &ev)) {
+		error_number = RMNETCTL_INIT_ERR_NETLINK_FD;
+		goto end;
+	}
+
+	return_code = RMNETCTL_SUCCESS;
+	while (sent < count || pending) {
+		/* Keep as many requests in flight as the handle takes */
+		while (sent < count) {
+			return_code = rtrmnet_control_flow(handle,
+				RMNET_ASYNC_TEST_DEV, RMNET_ASYNC_TEST_VND, 1,
+				(uint16_t)sent, 100, 0, &codes[sent]);
+			if (return_code != RMNETCTL_SUCCESS)
+				break;
+			sent++;
+		}
+		if (return_code != RMNETCTL_SUCCESS &&
+		    codes[sent] != RMNETCTL_API_ERR_ASYNC_BUSY) {
+			error_number = codes[sent];
+			goto end;
+		}
+
+		ready = epoll_wait(epfd, &ev, 1, RMNET_ASYNC_TEST_TIMEOUT_MS);
+		if (!ready || (ready < 0 && errno != EINTR)) {
+			error_number = RMNETCTL_API_ERR_MESSAGE_RECEIVE;
+			return_code = RMNETCTL_LIB_ERR;
+			goto end;
+		}
+		return_code = rtrmnet_ctl_async_process(handle, &pending,
+							&error_number);
+		if (return_code != RMNETCTL_SUCCESS)
+			goto end;
+	}
+
+	printf("async: %u requests, %u acked, %u rejected, %u lost\n",
+	       count, test.acked, test.rejected, test.lost);
+	if (test.lost)
+		return_code = RMNETCTL_LIB_ERR;
+	for (i = 0; i < count; i++) {
+		if (codes[i] != RMNETCTL_API_SUCCESS &&
+		    codes[i] != ENODEV) {
+			printf("request %u completed with %u\n", i, codes[i]);
+			return_code = RMNETCTL_LIB_ERR;
+		}
+	}
+	error_number = RMNETCTL_API_SUCCESS;
+
+end:
+	print_rmnet_api_status(return_code, error_number);
+	if (epfd >= 0)
+		close(epfd);
+	/* Closing the handle's socket ends the mock peer */
+	rtrmnet_ctl_deinit(handle);
+	if (peer > 0)
+		waitpid(peer, NULL, 0);
+	free(codes);
+	return return_code;
+}
+
+/*!
+* @brief Method to time one flowcontrol request per request against a batch
+* @details Sends count flowcontrol requests to a mock netlink peer one at a
+* time, then the same number queued on a batch, and prints the requests per
+* second of each
+* @param argc Number of arguments
+* @param argv count
+* @return RMNETCTL_SUCCESS if every request was acked
+* @return RMNETCTL_LIB_ERR if there was a library error
+* @return RMNETCTL_INVALID_ARG if invalid arguments were passed
+*/
+static int rmnet_batch_bench(int argc, char *argv[])
+{
+	struct rmnetctl_hndl_s *handle = NULL;
+	struct timespec t0, t1, t2;
+	uint16_t error_number = RMNETCTL_CFG_FAILURE_NO_COMMAND;
+	uint16_t *codes = NULL;
+	uint32_t count, failed = 0, i;
+	int return_code = RMNETCTL_LIB_ERR;
+	double single_s, batch_s;
+	pid_t peer = -1;
+
+	if (argc < 2 || !argv[1] || !_STRTOUI32(argv[1])) {
+		print_rmnet_api_status(RMNETCTL_LIB_ERR,
+		RMNETCTL_CFG_FAILURE_NO_COMMAND);
+		return RMNETCTL_INVALID_ARG;
+	}
+	count = _STRTOUI32(argv[1]);
+
+	codes = calloc(count, sizeof(*codes));
+	if (!codes)
+		return RMNETCTL_LIB_ERR;
+
+	return_code = rtrmnet_ctl_init(&handle, &error_number);
+	if (return_code != RMNETCTL_SUCCESS)
+		goto end;
+	return_code = rmnet_mock_peer_start(handle, 0, &peer, &error_number);
+	if (return_code != RMNETCTL_SUCCESS)
+		goto end;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < count; i++) {
+		return_code = rtrmnet_control_flow(handle,
+			RMNET_ASYNC_TEST_DEV, RMNET_ASYNC_TEST_VND, 1,
+			(uint16_t)i, 100, 0, &error_number);
+		if (return_code != RMNETCTL_SUCCESS)
+			goto end;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return_code = rtrmnet_ctl_batch_start(handle, &error_number);
+	if (return_code != RMNETCTL_SUCCESS)
+		goto end;
+	for (i = 0; i < count; i++) {
+		return_code = rtrmnet_control_flow(handle,
+			RMNET_ASYNC_TEST_DEV, RMNET_ASYNC_TEST_VND, 1,
+			(uint16_t)i, 100, 0, &codes[i]);
+		if (return_code != RMNETCTL_SUCCESS) {
+			error_number = codes[i];
+			goto end;
+		}
+	}
+	return_code = rtrmnet_ctl_batch_commit(handle, &failed, &error_number);
+	if (return_code != RMNETCTL_SUCCESS)
+		goto end;
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	single_s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	batch_s = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+	printf("batch: %u requests, %.0f/s one at a time, %.0f/s batched\n",
+	       count, count / single_s, count / batch_s);
+	error_number = RMNETCTL_API_SUCCESS;
+
+end:
+	print_rmnet_api_status(return_code, error_number);
+	/* Closing the handle's socket ends the mock peer */
+	rtrmnet_ctl_deinit(handle);
+	if (peer > 0)
+		waitpid(peer, NULL, 0);
+	free(codes);
+	return return_code;
+}
+
 /*!
 * @brief Method to make the API calls
 * @details Checks for each type of parameter and calls the appropriate
@@ -319,6 +656,12 @@ static int rmnet_api_call(int argc, char *argv[])
 		return RMNETCTL_LIB_ERR;
 	}
 
+	if (!strcmp(*argv, "-a"))
+		return rmnet_async_test(argc, argv);
+
+	if (!strcmp(*argv, "-b"))
+		return rmnet_batch_bench(argc, argv);
+
 	if (!strcmp(*argv, "-n")) {
 		return_code = rtrmnet_ctl_init(&handle, &error_number);
 		if (return_code != RMNETCTL_SUCCESS) {
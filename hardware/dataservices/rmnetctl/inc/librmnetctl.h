@@ -128,6 +128,9 @@ enum rmnetctl_error_codes_e {
 	RMNETCTL_KERNEL_ERR_BAD_EGRESS_DEVICE = 23,
 	/* TC handle is full */
 	RMNETCTL_KERNEL_ERR_TC_HANDLE_FULL = 24,
+	/* Too many requests in flight on an async handle, process acks and
+	   retry */
+	RMNETCTL_API_ERR_ASYNC_BUSY = 25,
 
 	/* This should always be the last element */
 	RMNETCTL_API_ERR_ENUM_LENGTH
@@ -165,7 +168,8 @@ char rmnetctl_error_code_text
 	"ERROR: Device doesn't exist\n",
 	"ERROR: One or more of the arguments is invalid\n",
 	"ERROR: Egress device is invalid\n",
-	"ERROR: TC handle is full\n"
+	"ERROR: TC handle is full\n",
+	"ERROR: Too many requests in flight on the handle\n"
 };
 
 /*===========================================================================
@@ -173,6 +177,18 @@ char rmnetctl_error_code_text
 ===========================================================================*/
 typedef struct rmnetctl_hndl_s rmnetctl_hndl_t;
 
+/*!
+* @brief Completion callback of a request sent on an async handle
+* @param hndl RmNet handle the request was sent on
+* @param return_code RMNETCTL_SUCCESS, RMNETCTL_KERNEL_ERR if the kernel
+* rejected the request or RMNETCTL_LIB_ERR if its ack was lost
+* @param error_code error_code the request was made with, now holding its
+* status code. Identifies the request
+* @param cookie cookie given to rtrmnet_ctl_async_enable
+*/
+typedef void (*rtrmnet_ctl_async_cb_t)(rmnetctl_hndl_t *hndl, int return_code,
+				       uint16_t *error_code, void *cookie);
+
 /*!
 * @brief Public API to initialize the RMNET control driver
 * @details Allocates memory for the RmNet handle. Creates and binds to a   and
@@ -536,6 +552,88 @@ int rtrmnet_ctl_init(rmnetctl_hndl_t **hndl, uint16_t *error_code);
  */
 int rtrmnet_ctl_deinit(rmnetctl_hndl_t *hndl);
 
+/* @brief Public API to start batching RTM_NETLINK requests on a handle
+ * @details Until rtrmnet_ctl_batch_commit is called, the rtrmnet_ctl_* vnd
+ * and rtrmnet_*_flow calls made with hndl only queue their request and
+ * return RMNETCTL_SUCCESS. Their error_code is written when the batch is
+ * committed, so it has to stay valid until then. Interfaces are looked up
+ * when a request is queued: a request naming an interface which does not
+ * exist fails right away with RMNETCTL_KERNEL_ERR and ENODEV, and one
+ * naming a vnd created or deleted earlier in the same batch fails with
+ * RMNETCTL_KERNEL_ERR and EBUSY. Commit the batch before such requests.
+ * @param hndl RmNet handle for the Netlink messages
+ * @param error_code Status code of this operation
+ * @return RMNETCTL_SUCCESS if successful
+ * @return RMNETCTL_LIB_ERR if a batch was already started, the handle is
+ * async or the batch could not be allocated. Check error_code
+ * @return RMNETCTL_INVALID_ARG if invalid arguments were passed to the API
+ */
+int rtrmnet_ctl_batch_start(rmnetctl_hndl_t *hndl, uint16_t *error_code);
+
+/* @brief Public API to send the requests batched on a handle
+ * @details The requests are sent in multipart messages of up to 64
+ * requests and their acks are matched by sequence number. Each request's
+ * error_code is set from its own ack. The handle is back to sending
+ * requests one at a time afterwards.
+ * @param hndl RmNet handle for the Netlink messages
+ * @param failed Set to the number of requests rejected by the kernel,
+ * may be NULL
+ * @param error_code Status code of this operation, the code of the first
+ * rejected request on RMNETCTL_KERNEL_ERR
+ * @return RMNETCTL_SUCCESS if every request succeeded
+ * @return RMNETCTL_LIB_ERR if there was a library error. Check error_code
+ * @return RMNETCTL_KERNEL_ERR if the kernel rejected any request.
+ * Check the error_code of each request
+ * @return RMNETCTL_INVALID_ARG if invalid arguments were passed to the API
+ */
+int rtrmnet_ctl_batch_commit(rmnetctl_hndl_t *hndl, uint32_t *failed,
+			     uint16_t *error_code);
+
+/* @brief Public API to switch a handle to asynchronous requests
+ * @details Makes the netlink socket of hndl non-blocking. Afterwards the
+ * rtrmnet_ctl_* vnd and rtrmnet_*_flow calls made with hndl return
+ * RMNETCTL_SUCCESS once their request is sent, without waiting for the
+ * ack. Each request completes through cb from rtrmnet_ctl_async_process,
+ * so its error_code has to stay valid until then. Up to 64 requests can
+ * be in flight, past that requests fail with RMNETCTL_API_ERR_ASYNC_BUSY.
+ * Requests still in flight when the handle is deinitialized are dropped
+ * without a callback. A handle can not batch and be async at once.
+ * @param hndl RmNet handle for the Netlink messages
+ * @param cb Called for every completed request, may send new requests
+ * @param cookie Passed to cb
+ * @param error_code Status code of this operation
+ * @return RMNETCTL_SUCCESS if successful
+ * @return RMNETCTL_LIB_ERR if there was a library error. Check error_code
+ * @return RMNETCTL_INVALID_ARG if invalid arguments were passed to the API
+ */
+int rtrmnet_ctl_async_enable(rmnetctl_hndl_t *hndl, rtrmnet_ctl_async_cb_t cb,
+			     void *cookie, uint16_t *error_code);
+
+/* @brief Public API to get the netlink socket of a handle
+ * @details On an async handle the socket can be registered for EPOLLIN in
+ * the caller's event loop, rtrmnet_ctl_async_process is then called when
+ * it is readable.
+ * @param hndl RmNet handle for the Netlink messages
+ * @return The socket file descriptor, -1 if hndl is NULL
+ */
+int rtrmnet_ctl_get_fd(rmnetctl_hndl_t *hndl);
+
+/* @brief Public API to complete the requests acked on an async handle
+ * @details Reads every ack queued on the socket without blocking and runs
+ * the callback of the request each one belongs to.
+ * @param hndl RmNet handle for the Netlink messages
+ * @param pending Set to the number of requests still in flight, may be
+ * NULL
+ * @param error_code Status code of this operation
+ * @return RMNETCTL_SUCCESS if successful
+ * @return RMNETCTL_LIB_ERR if the handle is not async or receiving failed.
+ * Requests in flight when receiving failed are completed with
+ * RMNETCTL_LIB_ERR. Check error_code
+ * @return RMNETCTL_INVALID_ARG if invalid arguments were passed to the API
+ */
+int rtrmnet_ctl_async_process(rmnetctl_hndl_t *hndl, uint32_t *pending,
+			      uint16_t *error_code);
+
 /* @brief Public API to create a new virtual device node
  * @details Message type is RTM_NEWLINK
  * @param hndl RmNet handle for the Netlink message
@@ -52,13 +52,22 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 * @var netlink_fd netlink file descriptor to be used
 * @var src_addr source socket address properties for this message
 * @var dest_addr destination socket address properties for this message
+* @var batch requests queued since rtrmnet_ctl_batch_start, NULL when the
+* requests are sent one at a time
+* @var async requests in flight since rtrmnet_ctl_async_enable, NULL when
+* the handle waits for the ack of each request
 */
 
+struct rmnetctl_batch_s;
+struct rmnetctl_async_s;
+
 struct rmnetctl_hndl_s {
 	 uint32_t pid;
 	 uint32_t transaction_id;
 	 int netlink_fd;
 	 struct sockaddr_nl src_addr, dest_addr;
+	 struct rmnetctl_batch_s *batch;
+	 struct rmnetctl_async_s *async;
 };
 
 #endif /* not defined LIBRMNETCTL_HNDL_H */
@@ -40,6 +40,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 			INCLUDE FILES
 ===========================================================================*/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* recvmmsg */
+#endif
 #include <sys/socket.h>
 #include <stdint.h>
 #include <linux/netlink.h>
@@ -48,6 +51,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <linux/rtnetlink.h>
 #include <linux/gen_stats.h>
 #include <net/if.h>
@@ -96,6 +100,72 @@ struct nlmsg {
 	char data[NLMSG_DATA_SIZE];
 };
 
+/* Requests of a batch in flight at once, and room for the ack of each */
+#define RMNETCTL_BATCH_WINDOW 64
+#define RMNETCTL_BATCH_ACK_SIZE (NLMSG_SPACE(sizeof(struct nlmsgerr)) + \
+				 sizeof(struct nlmsg))
+#define RMNETCTL_BATCH_BUF_SIZE 4096
+
+/* A request queued on a batch, error_code is filled in by its ack */
+struct rmnetctl_batch_op_s {
+	uint32_t seq;
+	size_t offset;
+	uint16_t *error_code;
+	int acked;
+};
+
+/* Interface indexes looked up while queueing a batch */
+#define RMNETCTL_BATCH_IFINDEX_CACHE 4
+
+struct rmnetctl_batch_ifindex_s {
+	char name[IFNAMSIZ];
+	unsigned int index;
+};
+
+/* Names of the vnds created or deleted by requests queued on a batch */
+struct rmnetctl_batch_name_s {
+	char name[IFNAMSIZ];
+};
+
+/* Requests queued between rtrmnet_ctl_batch_start and _commit, stored
+ * back to back in buf as they will be sent
+ */
+struct rmnetctl_batch_s {
+	char *buf;
+	size_t len;
+	size_t size;
+	struct rmnetctl_batch_op_s *ops;
+	uint32_t count;
+	uint32_t ops_size;
+	struct rmnetctl_batch_ifindex_s ifindex[RMNETCTL_BATCH_IFINDEX_CACHE];
+	uint32_t ifindex_next;
+	struct rmnetctl_batch_name_s *changed;
+	uint32_t changed_count;
+	uint32_t changed_size;
+};
+
+/* Requests in flight on an async handle, so their acks fit the socket
+ * receive buffer
+ */
+#define RMNETCTL_ASYNC_MAX_PENDING RMNETCTL_BATCH_WINDOW
+
+/* A request sent on an async handle, waiting for its ack */
+struct rmnetctl_async_op_s {
+	uint32_t seq;
+	uint16_t *error_code;
+	int used;
+};
+
+/* State of a handle after rtrmnet_ctl_async_enable */
+struct rmnetctl_async_s {
+	rtrmnet_ctl_async_cb_t cb;
+	void *cookie;
+	struct rmnetctl_async_op_s ops[RMNETCTL_ASYNC_MAX_PENDING];
+	uint32_t pending;
+	uint32_t next;
+	char *acks;
+};
+
 /* 0 reserved, 1-15 for data, 16-30 for acks */
 #define RMNETCTL_NUM_TX_QUEUES 31
 
@@ -1054,6 +1124,451 @@ static int rmnet_get_ack(rmnetctl_hndl_t *hndl, uint16_t *error_code)
 	return RMNETCTL_API_FIRST_ERR;
 }
 
+/* @brief Appends a request to the batch being queued on a handle
+ * @details The error code of the request is written when the batch is
+ * committed, until then it is set to RMNETCTL_API_ERR_MESSAGE_SEND.
+ * @param *batch Batch the request is queued on
+ * @param *nlh Request to queue
+ * @param *error_code Error code written once the request is acked
+ * @return RMNETCTL_SUCCESS if the request was queued
+ * @return RMNETCTL_LIB_ERR if the batch could not be grown
+ */
+static int rmnet_batch_queue(struct rmnetctl_batch_s *batch,
+			     struct nlmsghdr *nlh, uint16_t *error_code)
+{
+	size_t len = NLMSG_ALIGN(nlh->nlmsg_len);
+	struct rmnetctl_batch_op_s *ops;
+	char *buf;
+	size_t size;
+
+	if (batch->len + len > batch->size) {
+		size = batch->size ? batch->size : RMNETCTL_BATCH_BUF_SIZE;
+		while (size < batch->len + len)
+			size *= 2;
+		buf = realloc(batch->buf, size);
+		if (!buf) {
+			*error_code = RMNETCTL_API_ERR_REQUEST_NULL;
+			return RMNETCTL_LIB_ERR;
+		}
+		batch->buf = buf;
+		batch->size = size;
+	}
+
+	if (batch->count == batch->ops_size) {
+		size = batch->ops_size ? batch->ops_size * 2 :
+					 RMNETCTL_BATCH_WINDOW;
+		ops = realloc(batch->ops, size * sizeof(*ops));
+		if (!ops) {
+			*error_code = RMNETCTL_API_ERR_REQUEST_NULL;
+			return RMNETCTL_LIB_ERR;
+		}
+		batch->ops = ops;
+		batch->ops_size = size;
+	}
+
+	memset(batch->buf + batch->len, 0, len);
+	memcpy(batch->buf + batch->len, nlh, nlh->nlmsg_len);
+
+	ops = &batch->ops[batch->count++];
+	ops->seq = nlh->nlmsg_seq;
+	ops->offset = batch->len;
+	ops->error_code = error_code;
+	ops->acked = 0;
+	batch->len += len;
+
+	*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
+	return RMNETCTL_SUCCESS;
+}
+
+/* @brief Checks if a queued request creates or deletes a vnd
+ * @param *batch Batch being queued
+ * @param *name Name of the vnd
+ * @return 1 if a request queued on the batch creates or deletes name
+ */
+static int rmnet_batch_changed(struct rmnetctl_batch_s *batch,
+			       const char *name)
+{
+	uint32_t i;
+
+	for (i = 0; i < batch->changed_count; i++)
+		if (!strncmp(batch->changed[i].name, name, IFNAMSIZ))
+			return 1;
+	return 0;
+}
+
+/* @brief Records that a request queued on a batch creates or deletes a vnd
+ * @details Later requests of the batch naming the vnd are rejected, as
+ * its index can not be known until the batch is committed.
+ * @param *hndl RmNet handle for this transaction
+ * @param *name Name of the vnd
+ * @param *error_code Error code if the name could not be recorded
+ * @return RMNETCTL_SUCCESS if the name was recorded or no batch is queued
+ * @return RMNETCTL_LIB_ERR if the batch could not be grown
+ */
+static int rmnet_batch_change(rmnetctl_hndl_t *hndl, const char *name,
+			      uint16_t *error_code)
+{
+	struct rmnetctl_batch_s *batch = hndl->batch;
+	struct rmnetctl_batch_name_s *changed;
+	uint32_t size;
+
+	if (!batch || rmnet_batch_changed(batch, name))
+		return RMNETCTL_SUCCESS;
+
+	if (batch->changed_count == batch->changed_size) {
+		size = batch->changed_size ? batch->changed_size * 2 :
+					     RMNETCTL_BATCH_IFINDEX_CACHE;
+		changed = realloc(batch->changed, size * sizeof(*changed));
+		if (!changed) {
+			*error_code = RMNETCTL_API_ERR_REQUEST_NULL;
+			return RMNETCTL_LIB_ERR;
+		}
+		batch->changed = changed;
+		batch->changed_size = size;
+	}
+
+	strlcpy(batch->changed[batch->changed_count++].name, name, IFNAMSIZ);
+	return RMNETCTL_SUCCESS;
+}
+
+/* @brief Looks up the index of an interface
+ * @details if_nametoindex costs a socket and an ioctl, which is more than
+ * queueing the request itself. While a batch is queued the few interfaces
+ * its requests name are looked up once. A vnd created or deleted earlier
+ * in the same batch has no index yet, or a stale one, so it is refused.
+ * @param *hndl RmNet handle for this transaction
+ * @param *name Name of the interface
+ * @return Index of the interface
+ * @return -1 with errno set to ENODEV if there is no such interface, or to
+ * EBUSY if a request queued on the batch creates or deletes it
+ */
+static int rtrmnet_ifindex(rmnetctl_hndl_t *hndl, const char *name)
+{
+	struct rmnetctl_batch_s *batch = hndl->batch;
+	struct rmnetctl_batch_ifindex_s *entry;
+	unsigned int index;
+	int i;
+
+	if (batch) {
+		if (rmnet_batch_changed(batch, name)) {
+			errno = EBUSY;
+			return -1;
+		}
+
+		for (i = 0; i < RMNETCTL_BATCH_IFINDEX_CACHE; i++)
+			if (batch->ifindex[i].index &&
+			    !strncmp(batch->ifindex[i].name, name, IFNAMSIZ))
+				return batch->ifindex[i].index;
+	}
+
+	index = if_nametoindex(name);
+	if (!index) {
+		errno = ENODEV;
+		return -1;
+	}
+
+	if (batch) {
+		entry = &batch->ifindex[batch->ifindex_next++ %
+					RMNETCTL_BATCH_IFINDEX_CACHE];
+		strlcpy(entry->name, name, IFNAMSIZ);
+		entry->index = index;
+	}
+	return index;
+}
+
+/* @brief Sends a request on an async handle without waiting for its ack
+ * @details The error code of the request is set to
+ * RMNETCTL_API_ERR_MESSAGE_SEND until its ack is processed.
+ * @param *hndl RmNet handle for this transaction
+ * @param *nlh Request to send
+ * @param *error_code Error code of the request
+ * @return RMNETCTL_SUCCESS if the request was sent
+ * @return RMNETCTL_LIB_ERR if the request could not be sent, error_code is
+ * RMNETCTL_API_ERR_ASYNC_BUSY if it can be retried once acks are processed
+ */
+static int rmnet_async_send(rmnetctl_hndl_t *hndl, struct nlmsghdr *nlh,
+			    uint16_t *error_code)
+{
+	struct rmnetctl_async_s *async = hndl->async;
+	struct rmnetctl_async_op_s *op;
+	uint32_t i;
+
+	if (async->pending == RMNETCTL_ASYNC_MAX_PENDING) {
+		*error_code = RMNETCTL_API_ERR_ASYNC_BUSY;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	if (send(hndl->netlink_fd, nlh, nlh->nlmsg_len, MSG_DONTWAIT) < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			*error_code = RMNETCTL_API_ERR_ASYNC_BUSY;
+		else
+			*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	for (i = async->next; async->ops[i].used;
+	     i = (i + 1) % RMNETCTL_ASYNC_MAX_PENDING)
+		;
+	op = &async->ops[i];
+	op->seq = nlh->nlmsg_seq;
+	op->error_code = error_code;
+	op->used = 1;
+	async->next = (i + 1) % RMNETCTL_ASYNC_MAX_PENDING;
+	async->pending++;
+
+	*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
+	return RMNETCTL_SUCCESS;
+}
+
+/* @brief Sends a request built by one of the rtrmnet calls
+ * @details Waits for the ack of the request, queues the request if a
+ * batch was started on the handle, or leaves the ack to
+ * rtrmnet_ctl_async_process on an async handle.
+ * @param *hndl RmNet handle for this transaction
+ * @param *nlh Request to send
+ * @param *error_code Error code if transaction fails
+ * @return RMNETCTL_SUCCESS if the request was acked or queued
+ * @return RMNETCTL_LIB_ERR if the request could not be sent or queued
+ * @return RMNETCTL_KERNEL_ERR if the kernel rejected the request
+ */
+static int rtrmnet_send_req(rmnetctl_hndl_t *hndl, struct nlmsghdr *nlh,
+			    uint16_t *error_code)
+{
+	if (hndl->batch)
+		return rmnet_batch_queue(hndl->batch, nlh, error_code);
+
+	if (hndl->async)
+		return rmnet_async_send(hndl, nlh, error_code);
+
+	if (send(hndl->netlink_fd, nlh, nlh->nlmsg_len, 0) < 0) {
+		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	return rmnet_get_ack(hndl, error_code);
+}
+
+/* @brief Matches the acks in a receive buffer with the requests in flight
+ * @param *batch Batch being committed
+ * @param first Index of the first request of the window
+ * @param count Number of requests in the window
+ * @param *buf Received messages
+ * @param len Length of buf
+ * @param *failed Incremented for every request the kernel rejected
+ * @return Number of requests of the window acked by buf
+ */
+static uint32_t rmnet_batch_match_acks(struct rmnetctl_batch_s *batch,
+				       uint32_t first, uint32_t count,
+				       char *buf, int len, uint32_t *failed)
+{
+	struct nlmsghdr *nlh;
+	struct nlmsgerr *err;
+	struct rmnetctl_batch_op_s *op;
+	uint32_t i, acked = 0;
+
+	for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+	     nlh = NLMSG_NEXT(nlh, len)) {
+		if (nlh->nlmsg_type != NLMSG_ERROR)
+			continue;
+
+		/* Acks come back in order, so the first guess is usually it */
+		op = NULL;
+		i = nlh->nlmsg_seq - batch->ops[first].seq;
+		if (i < count && batch->ops[first + i].seq == nlh->nlmsg_seq)
+			op = &batch->ops[first + i];
+		for (i = 0; !op && i < count; i++)
+			if (batch->ops[first + i].seq == nlh->nlmsg_seq)
+				op = &batch->ops[first + i];
+		if (!op || op->acked)
+			continue;
+
+		err = (struct nlmsgerr *)NLMSG_DATA(nlh);
+		if (err->error) {
+			*op->error_code = -err->error;
+			(*failed)++;
+		} else {
+			*op->error_code = RMNETCTL_API_SUCCESS;
+		}
+		op->acked = 1;
+		acked++;
+	}
+
+	return acked;
+}
+
+/* @brief Sends the queued requests and collects their acks
+ * @details Requests are sent RMNETCTL_BATCH_WINDOW at a time in a single
+ * multipart message, and the acks of a window are drained before the next
+ * one is sent so they can not overrun the socket receive buffer.
+ * @param *hndl RmNet handle for this transaction
+ * @param *batch Batch to send
+ * @param *failed Set to the number of requests the kernel rejected
+ * @param *error_code Error code if transaction fails
+ * @return RMNETCTL_SUCCESS if every request was sent and acked
+ * @return RMNETCTL_LIB_ERR if sending or receiving failed
+ */
+static int rmnet_batch_send(rmnetctl_hndl_t *hndl,
+			    struct rmnetctl_batch_s *batch,
+			    uint32_t *failed, uint16_t *error_code)
+{
+	struct mmsghdr msgs[RMNETCTL_BATCH_WINDOW];
+	struct iovec iov[RMNETCTL_BATCH_WINDOW];
+	char *acks;
+	uint32_t first, count, pending, i;
+	size_t start, end;
+	int received, rc = RMNETCTL_SUCCESS;
+
+	acks = malloc(RMNETCTL_BATCH_WINDOW * RMNETCTL_BATCH_ACK_SIZE);
+	if (!acks) {
+		*error_code = RMNETCTL_API_ERR_RESPONSE_NULL;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	for (first = 0; first < batch->count; first += count) {
+		count = min(batch->count - first, RMNETCTL_BATCH_WINDOW);
+		start = batch->ops[first].offset;
+		end = first + count < batch->count ?
+		      batch->ops[first + count].offset : batch->len;
+
+		if (send(hndl->netlink_fd, batch->buf + start, end - start,
+			 0) < 0) {
+			*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
+			rc = RMNETCTL_LIB_ERR;
+			break;
+		}
+
+		for (pending = count; pending; ) {
+			for (i = 0; i < RMNETCTL_BATCH_WINDOW; i++) {
+				iov[i].iov_base = acks +
+						  i * RMNETCTL_BATCH_ACK_SIZE;
+				iov[i].iov_len = RMNETCTL_BATCH_ACK_SIZE;
+				memset(&msgs[i], 0, sizeof(msgs[i]));
+				msgs[i].msg_hdr.msg_iov = &iov[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			/* Every ack is its own datagram, take all queued */
+			received = recvmmsg(hndl->netlink_fd, msgs, pending,
+					    MSG_WAITFORONE, NULL);
+			if (received < 0) {
+				if (errno == EINTR)
+					continue;
+				for (i = first; i < first + count; i++)
+					if (!batch->ops[i].acked)
+						*batch->ops[i].error_code =
+						RMNETCTL_API_ERR_MESSAGE_RECEIVE;
+				*error_code = RMNETCTL_API_ERR_MESSAGE_RECEIVE;
+				rc = RMNETCTL_LIB_ERR;
+				goto out;
+			}
+
+			for (i = 0; i < (uint32_t)received && pending; i++)
+				pending -= rmnet_batch_match_acks(batch, first,
+					count, iov[i].iov_base,
+					(int)msgs[i].msg_len, failed);
+		}
+	}
+
+out:
+	/* Requests that were never sent keep RMNETCTL_API_ERR_MESSAGE_SEND */
+	free(acks);
+	return rc;
+}
+
+/* @brief Frees a batch and the requests queued on it
+ * @param *batch Batch to free
+ */
+static void rmnet_batch_free(struct rmnetctl_batch_s *batch)
+{
+	if (!batch)
+		return;
+
+	free(batch->buf);
+	free(batch->ops);
+	free(batch->changed);
+	free(batch);
+}
+
+/* @brief Completes the request an ack belongs to
+ * @details The request is released before the callback runs, so the
+ * callback may send new requests on the handle.
+ * @param *hndl RmNet handle the request was sent on
+ * @param *nlh Received ack
+ */
+static void rmnet_async_complete(rmnetctl_hndl_t *hndl, struct nlmsghdr *nlh)
+{
+	struct rmnetctl_async_s *async = hndl->async;
+	struct rmnetctl_async_op_s *op = NULL;
+	struct nlmsgerr *err;
+	uint16_t *error_code;
+	uint32_t oldest, i;
+	int rc;
+
+	/* Acks come back in order, so the oldest request is usually it */
+	oldest = async->next + RMNETCTL_ASYNC_MAX_PENDING - async->pending;
+	for (i = 0; i < RMNETCTL_ASYNC_MAX_PENDING; i++) {
+		op = &async->ops[(oldest + i) % RMNETCTL_ASYNC_MAX_PENDING];
+		if (op->used && op->seq == nlh->nlmsg_seq)
+			break;
+	}
+	if (i == RMNETCTL_ASYNC_MAX_PENDING)
+		return;
+
+	error_code = op->error_code;
+	err = (struct nlmsgerr *)NLMSG_DATA(nlh);
+	if (err->error) {
+		*error_code = -err->error;
+		rc = RMNETCTL_KERNEL_ERR;
+	} else {
+		*error_code = RMNETCTL_API_SUCCESS;
+		rc = RMNETCTL_SUCCESS;
+	}
+	op->used = 0;
+	async->pending--;
+
+	async->cb(hndl, rc, error_code, async->cookie);
+}
+
+/* @brief Fails every request in flight on an async handle
+ * @details Used when acks were lost, the callback of each request is run
+ * with RMNETCTL_LIB_ERR and RMNETCTL_API_ERR_MESSAGE_RECEIVE. The requests
+ * are all released before the first callback runs, so requests sent from
+ * a callback are not failed with them.
+ * @param *hndl RmNet handle the requests were sent on
+ */
+static void rmnet_async_fail_all(rmnetctl_hndl_t *hndl)
+{
+	struct rmnetctl_async_s *async = hndl->async;
+	uint16_t *failed[RMNETCTL_ASYNC_MAX_PENDING];
+	uint32_t count = 0, i;
+
+	for (i = 0; i < RMNETCTL_ASYNC_MAX_PENDING; i++) {
+		if (!async->ops[i].used)
+			continue;
+		failed[count] = async->ops[i].error_code;
+		*failed[count++] = RMNETCTL_API_ERR_MESSAGE_RECEIVE;
+		async->ops[i].used = 0;
+	}
+	async->pending = 0;
+
+	for (i = 0; i < count; i++)
+		async->cb(hndl, RMNETCTL_LIB_ERR, failed[i], async->cookie);
+}
+
+/* @brief Frees the async state of a handle
+ * @details Requests still in flight are dropped without running their
+ * callback.
+ * @param *async Async state to free
+ */
+static void rmnet_async_free(struct rmnetctl_async_s *async)
+{
+	if (!async)
+		return;
+
+	free(async->acks);
+	free(async);
+}
+
 /*
  *                       EXPOSED NEW DRIVER API
  */
@@ -1119,12 +1634,186 @@ int rtrmnet_ctl_deinit(rmnetctl_hndl_t *hndl)
 	if (!hndl)
 		return RMNETCTL_SUCCESS;
 
+	rmnet_batch_free(hndl->batch);
+	rmnet_async_free(hndl->async);
 	close(hndl->netlink_fd);
 	free(hndl);
 
 	return RMNETCTL_SUCCESS;
 }
 
+int rtrmnet_ctl_batch_start(rmnetctl_hndl_t *hndl, uint16_t *error_code)
+{
+	if (!hndl || !error_code)
+		return RMNETCTL_INVALID_ARG;
+
+	/* Committing blocks on the acks, which an async handle can not do */
+	if (hndl->batch || hndl->async) {
+		*error_code = RMNETCTL_API_ERR_REQUEST_INVALID;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	hndl->batch = calloc(1, sizeof(*hndl->batch));
+	if (!hndl->batch) {
+		*error_code = RMNETCTL_API_ERR_REQUEST_NULL;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	*error_code = RMNETCTL_API_SUCCESS;
+	return RMNETCTL_SUCCESS;
+}
+
+int rtrmnet_ctl_batch_commit(rmnetctl_hndl_t *hndl, uint32_t *failed,
+			     uint16_t *error_code)
+{
+	struct rmnetctl_batch_s *batch;
+	uint32_t rejected = 0, i;
+	int rc;
+
+	if (!hndl || !error_code)
+		return RMNETCTL_INVALID_ARG;
+
+	batch = hndl->batch;
+	if (!batch) {
+		*error_code = RMNETCTL_API_ERR_REQUEST_NULL;
+		return RMNETCTL_LIB_ERR;
+	}
+	hndl->batch = NULL;
+
+	*error_code = RMNETCTL_API_SUCCESS;
+	rc = rmnet_batch_send(hndl, batch, &rejected, error_code);
+	if (rc == RMNETCTL_SUCCESS && rejected) {
+		/* Report the first request the kernel rejected */
+		for (i = 0; i < batch->count; i++) {
+			if (*batch->ops[i].error_code != RMNETCTL_API_SUCCESS) {
+				*error_code = *batch->ops[i].error_code;
+				break;
+			}
+		}
+		rc = RMNETCTL_KERNEL_ERR;
+	}
+
+	if (failed)
+		*failed = rejected;
+	rmnet_batch_free(batch);
+	return rc;
+}
+
+int rtrmnet_ctl_async_enable(rmnetctl_hndl_t *hndl, rtrmnet_ctl_async_cb_t cb,
+			     void *cookie, uint16_t *error_code)
+{
+	int flags;
+
+	if (!hndl || !cb || !error_code)
+		return RMNETCTL_INVALID_ARG;
+
+	if (hndl->batch || hndl->async) {
+		*error_code = RMNETCTL_API_ERR_REQUEST_INVALID;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	hndl->async = calloc(1, sizeof(*hndl->async));
+	if (!hndl->async) {
+		*error_code = RMNETCTL_API_ERR_REQUEST_NULL;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	hndl->async->acks = malloc(RMNETCTL_ASYNC_MAX_PENDING *
+				   RMNETCTL_BATCH_ACK_SIZE);
+	if (!hndl->async->acks) {
+		rmnet_async_free(hndl->async);
+		hndl->async = NULL;
+		*error_code = RMNETCTL_API_ERR_RESPONSE_NULL;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	flags = fcntl(hndl->netlink_fd, F_GETFL);
+	if (flags < 0 ||
+	    fcntl(hndl->netlink_fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		rmnet_async_free(hndl->async);
+		hndl->async = NULL;
+		*error_code = RMNETCTL_INIT_ERR_NETLINK_FD;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	hndl->async->cb = cb;
+	hndl->async->cookie = cookie;
+	*error_code = RMNETCTL_API_SUCCESS;
+	return RMNETCTL_SUCCESS;
+}
+
+int rtrmnet_ctl_get_fd(rmnetctl_hndl_t *hndl)
+{
+	if (!hndl)
+		return -1;
+
+	return hndl->netlink_fd;
+}
+
+int rtrmnet_ctl_async_process(rmnetctl_hndl_t *hndl, uint32_t *pending,
+			      uint16_t *error_code)
+{
+	struct rmnetctl_async_s *async;
+	struct mmsghdr msgs[RMNETCTL_ASYNC_MAX_PENDING];
+	struct iovec iov[RMNETCTL_ASYNC_MAX_PENDING];
+	struct nlmsghdr *nlh;
+	int received, len, i, rc = RMNETCTL_SUCCESS;
+
+	if (!hndl || !error_code)
+		return RMNETCTL_INVALID_ARG;
+
+	async = hndl->async;
+	if (!async) {
+		*error_code = RMNETCTL_API_ERR_REQUEST_INVALID;
+		return RMNETCTL_LIB_ERR;
+	}
+
+	*error_code = RMNETCTL_API_SUCCESS;
+	for (;;) {
+		for (i = 0; i < RMNETCTL_ASYNC_MAX_PENDING; i++) {
+			iov[i].iov_base = async->acks +
+					  i * RMNETCTL_BATCH_ACK_SIZE;
+			iov[i].iov_len = RMNETCTL_BATCH_ACK_SIZE;
+			memset(&msgs[i], 0, sizeof(msgs[i]));
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		received = recvmmsg(hndl->netlink_fd, msgs,
+				    RMNETCTL_ASYNC_MAX_PENDING, MSG_DONTWAIT,
+				    NULL);
+		if (received < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			/* ENOBUFS means acks were dropped, nothing in flight
+			 * can be matched any more
+			 */
+			rmnet_async_fail_all(hndl);
+			*error_code = RMNETCTL_API_ERR_MESSAGE_RECEIVE;
+			rc = RMNETCTL_LIB_ERR;
+			break;
+		}
+
+		for (i = 0; i < received; i++) {
+			len = (int)msgs[i].msg_len;
+			for (nlh = (struct nlmsghdr *)iov[i].iov_base;
+			     NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+				if (nlh->nlmsg_type == NLMSG_ERROR)
+					rmnet_async_complete(hndl, nlh);
+		}
+
+		/* A short read drained the socket */
+		if (received < RMNETCTL_ASYNC_MAX_PENDING)
+			break;
+	}
+
+	if (pending)
+		*pending = async->pending;
+	return rc;
+}
+
 int rtrmnet_ctl_newvnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
 		       uint16_t *error_code, uint8_t  index,
 		       uint32_t flagconfig)
@@ -1151,7 +1840,7 @@ int rtrmnet_ctl_newvnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
 	hndl->transaction_id++;
 
 	/* Get index of devname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1238,12 +1927,10 @@ int rtrmnet_ctl_newvnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
 
 	linkinfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)linkinfo;
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
+	if (rmnet_batch_change(hndl, vndname, error_code))
 		return RMNETCTL_LIB_ERR;
-	}
 
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 int rtrmnet_ctl_delvnd(rmnetctl_hndl_t *hndl, char *vndname,
@@ -1263,20 +1950,18 @@ int rtrmnet_ctl_delvnd(rmnetctl_hndl_t *hndl, char *vndname,
 	hndl->transaction_id++;
 
 	/* Get index of vndname*/
-	devindex = if_nametoindex(vndname);
+	devindex = rtrmnet_ifindex(hndl, vndname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
 	}
 
-	/* Setup index attribute */
-	req.ifmsg.ifi_index = devindex;
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
+	if (rmnet_batch_change(hndl, vndname, error_code))
 		return RMNETCTL_LIB_ERR;
-	}
 
-	return rmnet_get_ack(hndl, error_code);
+	/* Setup index attribute */
+	req.ifmsg.ifi_index = devindex;
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 
@@ -1306,7 +1991,7 @@ int rtrmnet_ctl_changevnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
 	hndl->transaction_id++;
 
 	/* Get index of devname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1385,12 +2070,7 @@ int rtrmnet_ctl_changevnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
 
 	linkinfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)linkinfo;
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
-		return RMNETCTL_LIB_ERR;
-	}
-
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 int rtrmnet_ctl_bridgevnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
@@ -1413,13 +2093,13 @@ int rtrmnet_ctl_bridgevnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
 	hndl->transaction_id++;
 
 	/* Get index of vndname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
 	}
 
-	vndindex = if_nametoindex(vndname);
+	vndindex = rtrmnet_ifindex(hndl, vndname);
 	if (vndindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1436,12 +2116,7 @@ int rtrmnet_ctl_bridgevnd(rmnetctl_hndl_t *hndl, char *devname, char *vndname,
 	req.nl_addr.nlmsg_len = NLMSG_ALIGN(req.nl_addr.nlmsg_len) +
 				RTA_ALIGN(RTA_LENGTH(sizeof(vndindex)));
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
-		return RMNETCTL_LIB_ERR;
-	}
-
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 
@@ -1478,7 +2153,7 @@ int rtrmnet_activate_flow(rmnetctl_hndl_t *hndl,
 	hndl->transaction_id++;
 
 	/* Get index of devname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1548,12 +2223,7 @@ int rtrmnet_activate_flow(rmnetctl_hndl_t *hndl,
 
 	linkinfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)linkinfo;
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
-		return RMNETCTL_LIB_ERR;
-	}
-
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 
@@ -1588,7 +2258,7 @@ int rtrmnet_delete_flow(rmnetctl_hndl_t *hndl,
 	hndl->transaction_id++;
 
 	/* Get index of devname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1658,12 +2328,7 @@ int rtrmnet_delete_flow(rmnetctl_hndl_t *hndl,
 
 	linkinfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)linkinfo;
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
-		return RMNETCTL_LIB_ERR;
-	}
-
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 int rtrmnet_control_flow(rmnetctl_hndl_t *hndl,
@@ -1698,7 +2363,7 @@ int rtrmnet_control_flow(rmnetctl_hndl_t *hndl,
 	hndl->transaction_id++;
 
 	/* Get index of devname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1767,12 +2432,7 @@ int rtrmnet_control_flow(rmnetctl_hndl_t *hndl,
 	datainfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)datainfo;
 	linkinfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)linkinfo;
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
-		return RMNETCTL_LIB_ERR;
-	}
-
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 
@@ -1808,7 +2468,7 @@ int rtrmnet_flow_state_up(rmnetctl_hndl_t *hndl,
 	hndl->transaction_id++;
 
 	/* Get index of devname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1877,12 +2537,7 @@ int rtrmnet_flow_state_up(rmnetctl_hndl_t *hndl,
 	datainfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)datainfo;
 	linkinfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)linkinfo;
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
-		return RMNETCTL_LIB_ERR;
-	}
-
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
 
 
@@ -1915,7 +2570,7 @@ int rtrmnet_flow_state_down(rmnetctl_hndl_t *hndl,
 	hndl->transaction_id++;
 
 	/* Get index of devname*/
-	devindex = if_nametoindex(devname);
+	devindex = rtrmnet_ifindex(hndl, devname);
 	if (devindex < 0) {
 		*error_code = errno;
 		return RMNETCTL_KERNEL_ERR;
@@ -1984,10 +2639,5 @@ int rtrmnet_flow_state_down(rmnetctl_hndl_t *hndl,
 	datainfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)datainfo;
 	linkinfo->rta_len = (char *)NLMSG_TAIL(&req.nl_addr) - (char *)linkinfo;
 
-	if (send(hndl->netlink_fd, &req, req.nl_addr.nlmsg_len, 0) < 0) {
-		*error_code = RMNETCTL_API_ERR_MESSAGE_SEND;
-		return RMNETCTL_LIB_ERR;
-	}
-
-	return rmnet_get_ack(hndl, error_code);
+	return rtrmnet_send_req(hndl, &req.nl_addr, error_code);
 }
@@ -0,0 +1,289 @@
+/******************************************************************************
+
+			R M N E T _ A S Y N C _ T E S T . C
+
+******************************************************************************/
+
+/******************************************************************************
+
+  @file	rmnet_async_test.c
+  @brief Host test of the async rtrmnet handle mode
+
+  DESCRIPTION
+  Drives an async handle whose netlink socket is replaced by one end of a
+  socketpair. The test holds the other end and plays the kernel, so it
+  decides which requests are acked, in which order and with which error.
+  The library is built into the test to reach rmnet_async_fail_all.
+
+******************************************************************************/
+
+/*===========================================================================
+				INCLUDE FILES
+===========================================================================*/
+
+#include "../src/librmnetctl.c"
+
+#define TEST_DEV "lo"
+#define TEST_VND "rmnet_data0"
+
+static int failures;
+
+#define CHECK(X) do { if (!(X)) {                                      \
+		printf("%s:%d: CHECK(%s) failed\n", __func__, __LINE__, #X); \
+		failures++;                                            \
+	} } while (0)
+
+/*!
+* @brief Completions seen by the test callback
+*/
+struct rmnet_test_s {
+	uint32_t done;
+	uint32_t lib_err;
+	uint32_t kernel_err;
+	/* Requests the callback still has to send from inside itself */
+	uint32_t resend;
+	uint16_t resend_codes[RMNETCTL_ASYNC_MAX_PENDING];
+	uint32_t resent;
+};
+
+/*!
+* @brief Handle and peer socket of one test
+*/
+struct rmnet_test_env_s {
+	rmnetctl_hndl_t *hndl;
+	int peer;
+	struct rmnet_test_s test;
+};
+
+static int rmnet_test_send(rmnetctl_hndl_t *hndl, uint16_t *error_code)
+{
+	return rtrmnet_control_flow(hndl, TEST_DEV, TEST_VND, 1, 0, 100, 0,
+				    error_code);
+}
+
+static void rmnet_test_cb(rmnetctl_hndl_t *hndl, int return_code,
+			  uint16_t *error_code, void *cookie)
+{
+	struct rmnet_test_s *test = cookie;
+
+	(void)error_code;
+	test->done++;
+	if (return_code == RMNETCTL_LIB_ERR)
+		test->lib_err++;
+	else if (return_code == RMNETCTL_KERNEL_ERR)
+		test->kernel_err++;
+
+	if (test->resend) {
+		test->resend--;
+		CHECK(rmnet_test_send(hndl,
+			&test->resend_codes[test->resent++]) ==
+		      RMNETCTL_SUCCESS);
+	}
+}
+
+static int rmnet_test_setup(struct rmnet_test_env_s *env)
+{
+	uint16_t error_code;
+	int sv[2];
+
+	memset(env, 0, sizeof(*env));
+	if (rtrmnet_ctl_init(&env->hndl, &error_code) != RMNETCTL_SUCCESS ||
+	    socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0)
+		return -1;
+	if (dup2(sv[0], env->hndl->netlink_fd) < 0)
+		return -1;
+	close(sv[0]);
+	env->peer = sv[1];
+
+	return rtrmnet_ctl_async_enable(env->hndl, rmnet_test_cb, &env->test,
+					&error_code);
+}
+
+static void rmnet_test_teardown(struct rmnet_test_env_s *env)
+{
+	rtrmnet_ctl_deinit(env->hndl);
+	close(env->peer);
+}
+
+/*!
+* @brief Reads the next request the handle sent
+* @return Sequence number of the request, -1 if there is none
+*/
+static int64_t rmnet_test_read(struct rmnet_test_env_s *env)
+{
+	char buf[1024];
+	struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+
+	if (recv(env->peer, buf, sizeof(buf), MSG_DONTWAIT) <
+	    (ssize_t)sizeof(*nlh))
+		return -1;
+	return nlh->nlmsg_seq;
+}
+
+static void rmnet_test_ack(struct rmnet_test_env_s *env, uint32_t seq,
+			   int error)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct nlmsgerr err;
+	} ack;
+
+	memset(&ack, 0, sizeof(ack));
+	ack.nlh.nlmsg_len = sizeof(ack);
+	ack.nlh.nlmsg_type = NLMSG_ERROR;
+	ack.nlh.nlmsg_seq = seq;
+	ack.err.error = error;
+	CHECK(send(env->peer, &ack, sizeof(ack), 0) == sizeof(ack));
+}
+
+static uint32_t rmnet_test_process(struct rmnet_test_env_s *env)
+{
+	uint32_t pending = ~0U;
+	uint16_t error_code;
+
+	CHECK(rtrmnet_ctl_async_process(env->hndl, &pending, &error_code) ==
+	      RMNETCTL_SUCCESS);
+	return pending;
+}
+
+/*!
+* @brief Acks in any order complete the request they name, and only once
+*/
+static void test_ack_matching(void)
+{
+	struct rmnet_test_env_s env;
+	uint16_t codes[8];
+	int64_t seqs[8];
+	int i;
+
+	CHECK(rmnet_test_setup(&env) == RMNETCTL_SUCCESS);
+	for (i = 0; i < 8; i++) {
+		CHECK(rmnet_test_send(env.hndl, &codes[i]) == RMNETCTL_SUCCESS);
+		CHECK(codes[i] == RMNETCTL_API_ERR_MESSAGE_SEND);
+		seqs[i] = rmnet_test_read(&env);
+		CHECK(seqs[i] >= 0);
+	}
+
+	/* Newest first, odd ones rejected, plus a stray and a repeated ack */
+	for (i = 7; i >= 0; i--)
+		rmnet_test_ack(&env, seqs[i], i % 2 ? -ENODEV : 0);
+	rmnet_test_ack(&env, seqs[7] + 100, 0);
+	rmnet_test_ack(&env, seqs[3], 0);
+
+	CHECK(rmnet_test_process(&env) == 0);
+	CHECK(env.test.done == 8);
+	CHECK(env.test.kernel_err == 4);
+	CHECK(env.test.lib_err == 0);
+	for (i = 0; i < 8; i++)
+		CHECK(codes[i] == (i % 2 ? ENODEV : RMNETCTL_API_SUCCESS));
+
+	rmnet_test_teardown(&env);
+}
+
+/*!
+* @brief Past 64 requests in flight sends are refused, not queued
+*/
+static void test_busy_limit(void)
+{
+	struct rmnet_test_env_s env;
+	uint16_t codes[RMNETCTL_ASYNC_MAX_PENDING + 1];
+	int64_t first;
+	int i;
+
+	CHECK(rmnet_test_setup(&env) == RMNETCTL_SUCCESS);
+	for (i = 0; i < RMNETCTL_ASYNC_MAX_PENDING; i++)
+		CHECK(rmnet_test_send(env.hndl, &codes[i]) == RMNETCTL_SUCCESS);
+
+	CHECK(rmnet_test_send(env.hndl, &codes[i]) == RMNETCTL_LIB_ERR);
+	CHECK(codes[i] == RMNETCTL_API_ERR_ASYNC_BUSY);
+
+	/* Only the accepted requests reached the socket */
+	first = rmnet_test_read(&env);
+	for (i = 1; i < RMNETCTL_ASYNC_MAX_PENDING; i++)
+		CHECK(rmnet_test_read(&env) >= 0);
+	CHECK(rmnet_test_read(&env) == -1);
+
+	/* One ack makes room for one more */
+	rmnet_test_ack(&env, first, 0);
+	CHECK(rmnet_test_process(&env) == RMNETCTL_ASYNC_MAX_PENDING - 1);
+	CHECK(rmnet_test_send(env.hndl, &codes[RMNETCTL_ASYNC_MAX_PENDING]) ==
+	      RMNETCTL_SUCCESS);
+	CHECK(rmnet_test_send(env.hndl, &codes[0]) == RMNETCTL_LIB_ERR);
+	CHECK(codes[0] == RMNETCTL_API_ERR_ASYNC_BUSY);
+
+	rmnet_test_teardown(&env);
+}
+
+/*!
+* @brief Callbacks may send while acks are processed
+*/
+static void test_reentrant_complete(void)
+{
+	struct rmnet_test_env_s env;
+	uint16_t codes[4];
+	int64_t seq;
+	int i;
+
+	CHECK(rmnet_test_setup(&env) == RMNETCTL_SUCCESS);
+	for (i = 0; i < 4; i++)
+		CHECK(rmnet_test_send(env.hndl, &codes[i]) == RMNETCTL_SUCCESS);
+	env.test.resend = 4;
+	for (i = 0; i < 4; i++)
+		rmnet_test_ack(&env, rmnet_test_read(&env), 0);
+
+	CHECK(rmnet_test_process(&env) == 4);
+	CHECK(env.test.done == 4);
+	CHECK(env.test.resent == 4);
+
+	/* The resent requests complete on their own acks */
+	while ((seq = rmnet_test_read(&env)) >= 0)
+		rmnet_test_ack(&env, seq, 0);
+	CHECK(rmnet_test_process(&env) == 0);
+	CHECK(env.test.done == 8);
+	for (i = 0; i < 4; i++)
+		CHECK(env.test.resend_codes[i] == RMNETCTL_API_SUCCESS);
+
+	rmnet_test_teardown(&env);
+}
+
+/*!
+* @brief Requests sent from the callbacks of lost requests are not lost too
+* @details The handle is not full, so the requests sent by the callbacks
+* land in the slots after the failed ones.
+*/
+static void test_reentrant_fail_all(void)
+{
+	struct rmnet_test_env_s env;
+	uint16_t codes[4];
+	int i;
+
+	CHECK(rmnet_test_setup(&env) == RMNETCTL_SUCCESS);
+	for (i = 0; i < 4; i++)
+		CHECK(rmnet_test_send(env.hndl, &codes[i]) == RMNETCTL_SUCCESS);
+	env.test.resend = 4;
+
+	rmnet_async_fail_all(env.hndl);
+
+	CHECK(env.test.done == 4);
+	CHECK(env.test.lib_err == 4);
+	CHECK(env.test.resent == 4);
+	CHECK(env.hndl->async->pending == 4);
+	for (i = 0; i < 4; i++) {
+		CHECK(codes[i] == RMNETCTL_API_ERR_MESSAGE_RECEIVE);
+		CHECK(env.test.resend_codes[i] ==
+		      RMNETCTL_API_ERR_MESSAGE_SEND);
+	}
+
+	rmnet_test_teardown(&env);
+}
+
+int main(void)
+{
+	test_ack_matching();
+	test_busy_limit();
+	test_reentrant_complete();
+	test_reentrant_fail_all();
+
+	printf("%s\n", failures ? "FAILED" : "SUCCESS");
+	return failures ? RMNETCTL_LIB_ERR : RMNETCTL_SUCCESS;
+}
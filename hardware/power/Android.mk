@@ -20,8 +20,10 @@ LOCAL_SRC_FILES := \
     power-common.c \
     metadata-parser.c \
     utils.c \
-    list.c \
     hint-data.c \
+    frame-feedback.c \
+    interaction-policy.c \
+    power-trace.c \
     Power.cpp \
     main.cpp
 
@@ -40,6 +42,11 @@ ifneq ($(TARGET_POWERHAL_MODE_EXT),)
     LOCAL_SRC_FILES += ../../../../../$(TARGET_POWERHAL_MODE_EXT)
 endif
 
+ifneq ($(TARGET_POWERHAL_BOOST_EXT),)
+    LOCAL_CFLAGS += -DBOOST_EXT
+    LOCAL_SRC_FILES += ../../../../../$(TARGET_POWERHAL_BOOST_EXT)
+endif
+
 ifneq ($(TARGET_POWERHAL_SET_INTERACTIVE_EXT),)
     LOCAL_CFLAGS += -DSET_INTERACTIVE_EXT
     LOCAL_SRC_FILES += ../../../../../$(TARGET_POWERHAL_SET_INTERACTIVE_EXT)
@@ -53,6 +60,10 @@ ifeq ($(TARGET_USES_INTERACTION_BOOST),true)
     LOCAL_CFLAGS += -DINTERACTION_BOOST
 endif
 
+ifeq ($(TARGET_USES_ADAPTIVE_INTERACTION_BOOST),true)
+    LOCAL_CFLAGS += -DADAPTIVE_INTERACTION_BOOST
+endif
+
 LOCAL_MODULE := android.hardware.power-service-qti
 LOCAL_INIT_RC := android.hardware.power-service-qti.rc
 LOCAL_MODULE_TAGS := optional
@@ -61,3 +72,33 @@ LOCAL_VENDOR_MODULE := true
 LOCAL_VINTF_FRAGMENTS := power.xml
 
 include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := power-trace-replay
+LOCAL_SRC_FILES := \
+    interaction-policy.c \
+    power-trace.c \
+    tools/trace-replay.c
+LOCAL_CFLAGS += -Wall -Wextra -Werror
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := power-hint-bench
+LOCAL_SRC_FILES := \
+    hint-data.c \
+    tools/hint-bench.c
+LOCAL_SHARED_LIBRARIES := \
+    liblog \
+    libcutils
+LOCAL_HEADER_LIBRARIES := \
+    libhardware_headers
+LOCAL_CFLAGS += -Wall -Wextra -Werror -Wno-unused-parameter -Wno-unused-variable
+LOCAL_LDFLAGS += -Wl,--wrap=malloc -Wl,--wrap=calloc
+LOCAL_LDLIBS += -ldl -lpthread
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
@@ -40,6 +40,11 @@
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
 
+extern "C" {
+#include "power-trace.h"
+#include "utils.h"
+}
+
 using ::aidl::android::hardware::power::BnPower;
 using ::aidl::android::hardware::power::Boost;
 using ::aidl::android::hardware::power::IPower;
@@ -59,6 +64,11 @@ extern bool isDeviceSpecificModeSupported(Mode type, bool* _aidl_return);
 extern bool setDeviceSpecificMode(Mode type, bool enabled);
 #endif
 
+#ifdef BOOST_EXT
+extern bool isDeviceSpecificBoostSupported(Boost type, bool* _aidl_return);
+extern bool setDeviceSpecificBoost(Boost type, int32_t durationMs);
+#endif
+
 void setInteractive(bool interactive) {
     set_interactive(interactive ? 1 : 0);
 }
@@ -70,10 +80,12 @@ ndk::ScopedAStatus Power::setMode(Mode type, bool enabled) {
         return ndk::ScopedAStatus::ok();
     }
 #endif
+    power_trace_record(POWER_TRACE_MODE, static_cast<int32_t>(type), enabled,
+                       POWER_TRACE_FORWARDED, 0);
     switch (type) {
 #ifdef TAP_TO_WAKE_NODE
         case Mode::DOUBLE_TAP_TO_WAKE:
-            ::android::base::WriteStringToFile(enabled ? "1" : "0", TAP_TO_WAKE_NODE, true);
+            sysfs_write_cached(TAP_TO_WAKE_NODE, enabled ? "1" : "0");
             break;
 #else
         case Mode::DOUBLE_TAP_TO_WAKE:
@@ -136,6 +148,13 @@ ndk::ScopedAStatus Power::isModeSupported(Mode type, bool* _aidl_return) {
 ndk::ScopedAStatus Power::setBoost(Boost type, int32_t durationMs) {
     LOG(VERBOSE) << "Power setBoost: " << static_cast<int32_t>(type)
                  << ", duration: " << durationMs;
+#ifdef BOOST_EXT
+    if (setDeviceSpecificBoost(type, durationMs)) {
+        return ndk::ScopedAStatus::ok();
+    }
+#endif
+    power_trace_record(POWER_TRACE_BOOST, static_cast<int32_t>(type), durationMs,
+                       POWER_TRACE_FORWARDED, 0);
     switch (type) {
         case Boost::INTERACTION:
             power_hint(POWER_HINT_INTERACTION, &durationMs);
@@ -149,6 +168,13 @@ ndk::ScopedAStatus Power::setBoost(Boost type, int32_t durationMs) {
 
 ndk::ScopedAStatus Power::isBoostSupported(Boost type, bool* _aidl_return) {
     LOG(INFO) << "Power isBoostSupported: " << static_cast<int32_t>(type);
+
+#ifdef BOOST_EXT
+    if (isDeviceSpecificBoostSupported(type, _aidl_return)) {
+        return ndk::ScopedAStatus::ok();
+    }
+#endif
+
     switch (type) {
         case Boost::INTERACTION:
             *_aidl_return = true;
@@ -160,6 +186,11 @@ ndk::ScopedAStatus Power::isBoostSupported(Boost type, bool* _aidl_return) {
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t Power::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    power_trace_dump(fd);
+    return STATUS_OK;
+}
+
 }  // namespace impl
 }  // namespace power
 }  // namespace hardware
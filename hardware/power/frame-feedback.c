@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* struct ucred */
+#endif
+#define LOG_TAG "QTI PowerHAL"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <log/log.h>
+#include <private/android_filesystem_config.h>
+
+#include "frame-feedback.h"
+
+static int feedback_fd = -1;
+static frame_feedback_cb feedback_cb;
+
+static int feedback_trusted(struct msghdr* msg) {
+    struct cmsghdr* cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        struct ucred* cred;
+
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_CREDENTIALS) continue;
+
+        cred = (struct ucred*)CMSG_DATA(cmsg);
+        return cred->uid == AID_SYSTEM || cred->uid == AID_GRAPHICS;
+    }
+
+    return 0;
+}
+
+static void* feedback_thread(void* arg) {
+    char control[CMSG_SPACE(sizeof(struct ucred))];
+    struct frame_timing frame;
+    struct iovec iov = {
+            .iov_base = &frame,
+            .iov_len = sizeof(frame),
+    };
+
+    for (;;) {
+        struct msghdr msg = {
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+                .msg_control = control,
+                .msg_controllen = sizeof(control),
+        };
+        long long lateness;
+        ssize_t len;
+
+        len = recvmsg(feedback_fd, &msg, 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            ALOGE("Frame feedback receive failed: %s", strerror(errno));
+            break;
+        }
+
+        if (len != sizeof(frame) || !feedback_trusted(&msg)) continue;
+
+        lateness = ((long long)frame.actual_present_ns - (long long)frame.expected_present_ns) /
+                   1000;
+        if (lateness > INT_MAX) lateness = INT_MAX;
+        if (lateness < INT_MIN) lateness = INT_MIN;
+
+        feedback_cb(frame.actual_present_ns / 1000, lateness);
+    }
+
+    close(feedback_fd);
+    feedback_fd = -1;
+    return NULL;
+}
+
+int frame_feedback_start(frame_feedback_cb cb) {
+    struct sockaddr_un addr = {
+            .sun_family = AF_UNIX,
+    };
+    socklen_t addr_len;
+    pthread_t thread;
+    int on = 1;
+
+    if (feedback_fd >= 0) return 0;
+
+    /* abstract namespace, leading NUL */
+    strlcpy(addr.sun_path + 1, FRAME_FEEDBACK_SOCKET, sizeof(addr.sun_path) - 1);
+    addr_len = offsetof(struct sockaddr_un, sun_path) + 1 + strlen(FRAME_FEEDBACK_SOCKET);
+
+    feedback_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (feedback_fd < 0) {
+        ALOGE("Unable to create frame feedback socket: %s", strerror(errno));
+        return -1;
+    }
+
+    if (setsockopt(feedback_fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)) < 0 ||
+        bind(feedback_fd, (struct sockaddr*)&addr, addr_len) < 0) {
+        ALOGE("Unable to bind frame feedback socket: %s", strerror(errno));
+        close(feedback_fd);
+        feedback_fd = -1;
+        return -1;
+    }
+
+    feedback_cb = cb;
+    if (pthread_create(&thread, NULL, feedback_thread, NULL)) {
+        ALOGE("Unable to start frame feedback thread");
+        close(feedback_fd);
+        feedback_fd = -1;
+        return -1;
+    }
+    pthread_detach(thread);
+
+    return 0;
+}
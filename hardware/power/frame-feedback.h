@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FRAME_FEEDBACK_H__
+#define __FRAME_FEEDBACK_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Optional frame timing feedback for the adaptive interaction boost. A
+ * display side client sends one datagram per presented frame to the
+ * abstract unix socket below, both timestamps are CLOCK_MONOTONIC.
+ */
+#define FRAME_FEEDBACK_SOCKET "vendor.power.frame_timing"
+
+struct frame_timing {
+    uint64_t expected_present_ns;
+    uint64_t actual_present_ns;
+};
+
+typedef void (*frame_feedback_cb)(long long now_us, int lateness_us);
+
+int frame_feedback_start(frame_feedback_cb cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __FRAME_FEEDBACK_H__
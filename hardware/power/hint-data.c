@@ -27,20 +27,84 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stddef.h>
+
 #include <utils/Log.h>
 
 #include "hint-data.h"
 
-int hint_compare(struct hint_data* first_hint, struct hint_data* other_hint) {
-    if (first_hint == other_hint) {
-        return 0;
-    } else if ((first_hint && other_hint) && (first_hint->hint_id == other_hint->hint_id)) {
-        return 0;
-    } else {
-        return 1;
+static struct hint_data hint_table[HINT_TABLE_SIZE];
+
+static unsigned int hint_slot(unsigned long hint_id) {
+    /* Fibonacci hashing, hint IDs are clustered in the low bits. */
+    return (((unsigned int)hint_id * 2654435769u) >> 27) & (HINT_TABLE_SIZE - 1);
+}
+
+struct hint_data* hint_table_find(unsigned long hint_id) {
+    unsigned int slot = hint_slot(hint_id);
+
+    for (int i = 0; i < HINT_TABLE_SIZE; i++) {
+        struct hint_data* hint = &hint_table[slot];
+
+        if (hint->ref_count == 0) return NULL;
+        if (hint->hint_id == hint_id) return hint;
+        slot = (slot + 1) & (HINT_TABLE_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns the slot for 'hint_id', claiming a free one if the hint is not
+ * active yet. A newly claimed slot has a ref_count of 0 and must either be
+ * taken by the caller or handed back with hint_table_remove().
+ */
+struct hint_data* hint_table_insert(unsigned long hint_id) {
+    unsigned int slot = hint_slot(hint_id);
+
+    for (int i = 0; i < HINT_TABLE_SIZE; i++) {
+        struct hint_data* hint = &hint_table[slot];
+
+        if (hint->ref_count == 0) {
+            hint->hint_id = hint_id;
+            hint->perflock_handle = 0;
+            return hint;
+        }
+        if (hint->hint_id == hint_id) return hint;
+        slot = (slot + 1) & (HINT_TABLE_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+void hint_table_remove(struct hint_data* hint) {
+    unsigned int hole = hint - hint_table;
+    unsigned int slot = hole;
+
+    hint->ref_count = 0;
+
+    /*
+     * Backward shift deletion: pull later members of the probe sequence
+     * into the hole so lookups never need tombstones.
+     */
+    for (;;) {
+        struct hint_data* next;
+        unsigned int home;
+
+        slot = (slot + 1) & (HINT_TABLE_SIZE - 1);
+        next = &hint_table[slot];
+        if (next->ref_count == 0) break;
+
+        home = hint_slot(next->hint_id);
+        if (((slot - home) & (HINT_TABLE_SIZE - 1)) < ((slot - hole) & (HINT_TABLE_SIZE - 1)))
+            continue;
+
+        hint_table[hole] = *next;
+        next->ref_count = 0;
+        hole = slot;
     }
 }
 
 void hint_dump(struct hint_data* hint) {
-    ALOGV("hint_id: %lu", hint->hint_id);
+    ALOGV("hint_id: %lu refs: %d", hint->hint_id, hint->ref_count);
 }
@@ -59,10 +59,20 @@ struct hint_handles {
     int ref_count;
 };
 
+/*
+ * Active hints are kept in a preallocated open-addressing table, the number
+ * of concurrently held hints is small and bounded by the hint IDs above.
+ * Must be a power of two.
+ */
+#define HINT_TABLE_SIZE 32
+
 struct hint_data {
     unsigned long hint_id; /* This is our key. */
     unsigned long perflock_handle;
+    int ref_count; /* 0 marks an unused slot. */
 };
 
-int hint_compare(struct hint_data* first_hint, struct hint_data* other_hint);
+struct hint_data* hint_table_find(unsigned long hint_id);
+struct hint_data* hint_table_insert(unsigned long hint_id);
+void hint_table_remove(struct hint_data* hint);
 void hint_dump(struct hint_data* hint);
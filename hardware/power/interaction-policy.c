@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interaction-policy.h"
+
+#define MIN_INTERACTIVE_DURATION 500  /* ms */
+#define MAX_INTERACTIVE_DURATION 5000 /* ms */
+#define BOOST_DEBOUNCE_US 250000
+#define FLING_MIN_DURATION 750 /* ms */
+
+/*
+ * Adaptive policy: frames presented more than INTERACTION_FRAME_LATE_US past
+ * their deadline count as janky. Boosts are shortened while the jank average is
+ * low, made stronger while it is high, and released once EARLY_RELEASE_FRAMES
+ * frames in a row were on time. Without feedback newer than
+ * FRAME_FEEDBACK_TIMEOUT_US the static policy applies.
+ */
+#define FRAME_FEEDBACK_TIMEOUT_US 1000000
+#define EARLY_RELEASE_FRAMES 8
+#define JANK_SCALE 1024
+#define JANK_LOW (JANK_SCALE / 32)
+#define JANK_HIGH (JANK_SCALE / 8)
+
+static int policy_has_feedback(struct interaction_policy* policy, long long now_us) {
+    return policy->mode == INTERACTION_POLICY_ADAPTIVE && policy->last_frame_us &&
+           now_us - policy->last_frame_us < FRAME_FEEDBACK_TIMEOUT_US;
+}
+
+int interaction_policy_decide(struct interaction_policy* policy, long long now_us, int duration,
+                              int* strength) {
+    int adaptive = policy_has_feedback(policy, now_us);
+
+    if (duration < MIN_INTERACTIVE_DURATION) duration = MIN_INTERACTIVE_DURATION;
+    if (duration > MAX_INTERACTIVE_DURATION) duration = MAX_INTERACTIVE_DURATION;
+
+    *strength = INTERACTION_STRENGTH_NORMAL;
+    if (adaptive) {
+        if (policy->jank >= JANK_HIGH) {
+            *strength = INTERACTION_STRENGTH_HIGH;
+        } else if (policy->jank <= JANK_LOW) {
+            duration = MIN_INTERACTIVE_DURATION;
+        } else {
+            /* scale the fling part of the boost with the jank average */
+            duration = MIN_INTERACTIVE_DURATION + (long long)(duration - MIN_INTERACTIVE_DURATION) *
+                                                          (policy->jank - JANK_LOW) /
+                                                          (JANK_HIGH - JANK_LOW);
+        }
+    }
+
+    // don't hint if it's been less than 250ms since last boost
+    // also detect if we're doing anything resembling a fling
+    // support additional boosting in case of flings
+    if (policy->boosted && now_us - policy->last_boost_us < BOOST_DEBOUNCE_US &&
+        duration <= FLING_MIN_DURATION)
+        return 0;
+
+    policy->last_boost_us = now_us;
+    policy->boost_end_us = now_us + duration * 1000LL;
+    policy->on_time_count = 0;
+    policy->boosted = 1;
+
+    return duration;
+}
+
+int interaction_policy_frame(struct interaction_policy* policy, long long now_us,
+                             int lateness_us) {
+    int late = lateness_us > INTERACTION_FRAME_LATE_US;
+
+    if (policy->mode != INTERACTION_POLICY_ADAPTIVE) return 0;
+
+    policy->last_frame_us = now_us;
+    policy->jank += ((late ? JANK_SCALE : 0) - policy->jank) / 16;
+
+    if (now_us >= policy->boost_end_us) return 0;
+
+    if (late) {
+        policy->on_time_count = 0;
+        return 0;
+    }
+
+    if (++policy->on_time_count < EARLY_RELEASE_FRAMES || policy->jank >= JANK_HIGH) return 0;
+
+    policy->boost_end_us = now_us;
+    return 1;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __INTERACTION_POLICY_H__
+#define __INTERACTION_POLICY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Decision logic for Boost::INTERACTION, kept free of perf HAL calls so
+ * recorded traces can be replayed through it on the host.
+ */
+enum interaction_policy_mode {
+    INTERACTION_POLICY_STATIC,
+    INTERACTION_POLICY_ADAPTIVE,
+};
+
+/* Frames presented later than this past their deadline count as janky. */
+#define INTERACTION_FRAME_LATE_US 2000
+
+/* Boost strengths, INTERACTION_STRENGTH_NORMAL is the stock scroll boost. */
+enum interaction_strength {
+    INTERACTION_STRENGTH_NORMAL = 1,
+    INTERACTION_STRENGTH_HIGH = 2,
+};
+
+struct interaction_policy {
+    int mode;
+    long long last_boost_us;
+    int boosted;
+
+    /* frame feedback, only used by the adaptive policy */
+    long long last_frame_us;
+    long long boost_end_us;
+    int jank;          /* moving average of late frames, 1024 == all late */
+    int on_time_count; /* consecutive on time frames during the boost */
+};
+
+/*
+ * Returns the boost duration in ms for an interaction requested at 'now_us'
+ * (CLOCK_MONOTONIC) with the given duration, or 0 if it should be suppressed.
+ * 'strength' is set to the interaction_strength to boost with.
+ */
+int interaction_policy_decide(struct interaction_policy* policy, long long now_us, int duration,
+                              int* strength);
+
+/*
+ * Feeds back a presented frame, 'lateness_us' is how far past its deadline
+ * it was presented. Returns 1 if the current boost should be released now.
+ */
+int interaction_policy_frame(struct interaction_policy* policy, long long now_us,
+                             int lateness_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __INTERACTION_POLICY_H__
@@ -16,62 +16,107 @@
 
 #define LOG_TAG "QTI PowerHAL"
 #include <log/log.h>
+#include <pthread.h>
 
 #include <aidl/android/hardware/power/BnPower.h>
 
+using ::aidl::android::hardware::power::Boost;
+
 extern "C" {
+#include "frame-feedback.h"
 #include "hint-data.h"
+#include "interaction-policy.h"
 #include "metadata-defs.h"
 #include "performance.h"
 #include "power-common.h"
+#include "power-trace.h"
 #include "utils.h"
 
-const int kMinInteractiveDuration = 500;  /* ms */
-const int kMaxInteractiveDuration = 5000; /* ms */
+static struct interaction_policy s_policy;
+static pthread_mutex_t s_policy_lock = PTHREAD_MUTEX_INITIALIZER;
+static int s_policy_initialized = 0;
+static int interaction_handle = -1;
+static int strength_handle = -1;
 
-static void process_interaction_hint(void *data) {
-  static struct timespec s_previous_boost_timespec;
-  static int s_previous_duration = 0;
-  static int interaction_handle = -1;
+/* Taken on top of the scroll boost for INTERACTION_STRENGTH_HIGH. */
+static int high_strength_resources[] = {
+    CPU0_MIN_FREQ_NONTURBO_MAX, CPU1_MIN_FREQ_NONTURBO_MAX,
+    CPU2_MIN_FREQ_NONTURBO_MAX, CPU3_MIN_FREQ_NONTURBO_MAX};
 
-  struct timespec cur_boost_timespec;
-  long long elapsed_time;
-  int duration = kMinInteractiveDuration;
-
-  if (data) {
-    int input_duration = *((int *)data);
-    if (input_duration > duration) {
-      duration = (input_duration > kMaxInteractiveDuration)
-                     ? kMaxInteractiveDuration
-                     : input_duration;
-    }
+static long long timespec_to_us(const struct timespec *ts) {
+  return ts->tv_sec * 1000000LL + ts->tv_nsec / 1000;
+}
+
+static void release_interaction_locked(void) {
+  if (CHECK_HANDLE(interaction_handle)) {
+    release_request(interaction_handle);
+    interaction_handle = -1;
   }
+  if (CHECK_HANDLE(strength_handle)) {
+    release_request(strength_handle);
+    strength_handle = -1;
+  }
+}
+
+static void process_frame_feedback(long long now_us, int lateness_us) {
+  pthread_mutex_lock(&s_policy_lock);
+  int release = interaction_policy_frame(&s_policy, now_us, lateness_us);
+  power_trace_record(POWER_TRACE_FRAME, 0, lateness_us,
+                     release ? POWER_TRACE_RELEASED : POWER_TRACE_FORWARDED,
+                     interaction_handle);
+  if (release)
+    release_interaction_locked();
+  pthread_mutex_unlock(&s_policy_lock);
+}
+
+static void init_interaction_policy_locked(void) {
+  if (s_policy_initialized)
+    return;
+  s_policy_initialized = 1;
+
+#ifdef ADAPTIVE_INTERACTION_BOOST
+  s_policy.mode = INTERACTION_POLICY_ADAPTIVE;
+  /* Without a feedback client the adaptive policy acts like the static one. */
+  frame_feedback_start(process_frame_feedback);
+#endif
+}
+
+static void process_interaction_hint(void *data) {
+  struct timespec cur_boost_timespec;
+  int requested = data ? *((int *)data) : 0;
+  int duration;
+  int strength;
 
   clock_gettime(CLOCK_MONOTONIC, &cur_boost_timespec);
 
-  elapsed_time =
-      calc_timespan_us(s_previous_boost_timespec, cur_boost_timespec);
-  // don't hint if it's been less than 250ms since last boost
-  // also detect if we're doing anything resembling a fling
-  // support additional boosting in case of flings
-  if (elapsed_time < 250000 && duration <= 750) {
+  pthread_mutex_lock(&s_policy_lock);
+  init_interaction_policy_locked();
+
+  duration = interaction_policy_decide(
+      &s_policy, timespec_to_us(&cur_boost_timespec), requested, &strength);
+  if (!duration) {
+    power_trace_record(POWER_TRACE_BOOST, (int)Boost::INTERACTION, requested,
+                       POWER_TRACE_SUPPRESSED, interaction_handle);
+    pthread_mutex_unlock(&s_policy_lock);
     return;
   }
-  s_previous_boost_timespec = cur_boost_timespec;
-  s_previous_duration = duration;
 
-  if (CHECK_HANDLE(interaction_handle)) {
-    release_request(interaction_handle);
-    interaction_handle = -1;
-  }
+  release_interaction_locked();
 
   interaction_handle = perf_hint_enable_with_type(VENDOR_HINT_SCROLL_BOOST,
                                                   duration, SCROLL_VERTICAL);
+  if (strength == INTERACTION_STRENGTH_HIGH)
+    strength_handle = interaction_with_handle(
+        0, duration, ARRAY_SIZE(high_strength_resources),
+        high_strength_resources);
+  power_trace_record(POWER_TRACE_BOOST, (int)Boost::INTERACTION, requested,
+                     CHECK_HANDLE(interaction_handle) ? POWER_TRACE_BOOSTED
+                                                      : POWER_TRACE_FAILED,
+                     interaction_handle);
+  pthread_mutex_unlock(&s_policy_lock);
 }
 }
 
-using ::aidl::android::hardware::power::Boost;
-
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -57,6 +57,8 @@ void power_init() {
         handles[i].handle = 0;
         handles[i].ref_count = 0;
     }
+
+    scaling_governor_cache_init();
 }
 
 int __attribute__((weak)) power_hint_override(power_hint_t hint, void* data) {
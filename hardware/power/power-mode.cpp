@@ -20,11 +20,14 @@
 
 #include <aidl/android/hardware/power/BnPower.h>
 
+using ::aidl::android::hardware::power::Mode;
+
 extern "C" {
 #include "hint-data.h"
 #include "metadata-defs.h"
 #include "performance.h"
 #include "power-common.h"
+#include "power-trace.h"
 #include "utils.h"
 
 const int kMaxLaunchDuration = 5000; /* ms */
@@ -35,6 +38,8 @@ int process_activity_launch_hint(void *data) {
 
   // release lock early if launch has finished
   if (!data) {
+    power_trace_record(POWER_TRACE_MODE, (int)Mode::LAUNCH, 0,
+                       POWER_TRACE_RELEASED, launch_handle);
     if (CHECK_HANDLE(launch_handle)) {
       release_request(launch_handle);
       launch_handle = -1;
@@ -47,17 +52,22 @@ int process_activity_launch_hint(void *data) {
     launch_handle = perf_hint_enable_with_type(
         VENDOR_HINT_FIRST_LAUNCH_BOOST, kMaxLaunchDuration, LAUNCH_BOOST_V1);
     if (!CHECK_HANDLE(launch_handle)) {
+      power_trace_record(POWER_TRACE_MODE, (int)Mode::LAUNCH, 1,
+                         POWER_TRACE_FAILED, launch_handle);
       ALOGE("Failed to perform launch boost");
       return HINT_NONE;
     }
+    power_trace_record(POWER_TRACE_MODE, (int)Mode::LAUNCH, 1,
+                       POWER_TRACE_BOOSTED, launch_handle);
     launch_mode = 1;
+  } else {
+    power_trace_record(POWER_TRACE_MODE, (int)Mode::LAUNCH, 1,
+                       POWER_TRACE_SUPPRESSED, launch_handle);
   }
   return HINT_HANDLED;
 }
 }
 
-using ::aidl::android::hardware::power::Mode;
-
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "power-trace.h"
+
+/*
+ * Every Boost/Mode call is appended to a fixed ring. Writers claim a slot
+ * with a single fetch-add and publish it through a per-slot sequence, so
+ * recording never blocks the binder thread and the dump side can detect
+ * and skip slots that were overwritten while it was reading them.
+ *
+ * Frame feedback arrives once per frame and would push the much rarer
+ * Boost/Mode calls out of a shared ring within seconds, so frames go to a
+ * ring of their own. The dump merges both by time.
+ */
+struct power_trace_slot {
+    atomic_uint_fast64_t seq;
+    struct power_trace_record record;
+};
+
+struct power_trace_ring {
+    struct power_trace_slot slots[POWER_TRACE_SIZE];
+    atomic_uint_fast64_t head;
+};
+
+static struct power_trace_ring call_ring;
+static struct power_trace_ring frame_ring;
+
+static const char* const trace_kinds[] = {
+        [POWER_TRACE_BOOST] = "boost",
+        [POWER_TRACE_MODE] = "mode",
+        [POWER_TRACE_FRAME] = "frame",
+};
+
+static const char* const trace_decisions[] = {
+        [POWER_TRACE_FORWARDED] = "forwarded", [POWER_TRACE_BOOSTED] = "boosted",
+        [POWER_TRACE_SUPPRESSED] = "suppressed", [POWER_TRACE_RELEASED] = "released",
+        [POWER_TRACE_FAILED] = "failed",
+};
+
+#define TRACE_ARRAY_SIZE(x) (sizeof((x)) / sizeof((x)[0]))
+
+void power_trace_record(int kind, int id, int arg, int decision, int handle) {
+    struct power_trace_ring* ring = kind == POWER_TRACE_FRAME ? &frame_ring : &call_ring;
+    struct power_trace_slot* slot;
+    struct timespec ts;
+    uint_fast64_t idx;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    idx = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+    slot = &ring->slots[idx & (POWER_TRACE_SIZE - 1)];
+
+    /* Odd sequence marks the slot as being written. */
+    atomic_store_explicit(&slot->seq, 2 * idx + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->record.time_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    slot->record.kind = kind;
+    slot->record.id = id;
+    slot->record.arg = arg;
+    slot->record.decision = decision;
+    slot->record.handle = handle;
+
+    atomic_store_explicit(&slot->seq, 2 * idx + 2, memory_order_release);
+}
+
+static const char* trace_name(const char* const* names, size_t count, int value) {
+    if (value < 0 || (size_t)value >= count || !names[value]) return "unknown";
+    return names[value];
+}
+
+struct power_trace_cursor {
+    struct power_trace_ring* ring;
+    uint_fast64_t idx;
+    uint_fast64_t head;
+    int valid;
+    struct power_trace_record record;
+};
+
+static uint_fast64_t trace_cursor_init(struct power_trace_cursor* cursor,
+                                       struct power_trace_ring* ring) {
+    cursor->ring = ring;
+    cursor->head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    cursor->idx = cursor->head > POWER_TRACE_SIZE ? cursor->head - POWER_TRACE_SIZE : 0;
+    cursor->valid = 0;
+    return cursor->head;
+}
+
+/* Loads the next record which wasn't overwritten while it was read. */
+static int trace_cursor_next(struct power_trace_cursor* cursor) {
+    while (cursor->idx < cursor->head) {
+        uint_fast64_t idx = cursor->idx++;
+        struct power_trace_slot* slot = &cursor->ring->slots[idx & (POWER_TRACE_SIZE - 1)];
+
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != 2 * idx + 2) continue;
+        memcpy(&cursor->record, &slot->record, sizeof(cursor->record));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != 2 * idx + 2) continue;
+
+        cursor->valid = 1;
+        return 1;
+    }
+    cursor->valid = 0;
+    return 0;
+}
+
+void power_trace_dump(int fd) {
+    struct power_trace_cursor calls, frames;
+    uint_fast64_t call_head = trace_cursor_init(&calls, &call_ring);
+    uint_fast64_t frame_head = trace_cursor_init(&frames, &frame_ring);
+
+    dprintf(fd, "Power HAL trace: %llu calls, last %llu; %llu frames, last %llu\n",
+            (unsigned long long)call_head, (unsigned long long)(call_head - calls.idx),
+            (unsigned long long)frame_head, (unsigned long long)(frame_head - frames.idx));
+    dprintf(fd, "%-14s %-6s %4s %6s %-10s %s\n", "time_us", "kind", "id", "arg", "decision",
+            "handle");
+
+    trace_cursor_next(&calls);
+    trace_cursor_next(&frames);
+    while (calls.valid || frames.valid) {
+        struct power_trace_cursor* cursor;
+        struct power_trace_record* record;
+
+        if (!frames.valid || (calls.valid && calls.record.time_us <= frames.record.time_us))
+            cursor = &calls;
+        else
+            cursor = &frames;
+        record = &cursor->record;
+
+        dprintf(fd, "%-14llu %-6s %4d %6d %-10s %d\n", (unsigned long long)record->time_us,
+                trace_name(trace_kinds, TRACE_ARRAY_SIZE(trace_kinds), record->kind), record->id,
+                record->arg,
+                trace_name(trace_decisions, TRACE_ARRAY_SIZE(trace_decisions), record->decision),
+                record->handle);
+        trace_cursor_next(cursor);
+    }
+}
+
+static int trace_lookup(const char* const* names, size_t count, const char* name) {
+    for (size_t i = 0; i < count; i++) {
+        if (names[i] && !strcmp(names[i], name)) return i;
+    }
+    return -1;
+}
+
+/*
+ * Parses one record line of power_trace_dump() output, returns -1 for
+ * headers and anything else that isn't a record.
+ */
+int power_trace_parse(const char* line, struct power_trace_record* record) {
+    unsigned long long time_us;
+    char decision[16];
+    char kind[16];
+
+    if (sscanf(line, "%llu %15s %d %d %15s %d", &time_us, kind, &record->id, &record->arg,
+               decision, &record->handle) != 6)
+        return -1;
+
+    record->time_us = time_us;
+    record->kind = trace_lookup(trace_kinds, TRACE_ARRAY_SIZE(trace_kinds), kind);
+    record->decision = trace_lookup(trace_decisions, TRACE_ARRAY_SIZE(trace_decisions), decision);
+    if (record->kind < 0 || record->decision < 0) return -1;
+
+    return 0;
+}
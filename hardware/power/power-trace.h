@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __POWER_TRACE_H__
+#define __POWER_TRACE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entries per ring, must be a power of two. */
+#define POWER_TRACE_SIZE 2048
+
+enum power_trace_kind {
+    POWER_TRACE_BOOST,
+    POWER_TRACE_MODE,
+    POWER_TRACE_FRAME, /* frame feedback, arg is the lateness in us */
+};
+
+enum power_trace_decision {
+    POWER_TRACE_FORWARDED, /* passed on without a HAL side decision */
+    POWER_TRACE_BOOSTED,
+    POWER_TRACE_SUPPRESSED,
+    POWER_TRACE_RELEASED,
+    POWER_TRACE_FAILED,
+};
+
+struct power_trace_record {
+    uint64_t time_us; /* CLOCK_MONOTONIC */
+    int kind;
+    int id;  /* AIDL Boost or Mode value */
+    int arg; /* duration in ms for boosts, enabled for modes */
+    int decision;
+    int handle; /* perf lock handle, if any */
+};
+
+void power_trace_record(int kind, int id, int arg, int decision, int handle);
+void power_trace_dump(int fd);
+int power_trace_parse(const char* line, struct power_trace_record* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __POWER_TRACE_H__
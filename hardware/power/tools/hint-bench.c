@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures perform_hint_action()/undo_hint_action() against a stubbed perfd
+ * client. The stub replaces the perflock entry points utils.c resolves from
+ * libqti-perfd-client.so, so only the HAL's own hint bookkeeping is timed.
+ * Allocations are counted by wrapping malloc/calloc at link time.
+ *
+ *   power-hint-bench [bursts]
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../utils.c"
+
+#define DEFAULT_BURSTS 200000
+
+static unsigned long allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size) {
+    allocations++;
+    return __real_calloc(nmemb, size);
+}
+
+/* Stubbed perfd client: hands out handles and tracks held locks. */
+static int stub_next_handle = 1;
+static int stub_locks_held;
+static int stub_bad_releases;
+
+static int stub_perf_lock_acq(int handle, int duration, int list[], int num_args) {
+    (void)duration;
+    (void)list;
+    (void)num_args;
+    if (handle > 0) return handle;
+    stub_locks_held++;
+    return stub_next_handle++;
+}
+
+static int stub_perf_lock_rel(int handle) {
+    if (handle <= 0 || stub_locks_held == 0) {
+        stub_bad_releases++;
+        return -1;
+    }
+    stub_locks_held--;
+    return 0;
+}
+
+/*
+ * A camera/playback transition: encode and decode hints with display state
+ * changes and a nested repeat of the decode hint, released in a different
+ * order than they were taken.
+ */
+static const int burst_acquire[] = {
+        DISPLAY_STATE_HINT_ID,        DEFAULT_VIDEO_DECODE_HINT_ID, CAM_PREVIEW_HINT_ID,
+        DEFAULT_VIDEO_ENCODE_HINT_ID, DEFAULT_VIDEO_DECODE_HINT_ID, DISPLAY_STATE_HINT_ID_2,
+        SUSTAINED_PERF_HINT_ID,       VIDEO_ENCODE_HINT,            VIDEO_DECODE_HINT,
+};
+
+static const int burst_release[] = {
+        DEFAULT_VIDEO_DECODE_HINT_ID, VIDEO_DECODE_HINT,       DISPLAY_STATE_HINT_ID,
+        CAM_PREVIEW_HINT_ID,          SUSTAINED_PERF_HINT_ID,  DEFAULT_VIDEO_DECODE_HINT_ID,
+        DISPLAY_STATE_HINT_ID_2,      VIDEO_ENCODE_HINT,       DEFAULT_VIDEO_ENCODE_HINT_ID,
+};
+
+#define BURST_HINTS ((int)ARRAY_SIZE(burst_acquire))
+
+static int run_burst(void) {
+    int resources[] = {0x40C00000, 0x1};
+    int i;
+
+    for (i = 0; i < BURST_HINTS; i++) {
+        if (perform_hint_action(burst_acquire[i], resources, ARRAY_SIZE(resources))) return -1;
+    }
+    for (i = 0; i < BURST_HINTS; i++) undo_hint_action(burst_release[i]);
+    return 0;
+}
+
+static int check_nesting(void) {
+    int resources[] = {0x40C00000, 0x1};
+    int failures = 0;
+
+    perform_hint_action(DEFAULT_VIDEO_DECODE_HINT_ID, resources, ARRAY_SIZE(resources));
+    perform_hint_action(DEFAULT_VIDEO_DECODE_HINT_ID, resources, ARRAY_SIZE(resources));
+    if (stub_locks_held != 1) failures++;
+    undo_hint_action(DEFAULT_VIDEO_DECODE_HINT_ID);
+    if (stub_locks_held != 1) failures++;
+    undo_hint_action(DEFAULT_VIDEO_DECODE_HINT_ID);
+    if (stub_locks_held != 0) failures++;
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    unsigned long bursts = DEFAULT_BURSTS;
+    unsigned long burst_allocations;
+    struct timespec t0, t1;
+    unsigned long i;
+    double ns;
+
+    if (argc > 1) bursts = strtoul(argv[1], NULL, 0);
+
+    qcopt_handle = &stub_next_handle;
+    perf_lock_acq = stub_perf_lock_acq;
+    perf_lock_rel = stub_perf_lock_rel;
+
+    if (check_nesting()) {
+        fprintf(stderr, "nested hints not refcounted\n");
+        return EXIT_FAILURE;
+    }
+
+    allocations = 0;
+    if (run_burst() || stub_locks_held != 0) {
+        fprintf(stderr, "burst left %d locks held\n", stub_locks_held);
+        return EXIT_FAILURE;
+    }
+    burst_allocations = allocations;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < bursts; i++) run_burst();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+    printf("%d hints per burst: %.1f ns per perform/undo pair, %lu allocations per burst\n",
+           BURST_HINTS, ns / bursts / BURST_HINTS, burst_allocations);
+
+    if (stub_locks_held != 0 || stub_bad_releases != 0) {
+        fprintf(stderr, "%d locks leaked, %d bad releases\n", stub_locks_held, stub_bad_releases);
+        return EXIT_FAILURE;
+    }
+    /* Clear the stub so the destructor doesn't dlclose() it. */
+    qcopt_handle = NULL;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays Boost::INTERACTION calls and frame feedback captured with
+ * "dumpsys android.hardware.power.IPower/default" through the interaction
+ * boost policy, and reports the boost time spent and how many late frames
+ * were presented without a boost held.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../interaction-policy.h"
+#include "../power-trace.h"
+
+/* aidl::android::hardware::power::Boost::INTERACTION */
+#define BOOST_INTERACTION 0
+
+struct replay {
+    struct interaction_policy policy;
+
+    unsigned int interactions;
+    unsigned int boosts;
+    unsigned int agreed; /* same boost/suppress decision as recorded */
+    unsigned int frames;
+    unsigned int late_frames;
+    unsigned int late_unboosted;
+    unsigned long long boost_us;
+    unsigned long long strength_us; /* boost time weighted by strength */
+
+    int active;
+    int strength;
+    long long start_us;
+    long long end_us;
+};
+
+static void replay_close(struct replay* replay, long long now_us) {
+    long long end_us;
+
+    if (!replay->active) return;
+
+    end_us = now_us < replay->end_us ? now_us : replay->end_us;
+    if (end_us > replay->start_us) {
+        replay->boost_us += end_us - replay->start_us;
+        replay->strength_us += (end_us - replay->start_us) * replay->strength;
+    }
+    replay->active = 0;
+}
+
+static void replay_boost(struct replay* replay, const struct power_trace_record* record) {
+    int recorded_boost;
+    int duration;
+    int strength;
+
+    replay->interactions++;
+
+    duration = interaction_policy_decide(&replay->policy, record->time_us, record->arg, &strength);
+    recorded_boost = record->decision == POWER_TRACE_BOOSTED ||
+                     record->decision == POWER_TRACE_FAILED;
+    if (!!duration == recorded_boost) replay->agreed++;
+    if (!duration) return;
+
+    /* A new boost releases the previous one. */
+    replay_close(replay, record->time_us);
+
+    replay->boosts++;
+    replay->active = 1;
+    replay->strength = strength;
+    replay->start_us = record->time_us;
+    replay->end_us = record->time_us + duration * 1000LL;
+}
+
+static void replay_frame(struct replay* replay, const struct power_trace_record* record) {
+    long long now_us = record->time_us;
+
+    replay->frames++;
+    if (record->arg > INTERACTION_FRAME_LATE_US) {
+        replay->late_frames++;
+        if (!replay->active || now_us >= replay->end_us) replay->late_unboosted++;
+    }
+
+    if (interaction_policy_frame(&replay->policy, now_us, record->arg)) replay_close(replay, now_us);
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [-p static|adaptive] [trace]\n", name);
+}
+
+int main(int argc, char** argv) {
+    struct power_trace_record record;
+    struct replay replay;
+    char line[256];
+    FILE* fp = stdin;
+    int opt;
+
+    memset(&replay, 0, sizeof(replay));
+
+    while ((opt = getopt(argc, argv, "hp:")) != -1) {
+        switch (opt) {
+            case 'p':
+                if (!strcmp(optarg, "static")) {
+                    replay.policy.mode = INTERACTION_POLICY_STATIC;
+                } else if (!strcmp(optarg, "adaptive")) {
+                    replay.policy.mode = INTERACTION_POLICY_ADAPTIVE;
+                } else {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind > 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (optind < argc && strcmp(argv[optind], "-")) {
+        fp = fopen(argv[optind], "r");
+        if (!fp) {
+            perror(argv[optind]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (power_trace_parse(line, &record)) continue;
+        if (record.kind == POWER_TRACE_BOOST && record.id == BOOST_INTERACTION)
+            replay_boost(&replay, &record);
+        else if (record.kind == POWER_TRACE_FRAME)
+            replay_frame(&replay, &record);
+    }
+
+    if (fp != stdin) fclose(fp);
+
+    /* The last boost runs to completion. */
+    replay_close(&replay, LLONG_MAX);
+
+    printf("interactions:             %u\n", replay.interactions);
+    printf("boosts:                   %u\n", replay.boosts);
+    printf("suppressed:               %u\n", replay.interactions - replay.boosts);
+    printf("agreement with recording: %u/%u\n", replay.agreed, replay.interactions);
+    printf("boosted ms:               %llu\n", replay.boost_us / 1000);
+    printf("strength weighted ms:     %llu\n", replay.strength_us / 1000);
+    printf("boosted ms/interaction:   %.1f\n",
+           replay.interactions ? replay.boost_us / 1000.0 / replay.interactions : 0.0);
+    printf("frames:                   %u\n", replay.frames);
+    printf("late frames:              %u\n", replay.late_frames);
+    printf("late frames not boosted:  %u\n", replay.late_unboosted);
+
+    return EXIT_SUCCESS;
+}
@@ -31,12 +31,17 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include "hint-data.h"
-#include "list.h"
 #include "power-common.h"
 #include "utils.h"
 
@@ -63,7 +68,6 @@ static void* qcopt_handle;
 static int (*perf_lock_acq)(int handle, int duration, int list[], int numArgs);
 static int (*perf_lock_rel)(int handle);
 static int (*perf_hint)(int, const char*, int, int);
-static struct list_node active_hint_list_head;
 const char* pkg = "QTI PowerHAL";
 
 static void* get_qcopt_handle() {
@@ -176,7 +180,73 @@ int sysfs_write(const char* path, char* s) {
     return ret;
 }
 
-int get_scaling_governor(char governor[], int size) {
+/*
+ * Like sysfs_write() but keeps the node open across calls, for nodes that
+ * are written repeatedly from the binder thread.
+ */
+#define SYSFS_FD_CACHE_SIZE 8
+
+static struct {
+    const char* path;
+    int fd;
+} sysfs_fd_cache[SYSFS_FD_CACHE_SIZE];
+static pthread_mutex_t sysfs_fd_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int sysfs_fd_cache_get(const char* path, int* cached) {
+    char buf[80];
+    int fd;
+    int i;
+
+    *cached = 1;
+    for (i = 0; i < SYSFS_FD_CACHE_SIZE && sysfs_fd_cache[i].path; i++) {
+        if (!strcmp(sysfs_fd_cache[i].path, path)) return sysfs_fd_cache[i].fd;
+    }
+
+    fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening %s: %s\n", path, buf);
+        return -1;
+    }
+
+    if (i < SYSFS_FD_CACHE_SIZE) {
+        sysfs_fd_cache[i].path = path;
+        sysfs_fd_cache[i].fd = fd;
+    } else {
+        *cached = 0;
+    }
+
+    return fd;
+}
+
+int sysfs_write_cached(const char* path, const char* s) {
+    char buf[80];
+    int ret = 0;
+    int cached;
+    int fd;
+
+    pthread_mutex_lock(&sysfs_fd_cache_lock);
+
+    fd = sysfs_fd_cache_get(path, &cached);
+    if (fd < 0) {
+        ret = -1;
+    } else {
+        if (pwrite(fd, s, strlen(s), 0) < 0) {
+            strerror_r(errno, buf, sizeof(buf));
+            ALOGE("Error writing to %s: %s\n", path, buf);
+            ret = -1;
+        }
+
+        /* Table full, don't leak the descriptor. */
+        if (!cached) close(fd);
+    }
+
+    pthread_mutex_unlock(&sysfs_fd_cache_lock);
+
+    return ret;
+}
+
+static int read_scaling_governor(char governor[], int size) {
     for (size_t i = 0; i < ARRAY_SIZE(scaling_gov_path); i++) {
         if (get_scaling_governor_check_cores(governor, size, i) == 0) {
             // Obtained the scaling governor. Return.
@@ -187,6 +257,155 @@ int get_scaling_governor(char governor[], int size) {
     return -1;
 }
 
+/*
+ * The scaling governor is cached so the hint path does not have to go
+ * through sysfs. A helper thread refreshes the cache whenever one of the
+ * scaling_governor nodes is written (inotify) or a CPU changes state
+ * (uevent), which also covers policies appearing on hotplug.
+ *
+ * Governor names are interned in an append-only table and published with
+ * a single pointer, so readers never see a partially updated name. When
+ * the cache is unavailable we fall back to reading sysfs.
+ */
+#define GOVERNOR_CACHE_NAMES 8
+#define GOVERNOR_NAME_LEN 32
+#define UEVENT_CPU_PREFIX "@/devices/system/cpu/"
+
+static char governor_names[GOVERNOR_CACHE_NAMES][GOVERNOR_NAME_LEN];
+static int governor_names_count;
+static _Atomic(const char*) cached_governor;
+static pthread_once_t governor_cache_once = PTHREAD_ONCE_INIT;
+static int governor_inotify_fd = -1;
+static int governor_uevent_fd = -1;
+
+static void governor_cache_refresh(void) {
+    char governor[GOVERNOR_NAME_LEN];
+    const char* name = NULL;
+
+    if (read_scaling_governor(governor, sizeof(governor)) == 0) {
+        for (int i = 0; i < governor_names_count; i++) {
+            if (!strcmp(governor_names[i], governor)) {
+                name = governor_names[i];
+                break;
+            }
+        }
+
+        if (!name && governor_names_count < GOVERNOR_CACHE_NAMES) {
+            strlcpy(governor_names[governor_names_count], governor, GOVERNOR_NAME_LEN);
+            name = governor_names[governor_names_count++];
+        }
+    }
+
+    atomic_store_explicit(&cached_governor, name, memory_order_release);
+}
+
+static void governor_cache_watch(void) {
+    if (governor_inotify_fd < 0) return;
+
+    /* Re-adding an existing watch is harmless, offline policies fail. */
+    for (size_t i = 0; i < ARRAY_SIZE(scaling_gov_path); i++)
+        inotify_add_watch(governor_inotify_fd, scaling_gov_path[i], IN_MODIFY);
+}
+
+static int governor_cache_uevent(void) {
+    char buf[1024];
+    int changed = 0;
+    ssize_t len;
+
+    while ((len = recv(governor_uevent_fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) > 0) {
+        buf[len] = '\0';
+        /* The header is "<action>@<devpath>". */
+        if (strstr(buf, UEVENT_CPU_PREFIX)) changed = 1;
+    }
+
+    return changed;
+}
+
+static void* governor_cache_thread(void* arg) {
+    char buf[1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2] = {
+            {.fd = governor_inotify_fd, .events = POLLIN},
+            {.fd = governor_uevent_fd, .events = POLLIN},
+    };
+
+    for (;;) {
+        int changed = 0;
+
+        if (poll(fds, ARRAY_SIZE(fds), -1) < 0) {
+            if (errno == EINTR) continue;
+            ALOGE("Governor cache poll failed: %s", strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            while (read(governor_inotify_fd, buf, sizeof(buf)) > 0)
+                ;
+            changed = 1;
+        }
+
+        if ((fds[1].revents & POLLIN) && governor_cache_uevent()) {
+            governor_cache_watch();
+            changed = 1;
+        }
+
+        if (changed) governor_cache_refresh();
+    }
+
+    atomic_store_explicit(&cached_governor, NULL, memory_order_release);
+    return NULL;
+}
+
+static void governor_cache_init(void) {
+    struct sockaddr_nl addr = {
+            .nl_family = AF_NETLINK,
+            .nl_groups = 1,
+    };
+    pthread_t thread;
+
+    governor_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (governor_inotify_fd < 0) ALOGE("Unable to create inotify fd: %s", strerror(errno));
+
+    governor_uevent_fd =
+            socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (governor_uevent_fd >= 0 &&
+        bind(governor_uevent_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(governor_uevent_fd);
+        governor_uevent_fd = -1;
+    }
+    if (governor_uevent_fd < 0) ALOGE("Unable to open uevent socket: %s", strerror(errno));
+
+    /* Without any notification source the cache would go stale. */
+    if (governor_inotify_fd < 0 && governor_uevent_fd < 0) return;
+
+    governor_cache_watch();
+    governor_cache_refresh();
+
+    if (pthread_create(&thread, NULL, governor_cache_thread, NULL)) {
+        ALOGE("Unable to start governor cache thread");
+        atomic_store_explicit(&cached_governor, NULL, memory_order_release);
+        return;
+    }
+    pthread_detach(thread);
+}
+
+void scaling_governor_cache_init(void) {
+    pthread_once(&governor_cache_once, governor_cache_init);
+}
+
+int get_scaling_governor(char governor[], int size) {
+    const char* cached;
+
+    scaling_governor_cache_init();
+
+    cached = atomic_load_explicit(&cached_governor, memory_order_acquire);
+    if (cached) {
+        strlcpy(governor, cached, size);
+        return 0;
+    }
+
+    return read_scaling_governor(governor, size);
+}
+
 int get_scaling_governor_check_cores(char governor[], int size, int core_num) {
     if (sysfs_read(scaling_gov_path[core_num], governor, size) == -1) {
         // Can't obtain the scaling governor. Return.
@@ -274,39 +493,28 @@ void release_request(int lock_handle) {
 
 int perform_hint_action(int hint_id, int resource_values[], int num_resources) {
     if (qcopt_handle && perf_lock_acq) {
-        /* Acquire an indefinite lock for the requested resources. */
-        int lock_handle = perf_lock_acq(0, 0, resource_values, num_resources);
+        struct hint_data* hint = hint_table_insert(hint_id);
 
-        if (lock_handle == -1) {
-            ALOGE("Failed to acquire lock.");
-            return -EINVAL;
-        }
-
-        /* Add this handle to our internal hint-list. */
-        struct hint_data* new_hint = (struct hint_data*)malloc(sizeof(struct hint_data));
-
-        if (!new_hint) {
-            /* Can't keep track of this lock. Release it. */
-            if (perf_lock_rel) perf_lock_rel(lock_handle);
+        if (!hint) {
+            /* Can't keep track of another lock. */
             ALOGE("Failed to process hint.");
             return -ENOMEM;
         }
 
-        if (!active_hint_list_head.compare) {
-            active_hint_list_head.compare = (int (*)(void*, void*))hint_compare;
-            active_hint_list_head.dump = (void (*)(void*))hint_dump;
-        }
-
-        new_hint->hint_id = hint_id;
-        new_hint->perflock_handle = lock_handle;
+        /*
+         * Acquire an indefinite lock for the requested resources. A nested
+         * request for an active hint updates the lock it already holds.
+         */
+        int lock_handle = perf_lock_acq(hint->perflock_handle, 0, resource_values, num_resources);
 
-        if (add_list_node(&active_hint_list_head, new_hint) == NULL) {
-            free(new_hint);
-            /* Can't keep track of this lock. Release it. */
-            if (perf_lock_rel) perf_lock_rel(lock_handle);
-            ALOGE("Failed to process hint.");
-            return -ENOMEM;
+        if (lock_handle == -1) {
+            ALOGE("Failed to acquire lock.");
+            if (hint->ref_count == 0) hint_table_remove(hint);
+            return -EINVAL;
         }
+
+        hint->perflock_handle = lock_handle;
+        hint->ref_count++;
     }
     return 0;
 }
@@ -315,29 +523,19 @@ void undo_hint_action(int hint_id) {
     if (qcopt_handle) {
         if (perf_lock_rel) {
             /* Get hint-data associated with this hint-id */
-            struct list_node* found_node;
-            struct hint_data temp_hint_data = {.hint_id = hint_id};
-
-            found_node = find_node(&active_hint_list_head, &temp_hint_data);
+            struct hint_data* hint = hint_table_find(hint_id);
 
-            if (found_node) {
-                /* Release this lock. */
-                struct hint_data* found_hint_data = (struct hint_data*)(found_node->data);
+            if (!hint) {
+                ALOGE("Invalid hint ID.");
+                return;
+            }
 
-                if (found_hint_data) {
-                    if (perf_lock_rel(found_hint_data->perflock_handle) == -1)
-                        ALOGE("Perflock release failed.");
-                }
+            /* Only the outermost request releases the lock. */
+            if (--hint->ref_count > 0) return;
 
-                if (found_node->data) {
-                    /* We can free the hint-data for this node. */
-                    free(found_node->data);
-                }
+            if (perf_lock_rel(hint->perflock_handle) == -1) ALOGE("Perflock release failed.");
 
-                remove_list_node(&active_hint_list_head, found_node);
-            } else {
-                ALOGE("Invalid hint ID.");
-            }
+            hint_table_remove(hint);
         }
     }
 }
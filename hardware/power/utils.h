@@ -31,6 +31,8 @@
 
 int sysfs_read(const char* path, char* s, int num_bytes);
 int sysfs_write(const char* path, char* s);
+int sysfs_write_cached(const char* path, const char* s);
+void scaling_governor_cache_init(void);
 int get_scaling_governor(char governor[], int size);
 int get_scaling_governor_check_cores(char governor[], int size, int core_num);
 int is_interactive_governor(char*);
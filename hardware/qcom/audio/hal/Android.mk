@@ -84,6 +84,9 @@ endif
 
 LOCAL_SRC_FILES := \
 	audio_hw.c \
+	audio_pcm_kernels.c \
+	audio_hist.c \
+	offload_cmd_queue.c \
 	voice.c \
 	platform_info.c \
 	audio_extn/ext_speaker.c \
@@ -252,6 +255,10 @@ LOCAL_PROPRIETARY_MODULE := true
 
 LOCAL_CFLAGS += -Werror
 
+# tests/ builds against the same struct layouts
+AUDIO_HAL_CFLAGS := $(LOCAL_CFLAGS)
+AUDIO_HAL_C_INCLUDES := $(LOCAL_C_INCLUDES)
+
 include $(BUILD_SHARED_LIBRARY)
 
 include $(CLEAR_VARS)
@@ -259,4 +266,6 @@ LOCAL_MODULE := audio_headers
 LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/audio_extn
 include $(BUILD_HEADER_LIBRARY)
 
+include $(LOCAL_PATH)/tests/Android.mk
+
 endif
@@ -219,17 +219,34 @@ void hw_info_append_hw_type(void *hw_info, snd_device_t snd_device,
                              char *device_name);
 #endif /* HW_VARIANTS_ENABLED */
 
-typedef void (* snd_mon_cb)(void * stream, struct str_parms * parms);
+typedef enum {
+    SND_MON_EVENT_CARD,         /* sound card SSR */
+    SND_MON_EVENT_CPE,          /* codec processing engine SSR */
+    SND_MON_EVENT_SLPI,         /* sensor low power island SSR */
+    SND_MON_EVENT_EXT_DEVICE,   /* external audio device switch */
+} snd_mon_event_type_t;
+
+typedef struct {
+    snd_mon_event_type_t type;
+    int card;                   /* card, cpe or slpi index; -1 for devices */
+    card_status_t status;       /* ONLINE doubles as "on" for devices */
+    const char *dev;            /* switch name, only for EXT_DEVICE */
+} snd_mon_event_t;
+
+/* called on the monitor thread, event is only valid for the call */
+typedef void (* snd_mon_cb)(void * stream, const snd_mon_event_t * event);
 #ifndef SND_MONITOR_ENABLED
 #define audio_extn_snd_mon_init()           (0)
 #define audio_extn_snd_mon_deinit()         (0)
 #define audio_extn_snd_mon_register_listener(stream, cb) (0)
 #define audio_extn_snd_mon_unregister_listener(stream) (0)
+#define audio_extn_snd_mon_dump(fd)         (0)
 #else
 int audio_extn_snd_mon_init();
 int audio_extn_snd_mon_deinit();
 int audio_extn_snd_mon_register_listener(void *stream, snd_mon_cb cb);
 int audio_extn_snd_mon_unregister_listener(void *stream);
+void audio_extn_snd_mon_dump(int fd);
 #endif
 
 bool audio_extn_utils_resolve_config_file(char[]);
@@ -485,7 +485,7 @@ static void *audio_extn_cirrus_calibration_thread() {
     uc_info_rx->in_snd_device = SND_DEVICE_NONE;
     uc_info_rx->stream.out = adev->primary_output;
     uc_info_rx->out_snd_device = SND_DEVICE_OUT_SPEAKER;
-    list_add_tail(&adev->usecase_list, &uc_info_rx->list);
+    add_usecase_to_list(adev, uc_info_rx);
 
     enable_snd_device(adev, SND_DEVICE_OUT_SPEAKER);
     enable_audio_route(adev, uc_info_rx);
@@ -532,7 +532,7 @@ close_stream:
     }
     disable_audio_route(adev, uc_info_rx);
     disable_snd_device(adev, SND_DEVICE_OUT_SPEAKER);
-    list_remove(&uc_info_rx->list);
+    remove_usecase_from_list(adev, uc_info_rx);
     free(uc_info_rx);
     pthread_mutex_unlock(&adev->lock);
 exit:
@@ -826,7 +826,7 @@ int audio_extn_spkr_prot_start_processing(snd_device_t snd_device) {
     uc_info_tx->out_snd_device = SND_DEVICE_NONE;
     handle.pcm_tx = NULL;
 
-    list_add_tail(&adev->usecase_list, &uc_info_tx->list);
+    add_usecase_to_list(adev, uc_info_tx);
 
     enable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
     enable_audio_route(adev, uc_info_tx);
@@ -877,7 +877,7 @@ exit:
 
         disable_audio_route(adev, uc_info_tx);
         disable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
-        list_remove(&uc_info_tx->list);
+        remove_usecase_from_list(adev, uc_info_tx);
         free(uc_info_tx);
     }
 
@@ -906,7 +906,7 @@ void audio_extn_spkr_prot_stop_processing(snd_device_t snd_device) {
 
         disable_audio_route(adev, uc_info_tx);
         disable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
-        list_remove(&uc_info_tx->list);
+        remove_usecase_from_list(adev, uc_info_tx);
         free(uc_info_tx);
 
         audio_route_reset_path(adev->audio_route,
@@ -264,7 +264,7 @@ static int32_t start_hfp(struct audio_device *adev,
     uc_info->in_snd_device = SND_DEVICE_NONE;
     uc_info->out_snd_device = SND_DEVICE_NONE;
 
-    list_add_tail(&adev->usecase_list, &uc_info->list);
+    add_usecase_to_list(adev, uc_info);
 
     audio_extn_tfa_98xx_set_mode_bt();
 
@@ -404,7 +404,7 @@ static int32_t stop_hfp(struct audio_device *adev)
     }
     adev->enable_hfp = false;
 
-    list_remove(&uc_info->list);
+    remove_usecase_from_list(adev, uc_info);
     free(uc_info);
 
     ALOGD("%s: exit: status(%d)", __func__, ret);
@@ -24,9 +24,14 @@
    Each stream in audio_hal registers for a callback in
    adev_open_*_stream.
 
-   A thread is spawned to poll() on sound card state files in /proc.
-   On observing a sound card state change, this thread invokes the
-   callbacks registered.
+   A thread is spawned to epoll_wait() on sound card state files in /proc
+   and switch state files in /sys. On observing a state change, this thread
+   hands a parsed snd_mon_event_t to the callbacks registered.
+
+   Card state transitions that follow a delivered one within the debounce
+   window are coalesced: the first transition of an SSR is reported at once,
+   the state the card settles in is reported when the window closes, and a
+   flap that ends where it started is not reported at all.
 
    Callbacks are deregistered in adev_close_*_stream and adev_close
 */
@@ -35,13 +40,15 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
-#include <sys/poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <pthread.h>
 #include <cutils/list.h>
 #include <cutils/hashmap.h>
+#include <cutils/properties.h>
 #include <log/log.h>
-#include <cutils/str_parms.h>
 #include <ctype.h>
+#include <utils/Timers.h>
 
 #include "audio_hw.h"
 #include "audio_extn.h"
@@ -59,72 +66,66 @@
 #define MAX_SLEEP_RETRY 100
 #define AUDIO_INIT_SLEEP_WAIT 100 /* 100 ms */
 
-#define AUDIO_PARAMETER_KEY_EXT_AUDIO_DEVICE "ext_audio_device"
+#define SND_MON_DEBOUNCE_MS_DEFAULT 100
+#define SND_MON_MAX_EVENTS 8
 
 typedef enum {
-    audio_event_on,
-    audio_event_off
-} audio_event_status;
+    SRC_QUIT,
+    SRC_SNDCARD,
+    SRC_DEV_EVENT,
+} src_type_t;
 
+// what an epoll event's data.ptr points at
 typedef struct {
-    int card;
+    src_type_t type;
     int fd;
+} event_src_t;
+
+typedef struct {
+    event_src_t src;
+    int card;
     struct listnode node; // membership in sndcards list
-    card_status_t status;
+    card_status_t status;           // last read from the state file
+    card_status_t reported;         // last handed to listeners
+    nsecs_t quiet_until_ns;         // end of the debounce window
+    bool pending;                   // status may differ from reported
 } sndcard_t;
 
 typedef struct {
+    event_src_t src;
     char * dev;
-    int fd;
     int status;
     struct listnode node; // membership in deviceevents list;
 } dev_event_t;
 
-typedef void (* notifyfn)(const void * target, const char * msg);
-
 typedef struct {
-    const void * target;
-    notifyfn notify;
     struct listnode cards;
     unsigned int num_cards;
     struct listnode dev_events;
     unsigned int num_dev_events;
     pthread_t monitor_thread;
-    int intpipe[2];
+    int epoll_fd;
+    event_src_t quit;               // eventfd signalled by deinit
+    nsecs_t debounce_ns;
     Hashmap * listeners; // from stream * -> callback func
+    audio_hist_t dispatch_hist;     // state file wakeup to last callback
     bool initcheck;
 } sndmonitor_state_t;
 
 static sndmonitor_state_t sndmonitor;
 
-static char * read_state(int fd)
+/* reads the whole state file into buf, trailing whitespace trimmed */
+static ssize_t read_state(int fd, char * buf, size_t size)
 {
-    struct stat buf;
-    if (fstat(fd, &buf) < 0)
-        return NULL;
-
-    off_t pos = lseek(fd, 0, SEEK_CUR);
-    off_t avail = buf.st_size - pos;
-    if (avail <= 0) {
-        ALOGD("avail %ld", avail);
-        return NULL;
-    }
+    // pread from 0 also re-arms POLLPRI on both procfs and sysfs
+    ssize_t bytes = pread(fd, buf, size - 1, 0);
+    if (bytes < 0)
+        return -errno;
 
-    char * state = (char *)calloc(avail+1, sizeof(char));
-    if (!state)
-        return NULL;
-
-    ssize_t bytes=read(fd, state, avail);
-    if (bytes <= 0)
-        return NULL;
-
-    // trim trailing whitespace
-    while (bytes && isspace(*(state+bytes-1))) {
-        *(state + bytes - 1) = '\0';
+    while (bytes && isspace((unsigned char)buf[bytes - 1]))
         --bytes;
-    }
-    lseek(fd, 0, SEEK_SET);
-    return state;
+    buf[bytes] = '\0';
+    return bytes;
 }
 
 static int add_new_sndcard(int card, int fd)
@@ -134,18 +135,18 @@ static int add_new_sndcard(int card, int fd)
     if (!s)
         return -1;
 
+    s->src.type = SRC_SNDCARD;
+    s->src.fd = fd; // dup?
     s->card = card;
-    s->fd = fd; // dup?
 
-    char * state = read_state(fd);
-    bool online = state && !strcmp(state, "ONLINE");
+    char state[16];
+    bool online = read_state(fd, state, sizeof(state)) > 0 &&
+                  !strcmp(state, "ONLINE");
 
     ALOGV("card %d initial state %s %d", card, state, online);
 
-    if (state)
-        free(state);
-
     s->status = online ? CARD_STATUS_ONLINE : CARD_STATUS_OFFLINE;
+    s->reported = s->status;
     list_add_tail(&sndmonitor.cards, &s->node);
     return 0;
 }
@@ -287,7 +288,7 @@ static void free_sndcards()
         struct listnode * n = list_head(&sndmonitor.cards);
         sndcard_t * s = node_to_item(n, sndcard_t, node);
         list_remove(n);
-        close(s->fd);
+        close(s->src.fd);
         free(s);
     }
 }
@@ -300,7 +301,12 @@ static int add_new_dev_event(char * d_name, int fd)
         return -1;
 
     d->dev = strdup(d_name);
-    d->fd = fd;
+    if (!d->dev) {
+        free(d);
+        return -1;
+    }
+    d->src.type = SRC_DEV_EVENT;
+    d->src.fd = fd;
     list_add_tail(&sndmonitor.dev_events, &d->node);
     return 0;
 }
@@ -331,9 +337,10 @@ static int enum_dev_events()
         fd = open(path, O_RDONLY);
         if (fd == -1) {
             ALOGE("Open %s failed : %s", path, strerror(errno));
+        } else if (!add_new_dev_event(in_file->d_name, fd)) {
+            num_dev_events++;
         } else {
-            if (!add_new_dev_event(in_file->d_name, fd))
-                num_dev_events++;
+            close(fd);
         }
     }
     closedir(dp);
@@ -347,210 +354,206 @@ static void free_dev_events()
         struct listnode * n = list_head(&sndmonitor.dev_events);
         dev_event_t * d = node_to_item(n, dev_event_t, node);
         list_remove(n);
-        close(d->fd);
+        close(d->src.fd);
         free(d->dev);
         free(d);
     }
 }
 
-static int notify(const struct str_parms * params)
-{
-    if (!params)
-        return -1;
+static void notify(const snd_mon_event_t * event, nsecs_t wakeup_ns);
 
-    char * str = str_parms_to_str((struct str_parms *)params);
+static void on_dev_event(dev_event_t * dev_event, nsecs_t wakeup_ns)
+{
+    char state[16];
+    if (read_state(dev_event->src.fd, state, sizeof(state)) <= 0)
+        return;
 
-    if (!str)
-        return -1;
+    int status = atoi(state);
+    if (status == dev_event->status)
+        return;
 
-    if (sndmonitor.notify)
-        sndmonitor.notify(sndmonitor.target, str);
+    dev_event->status = status;
 
-    ALOGV("%s", str);
-    free(str);
-    return 0;
+    snd_mon_event_t event = {
+        .type = SND_MON_EVENT_EXT_DEVICE,
+        .card = -1,
+        .status = status ? CARD_STATUS_ONLINE : CARD_STATUS_OFFLINE,
+        .dev = dev_event->dev,
+    };
+    notify(&event, wakeup_ns);
 }
 
-int on_dev_event(dev_event_t * dev_event)
+static void report_sndcard(sndcard_t * s, nsecs_t now, nsecs_t wakeup_ns)
 {
-    char state_buf[2];
-    if (read(dev_event->fd, state_buf, 1) <= 0)
-        return -1;
-
-    lseek(dev_event->fd, 0, SEEK_SET);
-    state_buf[1]='\0';
-    if (atoi(state_buf) == dev_event->status)
-        return 0;
-
-    dev_event->status = atoi(state_buf);
-
-    struct str_parms * params = str_parms_create();
-
-    if (!params)
-        return -1;
-
-    char val[32] = {0};
-    snprintf(val, sizeof(val), "%s,%s", dev_event->dev,
-             dev_event->status ? "ON" : "OFF");
+    s->pending = false;
+    if (s->status == s->reported) {
+        // flapped back before the window closed, nobody needs to hear it
+        return;
+    }
 
-    if (str_parms_add_str(params, AUDIO_PARAMETER_KEY_EXT_AUDIO_DEVICE, val) < 0)
-        return -1;
+    s->reported = s->status;
+    s->quiet_until_ns = now + sndmonitor.debounce_ns;
 
-    int ret = notify(params);
-    str_parms_destroy(params);
-    return ret;
+    /*
+     * cpe actual card num is (card - CPE_MAGIC_NUM), so subtract accordingly.
+     * SLPI actual fd num is (card - SLPI_MAGIC_NUM), so subtract accordingly.
+     */
+    snd_mon_event_t event = { .status = s->status, .dev = NULL };
+    if (s->card >= SLPI_MAGIC_NUM) {
+        event.type = SND_MON_EVENT_SLPI;
+        event.card = s->card - SLPI_MAGIC_NUM;
+    } else if (s->card >= CPE_MAGIC_NUM) {
+        event.type = SND_MON_EVENT_CPE;
+        event.card = s->card - CPE_MAGIC_NUM;
+    } else {
+        event.type = SND_MON_EVENT_CARD;
+        event.card = s->card;
+    }
+    notify(&event, wakeup_ns);
 }
 
-bool on_sndcard_state_update(sndcard_t * s)
+static void on_sndcard_state_update(sndcard_t * s, nsecs_t wakeup_ns)
 {
-    char rd_buf[9]={0};
+    char state[16];
     card_status_t status;
 
-    if (read(s->fd, rd_buf, 8) <= 0)
-        return -1;
-
-    rd_buf[8] = '\0';
-    lseek(s->fd, 0, SEEK_SET);
+    if (read_state(s->src.fd, state, sizeof(state)) <= 0)
+        return;
 
-    ALOGV("card num %d, new state %s", s->card, rd_buf);
+    ALOGV("card num %d, new state %s", s->card, state);
 
-    if (strstr(rd_buf, "OFFLINE"))
+    if (strstr(state, "OFFLINE"))
         status = CARD_STATUS_OFFLINE;
-    else if (strstr(rd_buf, "ONLINE"))
+    else if (strstr(state, "ONLINE"))
         status = CARD_STATUS_ONLINE;
     else {
         ALOGE("unknown state");
-        return 0;
+        return;
     }
 
     if (status == s->status) // no change
-        return 0;
+        return;
 
     s->status = status;
 
-    struct str_parms * params = str_parms_create();
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (now < s->quiet_until_ns) {
+        ALOGV("card num %d, deferring %s", s->card,
+              status == CARD_STATUS_ONLINE ? "ONLINE" : "OFFLINE");
+        s->pending = true;
+        return;
+    }
+    report_sndcard(s, now, wakeup_ns);
+}
 
-    if (!params)
-        return -1;
+/* reports cards whose debounce window closed, returns epoll timeout in ms */
+static int flush_pending_sndcards()
+{
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t next = -1;
+    struct listnode *node;
 
-    char val[32] = {0};
-    bool is_cpe = ((s->card >= CPE_MAGIC_NUM) && (s->card < SLPI_MAGIC_NUM));
-    bool is_slpi = (s->card == SLPI_MAGIC_NUM);
-    /*
-     * cpe actual card num is (card - CPE_MAGIC_NUM), so subtract accordingly.
-     * SLPI actual fd num is (card - SLPI_MAGIC_NUM), so subtract accordingly.
-     */
-    snprintf(val, sizeof(val), "%d,%s",
-        s->card - (is_cpe ? CPE_MAGIC_NUM : (is_slpi ? SLPI_MAGIC_NUM : 0)),
-                 status == CARD_STATUS_ONLINE ? "ONLINE" : "OFFLINE");
+    list_for_each(node, &sndmonitor.cards) {
+        sndcard_t * s = node_to_item(node, sndcard_t, node);
+        if (!s->pending)
+            continue;
+        if (now >= s->quiet_until_ns) {
+            report_sndcard(s, now, now);
+            continue;
+        }
+        if (next < 0 || s->quiet_until_ns < next)
+            next = s->quiet_until_ns;
+    }
 
-    if (str_parms_add_str(params,
-            is_cpe ? "CPE_STATUS" : (is_slpi ? "SLPI_STATUS" : "SND_CARD_STATUS"),
-                          val) < 0)
+    if (next < 0)
         return -1;
+    // round up so we never wake just short of the deadline
+    return (int)((next - now + 999999) / 1000000);
+}
 
-    int ret = notify(params);
-    str_parms_destroy(params);
-    return ret;
+static int add_epoll_src(event_src_t * src)
+{
+    struct epoll_event ev = {
+        .events = src->type == SRC_QUIT ? EPOLLIN : EPOLLPRI,
+        .data.ptr = src,
+    };
+    return epoll_ctl(sndmonitor.epoll_fd, EPOLL_CTL_ADD, src->fd, &ev);
 }
 
-void * monitor_thread_loop(void * args __unused)
+static int add_epoll_srcs()
 {
-    ALOGV("Start threadLoop()");
-    unsigned int num_poll_fds = sndmonitor.num_cards +
-                                sndmonitor.num_dev_events + 1/*pipe*/;
-    struct pollfd * pfd = (struct pollfd *)calloc(sizeof(struct pollfd),
-                                                  num_poll_fds);
-    if (!pfd)
-        return NULL;
+    struct listnode *node;
 
-    pfd[0].fd = sndmonitor.intpipe[0];
-    pfd[0].events = POLLPRI|POLLIN;
+    if (add_epoll_src(&sndmonitor.quit) < 0)
+        return -errno;
 
-    int i=1;
-    struct listnode *node;
     list_for_each(node, &sndmonitor.cards) {
         sndcard_t * s = node_to_item(node, sndcard_t, node);
-        pfd[i].fd = s->fd;
-        pfd[i].events = POLLPRI;
-        ++i;
+        if (add_epoll_src(&s->src) < 0)
+            return -errno;
     }
 
     list_for_each(node, &sndmonitor.dev_events) {
         dev_event_t * d = node_to_item(node, dev_event_t, node);
-        pfd[i].fd = d->fd;
-        pfd[i].events = POLLPRI;
-        ++i;
+        if (add_epoll_src(&d->src) < 0)
+            return -errno;
     }
+    return 0;
+}
+
+void * monitor_thread_loop(void * args __unused)
+{
+    ALOGV("Start threadLoop()");
+    struct epoll_event events[SND_MON_MAX_EVENTS];
 
     while (1) {
-        if (poll(pfd, num_poll_fds, -1) < 0) {
+        /*
+         * Recomputed from the deadlines on every pass, an interrupted or
+         * early wakeup must not restart the debounce window.
+         */
+        int timeout_ms = flush_pending_sndcards();
+        int n = epoll_wait(sndmonitor.epoll_fd, events, SND_MON_MAX_EVENTS,
+                           timeout_ms);
+        if (n < 0) {
             int errno_ = errno;
-            ALOGE("poll() failed w/ err %s", strerror(errno));
+            ALOGE("epoll_wait() failed w/ err %s", strerror(errno));
             switch (errno_) {
             case EINTR:
-            case ENOMEM:
-                sleep(2);
                 continue;
             default:
-                /* above errors can be caused due to current system
-                   state .. any other error is not expected */
-                LOG_ALWAYS_FATAL("unxpected poll() system call failure");
+                /* EINTR is caused by the current system state ..
+                   any other error is not expected */
+                LOG_ALWAYS_FATAL("unxpected epoll_wait() system call failure");
                 break;
             }
         }
-        ALOGV("out of poll()");
-
-#define READY_TO_READ(p) ((p)->revents & (POLLIN|POLLPRI))
-#define ERROR_IN_FD(p) ((p)->revents & (POLLERR|POLLHUP|POLLNVAL))
-
-        // check if requested to exit
-        if (READY_TO_READ(&pfd[0])) {
-            char buf[2]={0};
-            read(pfd[0].fd, buf, 1);
-            if (!strcmp(buf, "Q"))
-                break;
-        } else if (ERROR_IN_FD(&pfd[0])) {
-            // do not consider for poll again
-            // POLLERR - can this happen?
-            // POLLHUP - adev must not close pipe
-            // POLLNVAL - fd is valid
-            LOG_ALWAYS_FATAL("unxpected error in pipe poll fd 0x%x",
-                             pfd[0].revents);
-            pfd[0].fd *= -1;
-        }
-
-        i=1;
-        list_for_each(node, &sndmonitor.cards) {
-            sndcard_t * s = node_to_item(node, sndcard_t, node);
-            if (READY_TO_READ(&pfd[i]))
-                on_sndcard_state_update(s);
-            else if (ERROR_IN_FD(&pfd[i])) {
-                // do not consider for poll again
-                // POLLERR - can this happen as we are reading from a fs?
-                // POLLHUP - not valid for cardN/state
-                // POLLNVAL - fd is valid
-                LOG_ALWAYS_FATAL("unxpected error in card poll fd 0x%x",
-                                 pfd[i].revents);
-                pfd[i].fd *= -1;
+        ALOGV("out of epoll_wait() with %d events", n);
+
+        const nsecs_t wakeup_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (int i = 0; i < n; i++) {
+            event_src_t * src = (event_src_t *)events[i].data.ptr;
+            uint32_t revents = events[i].events;
+
+            if (!(revents & (EPOLLIN|EPOLLPRI))) {
+                // EPOLLERR - can this happen as we are reading from a fs?
+                // EPOLLHUP - not valid for state files, deinit keeps quit fd
+                LOG_ALWAYS_FATAL("unxpected error on fd %d type %d 0x%x",
+                                 src->fd, src->type, revents);
+                continue;
             }
-            ++i;
-        }
 
-        list_for_each(node, &sndmonitor.dev_events) {
-            dev_event_t * d = node_to_item(node, dev_event_t, node);
-            if (READY_TO_READ(&pfd[i]))
-                on_dev_event(d);
-            else if (ERROR_IN_FD(&pfd[i])) {
-                // do not consider for poll again
-                // POLLERR - can this happen as we are reading from a fs?
-                // POLLHUP - not valid for switch/state
-                // POLLNVAL - fd is valid
-                LOG_ALWAYS_FATAL("unxpected error in dev poll fd 0x%x",
-                                 pfd[i].revents);
-                pfd[i].fd *= -1;
+            switch (src->type) {
+            case SRC_QUIT:
+                ALOGV("Exit threadLoop()");
+                return NULL;
+            case SRC_SNDCARD:
+                on_sndcard_state_update(node_to_item(src, sndcard_t, src),
+                                        wakeup_ns);
+                break;
+            case SRC_DEV_EVENT:
+                on_dev_event(node_to_item(src, dev_event_t, src), wakeup_ns);
+                break;
             }
-            ++i;
         }
     }
 
@@ -571,25 +574,21 @@ static bool hasheq(void * key1, void *key2)
 static bool snd_cb(void* key, void* value, void* context)
 {
     snd_mon_cb cb = (snd_mon_cb)value;
-    cb(key, context);
+    cb(key, (const snd_mon_event_t *)context);
     return true;
 }
 
-static void snd_mon_update(const void * target __unused, const char * msg)
+static void notify(const snd_mon_event_t * event, nsecs_t wakeup_ns)
 {
-    // target can be used to check if this message is intended for the
-    // recipient or not. (using some statically saved state)
-
-    struct str_parms *parms = str_parms_create_str(msg);
-
-    if (!parms)
-        return;
+    ALOGV("type %d card %d status %d dev %s", event->type, event->card,
+          event->status, event->dev ? event->dev : "");
 
     hashmapLock(sndmonitor.listeners);
-    hashmapForEach(sndmonitor.listeners, snd_cb, parms);
+    hashmapForEach(sndmonitor.listeners, snd_cb, (void *)event);
     hashmapUnlock(sndmonitor.listeners);
 
-    str_parms_destroy(parms);
+    audio_hist_log(&sndmonitor.dispatch_hist,
+                   systemTime(SYSTEM_TIME_MONOTONIC) - wakeup_ns);
 }
 
 static int listeners_init()
@@ -631,13 +630,13 @@ int audio_extn_snd_mon_deinit()
     if (!sndmonitor.initcheck)
         return -1;
 
-    write(sndmonitor.intpipe[1], "Q", 1);
+    eventfd_write(sndmonitor.quit.fd, 1);
     pthread_join(sndmonitor.monitor_thread, (void **) NULL);
     free_dev_events();
     listeners_deinit();
     free_sndcards();
-    close(sndmonitor.intpipe[0]);
-    close(sndmonitor.intpipe[1]);
+    close(sndmonitor.epoll_fd);
+    close(sndmonitor.quit.fd);
 
     sndmonitor.initcheck = 0;
     return 0;
@@ -645,14 +644,22 @@ int audio_extn_snd_mon_deinit()
 
 int audio_extn_snd_mon_init()
 {
-    sndmonitor.notify = snd_mon_update;
-    sndmonitor.target = NULL; // unused for now
     list_init(&sndmonitor.cards);
     list_init(&sndmonitor.dev_events);
     sndmonitor.initcheck = false;
+    sndmonitor.debounce_ns = (nsecs_t)property_get_int32(
+            "vendor.audio.snd_mon_debounce_ms",
+            SND_MON_DEBOUNCE_MS_DEFAULT) * 1000000;
+    audio_hist_reset(&sndmonitor.dispatch_hist);
 
-    if (pipe(sndmonitor.intpipe) < 0)
-        goto pipe_error;
+    sndmonitor.quit.type = SRC_QUIT;
+    sndmonitor.quit.fd = eventfd(0, EFD_CLOEXEC);
+    if (sndmonitor.quit.fd < 0)
+        goto eventfd_error;
+
+    sndmonitor.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sndmonitor.epoll_fd < 0)
+        goto epoll_error;
 
     if (enum_sndcards() < 0)
         goto enum_sncards_error;
@@ -664,7 +671,13 @@ int audio_extn_snd_mon_init()
     enum_dev_events(); // failure here isn't fatal
 #endif
 
-    int ret = pthread_create(&sndmonitor.monitor_thread,
+    int ret = add_epoll_srcs();
+    if (ret < 0) {
+        ALOGE("epoll_ctl failed: %s", strerror(-ret));
+        goto monitor_thread_create_error;
+    }
+
+    ret = pthread_create(&sndmonitor.monitor_thread,
                              (const pthread_attr_t *) NULL,
                              monitor_thread_loop, NULL);
 
@@ -675,13 +688,15 @@ int audio_extn_snd_mon_init()
     return 0;
 
 monitor_thread_create_error:
+    free_dev_events();
     listeners_deinit();
 listeners_error:
     free_sndcards();
 enum_sncards_error:
-    close(sndmonitor.intpipe[0]);
-    close(sndmonitor.intpipe[1]);
-pipe_error:
+    close(sndmonitor.epoll_fd);
+epoll_error:
+    close(sndmonitor.quit.fd);
+eventfd_error:
     return -ENODEV;
 }
 
@@ -705,3 +720,12 @@ int audio_extn_snd_mon_unregister_listener(void * stream)
     ALOGV("deregister listener for stream %p ", stream);
     return del_listener(stream);
 }
+
+void audio_extn_snd_mon_dump(int fd)
+{
+    if (!sndmonitor.initcheck)
+        return;
+
+    audio_hist_dump(&sndmonitor.dispatch_hist, fd, "  ",
+                    "Sound card event dispatch time");
+}
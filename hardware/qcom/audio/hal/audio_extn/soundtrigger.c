@@ -208,13 +208,30 @@ static int populate_usecase(struct audio_hal_usecase *usecase,
     return status;
 }
 
-static void stdev_snd_mon_cb(void * stream __unused, struct str_parms * parms)
+static void stdev_snd_mon_cb(void * stream __unused, const snd_mon_event_t * event)
 {
-    if (!parms)
+    struct audio_event_info ev_info;
+    bool online;
+
+    if (!st_dev || !event)
         return;
 
-    audio_extn_sound_trigger_set_parameters(NULL, parms);
-    return;
+    online = (event->status == CARD_STATUS_ONLINE);
+    switch (event->type) {
+    case SND_MON_EVENT_CARD:
+        ev_info.u.status = online ? SND_CARD_STATUS_ONLINE :
+                                    SND_CARD_STATUS_OFFLINE;
+        break;
+    case SND_MON_EVENT_CPE:
+        ev_info.u.status = online ? CPE_STATUS_ONLINE : CPE_STATUS_OFFLINE;
+        break;
+    case SND_MON_EVENT_SLPI:
+        ev_info.u.status = online ? SLPI_STATUS_ONLINE : SLPI_STATUS_OFFLINE;
+        break;
+    default:
+        return;
+    }
+    st_dev->st_callback(AUDIO_EVENT_SSR, &ev_info);
 }
 
 int audio_hw_call_back(sound_trigger_event_type_t event,
@@ -340,7 +340,7 @@ static int spkr_calibrate(int t0)
     uc_info_rx->stream.out = adev->primary_output;
     uc_info_rx->out_snd_device = SND_DEVICE_OUT_SPEAKER_PROTECTED;
     disable_rx = true;
-    list_add_tail(&adev->usecase_list, &uc_info_rx->list);
+    add_usecase_to_list(adev, uc_info_rx);
     enable_snd_device(adev, SND_DEVICE_OUT_SPEAKER_PROTECTED);
     enable_audio_route(adev, uc_info_rx);
 
@@ -373,7 +373,7 @@ static int spkr_calibrate(int t0)
     uc_info_tx->out_snd_device = SND_DEVICE_NONE;
 
     disable_tx = true;
-    list_add_tail(&adev->usecase_list, &uc_info_tx->list);
+    add_usecase_to_list(adev, uc_info_tx);
     enable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
     enable_audio_route(adev, uc_info_tx);
 
@@ -510,12 +510,12 @@ exit:
         pthread_mutex_lock(&handle.spkr_calib_cancelack_mutex);
     }
     if (disable_rx) {
-        list_remove(&uc_info_rx->list);
+        remove_usecase_from_list(adev, uc_info_rx);
         disable_snd_device(adev, SND_DEVICE_OUT_SPEAKER_PROTECTED);
         disable_audio_route(adev, uc_info_rx);
     }
     if (disable_tx) {
-        list_remove(&uc_info_tx->list);
+        remove_usecase_from_list(adev, uc_info_tx);
         disable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
         disable_audio_route(adev, uc_info_tx);
     }
@@ -830,7 +830,7 @@ int audio_extn_spkr_prot_start_processing(snd_device_t snd_device)
         uc_info_tx->in_snd_device = SND_DEVICE_IN_CAPTURE_VI_FEEDBACK;
         uc_info_tx->out_snd_device = SND_DEVICE_NONE;
         handle.pcm_tx = NULL;
-        list_add_tail(&adev->usecase_list, &uc_info_tx->list);
+        add_usecase_to_list(adev, uc_info_tx);
         enable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
         enable_audio_route(adev, uc_info_tx);
 
@@ -875,7 +875,7 @@ exit:
         if (handle.pcm_tx)
             pcm_close(handle.pcm_tx);
         handle.pcm_tx = NULL;
-        list_remove(&uc_info_tx->list);
+        remove_usecase_from_list(adev, uc_info_tx);
         disable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
         disable_audio_route(adev, uc_info_tx);
         free(uc_info_tx);
@@ -902,7 +902,7 @@ void audio_extn_spkr_prot_stop_processing(snd_device_t snd_device)
         handle.pcm_tx = NULL;
         disable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
         if (uc_info_tx) {
-            list_remove(&uc_info_tx->list);
+            remove_usecase_from_list(adev, uc_info_tx);
             disable_audio_route(adev, uc_info_tx);
             free(uc_info_tx);
         }
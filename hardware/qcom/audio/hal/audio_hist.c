@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "audio_hist.h"
+
+void audio_hist_log(audio_hist_t *hist, int64_t ns)
+{
+    uint64_t us = ns > 0 ? (uint64_t)ns / 1000 : 0;
+    unsigned int bucket = us < 2 ? 0 : 63 - __builtin_clzll(us);
+    int64_t max;
+
+    if (bucket >= AUDIO_HIST_BUCKETS)
+        bucket = AUDIO_HIST_BUCKETS - 1;
+    atomic_fetch_add_explicit(&hist->count[bucket], 1, memory_order_relaxed);
+
+    max = atomic_load_explicit(&hist->max_ns, memory_order_relaxed);
+    while (ns > max &&
+           !atomic_compare_exchange_weak_explicit(&hist->max_ns, &max, ns,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
+}
+
+void audio_hist_reset(audio_hist_t *hist)
+{
+    for (int i = 0; i < AUDIO_HIST_BUCKETS; i++)
+        atomic_store_explicit(&hist->count[i], 0, memory_order_relaxed);
+    atomic_store_explicit(&hist->max_ns, 0, memory_order_relaxed);
+}
+
+void audio_hist_dump(audio_hist_t *hist, int fd, const char *prefix, const char *name)
+{
+    uint32_t count[AUDIO_HIST_BUCKETS];
+    uint64_t total = 0;
+    char buffer[512];
+    int len;
+
+    for (int i = 0; i < AUDIO_HIST_BUCKETS; i++) {
+        count[i] = atomic_load_explicit(&hist->count[i], memory_order_relaxed);
+        total += count[i];
+    }
+    if (total == 0)
+        return;
+
+    len = snprintf(buffer, sizeof(buffer), "n %llu max %.3f ms |", (unsigned long long)total,
+                   atomic_load_explicit(&hist->max_ns, memory_order_relaxed) * 1e-6);
+    for (int i = 0; i < AUDIO_HIST_BUCKETS && len < (int)sizeof(buffer); i++) {
+        if (count[i] == 0)
+            continue;
+        if (i == AUDIO_HIST_BUCKETS - 1)
+            len += snprintf(buffer + len, sizeof(buffer) - len, " >=%lluus:%u",
+                            1ULL << i, count[i]);
+        else
+            len += snprintf(buffer + len, sizeof(buffer) - len, " <%lluus:%u",
+                            1ULL << (i + 1), count[i]);
+    }
+    dprintf(fd, "%s%s: %s\n", prefix, name, buffer);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIO_HIST_H
+#define AUDIO_HIST_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Bucket 0 counts durations below 2 us, bucket i durations in
+ * [2^i, 2^(i + 1)) us and the last bucket everything from ~0.5 s up.
+ */
+#define AUDIO_HIST_BUCKETS 20
+
+/*
+ * Latency histogram cheap enough to log on every buffer. Logging only does
+ * relaxed atomic increments, so it needs no lock and may race with a dump or
+ * reset; at worst a few samples are miscounted.
+ */
+typedef struct {
+    atomic_uint_least32_t count[AUDIO_HIST_BUCKETS];
+    atomic_int_least64_t max_ns;
+} audio_hist_t;
+
+void audio_hist_log(audio_hist_t *hist, int64_t ns);
+
+void audio_hist_reset(audio_hist_t *hist);
+
+/* prints "<prefix><name>: n <count> max <x> ms | <2us:<n> <4us:<n> ..." unless empty */
+void audio_hist_dump(audio_hist_t *hist, int fd, const char *prefix, const char *name);
+
+#endif /* AUDIO_HIST_H */
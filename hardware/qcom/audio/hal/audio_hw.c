@@ -53,6 +53,7 @@
 #include "audio_hw.h"
 #include "audio_extn.h"
 #include "audio_perf.h"
+#include "audio_pcm_kernels.h"
 #include "platform_api.h"
 #include <platform.h>
 #include "voice_extn.h"
@@ -470,27 +471,6 @@ static void release_in_focus(struct stream_in *in, long ns __unused)
         adev->adm_abandon_focus(adev->adm_data, in->capture_handle);
 }
 
-static int parse_snd_card_status(struct str_parms * parms, int * card,
-                                 card_status_t * status)
-{
-    char value[32]={0};
-    char state[32]={0};
-
-    int ret = str_parms_get_str(parms, "SND_CARD_STATUS", value, sizeof(value));
-
-    if (ret < 0)
-        return -1;
-
-    // sscanf should be okay as value is of max length 32.
-    // same as sizeof state.
-    if (sscanf(value, "%d,%s", card, state) < 2)
-        return -1;
-
-    *status = !strcmp(state, "ONLINE") ? CARD_STATUS_ONLINE :
-                                         CARD_STATUS_OFFLINE;
-    return 0;
-}
-
 // always call with adev lock held
 void send_gain_dep_calibration_l() {
     if (last_known_cal_step >= 0)
@@ -648,11 +628,106 @@ static bool is_a2dp_device(snd_device_t out_snd_device)
    return out_snd_device == SND_DEVICE_OUT_BT_A2DP;
 }
 
+/* Direct mapped, so a slot only gets recomposed when two hot paths collide */
+#define MIXER_PATH_CACHE_SIZE 64
+
+struct mixer_path_cache_entry {
+    audio_usecase_t usecase;
+    snd_device_t snd_device;
+    char path[MIXER_PATH_MAX_LENGTH];
+};
+
+/*
+ * Returns the mixer path of usecase on snd_device: the use_case_table name
+ * followed by the backend of the device. Backends are fixed once the
+ * platform is initialized, so the composed name is cached.
+ * The result is valid until the next call, must be called with hw device
+ * mutex locked.
+ */
+static const char *get_usecase_mixer_path(struct audio_device *adev,
+                                          audio_usecase_t uc_id,
+                                          snd_device_t snd_device)
+{
+    struct mixer_path_cache_entry *entry;
+
+    entry = &adev->mixer_path_cache[((unsigned int)uc_id * SND_DEVICE_MAX +
+                                     (unsigned int)snd_device) %
+                                    MIXER_PATH_CACHE_SIZE];
+    if (entry->path[0] != '\0' && entry->usecase == uc_id &&
+            entry->snd_device == snd_device)
+        return entry->path;
+
+    entry->usecase = uc_id;
+    entry->snd_device = snd_device;
+    // we shouldn't truncate mixer_path
+    ALOGW_IF(strlcpy(entry->path, use_case_table[uc_id], sizeof(entry->path))
+            >= sizeof(entry->path), "%s: truncation on mixer path", __func__);
+    // this also appends to mixer_path
+    platform_add_backend_name(adev->platform, entry->path, snd_device);
+    return entry->path;
+}
+
+/*
+ * Apply or reset a usecase mixer path. While a device switch defers the
+ * mixer update, only the path state changes and the controls are written
+ * by flush_mixer_update(), skipping those the switch leaves as is. Only
+ * usecase paths are deferred: sound device paths are written in order by
+ * enable_snd_device() and disable_snd_device(), which flush first.
+ */
+static void apply_mixer_path(struct audio_device *adev, const char *path)
+{
+    if (adev->defer_mixer_update) {
+        audio_route_apply_path(adev->audio_route, path);
+        adev->mixer_update_pending = true;
+    } else {
+        audio_route_apply_and_update_path(adev->audio_route, path);
+    }
+}
+
+static void reset_mixer_path(struct audio_device *adev, const char *path)
+{
+    if (adev->defer_mixer_update) {
+        audio_route_reset_path(adev->audio_route, path);
+        adev->mixer_update_pending = true;
+    } else {
+        audio_route_reset_and_update_path(adev->audio_route, path);
+    }
+}
+
+/* must be called with hw device mutex locked */
+static void flush_mixer_update(struct audio_device *adev)
+{
+    if (adev->mixer_update_pending) {
+        adev->mixer_update_pending = false;
+        audio_route_update_mixer(adev->audio_route);
+    }
+}
+
+/*
+ * Sound device paths are powered up and down in order and extensions open
+ * and start feedback PCMs while enabling them, so the deferred usecase
+ * paths are written first and nothing is deferred until the device is done.
+ * Returns the deferral state to pass to end_snd_device_update().
+ */
+static bool begin_snd_device_update(struct audio_device *adev)
+{
+    bool defer_mixer_update = adev->defer_mixer_update;
+
+    flush_mixer_update(adev);
+    adev->defer_mixer_update = false;
+    return defer_mixer_update;
+}
+
+static void end_snd_device_update(struct audio_device *adev, bool defer_mixer_update)
+{
+    adev->defer_mixer_update = defer_mixer_update;
+}
+
 int enable_audio_route(struct audio_device *adev,
                        struct audio_usecase *usecase)
 {
     snd_device_t snd_device;
-    char mixer_path[MIXER_PATH_MAX_LENGTH];
+    const char *mixer_path;
 
     if (usecase == NULL)
         return -EINVAL;
@@ -696,14 +771,9 @@ int enable_audio_route(struct audio_device *adev,
     audio_extn_ma_set_device(usecase);
     audio_extn_utils_send_audio_calibration(adev, usecase);
 
-    // we shouldn't truncate mixer_path
-    ALOGW_IF(strlcpy(mixer_path, use_case_table[usecase->id], sizeof(mixer_path))
-            >= sizeof(mixer_path), "%s: truncation on mixer path", __func__);
-    // this also appends to mixer_path
-    platform_add_backend_name(adev->platform, mixer_path, snd_device);
-
+    mixer_path = get_usecase_mixer_path(adev, usecase->id, snd_device);
     ALOGD("%s: usecase(%d) apply and update mixer path: %s", __func__,  usecase->id, mixer_path);
-    audio_route_apply_and_update_path(adev->audio_route, mixer_path);
+    apply_mixer_path(adev, mixer_path);
 
     ALOGV("%s: exit", __func__);
     return 0;
@@ -713,7 +783,7 @@ int disable_audio_route(struct audio_device *adev,
                         struct audio_usecase *usecase)
 {
     snd_device_t snd_device;
-    char mixer_path[MIXER_PATH_MAX_LENGTH];
+    const char *mixer_path;
 
     if (usecase == NULL)
         return -EINVAL;
@@ -724,14 +794,10 @@ int disable_audio_route(struct audio_device *adev,
     else
         snd_device = usecase->out_snd_device;
 
-    // we shouldn't truncate mixer_path
-    ALOGW_IF(strlcpy(mixer_path, use_case_table[usecase->id], sizeof(mixer_path))
-            >= sizeof(mixer_path), "%s: truncation on mixer path", __func__);
-    // this also appends to mixer_path
-    platform_add_backend_name(adev->platform, mixer_path, snd_device);
+    mixer_path = get_usecase_mixer_path(adev, usecase->id, snd_device);
     ALOGD("%s: usecase(%d) reset and update mixer path: %s", __func__, usecase->id, mixer_path);
 
-    audio_route_reset_and_update_path(adev->audio_route, mixer_path);
+    reset_mixer_path(adev, mixer_path);
     if (usecase->type == PCM_CAPTURE) {
         struct stream_in *in = usecase->stream.in;
         if (in && in->ec_opened) {
@@ -745,8 +811,83 @@ int disable_audio_route(struct audio_device *adev,
     return 0;
 }
 
-int enable_snd_device(struct audio_device *adev,
-                      snd_device_t snd_device)
+/*
+ * An output sound device is kept enabled for snd_device_linger_ms after the
+ * last playback usecase on it stops, so that a stream restarting on the same
+ * device finds the path already powered and calibrated. Only one device
+ * lingers, and enabling any other sound device releases it first so a
+ * lingering path never shares a backend with a new one.
+ */
+
+/* must be called with hw device mutex locked */
+static void release_warm_snd_device(struct audio_device *adev)
+{
+    snd_device_t snd_device = adev->warm_snd_device;
+
+    if (snd_device == SND_DEVICE_NONE)
+        return;
+
+    ALOGV("%s: snd_device(%d: %s)", __func__,
+          snd_device, platform_get_snd_device_name(snd_device));
+    adev->warm_snd_device = SND_DEVICE_NONE;
+    disable_snd_device(adev, snd_device);
+}
+
+/*
+ * Keeps the reference usecase holds on its output sound device instead of
+ * dropping it. Returns false if the device must be disabled right away.
+ * must be called with hw device mutex locked
+ */
+static bool linger_snd_device(struct audio_device *adev,
+                              struct audio_usecase *usecase)
+{
+    snd_device_t snd_device = usecase->out_snd_device;
+
+    if (adev->snd_device_linger_ms <= 0 ||
+        usecase->type != PCM_PLAYBACK ||
+        snd_device == SND_DEVICE_NONE ||
+        is_a2dp_device(snd_device) ||
+        (usecase->devices & ~AUDIO_DEVICE_OUT_ALL_CODEC_BACKEND) ||
+        adev->card_status == CARD_STATUS_OFFLINE ||
+        audio_extn_tfa_98xx_is_supported())
+        return false;
+
+    release_warm_snd_device(adev);
+    adev->warm_snd_device = snd_device;
+    adev->warm_snd_device_deadline_ns = systemTime(SYSTEM_TIME_MONOTONIC) +
+            (int64_t)adev->snd_device_linger_ms * 1000000LL;
+    pthread_cond_signal(&adev->snd_device_linger_cond);
+    return true;
+}
+
+static void *snd_device_linger_thread_loop(void *context)
+{
+    struct audio_device *adev = (struct audio_device *)context;
+
+    prctl(PR_SET_NAME, (unsigned long)"Snd Dev Linger", 0, 0, 0);
+
+    pthread_mutex_lock(&adev->lock);
+    while (!adev->snd_device_linger_exit) {
+        if (adev->warm_snd_device == SND_DEVICE_NONE) {
+            pthread_cond_wait(&adev->snd_device_linger_cond, &adev->lock);
+            continue;
+        }
+        if (systemTime(SYSTEM_TIME_MONOTONIC) >= adev->warm_snd_device_deadline_ns) {
+            release_warm_snd_device(adev);
+            continue;
+        }
+        struct timespec deadline = {
+            .tv_sec = adev->warm_snd_device_deadline_ns / NANOS_PER_SECOND,
+            .tv_nsec = adev->warm_snd_device_deadline_ns % NANOS_PER_SECOND,
+        };
+        pthread_cond_timedwait(&adev->snd_device_linger_cond, &adev->lock, &deadline);
+    }
+    pthread_mutex_unlock(&adev->lock);
+    return NULL;
+}
+
+static int do_enable_snd_device(struct audio_device *adev,
+                                snd_device_t snd_device)
 {
     int i, num_devices = 0;
     snd_device_t new_snd_devices[2];
@@ -759,6 +900,15 @@ int enable_snd_device(struct audio_device *adev,
 
     platform_send_audio_calibration(adev->platform, snd_device);
 
+    if (adev->warm_snd_device == snd_device) {
+        /* take over the reference kept since its last usecase stopped */
+        ALOGV("%s: snd_device(%d: %s) is still warm",
+              __func__, snd_device, platform_get_snd_device_name(snd_device));
+        adev->warm_snd_device = SND_DEVICE_NONE;
+        return 0;
+    }
+    release_warm_snd_device(adev);
+
     if (adev->snd_dev_ref_cnt[snd_device] >= 1) {
         ALOGV("%s: snd_device(%d: %s) is already active",
               __func__, snd_device, platform_get_snd_device_name(snd_device));
@@ -811,6 +961,7 @@ int enable_snd_device(struct audio_device *adev,
 
         audio_route_apply_and_update_path(adev->audio_route, device_name);
     }
+    adev->snd_device_power_ups++;
 on_success:
     adev->snd_dev_ref_cnt[snd_device]++;
     ret_val = 0;
@@ -818,8 +969,18 @@ on_error:
     return ret_val;
 }
 
-int disable_snd_device(struct audio_device *adev,
-                       snd_device_t snd_device)
+int enable_snd_device(struct audio_device *adev,
+                      snd_device_t snd_device)
+{
+    bool defer_mixer_update = begin_snd_device_update(adev);
+    int ret = do_enable_snd_device(adev, snd_device);
+
+    end_snd_device_update(adev, defer_mixer_update);
+    return ret;
+}
+
+static int do_disable_snd_device(struct audio_device *adev,
+                                 snd_device_t snd_device)
 {
     int i, num_devices = 0;
     snd_device_t new_snd_devices[2];
@@ -880,6 +1041,16 @@ int disable_snd_device(struct audio_device *adev,
     return 0;
 }
 
+int disable_snd_device(struct audio_device *adev,
+                       snd_device_t snd_device)
+{
+    bool defer_mixer_update = begin_snd_device_update(adev);
+    int ret = do_disable_snd_device(adev, snd_device);
+
+    end_snd_device_update(adev, defer_mixer_update);
+    return ret;
+}
+
 #ifdef DYNAMIC_ECNS_ENABLED
 static int send_effect_enable_disable_mixer_ctl(struct audio_device *adev,
                           struct stream_in *in,
@@ -994,6 +1165,9 @@ static int check_and_enable_effect(struct audio_device *adev)
     struct listnode *node;
     struct stream_in *in = NULL;
 
+    if (adev->usecase_type_cnt[PCM_CAPTURE] == 0)
+        return 0;
+
     list_for_each(node, &adev->usecase_list)
     {
         struct audio_usecase *usecase = node_to_item(node, struct audio_usecase, list);
@@ -1129,6 +1303,36 @@ end:
     return d2; // return whatever was calculated before.
 }
 
+/*
+ * Number of listed usecases of the given kind, other than uc_info, that are
+ * not on snd_device. For playback the out devices of all non-capture
+ * usecases are considered, for capture the in devices of all non-playback
+ * usecases.
+ */
+static unsigned int count_usecases_off_snd_device(struct audio_device *adev,
+                                                  struct audio_usecase *uc_info,
+                                                  snd_device_t snd_device,
+                                                  bool playback)
+{
+    usecase_type_t skip_type = playback ? PCM_CAPTURE : PCM_PLAYBACK;
+    unsigned int total = 0, on_device = 0;
+    int i;
+
+    for (i = 0; i < USECASE_TYPE_MAX; i++) {
+        if (i != skip_type)
+            total += adev->usecase_type_cnt[i];
+    }
+    if (snd_device > SND_DEVICE_NONE && snd_device < SND_DEVICE_MAX)
+        on_device = adev->snd_dev_usecase_cnt[snd_device];
+
+    if (uc_info->listed && uc_info->type != skip_type) {
+        total--;
+        if (uc_info->listed_snd_device[playback ? 0 : 1] == snd_device)
+            on_device--;
+    }
+    return total - on_device;
+}
+
 static void check_and_route_playback_usecases(struct audio_device *adev,
                                               struct audio_usecase *uc_info,
                                               snd_device_t snd_device)
@@ -1152,6 +1356,10 @@ static void check_and_route_playback_usecases(struct audio_device *adev,
          force_routing = true;
     }
 
+    if (!force_routing &&
+            count_usecases_off_snd_device(adev, uc_info, snd_device, true) == 0)
+        return;
+
     /*
      * This function is to make sure that all the usecases that are active on
      * the hardware codec backend are always routed to any one device that is
@@ -1202,7 +1410,8 @@ static void check_and_route_playback_usecases(struct audio_device *adev,
                                                       snd_device);
                 enable_snd_device(adev, d_device);
                 /* Update the out_snd_device before enabling the audio route */
-                usecase->out_snd_device = d_device;
+                set_usecase_snd_devices(adev, usecase, d_device,
+                                        usecase->in_snd_device);
             }
         }
 
@@ -1234,6 +1443,9 @@ static void check_and_route_capture_usecases(struct audio_device *adev,
 
     platform_check_and_set_capture_backend_cfg(adev, uc_info, snd_device);
 
+    if (count_usecases_off_snd_device(adev, uc_info, snd_device, false) == 0)
+        return;
+
     /*
      * This function is to make sure that all the active capture usecases
      * are always routed to the same input sound device.
@@ -1287,7 +1499,8 @@ static void check_and_route_capture_usecases(struct audio_device *adev,
             usecase = node_to_item(node, struct audio_usecase, list);
             /* Update the in_snd_device only before enabling the audio route */
             if (switch_device[usecase->id] ) {
-                usecase->in_snd_device = snd_device;
+                set_usecase_snd_devices(adev, usecase, usecase->out_snd_device,
+                                        snd_device);
                 enable_audio_route(adev, usecase);
             }
         }
@@ -1466,6 +1679,9 @@ static audio_usecase_t get_voice_usecase_id_from_list(struct audio_device *adev)
     struct audio_usecase *usecase;
     struct listnode *node;
 
+    if (adev->usecase_type_cnt[VOICE_CALL] == 0)
+        return USECASE_INVALID;
+
     list_for_each(node, &adev->usecase_list) {
         usecase = node_to_item(node, struct audio_usecase, list);
         if (usecase->type == VOICE_CALL) {
@@ -1479,15 +1695,86 @@ static audio_usecase_t get_voice_usecase_id_from_list(struct audio_device *adev)
 struct audio_usecase *get_usecase_from_list(struct audio_device *adev,
                                             audio_usecase_t uc_id)
 {
-    struct audio_usecase *usecase;
+    if (uc_id < 0 || uc_id >= AUDIO_USECASE_MAX)
+        return NULL;
+    return adev->active_usecases[uc_id];
+}
+
+static void index_usecase_snd_devices(struct audio_device *adev,
+                                      struct audio_usecase *usecase,
+                                      int delta)
+{
+    snd_device_t out_snd_device = usecase->listed_snd_device[0];
+    snd_device_t in_snd_device = usecase->listed_snd_device[1];
+
+    if (usecase->type != PCM_CAPTURE &&
+            out_snd_device > SND_DEVICE_NONE && out_snd_device < SND_DEVICE_MAX)
+        adev->snd_dev_usecase_cnt[out_snd_device] += delta;
+    if (usecase->type != PCM_PLAYBACK &&
+            in_snd_device > SND_DEVICE_NONE && in_snd_device < SND_DEVICE_MAX)
+        adev->snd_dev_usecase_cnt[in_snd_device] += delta;
+}
+
+/* must be called with hw device mutex locked */
+void add_usecase_to_list(struct audio_device *adev,
+                         struct audio_usecase *usecase)
+{
+    list_add_tail(&adev->usecase_list, &usecase->list);
+
+    /* like the list walk it replaces, the lookup finds the oldest usecase */
+    if (usecase->id >= 0 && usecase->id < AUDIO_USECASE_MAX &&
+            adev->active_usecases[usecase->id] == NULL)
+        adev->active_usecases[usecase->id] = usecase;
+    adev->usecase_type_cnt[usecase->type]++;
+
+    usecase->listed = true;
+    usecase->listed_snd_device[0] = usecase->out_snd_device;
+    usecase->listed_snd_device[1] = usecase->in_snd_device;
+    index_usecase_snd_devices(adev, usecase, 1);
+}
+
+/* must be called with hw device mutex locked */
+void remove_usecase_from_list(struct audio_device *adev,
+                              struct audio_usecase *usecase)
+{
+    struct audio_usecase *uc;
     struct listnode *node;
 
-    list_for_each(node, &adev->usecase_list) {
-        usecase = node_to_item(node, struct audio_usecase, list);
-        if (usecase->id == uc_id)
-            return usecase;
+    list_remove(&usecase->list);
+
+    index_usecase_snd_devices(adev, usecase, -1);
+    usecase->listed = false;
+    adev->usecase_type_cnt[usecase->type]--;
+
+    if (usecase->id >= 0 && usecase->id < AUDIO_USECASE_MAX &&
+            adev->active_usecases[usecase->id] == usecase) {
+        adev->active_usecases[usecase->id] = NULL;
+        list_for_each(node, &adev->usecase_list) {
+            uc = node_to_item(node, struct audio_usecase, list);
+            if (uc->id == usecase->id) {
+                adev->active_usecases[usecase->id] = uc;
+                break;
+            }
+        }
     }
-    return NULL;
+}
+
+/* must be called with hw device mutex locked */
+void set_usecase_snd_devices(struct audio_device *adev,
+                             struct audio_usecase *usecase,
+                             snd_device_t out_snd_device,
+                             snd_device_t in_snd_device)
+{
+    usecase->out_snd_device = out_snd_device;
+    usecase->in_snd_device = in_snd_device;
+
+    if (!usecase->listed)
+        return;
+
+    index_usecase_snd_devices(adev, usecase, -1);
+    usecase->listed_snd_device[0] = out_snd_device;
+    usecase->listed_snd_device[1] = in_snd_device;
+    index_usecase_snd_devices(adev, usecase, 1);
 }
 
 static bool force_device_switch(struct audio_usecase *usecase)
@@ -1513,6 +1800,9 @@ struct stream_in *adev_get_active_input(const struct audio_device *adev)
     struct listnode *node;
     struct stream_in *last_active_in = NULL;
 
+    if (adev->usecase_type_cnt[PCM_CAPTURE] == 0)
+        return NULL;
+
     /* Get last added active input.
      * TODO: We may use a priority mechanism to pick highest priority active source */
     list_for_each(node, &adev->usecase_list)
@@ -1530,6 +1820,9 @@ struct stream_in *get_voice_communication_input(const struct audio_device *adev)
 {
     struct listnode *node;
 
+    if (adev->usecase_type_cnt[PCM_CAPTURE] == 0)
+        return NULL;
+
     /* First check active inputs with voice communication source and then
      * any input if audio mode is in communication */
     list_for_each(node, &adev->usecase_list)
@@ -1584,6 +1877,9 @@ static struct stream_in *get_priority_input(struct audio_device *adev)
     struct stream_in *priority_in = NULL;
     struct stream_in *in;
 
+    if (adev->usecase_type_cnt[PCM_CAPTURE] == 0)
+        return NULL;
+
     list_for_each(node, &adev->usecase_list) {
         usecase = node_to_item(node, struct audio_usecase, list);
         if (usecase->type == PCM_CAPTURE) {
@@ -1613,6 +1909,8 @@ int select_devices_with_force_switch(struct audio_device *adev,
     audio_usecase_t hfp_ucid;
     struct listnode *node;
     int status = 0;
+    int64_t switch_start_ns;
+    bool defer_mixer_update;
     struct audio_usecase *voip_usecase = get_usecase_from_list(adev,
                                              USECASE_AUDIO_PLAYBACK_VOIP);
 
@@ -1772,6 +2070,20 @@ int select_devices_with_force_switch(struct audio_device *adev,
         adev->last_logged_snd_device[uc_id][1] = in_snd_device;
     }
 
+    switch_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    /*
+     * Batch the usecase path writes of the switch, so usecases rerouted
+     * together are written at once. Sound device paths in between are still
+     * written in order, see begin_snd_device_update(). Voice and HFP
+     * switches keep writing each path as it changes, the modem is told
+     * about the devices in between.
+     */
+    defer_mixer_update = !adev->defer_mixer_update &&
+                         (usecase->type == PCM_PLAYBACK ||
+                          usecase->type == PCM_CAPTURE);
+    if (defer_mixer_update)
+        adev->defer_mixer_update = true;
+
     /*
      * Limitation: While in call, to do a device switch we need to disable
      * and enable both RX and TX devices though one of them is same as current
@@ -1828,13 +2140,19 @@ int select_devices_with_force_switch(struct audio_device *adev,
                                                         out_snd_device,
                                                         in_snd_device);
 
-    usecase->in_snd_device = in_snd_device;
-    usecase->out_snd_device = out_snd_device;
+    set_usecase_snd_devices(adev, usecase, out_snd_device, in_snd_device);
 
     audio_extn_tfa_98xx_set_mode();
 
     enable_audio_route(adev, usecase);
 
+    if (defer_mixer_update) {
+        adev->defer_mixer_update = false;
+        flush_mixer_update(adev);
+    }
+    simple_stats_log(&adev->device_switch_ms,
+                     (systemTime(SYSTEM_TIME_MONOTONIC) - switch_start_ns) * 1e-6);
+
     /* If input stream is already running the effect needs to be
        applied on the new input device that's being enabled here.  */
     if (in_snd_device != SND_DEVICE_NONE)
@@ -1896,7 +2214,7 @@ static int stop_input_stream(struct stream_in *in)
     /* 2. Disable the tx device */
     disable_snd_device(adev, uc_info->in_snd_device);
 
-    list_remove(&uc_info->list);
+    remove_usecase_from_list(adev, uc_info);
     free(uc_info);
 
     if (priority_in == in) {
@@ -1915,6 +2233,7 @@ int start_input_stream(struct stream_in *in)
     int ret = 0;
     struct audio_usecase *uc_info;
     struct audio_device *adev = in->dev;
+    unsigned int power_ups;
 
     ALOGV("%s: enter: usecase(%d)", __func__, in->usecase);
 
@@ -1951,12 +2270,14 @@ int start_input_stream(struct stream_in *in)
     uc_info->in_snd_device = SND_DEVICE_NONE;
     uc_info->out_snd_device = SND_DEVICE_NONE;
 
-    list_add_tail(&adev->usecase_list, &uc_info->list);
+    add_usecase_to_list(adev, uc_info);
 
     audio_streaming_hint_start();
     audio_extn_perf_lock_acquire();
 
+    power_ups = adev->snd_device_power_ups;
     select_devices(adev, in->usecase);
+    in->cold_start = adev->snd_device_power_ups != power_ups;
 
     if (in->usecase == USECASE_AUDIO_RECORD_MMAP) {
         if (in->pcm == NULL || !pcm_is_ready(in->pcm)) {
@@ -2053,17 +2374,63 @@ void lock_output_stream(struct stream_out *out)
     pthread_mutex_unlock(&out->pre_lock);
 }
 
+/* adev->lock for routing changes, feeds the routing lock histograms */
+static void lock_adev_routing(struct audio_device *adev)
+{
+    const int64_t start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    pthread_mutex_lock(&adev->lock);
+    adev->routing_lock_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    audio_hist_log(&adev->routing_lock_wait_hist, adev->routing_lock_ns - start_ns);
+}
+
+static void unlock_adev_routing(struct audio_device *adev)
+{
+    audio_hist_log(&adev->routing_lock_hold_hist,
+                   systemTime(SYSTEM_TIME_MONOTONIC) - adev->routing_lock_ns);
+    pthread_mutex_unlock(&adev->lock);
+}
+
+/* must be called with out->lock locked */
+static void out_sync_hist_l(struct stream_out *out)
+{
+    const unsigned int gen = atomic_load_explicit(&out->dev->hist_gen, memory_order_relaxed);
+
+    if (out->hist_gen != gen) {
+        audio_hist_reset(&out->write_hist);
+        audio_hist_reset(&out->pcm_write_hist);
+        audio_hist_reset(&out->lock_wait_hist);
+        out->hist_gen = gen;
+    }
+}
+
+/* must be called with in->lock locked */
+static void in_sync_hist_l(struct stream_in *in)
+{
+    const unsigned int gen = atomic_load_explicit(&in->dev->hist_gen, memory_order_relaxed);
+
+    if (in->hist_gen != gen) {
+        audio_hist_reset(&in->read_hist);
+        audio_hist_reset(&in->pcm_read_hist);
+        audio_hist_reset(&in->lock_wait_hist);
+        in->hist_gen = gen;
+    }
+}
+
 /* must be called with out->lock locked */
 static int send_offload_cmd_l(struct stream_out* out, int command)
 {
-    struct offload_cmd *cmd = (struct offload_cmd *)calloc(1, sizeof(struct offload_cmd));
+    int ret = 0;
 
     ALOGVV("%s %d", __func__, command);
 
-    cmd->cmd = command;
-    list_add_tail(&out->offload_cmd_list, &cmd->node);
-    pthread_cond_signal(&out->offload_cond);
-    return 0;
+    if (command == OFFLOAD_CMD_EXIT)
+        offload_cmd_queue_exit(&out->offload_cmds);
+    else
+        ret = offload_cmd_queue_send(&out->offload_cmds, command);
+    if (ret)
+        ALOGE("%s: command queue full, dropping command %d", __func__, command);
+    return ret;
 }
 
 /* must be called iwth out->lock locked */
@@ -2083,7 +2450,6 @@ static void stop_compressed_output_l(struct stream_out *out)
 static void *offload_thread_loop(void *context)
 {
     struct stream_out *out = (struct stream_out *) context;
-    struct listnode *item;
 
     setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
     set_sched_policy(0, SP_FOREGROUND);
@@ -2094,43 +2460,36 @@ static void *offload_thread_loop(void *context)
     lock_output_stream(out);
     out->offload_state = OFFLOAD_STATE_IDLE;
     out->playback_started = 0;
+    pthread_mutex_unlock(&out->lock);
+
+    /* out->lock is only taken to run a command, never to wait for one */
     for (;;) {
-        struct offload_cmd *cmd = NULL;
+        int cmd, ret;
         stream_callback_event_t event;
         bool send_callback = false;
 
-        ALOGVV("%s offload_cmd_list %d out->offload_state %d",
-              __func__, list_empty(&out->offload_cmd_list),
-              out->offload_state);
-        if (list_empty(&out->offload_cmd_list)) {
-            ALOGV("%s SLEEPING", __func__);
-            pthread_cond_wait(&out->offload_cond, &out->lock);
-            ALOGV("%s RUNNING", __func__);
-            continue;
-        }
-
-        item = list_head(&out->offload_cmd_list);
-        cmd = node_to_item(item, struct offload_cmd, node);
-        list_remove(item);
+        ALOGV("%s SLEEPING", __func__);
+        ret = offload_cmd_queue_receive(&out->offload_cmds, &cmd);
+        if (ret < 0)
+            ALOGE("%s: failed to wait for commands: %s", __func__, strerror(-ret));
+        if (ret <= 0)
+            break;
+        ALOGV("%s RUNNING", __func__);
 
+        lock_output_stream(out);
         ALOGVV("%s STATE %d CMD %d out->compr %p",
-               __func__, out->offload_state, cmd->cmd, out->compr);
-
-        if (cmd->cmd == OFFLOAD_CMD_EXIT) {
-            free(cmd);
-            break;
-        }
+               __func__, out->offload_state, cmd, out->compr);
 
         if (out->compr == NULL) {
             ALOGE("%s: Compress handle is NULL", __func__);
-            free(cmd);
             pthread_cond_signal(&out->cond);
+            pthread_mutex_unlock(&out->lock);
             continue;
         }
         out->offload_thread_blocked = true;
         pthread_mutex_unlock(&out->lock);
         send_callback = false;
-        switch (cmd->cmd) {
+        switch (cmd) {
         case OFFLOAD_CMD_WAIT_FOR_BUFFER:
             compress_wait(out->compr, -1);
             send_callback = true;
@@ -2154,7 +2513,7 @@ static void *offload_thread_loop(void *context)
             event = STREAM_CBK_EVENT_ERROR;
             break;
         default:
-            ALOGE("%s unknown command received: %d", __func__, cmd->cmd);
+            ALOGE("%s unknown command received: %d", __func__, cmd);
             break;
         }
         lock_output_stream(out);
@@ -2164,15 +2523,11 @@ static void *offload_thread_loop(void *context)
             ALOGVV("%s: sending offload_callback event %d", __func__, event);
             out->offload_callback(event, NULL, out->offload_cookie);
         }
-        free(cmd);
+        pthread_mutex_unlock(&out->lock);
     }
 
+    lock_output_stream(out);
     pthread_cond_signal(&out->cond);
-    while (!list_empty(&out->offload_cmd_list)) {
-        item = list_head(&out->offload_cmd_list);
-        list_remove(item);
-        free(node_to_item(item, struct offload_cmd, node));
-    }
     pthread_mutex_unlock(&out->lock);
 
     return NULL;
@@ -2180,8 +2535,12 @@ static void *offload_thread_loop(void *context)
 
 static int create_offload_callback_thread(struct stream_out *out)
 {
-    pthread_cond_init(&out->offload_cond, (const pthread_condattr_t *) NULL);
-    list_init(&out->offload_cmd_list);
+    int ret = offload_cmd_queue_init(&out->offload_cmds);
+
+    if (ret) {
+        ALOGE("%s: eventfd failed: %s", __func__, strerror(-ret));
+        return ret;
+    }
     pthread_create(&out->offload_thread, (const pthread_attr_t *) NULL,
                     offload_thread_loop, out);
     return 0;
@@ -2195,7 +2554,7 @@ static int destroy_offload_callback_thread(struct stream_out *out)
 
     pthread_mutex_unlock(&out->lock);
     pthread_join(out->offload_thread, (void **) NULL);
-    pthread_cond_destroy(&out->offload_cond);
+    offload_cmd_queue_release(&out->offload_cmds);
 
     return 0;
 }
@@ -2358,10 +2717,11 @@ static int stop_output_stream(struct stream_out *out)
     /* 1. Get and set stream specific mixer controls */
     disable_audio_route(adev, uc_info);
 
-    /* 2. Disable the rx device */
-    disable_snd_device(adev, uc_info->out_snd_device);
+    /* 2. Disable the rx device, unless it is kept warm for a restart */
+    if (!linger_snd_device(adev, uc_info))
+        disable_snd_device(adev, uc_info->out_snd_device);
 
-    list_remove(&uc_info->list);
+    remove_usecase_from_list(adev, uc_info);
 
     audio_extn_extspk_update(adev->extspk);
 
@@ -2445,6 +2805,7 @@ int start_output_stream(struct stream_out *out)
     struct audio_usecase *uc_info;
     struct audio_device *adev = out->dev;
     bool a2dp_combo = false;
+    unsigned int power_ups;
 
     ALOGV("%s: enter: usecase(%d: %s) %s devices(%#x)",
           __func__, out->usecase, use_case_table[out->usecase],
@@ -2506,11 +2867,12 @@ int start_output_stream(struct stream_out *out)
            This is eventually done as part of select_devices */
     }
 
-    list_add_tail(&adev->usecase_list, &uc_info->list);
+    add_usecase_to_list(adev, uc_info);
 
     audio_streaming_hint_start();
     audio_extn_perf_lock_acquire();
 
+    power_ups = adev->snd_device_power_ups;
     if ((out->devices & AUDIO_DEVICE_OUT_ALL_A2DP) &&
         (!audio_extn_a2dp_is_ready())) {
         if (!a2dp_combo) {
@@ -2527,6 +2889,7 @@ int start_output_stream(struct stream_out *out)
     } else {
          select_devices(adev, out->usecase);
     }
+    out->cold_start = adev->snd_device_power_ups != power_ups;
 
     audio_extn_extspk_update(adev->extspk);
 
@@ -2807,7 +3170,7 @@ static int out_standby_l(struct audio_stream *stream)
     if (!out->standby) {
         if (adev->adm_deregister_stream)
             adev->adm_deregister_stream(adev->adm_data, out->handle);
-        pthread_mutex_lock(&adev->lock);
+        lock_adev_routing(adev);
         out->standby = true;
         if (out->usecase != USECASE_AUDIO_PLAYBACK_OFFLOAD) {
             if (out->pcm) {
@@ -2851,7 +3214,7 @@ static int out_standby_l(struct audio_stream *stream)
         if (do_stop) {
             stop_output_stream(out);
         }
-        pthread_mutex_unlock(&adev->lock);
+        unlock_adev_routing(adev);
     }
     return 0;
 }
@@ -2911,6 +3274,16 @@ static int out_dump(const struct audio_stream *stream, int fd)
         simple_stats_to_string(&out->start_latency_ms, buffer, sizeof(buffer));
         dprintf(fd, "      Start latency ms: %s\n", buffer);
     }
+    if (out->cold_start_latency_ms.n > 0) {
+        simple_stats_to_string(&out->cold_start_latency_ms, buffer, sizeof(buffer));
+        dprintf(fd, "      Cold start latency ms: %s\n", buffer);
+    }
+
+    if (locked)
+        out_sync_hist_l(out);
+    audio_hist_dump(&out->write_hist, fd, "      ", "Write time");
+    audio_hist_dump(&out->pcm_write_hist, fd, "      ", "Pcm write time");
+    audio_hist_dump(&out->lock_wait_hist, fd, "      ", "Lock wait time");
 
     if (locked) {
         pthread_mutex_unlock(&out->lock);
@@ -2998,7 +3371,7 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
             forced_speaker_fallback = true;
         }
 
-        pthread_mutex_lock(&adev->lock);
+        lock_adev_routing(adev);
 
         /*
          * When HDMI cable is unplugged the music playback is paused and
@@ -3045,7 +3418,7 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
                      */
                     out->devices = val;
                     pthread_mutex_unlock(&out->lock);
-                    pthread_mutex_unlock(&adev->lock);
+                    unlock_adev_routing(adev);
                     status = -ENOSYS;
                     goto routing_fail;
                 }
@@ -3061,7 +3434,7 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
             (card = get_alive_usb_card(parms)) >= 0) {
 
             ALOGW("out_set_parameters() ignoring rerouting to non existing USB card %d", card);
-            pthread_mutex_unlock(&adev->lock);
+            unlock_adev_routing(adev);
             pthread_mutex_unlock(&out->lock);
             status = -ENOSYS;
             goto routing_fail;
@@ -3169,7 +3542,7 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
 
         }
 
-        pthread_mutex_unlock(&adev->lock);
+        unlock_adev_routing(adev);
         pthread_mutex_unlock(&out->lock);
 
         /*handles device and call state changes*/
@@ -3443,18 +3816,16 @@ static int out_set_volume(struct audio_stream_out *stream, float left,
 
 // note: this call is safe only if the stream_cb is
 // removed first in close_output_stream (as is done now).
-static void out_snd_mon_cb(void * stream, struct str_parms * parms)
+static void out_snd_mon_cb(void * stream, const snd_mon_event_t * event)
 {
-    if (!stream || !parms)
+    if (!stream || !event || event->type != SND_MON_EVENT_CARD)
         return;
 
     struct stream_out *out = (struct stream_out *)stream;
     struct audio_device *adev = out->dev;
 
-    card_status_t status;
-    int card;
-    if (parse_snd_card_status(parms, &card, &status) < 0)
-        return;
+    const card_status_t status = event->status;
+    const int card = event->card;
 
     pthread_mutex_lock(&adev->lock);
     bool valid_cb = (card == adev->snd_card);
@@ -3503,8 +3874,11 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
     struct audio_device *adev = out->dev;
     ssize_t ret = 0;
     int error_code = ERROR_CODE_STANDBY;
+    const int64_t write_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
 
     lock_output_stream(out);
+    out_sync_hist_l(out);
+    audio_hist_log(&out->lock_wait_hist, systemTime(SYSTEM_TIME_MONOTONIC) - write_start_ns);
     // this is always nonzero
     const size_t frame_size = audio_stream_out_frame_size(stream);
     const size_t frames = bytes / frame_size;
@@ -3529,13 +3903,13 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
         out->standby = false;
         const int64_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
 
-        pthread_mutex_lock(&adev->lock);
+        lock_adev_routing(adev);
         ret = start_output_stream(out);
 
         /* ToDo: If use case is compress offload should return 0 */
         if (ret != 0) {
             out->standby = true;
-            pthread_mutex_unlock(&adev->lock);
+            unlock_adev_routing(adev);
             goto exit;
         }
 
@@ -3543,11 +3917,13 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
         // dont change level anywhere except at the audio_hw_send_gain_dep_calibration
         ALOGD("%s: retry previous failed cal level set", __func__);
         send_gain_dep_calibration_l();
-        pthread_mutex_unlock(&adev->lock);
+        unlock_adev_routing(adev);
 
         // log startup time in ms.
-        simple_stats_log(
-                &out->start_latency_ms, (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) * 1e-6);
+        const double start_latency_ms = (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) * 1e-6;
+        simple_stats_log(&out->start_latency_ms, start_latency_ms);
+        if (out->cold_start)
+            simple_stats_log(&out->cold_start_latency_ms, start_latency_ms);
         out->last_fifo_valid = false; // we're coming out of standby, last_fifo isn't valid.
     }
 
@@ -3578,7 +3954,10 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
             if (avail > bytes) {
                 avail = bytes;
             }
+            const int64_t pcm_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
             ret = compress_write(out->compr, buffer, avail);
+            audio_hist_log(&out->pcm_write_hist,
+                           systemTime(SYSTEM_TIME_MONOTONIC) - pcm_start_ns);
             ALOGVV("%s: writing buffer (%d bytes) to compress device returned %zd",
                    __func__, avail, ret);
         }
@@ -3611,16 +3990,12 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                 out->usecase == USECASE_INCALL_MUSIC_UPLINK ||
                 out->usecase == USECASE_INCALL_MUSIC_UPLINK2) {
                 size_t channel_count = audio_channel_count_from_out_mask(out->channel_mask);
-                int16_t *src = (int16_t *)buffer;
-                int16_t *dst = (int16_t *)buffer;
 
                 LOG_ALWAYS_FATAL_IF(out->config.channels != 1 || channel_count != 2 ||
                                     out->format != AUDIO_FORMAT_PCM_16_BIT,
                                     "out_write called for VOIP use case with wrong properties");
 
-                for (size_t i = 0; i < frames ; i++, dst++, src += 2) {
-                    *dst = (int16_t)(((int32_t)src[0] + (int32_t)src[1]) >> 1);
-                }
+                pcm_downmix_stereo_to_mono_16((int16_t *)buffer, (const int16_t *)buffer, frames);
                 bytes_to_write /= 2;
             }
 
@@ -3650,6 +4025,7 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
             long ns = (frames * (int64_t) NANOS_PER_SECOND) / out->config.rate;
             request_out_focus(out, ns);
 
+            const int64_t pcm_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
             bool use_mmap = is_mmap_usecase(out->usecase) || out->realtime;
             if (use_mmap) {
                 ret = pcm_mmap_write(out->pcm, (void *)buffer, bytes_to_write);
@@ -3683,9 +4059,7 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                         adev->haptic_buffer_size = total_haptic_buffer_size;
                     }
 
-                    size_t src_index = 0, aud_index = 0, hap_index = 0;
                     uint8_t *audio_buffer = (uint8_t *)buffer;
-                    uint8_t *haptic_buffer  = adev->haptic_buffer;
 
                     // This is required for testing only. This works for stereo data only.
                     // One channel is fed to audio stream and other to haptic stream for testing.
@@ -3693,19 +4067,8 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                        audio_frame_size = haptic_frame_size = bytes_per_sample;
                     }
 
-                    for (size_t i = 0; i < frame_count; i++) {
-                        for (size_t j = 0; j < audio_frame_size; j++)
-                            audio_buffer[aud_index++] = audio_buffer[src_index++];
-
-                        for (size_t j = 0; j < haptic_frame_size; j++)
-                            haptic_buffer[hap_index++] = audio_buffer[src_index++];
-                        }
-
-                        // This is required for testing only.
-                        // Discard haptic channel data.
-                        if (force_haptic_path) {
-                            src_index += haptic_frame_size;
-                    }
+                    pcm_deinterleave_haptics(audio_buffer, adev->haptic_buffer, frame_count,
+                                             audio_frame_size, haptic_frame_size);
 
                     // write to audio pipeline
                     ret = pcm_write(out->pcm,
@@ -3722,6 +4085,8 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                     ret = pcm_write(out->pcm, (void *)buffer, bytes_to_write);
                 }
             }
+            audio_hist_log(&out->pcm_write_hist,
+                           systemTime(SYSTEM_TIME_MONOTONIC) - pcm_start_ns);
             release_out_focus(out, ns);
         } else {
             LOG_ALWAYS_FATAL("out->pcm is NULL after starting output stream");
@@ -3745,6 +4110,7 @@ exit:
         }
     }
 
+    audio_hist_log(&out->write_hist, systemTime(SYSTEM_TIME_MONOTONIC) - write_start_ns);
     pthread_mutex_unlock(&out->lock);
 
     if (ret != 0) {
@@ -4210,7 +4576,7 @@ static int in_standby(struct audio_stream *stream)
         if (adev->adm_deregister_stream)
             adev->adm_deregister_stream(adev->adm_data, in->capture_handle);
 
-        pthread_mutex_lock(&adev->lock);
+        lock_adev_routing(adev);
         in->standby = true;
         if (in->usecase == USECASE_AUDIO_RECORD_MMAP) {
             do_stop = in->capture_started;
@@ -4236,7 +4602,7 @@ static int in_standby(struct audio_stream *stream)
             status = stop_input_stream(in);
         }
 
-        pthread_mutex_unlock(&adev->lock);
+        unlock_adev_routing(adev);
     }
     pthread_mutex_unlock(&in->lock);
     ALOGV("%s: exit:  status(%d)", __func__, status);
@@ -4260,6 +4626,16 @@ static int in_dump(const struct audio_stream *stream, int fd)
         simple_stats_to_string(&in->start_latency_ms, buffer, sizeof(buffer));
         dprintf(fd, "      Start latency ms: %s\n", buffer);
     }
+    if (in->cold_start_latency_ms.n > 0) {
+        simple_stats_to_string(&in->cold_start_latency_ms, buffer, sizeof(buffer));
+        dprintf(fd, "      Cold start latency ms: %s\n", buffer);
+    }
+
+    if (locked)
+        in_sync_hist_l(in);
+    audio_hist_dump(&in->read_hist, fd, "      ", "Read time");
+    audio_hist_dump(&in->pcm_read_hist, fd, "      ", "Pcm read time");
+    audio_hist_dump(&in->lock_wait_hist, fd, "      ", "Lock wait time");
 
     if (locked) {
         pthread_mutex_unlock(&in->lock);
@@ -4288,7 +4664,7 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
 
     lock_input_stream(in);
 
-    pthread_mutex_lock(&adev->lock);
+    lock_adev_routing(adev);
     if (ret >= 0) {
         val = atoi(value);
         /* no audio source uses val == 0 */
@@ -4328,7 +4704,7 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
         }
     }
 
-    pthread_mutex_unlock(&adev->lock);
+    unlock_adev_routing(adev);
     pthread_mutex_unlock(&in->lock);
 
     str_parms_destroy(parms);
@@ -4398,18 +4774,16 @@ static int in_set_gain(struct audio_stream_in *stream, float gain)
     return 0;
 }
 
-static void in_snd_mon_cb(void * stream, struct str_parms * parms)
+static void in_snd_mon_cb(void * stream, const snd_mon_event_t * event)
 {
-    if (!stream || !parms)
+    if (!stream || !event || event->type != SND_MON_EVENT_CARD)
         return;
 
     struct stream_in *in = (struct stream_in *)stream;
     struct audio_device *adev = in->dev;
 
-    card_status_t status;
-    int card;
-    if (parse_snd_card_status(parms, &card, &status) < 0)
-        return;
+    const card_status_t status = event->status;
+    const int card = event->card;
 
     pthread_mutex_lock(&adev->lock);
     bool valid_cb = (card == adev->snd_card);
@@ -4441,10 +4815,12 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     struct stream_in *in = (struct stream_in *)stream;
     struct audio_device *adev = in->dev;
     int i, ret = -1;
-    int *int_buf_stream = NULL;
     int error_code = ERROR_CODE_STANDBY; // initial errors are considered coming out of standby.
+    const int64_t read_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
 
     lock_input_stream(in);
+    in_sync_hist_l(in);
+    audio_hist_log(&in->lock_wait_hist, systemTime(SYSTEM_TIME_MONOTONIC) - read_start_ns);
     const size_t frame_size = audio_stream_in_frame_size(stream);
     const size_t frames = bytes / frame_size;
 
@@ -4464,17 +4840,19 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     if (in->standby) {
         const int64_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
 
-        pthread_mutex_lock(&adev->lock);
+        lock_adev_routing(adev);
         ret = start_input_stream(in);
-        pthread_mutex_unlock(&adev->lock);
+        unlock_adev_routing(adev);
         if (ret != 0) {
             goto exit;
         }
         in->standby = 0;
 
         // log startup time in ms.
-        simple_stats_log(
-                &in->start_latency_ms, (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) * 1e-6);
+        const double start_latency_ms = (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) * 1e-6;
+        simple_stats_log(&in->start_latency_ms, start_latency_ms);
+        if (in->cold_start)
+            simple_stats_log(&in->cold_start_latency_ms, start_latency_ms);
     }
 
     // errors that occur here are read errors.
@@ -4487,11 +4865,13 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
 
     bool use_mmap = is_mmap_usecase(in->usecase) || in->realtime;
     if (in->pcm) {
+        const int64_t pcm_start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
         if (use_mmap) {
             ret = pcm_mmap_read(in->pcm, buffer, bytes);
         } else {
             ret = pcm_read(in->pcm, buffer, bytes);
         }
+        audio_hist_log(&in->pcm_read_hist, systemTime(SYSTEM_TIME_MONOTONIC) - pcm_start_ns);
         if (ret < 0) {
             ALOGE("Failed to read w/err %s", strerror(errno));
             ret = -errno;
@@ -4499,10 +4879,7 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
         if (!ret && bytes > 0 && (in->format == AUDIO_FORMAT_PCM_8_24_BIT)) {
             if (bytes % 4 == 0) {
                 /* data from DSP comes in 24_8 format, convert it to 8_24 */
-                int_buf_stream = buffer;
-                for (size_t itt=0; itt < bytes/4 ; itt++) {
-                    int_buf_stream[itt] >>= 8;
-                }
+                pcm_convert_24_8_to_8_24((int32_t *)buffer, bytes / 4);
             } else {
                 ALOGE("%s: !!! something wrong !!! ... data not 32 bit aligned ", __func__);
                 ret = -EINVAL;
@@ -4526,6 +4903,7 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     }
 
 exit:
+    audio_hist_log(&in->read_hist, systemTime(SYSTEM_TIME_MONOTONIC) - read_start_ns);
     pthread_mutex_unlock(&in->lock);
 
     if (ret != 0) {
@@ -5193,7 +5571,11 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
 
         check_and_set_gapless_mode(adev);
 
-        create_offload_callback_thread(out);
+        ret = create_offload_callback_thread(out);
+        if (ret != 0) {
+            free(out->compr_config.codec);
+            goto error_open;
+        }
         ALOGV("%s: offloaded output offload_info version %04x bit rate %d",
                 __func__, config->offload_info.version,
                 config->offload_info.bit_rate);
@@ -5615,7 +5997,7 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
 
     ALOGV("%s: enter: %s", __func__, kvpairs);
 
-    pthread_mutex_lock(&adev->lock);
+    lock_adev_routing(adev);
 
     parms = str_parms_create_str(kvpairs);
     status = voice_set_parameters(adev, parms);
@@ -5632,6 +6014,14 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
             adev->bluetooth_nrec = false;
     }
 
+    ret = str_parms_get_str(parms, "reset_latency_stats", value, sizeof(value));
+    if (ret >= 0) {
+        /* streams reset their own histograms on their next read/write or dump */
+        atomic_fetch_add_explicit(&adev->hist_gen, 1, memory_order_relaxed);
+        audio_hist_reset(&adev->routing_lock_wait_hist);
+        audio_hist_reset(&adev->routing_lock_hold_hist);
+    }
+
     ret = str_parms_get_str(parms, "screen_state", value, sizeof(value));
     if (ret >= 0) {
         if (strcmp(value, AUDIO_PARAMETER_VALUE_ON) == 0)
@@ -5737,9 +6127,9 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
                 (usecase->devices & AUDIO_DEVICE_OUT_ALL_A2DP)) {
                 ALOGD("%s: reconfigure A2DP... forcing device switch", __func__);
 
-                pthread_mutex_unlock(&adev->lock);
+                unlock_adev_routing(adev);
                 lock_output_stream(usecase->stream.out);
-                pthread_mutex_lock(&adev->lock);
+                lock_adev_routing(adev);
                 audio_extn_a2dp_set_handoff_mode(true);
                 // force device switch to reconfigure encoder
                 select_devices(adev, usecase->id);
@@ -5778,7 +6168,7 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
 
 done:
     str_parms_destroy(parms);
-    pthread_mutex_unlock(&adev->lock);
+    unlock_adev_routing(adev);
     ALOGV("%s: exit with code(%d)", __func__, status);
     return status;
 }
@@ -5849,7 +6239,7 @@ static int adev_set_mode(struct audio_hw_device *dev, audio_mode_t mode)
 {
     struct audio_device *adev = (struct audio_device *)dev;
 
-    pthread_mutex_lock(&adev->lock);
+    lock_adev_routing(adev);
     if (adev->mode != mode) {
         ALOGD("%s: mode %d", __func__, (int)mode);
         adev->mode = mode;
@@ -5872,7 +6262,7 @@ static int adev_set_mode(struct audio_hw_device *dev, audio_mode_t mode)
             }
         }
     }
-    pthread_mutex_unlock(&adev->lock);
+    unlock_adev_routing(adev);
 
     audio_extn_extspk_set_mode(adev->extspk, mode);
 
@@ -6265,8 +6655,24 @@ static void adev_close_input_stream(struct audio_hw_device *dev __unused,
     return;
 }
 
-static int adev_dump(const audio_hw_device_t *device __unused, int fd __unused)
+static int adev_dump(const audio_hw_device_t *device, int fd)
 {
+    struct audio_device *adev = (struct audio_device *)device;
+    char buffer[256]; // for statistics formatting
+
+    // We try to get the lock for consistency,
+    // but it isn't necessary for these variables.
+    const bool locked = (pthread_mutex_trylock(&adev->lock) == 0);
+    if (adev->device_switch_ms.n > 0) {
+        simple_stats_to_string(&adev->device_switch_ms, buffer, sizeof(buffer));
+        dprintf(fd, "  Device switch ms: %s\n", buffer);
+    }
+    audio_hist_dump(&adev->routing_lock_wait_hist, fd, "  ", "Routing lock wait time");
+    audio_hist_dump(&adev->routing_lock_hold_hist, fd, "  ", "Routing lock hold time");
+    audio_extn_snd_mon_dump(fd);
+    if (locked) {
+        pthread_mutex_unlock(&adev->lock);
+    }
     return 0;
 }
 
@@ -6370,7 +6776,7 @@ static int adev_verify_devices(struct audio_device *adev)
             uc_info.devices = audio_device;
             uc_info.in_snd_device = SND_DEVICE_NONE;
             uc_info.out_snd_device = SND_DEVICE_NONE;
-            list_add_tail(&adev->usecase_list, &uc_info.list);
+            add_usecase_to_list(adev, &uc_info);
 
             /* select device - similar to start_(in/out)put_stream() */
             retval = select_devices(adev, audio_usecase);
@@ -6393,7 +6799,7 @@ static int adev_verify_devices(struct audio_device *adev)
             /* 2. Disable the rx device */
             retval = disable_snd_device(adev,
                     dir ? uc_info.in_snd_device : uc_info.out_snd_device);
-            list_remove(&uc_info.list);
+            remove_usecase_from_list(adev, &uc_info);
         }
     }
     return 0;
@@ -6408,11 +6814,21 @@ static int adev_close(hw_device_t *device)
         goto done;
 
     if ((--audio_device_ref_count) == 0) {
+        pthread_mutex_lock(&adev->lock);
+        release_warm_snd_device(adev);
+        adev->snd_device_linger_exit = true;
+        pthread_cond_signal(&adev->snd_device_linger_cond);
+        pthread_mutex_unlock(&adev->lock);
+        if (adev->snd_device_linger_ms > 0)
+            pthread_join(adev->snd_device_linger_thread, (void **) NULL);
+        pthread_cond_destroy(&adev->snd_device_linger_cond);
         audio_extn_snd_mon_unregister_listener(adev);
         audio_extn_tfa_98xx_deinit();
         audio_extn_ma_deinit();
         audio_route_free(adev->audio_route);
         free(adev->snd_dev_ref_cnt);
+        free(adev->snd_dev_usecase_cnt);
+        free(adev->mixer_path_cache);
         platform_deinit(adev->platform);
         audio_extn_extspk_deinit(adev->extspk);
         audio_extn_sound_trigger_deinit(adev);
@@ -6453,16 +6869,13 @@ static int period_size_is_plausible_for_low_latency(int period_size)
     }
 }
 
-static void adev_snd_mon_cb(void * stream __unused, struct str_parms * parms)
+static void adev_snd_mon_cb(void * stream __unused, const snd_mon_event_t * event)
 {
-    int card;
-    card_status_t status;
-
-    if (!parms)
+    if (!event || event->type != SND_MON_EVENT_CARD)
         return;
 
-    if (parse_snd_card_status(parms, &card, &status) < 0)
-        return;
+    const card_status_t status = event->status;
+    const int card = event->card;
 
     pthread_mutex_lock(&adev->lock);
     bool valid_cb = (card == adev->snd_card);
@@ -6470,6 +6883,9 @@ static void adev_snd_mon_cb(void * stream __unused, struct str_parms * parms)
         if (adev->card_status != status) {
             adev->card_status = status;
             platform_snd_card_update(adev->platform, status);
+            /* the codec comes back reset, do not keep a path it lost */
+            if (status == CARD_STATUS_OFFLINE)
+                release_warm_snd_device(adev);
         }
     }
     pthread_mutex_unlock(&adev->lock);
@@ -6604,6 +7020,22 @@ static int adev_open(const hw_module_t *module, const char *name,
     adev->acdb_settings = TTY_MODE_OFF;
     /* adev->cur_hdmi_channels = 0;  by calloc() */
     adev->snd_dev_ref_cnt = calloc(SND_DEVICE_MAX, sizeof(int));
+    adev->snd_dev_usecase_cnt = calloc(SND_DEVICE_MAX, sizeof(int));
+    adev->mixer_path_cache = calloc(MIXER_PATH_CACHE_SIZE,
+                                    sizeof(struct mixer_path_cache_entry));
+    if (!adev->snd_dev_ref_cnt || !adev->snd_dev_usecase_cnt ||
+            !adev->mixer_path_cache) {
+        pthread_mutex_unlock(&adev->lock);
+        free(adev->snd_dev_ref_cnt);
+        free(adev->snd_dev_usecase_cnt);
+        free(adev->mixer_path_cache);
+        free(adev);
+        ALOGE("%s: Failed to allocate sound device state, aborting.", __func__);
+        *device = NULL;
+        pthread_mutex_unlock(&adev_init_lock);
+        return -ENOMEM;
+    }
+    adev->warm_snd_device = SND_DEVICE_NONE;
     voice_init(adev);
     list_init(&adev->usecase_list);
     pthread_mutex_unlock(&adev->lock);
@@ -6612,6 +7044,8 @@ static int adev_open(const hw_module_t *module, const char *name,
     adev->platform = platform_init(adev);
     if (!adev->platform) {
         free(adev->snd_dev_ref_cnt);
+        free(adev->snd_dev_usecase_cnt);
+        free(adev->mixer_path_cache);
         free(adev);
         ALOGE("%s: Failed to init platform data, aborting.", __func__);
         *device = NULL;
@@ -6707,6 +7141,20 @@ static int adev_open(const hw_module_t *module, const char *name,
 
     adev->mic_break_enabled = property_get_bool("vendor.audio.mic_break", false);
 
+    pthread_condattr_t linger_cond_attr;
+    pthread_condattr_init(&linger_cond_attr);
+    pthread_condattr_setclock(&linger_cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&adev->snd_device_linger_cond, &linger_cond_attr);
+    pthread_condattr_destroy(&linger_cond_attr);
+    adev->snd_device_linger_ms = property_get_int32("vendor.audio.snd_device_linger_ms",
+                                                    SND_DEVICE_LINGER_MS_DEFAULT);
+    if (adev->snd_device_linger_ms > 0 &&
+        pthread_create(&adev->snd_device_linger_thread, (const pthread_attr_t *) NULL,
+                       snd_device_linger_thread_loop, adev) != 0) {
+        ALOGE("%s: failed to start snd device linger thread", __func__);
+        adev->snd_device_linger_ms = 0;
+    }
+
     adev->camera_orientation = CAMERA_DEFAULT;
 
     // commented as full set of app type cfg is sent from platform
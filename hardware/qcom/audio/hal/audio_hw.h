@@ -17,6 +17,7 @@
 #ifndef QCOM_AUDIO_HW_H
 #define QCOM_AUDIO_HW_H
 
+#include <stdatomic.h>
 #include <cutils/str_parms.h>
 #include <cutils/list.h>
 #include <hardware/audio.h>
@@ -27,6 +28,8 @@
 #include <audio_route/audio_route.h>
 #include <audio_utils/ErrorLog.h>
 #include <audio_utils/Statistics.h>
+#include "audio_hist.h"
+#include "offload_cmd_queue.h"
 #include "voice.h"
 
 // dlopen() does not go through default library path search if there is a "/" in the library name.
@@ -57,6 +60,9 @@
 
 #define ERROR_LOG_ENTRIES 16
 
+/* how long an output snd device stays enabled after standby, 0 disables */
+#define SND_DEVICE_LINGER_MS_DEFAULT 1000
+
 /* Error types for the error log */
 enum {
     ERROR_CODE_STANDBY = 1,
@@ -195,12 +201,6 @@ enum {
     OFFLOAD_STATE_PAUSED,
 };
 
-struct offload_cmd {
-    struct listnode node;
-    int cmd;
-    int data[];
-};
-
 struct stream_app_type_cfg {
     int sample_rate;
     uint32_t bit_width; // unused
@@ -240,9 +240,8 @@ struct stream_out {
     int non_blocking;
     int playback_started;
     int offload_state;
-    pthread_cond_t offload_cond;
     pthread_t offload_thread;
-    struct listnode offload_cmd_list;
+    struct offload_cmd_queue offload_cmds;
     bool offload_thread_blocked;
 
     stream_callback_t offload_callback;
@@ -272,6 +271,13 @@ struct stream_out {
 
     simple_stats_t fifo_underruns;  // TODO: keep a list of the last N fifo underrun times.
     simple_stats_t start_latency_ms;
+    simple_stats_t cold_start_latency_ms; // starts that had to power up a sound device.
+    bool cold_start;
+
+    unsigned int hist_gen;          // adev->hist_gen the histograms below were last reset at.
+    audio_hist_t write_hist;        // out_write() wall time.
+    audio_hist_t pcm_write_hist;    // time blocked in pcm/compress write.
+    audio_hist_t lock_wait_hist;    // time out_write() waited for out->lock.
 };
 
 struct stream_in {
@@ -322,6 +328,13 @@ struct stream_in {
     error_log_t *error_log;
 
     simple_stats_t start_latency_ms;
+    simple_stats_t cold_start_latency_ms; // starts that had to power up a sound device.
+    bool cold_start;
+
+    unsigned int hist_gen;          // adev->hist_gen the histograms below were last reset at.
+    audio_hist_t read_hist;         // in_read() wall time.
+    audio_hist_t pcm_read_hist;     // time blocked in pcm read.
+    audio_hist_t lock_wait_hist;    // time in_read() waited for in->lock.
 };
 
 typedef enum usecase_type_t {
@@ -332,6 +345,8 @@ typedef enum usecase_type_t {
     USECASE_TYPE_MAX
 } usecase_type_t;
 
+struct mixer_path_cache_entry;
+
 union stream_ptr {
     struct stream_in *in;
     struct stream_out *out;
@@ -345,6 +360,10 @@ struct audio_usecase {
     snd_device_t out_snd_device;
     snd_device_t in_snd_device;
     union stream_ptr stream;
+    /* set by add_usecase_to_list(), with the devices counted in
+     * snd_dev_usecase_cnt while the usecase is in usecase_list */
+    bool listed;
+    snd_device_t listed_snd_device[2]; /* [out, in] */
 };
 
 typedef void* (*adm_init_t)();
@@ -374,6 +393,19 @@ struct audio_device {
     bool screen_off;
     int *snd_dev_ref_cnt;
     struct listnode usecase_list;
+    /* indexes of usecase_list, only updated through add_usecase_to_list(),
+     * remove_usecase_from_list() and set_usecase_snd_devices() */
+    struct audio_usecase *active_usecases[AUDIO_USECASE_MAX];
+    unsigned int usecase_type_cnt[USECASE_TYPE_MAX];
+    /* listed usecases on each snd device: the out device of non-capture
+     * usecases and the in device of non-playback usecases */
+    int *snd_dev_usecase_cnt;
+    /* composed usecase mixer paths, see get_usecase_mixer_path() */
+    struct mixer_path_cache_entry *mixer_path_cache;
+    /* set while select_devices() batches usecase path writes of a device
+     * switch, mixer_update_pending once a write is held back */
+    bool defer_mixer_update;
+    bool mixer_update_pending;
     struct audio_route *audio_route;
     int acdb_settings;
     struct voice voice;
@@ -429,6 +461,20 @@ struct audio_device {
 
     /* logging */
     snd_device_t last_logged_snd_device[AUDIO_USECASE_MAX][2]; /* [out, in] */
+    simple_stats_t device_switch_ms;
+    atomic_uint hist_gen; /* bumped to reset all stream histograms */
+    int64_t routing_lock_ns; /* when adev->lock was taken by lock_adev_routing() */
+    audio_hist_t routing_lock_wait_hist;
+    audio_hist_t routing_lock_hold_hist;
+
+    /* output snd device kept enabled after its last usecase stopped */
+    snd_device_t warm_snd_device;
+    int64_t warm_snd_device_deadline_ns;
+    int snd_device_linger_ms;
+    unsigned int snd_device_power_ups; /* enables that powered a sound device */
+    pthread_t snd_device_linger_thread;
+    pthread_cond_t snd_device_linger_cond;
+    bool snd_device_linger_exit;
     int camera_orientation; /* CAMERA_BACK_LANDSCAPE ... CAMERA_FRONT_PORTRAIT */
     bool bt_sco_on;
 };
@@ -451,6 +497,17 @@ int enable_audio_route(struct audio_device *adev,
 struct audio_usecase *get_usecase_from_list(struct audio_device *adev,
                                             audio_usecase_t uc_id);
 
+void add_usecase_to_list(struct audio_device *adev,
+                         struct audio_usecase *usecase);
+
+void remove_usecase_from_list(struct audio_device *adev,
+                              struct audio_usecase *usecase);
+
+void set_usecase_snd_devices(struct audio_device *adev,
+                             struct audio_usecase *usecase,
+                             snd_device_t out_snd_device,
+                             snd_device_t in_snd_device);
+
 int check_a2dp_restore(struct audio_device *adev, struct stream_out *out, bool restore);
 
 #define LITERAL_TO_STRING(x) #x
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PCM_KERNELS_NEON
+#endif
+
+#include "audio_pcm_kernels.h"
+
+void pcm_downmix_stereo_to_mono_16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    size_t i = 0;
+
+#ifdef PCM_KERNELS_NEON
+    /* halving add is (a + b) >> 1 computed without overflow */
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t lr = vld2q_s16(src + 2 * i);
+        vst1q_s16(dst + i, vhaddq_s16(lr.val[0], lr.val[1]));
+    }
+#endif
+    for (; i < frames; i++)
+        dst[i] = (int16_t)(((int32_t)src[2 * i] + (int32_t)src[2 * i + 1]) >> 1);
+}
+
+void pcm_convert_24_8_to_8_24(int32_t *buf, size_t samples)
+{
+    size_t i = 0;
+
+#ifdef PCM_KERNELS_NEON
+    for (; i + 4 <= samples; i += 4)
+        vst1q_s32(buf + i, vshrq_n_s32(vld1q_s32(buf + i), 8));
+#endif
+    for (; i < samples; i++)
+        buf[i] >>= 8;
+}
+
+/* only the 16 bit stereo + mono haptic layout is vectorized */
+static size_t deinterleave_16_2_1(uint8_t *buf, uint8_t *haptic, size_t frames)
+{
+    size_t i = 0;
+
+#ifdef PCM_KERNELS_NEON
+    uint16_t *s = (uint16_t *)buf;
+    uint16_t *h = (uint16_t *)haptic;
+
+    /* stores of block i end before the loads of block i + 1 begin */
+    for (; i + 8 <= frames; i += 8) {
+        uint16x8x3_t in = vld3q_u16(s + 3 * i);
+        uint16x8x2_t out = { { in.val[0], in.val[1] } };
+        vst2q_u16(s + 2 * i, out);
+        vst1q_u16(h + i, in.val[2]);
+    }
+#else
+    (void)buf;
+    (void)haptic;
+    (void)frames;
+#endif
+    return i;
+}
+
+void pcm_deinterleave_haptics(uint8_t *buf, uint8_t *haptic, size_t frames,
+                              size_t audio_frame_size, size_t haptic_frame_size)
+{
+    size_t i = 0, src_index, aud_index, hap_index;
+
+    if (audio_frame_size == 4 && haptic_frame_size == 2)
+        i = deinterleave_16_2_1(buf, haptic, frames);
+
+    /* copying forward is safe in place, the audio part never passes its source */
+    src_index = i * (audio_frame_size + haptic_frame_size);
+    aud_index = i * audio_frame_size;
+    hap_index = i * haptic_frame_size;
+    for (; i < frames; i++) {
+        for (size_t j = 0; j < audio_frame_size; j++)
+            buf[aud_index++] = buf[src_index++];
+        for (size_t j = 0; j < haptic_frame_size; j++)
+            haptic[hap_index++] = buf[src_index++];
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIO_PCM_KERNELS_H
+#define AUDIO_PCM_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Sample conversion loops run on every buffer of the playback and capture
+ * threads. Each kernel has a NEON implementation when the target supports it
+ * and a plain C one otherwise; both produce identical output.
+ *
+ * All kernels may be called in place (dst == src).
+ */
+
+/* dst[i] = (src[2i] + src[2i + 1]) >> 1, 16 bit stereo to mono */
+void pcm_downmix_stereo_to_mono_16(int16_t *dst, const int16_t *src, size_t frames);
+
+/* buf[i] >>= 8, DSP 24_8 capture data to AUDIO_FORMAT_PCM_8_24_BIT */
+void pcm_convert_24_8_to_8_24(int32_t *buf, size_t samples);
+
+/*
+ * Split interleaved frames of (audio_frame_size + haptic_frame_size) bytes:
+ * the audio part is compacted at the start of buf and the haptic part is
+ * copied to haptic.
+ */
+void pcm_deinterleave_haptics(uint8_t *buf, uint8_t *haptic, size_t frames,
+                              size_t audio_frame_size, size_t haptic_frame_size);
+
+#endif /* AUDIO_PCM_KERNELS_H */
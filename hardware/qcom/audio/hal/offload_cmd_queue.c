@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "offload_cmd_queue.h"
+
+int offload_cmd_queue_init(struct offload_cmd_queue *queue)
+{
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->queued, 0);
+    atomic_init(&queue->exit, false);
+    queue->fd = eventfd(0, EFD_CLOEXEC);
+    return queue->fd < 0 ? -errno : 0;
+}
+
+void offload_cmd_queue_release(struct offload_cmd_queue *queue)
+{
+    close(queue->fd);
+    queue->fd = -1;
+}
+
+static void wake(struct offload_cmd_queue *queue)
+{
+    uint64_t count = 1;
+
+    /* can not fail, the reader resets the counter long before it saturates */
+    (void)write(queue->fd, &count, sizeof(count));
+}
+
+int offload_cmd_queue_send(struct offload_cmd_queue *queue, int cmd)
+{
+    unsigned int bit = 1u << cmd;
+    unsigned int tail, head;
+
+    /* the queued command has not run yet, it covers this send too */
+    if (atomic_fetch_or_explicit(&queue->queued, bit, memory_order_acq_rel) & bit)
+        return 0;
+
+    tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == OFFLOAD_CMD_QUEUE_SIZE) {
+        atomic_fetch_and_explicit(&queue->queued, ~bit, memory_order_relaxed);
+        return -ENOSPC;
+    }
+    queue->cmds[tail & (OFFLOAD_CMD_QUEUE_SIZE - 1)] = cmd;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    wake(queue);
+    return 0;
+}
+
+void offload_cmd_queue_exit(struct offload_cmd_queue *queue)
+{
+    atomic_store_explicit(&queue->exit, true, memory_order_release);
+    wake(queue);
+}
+
+int offload_cmd_queue_receive(struct offload_cmd_queue *queue, int *cmd)
+{
+    unsigned int head, tail;
+    uint64_t count;
+
+    for (;;) {
+        if (atomic_load_explicit(&queue->exit, memory_order_acquire))
+            return 0;
+
+        head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (head != tail)
+            break;
+        if (read(queue->fd, &count, sizeof(count)) < 0 && errno != EINTR)
+            return -errno;
+    }
+
+    *cmd = queue->cmds[head & (OFFLOAD_CMD_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    /*
+     * Sends from here on queue the command again. One that still found the
+     * bit set is ordered before this, so the command about to run covers it.
+     */
+    atomic_fetch_and_explicit(&queue->queued, ~(1u << *cmd), memory_order_acq_rel);
+    return 1;
+}
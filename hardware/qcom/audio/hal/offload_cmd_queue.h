@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OFFLOAD_CMD_QUEUE_H
+#define OFFLOAD_CMD_QUEUE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/* must be a power of 2, larger than the number of distinct commands */
+#define OFFLOAD_CMD_QUEUE_SIZE 8
+
+/*
+ * Commands for the offload callback thread. Senders hold out->lock, so the
+ * queue has one writer and one reader and needs no lock; an eventfd wakes
+ * the reader. A command that is still queued is not queued again, the
+ * pending one runs after the repeated send and answers both. The queue
+ * holds at most one of each command and never fills up.
+ */
+struct offload_cmd_queue {
+    int cmds[OFFLOAD_CMD_QUEUE_SIZE];
+    atomic_uint head;    /* advanced by the reader */
+    atomic_uint tail;    /* advanced by the writer */
+    atomic_uint queued;  /* bit n set while command n is queued */
+    atomic_bool exit;
+    int fd;
+};
+
+/* returns 0 or -errno if the eventfd can not be created */
+int offload_cmd_queue_init(struct offload_cmd_queue *queue);
+
+void offload_cmd_queue_release(struct offload_cmd_queue *queue);
+
+/*
+ * Queues cmd, below 32, unless it is queued already. Returns 0, or -ENOSPC
+ * if OFFLOAD_CMD_QUEUE_SIZE distinct commands are already queued.
+ */
+int offload_cmd_queue_send(struct offload_cmd_queue *queue, int cmd);
+
+/* not queued, so it can never be refused; the reader stops at its next receive */
+void offload_cmd_queue_exit(struct offload_cmd_queue *queue);
+
+/*
+ * Waits for the next command. Returns 1 with *cmd set, 0 once exit was
+ * requested, or -errno if waiting failed.
+ */
+int offload_cmd_queue_receive(struct offload_cmd_queue *queue, int *cmd);
+
+#endif /* OFFLOAD_CMD_QUEUE_H */
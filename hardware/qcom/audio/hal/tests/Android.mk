@@ -0,0 +1,106 @@
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := usecase_bench.c
+
+LOCAL_CFLAGS := $(AUDIO_HAL_CFLAGS)
+LOCAL_CFLAGS += -DAUDIO_PLATFORM_NAME=\"$(TARGET_BOARD_PLATFORM)\"
+
+LOCAL_C_INCLUDES := $(AUDIO_HAL_C_INCLUDES)
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/..
+
+# the HAL resolves audio_route, calibration and mutex calls to the bench's wrappers
+LOCAL_LDFLAGS := -rdynamic
+
+LOCAL_SHARED_LIBRARIES := libcutils libdl
+
+LOCAL_HEADER_LIBRARIES := libhardware_headers audio_headers
+
+LOCAL_MODULE := audio_hal_usecase_bench
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PROPRIETARY_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := mixer_sequence_test.c
+
+LOCAL_CFLAGS := -DAUDIO_PLATFORM_NAME=\"$(TARGET_BOARD_PLATFORM)\"
+
+# the HAL resolves audio_route and tinyalsa calls to the test's wrappers
+LOCAL_LDFLAGS := -rdynamic
+
+LOCAL_SHARED_LIBRARIES := libdl
+
+LOCAL_HEADER_LIBRARIES := libhardware_headers audio_headers
+
+LOCAL_MODULE := audio_hal_mixer_sequence_test
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PROPRIETARY_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := pcm_kernels_test.c ../audio_pcm_kernels.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/..
+
+LOCAL_MODULE := audio_hal_pcm_kernels_test
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PROPRIETARY_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := pcm_kernels_bench.c ../audio_pcm_kernels.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/..
+
+LOCAL_MODULE := audio_hal_pcm_kernels_bench
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PROPRIETARY_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := offload_cmd_queue_test.c ../offload_cmd_queue.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/..
+
+LOCAL_MODULE := audio_hal_offload_cmd_queue_test
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PROPRIETARY_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+
+ifeq ($(strip $(AUDIO_FEATURE_ENABLED_SND_MONITOR)), true)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := sndmonitor_debounce_test.c ../audio_hist.c
+
+LOCAL_CFLAGS := $(AUDIO_HAL_CFLAGS)
+
+LOCAL_C_INCLUDES := $(AUDIO_HAL_C_INCLUDES)
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/..
+
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+
+LOCAL_HEADER_LIBRARIES := libhardware_headers audio_headers
+
+LOCAL_MODULE := audio_hal_sndmonitor_debounce_test
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PROPRIETARY_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+endif
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Records the mixer writes of a playback device switch. The test exports
+ * the audio_route and tinyalsa entry points the HAL uses, so the HAL it
+ * loads calls these wrappers, which log the call and forward it to the
+ * real library. With a deep buffer and a low latency stream playing on
+ * speaker, the low latency one is routed to headphones and back. Both
+ * streams share the codec backend, so the two switches reroute both.
+ *
+ * Each mixer write is printed in the order it reaches the mixer. Paths
+ * that were only applied or reset are written together by the next
+ * audio_route_update_mixer(). Running the test against two HAL builds
+ * shows how their sequences differ. It fails if:
+ *  - a single update writes both resets and applies, so the old paths
+ *    are no longer powered down before the new ones come up;
+ *  - a path is written or a PCM is opened or started while earlier
+ *    path changes are still waiting for an update.
+ *
+ *   audio_hal_mixer_sequence_test [hal path]
+ */
+
+#include <dlfcn.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+
+#ifdef __LP64__
+#define HAL_DIR "/vendor/lib64/hw/"
+#else
+#define HAL_DIR "/vendor/lib/hw/"
+#endif
+
+#define MAX_PENDING 32
+
+struct audio_route;
+struct pcm;
+struct pcm_config;
+
+static int (*real_apply_path)(struct audio_route *, const char *);
+static int (*real_apply_and_update_path)(struct audio_route *, const char *);
+static int (*real_reset_path)(struct audio_route *, const char *);
+static int (*real_reset_and_update_path)(struct audio_route *, const char *);
+static int (*real_update_mixer)(struct audio_route *);
+static struct pcm *(*real_pcm_open)(unsigned int, unsigned int, unsigned int,
+                                    const struct pcm_config *);
+static int (*real_pcm_start)(struct pcm *);
+
+static bool recording;
+static int failures;
+/* set while a real call runs, as libaudioroute calls its own exports */
+static bool forwarding;
+
+#define FORWARD(call) ({ \
+    bool outer = forwarding; \
+    forwarding = true; \
+    __typeof__(call) ret = (call); \
+    forwarding = outer; \
+    ret; \
+})
+
+/* path changes waiting for audio_route_update_mixer() */
+static struct {
+    bool reset;
+    char name[128];
+} pending[MAX_PENDING];
+static int num_pending;
+static int pending_resets;
+
+static void fail(const char *what, const char *name)
+{
+    printf("  FAIL: %s %s with %d path changes pending\n", what, name, num_pending);
+    failures++;
+}
+
+static void hold(const char *name, bool reset)
+{
+    if (!recording || forwarding)
+        return;
+    if (num_pending == MAX_PENDING) {
+        fail("too many pending changes at", name);
+        return;
+    }
+    pending[num_pending].reset = reset;
+    snprintf(pending[num_pending].name, sizeof(pending[num_pending].name), "%s", name);
+    num_pending++;
+    pending_resets += reset;
+}
+
+static void write_now(const char *name, bool reset)
+{
+    if (!recording || forwarding)
+        return;
+    if (num_pending)
+        fail(reset ? "reset" : "apply", name);
+    printf("  %s %s\n", reset ? "reset" : "apply", name);
+}
+
+int audio_route_apply_path(struct audio_route *ar, const char *name)
+{
+    hold(name, false);
+    return FORWARD(real_apply_path(ar, name));
+}
+
+int audio_route_reset_path(struct audio_route *ar, const char *name)
+{
+    hold(name, true);
+    return FORWARD(real_reset_path(ar, name));
+}
+
+int audio_route_apply_and_update_path(struct audio_route *ar, const char *name)
+{
+    write_now(name, false);
+    return FORWARD(real_apply_and_update_path(ar, name));
+}
+
+int audio_route_reset_and_update_path(struct audio_route *ar, const char *name)
+{
+    write_now(name, true);
+    return FORWARD(real_reset_and_update_path(ar, name));
+}
+
+int audio_route_update_mixer(struct audio_route *ar)
+{
+    int i;
+
+    if (recording && !forwarding) {
+        printf("  update:");
+        for (i = 0; i < num_pending; i++)
+            printf(" %s %s%s", pending[i].reset ? "reset" : "apply", pending[i].name,
+                   i + 1 < num_pending ? "," : "\n");
+        if (num_pending == 0)
+            printf(" nothing\n");
+        if (pending_resets && pending_resets != num_pending) {
+            printf("  FAIL: %d resets and %d applies written together\n",
+                   pending_resets, num_pending - pending_resets);
+            failures++;
+        }
+        num_pending = 0;
+        pending_resets = 0;
+    }
+    return FORWARD(real_update_mixer(ar));
+}
+
+struct pcm *pcm_open(unsigned int card, unsigned int device, unsigned int flags,
+                     const struct pcm_config *config)
+{
+    if (recording && !forwarding) {
+        if (num_pending)
+            fail("pcm_open on", "its device");
+        printf("  pcm_open card %u device %u\n", card, device);
+    }
+    return FORWARD(real_pcm_open(card, device, flags, config));
+}
+
+int pcm_start(struct pcm *pcm)
+{
+    if (recording && !forwarding) {
+        if (num_pending)
+            fail("pcm_start on", "a pcm");
+        printf("  pcm_start\n");
+    }
+    return FORWARD(real_pcm_start(pcm));
+}
+
+static int load_real(void)
+{
+    void *route = dlopen("libaudioroute.so", RTLD_NOW);
+    void *alsa = dlopen("libtinyalsa.so", RTLD_NOW);
+
+    if (route == NULL || alsa == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        return -1;
+    }
+    real_apply_path = dlsym(route, "audio_route_apply_path");
+    real_apply_and_update_path = dlsym(route, "audio_route_apply_and_update_path");
+    real_reset_path = dlsym(route, "audio_route_reset_path");
+    real_reset_and_update_path = dlsym(route, "audio_route_reset_and_update_path");
+    real_update_mixer = dlsym(route, "audio_route_update_mixer");
+    real_pcm_open = dlsym(alsa, "pcm_open");
+    real_pcm_start = dlsym(alsa, "pcm_start");
+    return 0;
+}
+
+static struct audio_hw_device *open_hal(const char *path)
+{
+    struct hw_module_t *module;
+    struct hw_device_t *device;
+    void *hal = dlopen(path, RTLD_NOW);
+
+    if (hal == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        return NULL;
+    }
+    module = dlsym(hal, HAL_MODULE_INFO_SYM_AS_STR);
+    if (module == NULL ||
+            module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device) != 0) {
+        fprintf(stderr, "%s: can not open the audio device\n", path);
+        return NULL;
+    }
+    return (struct audio_hw_device *)device;
+}
+
+static struct audio_stream_out *start_output(struct audio_hw_device *dev,
+                                             audio_io_handle_t handle,
+                                             audio_output_flags_t flags)
+{
+    struct audio_config config = AUDIO_CONFIG_INITIALIZER;
+    struct audio_stream_out *out;
+    size_t size;
+    void *buf;
+
+    config.sample_rate = 48000;
+    config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+    config.format = AUDIO_FORMAT_PCM_16_BIT;
+    if (dev->open_output_stream(dev, handle, AUDIO_DEVICE_OUT_SPEAKER, flags, &config,
+                                &out, "") != 0)
+        return NULL;
+
+    /* the first write starts the stream on speaker */
+    size = out->common.get_buffer_size(&out->common);
+    buf = calloc(1, size);
+    out->write(out, buf, size);
+    free(buf);
+    return out;
+}
+
+static void switch_device(struct audio_stream_out *out, audio_devices_t device,
+                          const char *name)
+{
+    char kvpairs[32];
+
+    snprintf(kvpairs, sizeof(kvpairs), "%s=%d", AUDIO_PARAMETER_STREAM_ROUTING, device);
+    printf("%s:\n", name);
+    recording = true;
+    out->common.set_parameters(&out->common, kvpairs);
+    recording = false;
+    if (num_pending) {
+        fail("switch ended", "");
+        num_pending = 0;
+        pending_resets = 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct audio_stream_out *deep_buffer, *low_latency;
+    struct audio_hw_device *dev;
+    char path[PATH_MAX];
+
+    if (argc > 1)
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    else
+        snprintf(path, sizeof(path), HAL_DIR "audio.primary.%s.so", AUDIO_PLATFORM_NAME);
+    if (load_real())
+        return EXIT_FAILURE;
+    dev = open_hal(path);
+    if (dev == NULL)
+        return EXIT_FAILURE;
+
+    deep_buffer = start_output(dev, 1, AUDIO_OUTPUT_FLAG_DEEP_BUFFER);
+    low_latency = start_output(dev, 2, AUDIO_OUTPUT_FLAG_PRIMARY);
+    if (deep_buffer == NULL || low_latency == NULL) {
+        fprintf(stderr, "can not start the output streams\n");
+        return EXIT_FAILURE;
+    }
+
+    switch_device(low_latency, AUDIO_DEVICE_OUT_WIRED_HEADPHONE, "speaker -> headphones");
+    switch_device(low_latency, AUDIO_DEVICE_OUT_SPEAKER, "headphones -> speaker");
+
+    dev->close_output_stream(dev, low_latency);
+    dev->close_output_stream(dev, deep_buffer);
+    dev->common.close(&dev->common);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Producer/consumer stress test of the offload command queue. The main
+ * thread sends commands under a mutex, as out_write() and out_drain() do
+ * under out->lock, in bursts of WAIT_FOR_BUFFER as a blocked writer would.
+ * A second thread plays the offload thread: it takes the mutex to run each
+ * command and now and then stalls outside it, as in compress_wait(). Checks:
+ *  - no send is refused, however far the consumer falls behind;
+ *  - the queue never holds more than one entry per command;
+ *  - every send is followed by a run of its command, none is lost;
+ *  - exit ends the consumer even while it waits.
+ *
+ * It then measures how long a WAIT_FOR_BUFFER takes from the send to its
+ * callback, for the list and condition variable loop the HAL used before
+ * and for the queue. A writer plays out_write(): under out->lock it sends
+ * the command, then waits for the WRITE_READY callback before its next
+ * write. The offload thread runs the command against a stub compress_wait()
+ * that returns at once, so each sample is the wakeup and locking cost alone.
+ *
+ *   audio_hal_offload_cmd_queue_test [sends]
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "offload_cmd_queue.h"
+
+#define DEFAULT_SENDS 1000000
+#define NUM_CMDS 4 /* drain, partial drain, wait for buffer, error */
+#define CMD_WAIT_FOR_BUFFER 3
+#define SYNC_INTERVAL 10000
+#define LOST_TIMEOUT_S 5
+#define LATENCY_ROUNDS 20000
+
+static struct offload_cmd_queue queue;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ran = PTHREAD_COND_INITIALIZER;
+
+/* under lock: a clock ticking on every send and run */
+static unsigned long now;
+static unsigned long last_sent[NUM_CMDS + 1];
+static unsigned long last_run[NUM_CMDS + 1];
+static unsigned long sends, runs;
+static int failures;
+
+static uint32_t seed = 1;
+
+static uint32_t next_random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static void *consumer_loop(void *arg)
+{
+    uint32_t stall_seed = 7;
+    int cmd, ret;
+
+    (void)arg;
+    while ((ret = offload_cmd_queue_receive(&queue, &cmd)) == 1) {
+        pthread_mutex_lock(&lock);
+        if (cmd < 1 || cmd > NUM_CMDS) {
+            printf("received unknown command %d\n", cmd);
+            failures++;
+        } else {
+            last_run[cmd] = ++now;
+        }
+        runs++;
+        pthread_cond_signal(&ran);
+        pthread_mutex_unlock(&lock);
+
+        /* the command itself, outside the lock */
+        stall_seed = stall_seed * 1103515245 + 12345;
+        if ((stall_seed >> 16) % 512 == 0)
+            usleep(200);
+    }
+    if (ret < 0) {
+        printf("receive failed: %d\n", ret);
+        failures++;
+    }
+    return NULL;
+}
+
+/* under lock: true once every send has been followed by a run */
+static int all_run(void)
+{
+    for (int cmd = 1; cmd <= NUM_CMDS; cmd++) {
+        if (last_sent[cmd] > last_run[cmd])
+            return 0;
+    }
+    return 1;
+}
+
+static void wait_all_run(void)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += LOST_TIMEOUT_S;
+    pthread_mutex_lock(&lock);
+    while (!all_run()) {
+        if (pthread_cond_timedwait(&ran, &lock, &deadline) != 0) {
+            printf("commands lost after %lu sends\n", sends);
+            failures++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void send_cmd(int cmd)
+{
+    unsigned int depth;
+    int ret;
+
+    pthread_mutex_lock(&lock);
+    last_sent[cmd] = ++now;
+    ret = offload_cmd_queue_send(&queue, cmd);
+    sends++;
+    depth = atomic_load(&queue.tail) - atomic_load(&queue.head);
+    pthread_mutex_unlock(&lock);
+
+    if (ret != 0) {
+        printf("send %lu of command %d failed: %d\n", sends, cmd, ret);
+        failures++;
+    }
+    if (depth > NUM_CMDS) {
+        printf("%u entries queued for %d commands\n", depth, NUM_CMDS);
+        failures++;
+    }
+}
+
+/*
+ * Write to callback latency. out_lock stands for out->lock; the writer
+ * waits for each callback on its own lock, as AudioFlinger does.
+ */
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t cb_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cb_cond = PTHREAD_COND_INITIALIZER;
+static struct timespec sent_at;  /* under out_lock */
+static long latency_ns[LATENCY_ROUNDS];
+static int callbacks;           /* under cb_lock */
+
+/* the list and condition variable the offload thread waited on before */
+struct list_cmd {
+    struct list_cmd *next;
+    int cmd;
+};
+
+static struct list_cmd *list_head, *list_tail;  /* under out_lock */
+static pthread_cond_t list_cond = PTHREAD_COND_INITIALIZER;
+
+static long elapsed_ns(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000000L + (to->tv_nsec - from->tv_nsec);
+}
+
+/* the DSP has room already */
+static int compress_wait(void)
+{
+    return 0;
+}
+
+/* under out_lock, as out->offload_callback() is called */
+static void write_ready_callback(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    pthread_mutex_lock(&cb_lock);
+    if (callbacks < LATENCY_ROUNDS)
+        latency_ns[callbacks] = elapsed_ns(&sent_at, &ts);
+    callbacks++;
+    pthread_cond_signal(&cb_cond);
+    pthread_mutex_unlock(&cb_lock);
+}
+
+/* under out_lock, the old send_offload_cmd_l() */
+static void list_send(int cmd)
+{
+    struct list_cmd *item = calloc(1, sizeof(*item));
+
+    item->cmd = cmd;
+    if (list_tail)
+        list_tail->next = item;
+    else
+        list_head = item;
+    list_tail = item;
+    pthread_cond_signal(&list_cond);
+}
+
+/* the old offload_thread_loop(): waits for commands under out_lock */
+static void *list_loop(void *arg)
+{
+    struct list_cmd *item;
+    bool done = false;
+
+    (void)arg;
+    pthread_mutex_lock(&out_lock);
+    while (!done) {
+        if (list_head == NULL) {
+            pthread_cond_wait(&list_cond, &out_lock);
+            continue;
+        }
+        item = list_head;
+        list_head = item->next;
+        if (list_head == NULL)
+            list_tail = NULL;
+        if (item->cmd == 0) {
+            done = true;
+        } else {
+            pthread_mutex_unlock(&out_lock);
+            compress_wait();
+            pthread_mutex_lock(&out_lock);
+            write_ready_callback();
+        }
+        free(item);
+    }
+    pthread_mutex_unlock(&out_lock);
+    return NULL;
+}
+
+static void queue_send(int cmd)
+{
+    if (cmd == 0)
+        offload_cmd_queue_exit(&queue);
+    else
+        offload_cmd_queue_send(&queue, cmd);
+}
+
+/* the current offload_thread_loop(): out_lock only to run a command */
+static void *queue_loop(void *arg)
+{
+    int cmd;
+
+    (void)arg;
+    while (offload_cmd_queue_receive(&queue, &cmd) == 1) {
+        pthread_mutex_lock(&out_lock);
+        pthread_mutex_unlock(&out_lock);
+        compress_wait();
+        pthread_mutex_lock(&out_lock);
+        write_ready_callback();
+        pthread_mutex_unlock(&out_lock);
+    }
+    return NULL;
+}
+
+static int compare_long(const void *a, const void *b)
+{
+    long x = *(const long *)a, y = *(const long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void measure_latency(const char *name, void *(*loop)(void *),
+                            void (*send)(int))
+{
+    struct timespec deadline;
+    pthread_t thread;
+    int i;
+
+    callbacks = 0;
+    pthread_create(&thread, NULL, loop, NULL);
+    for (i = 0; i < LATENCY_ROUNDS; i++) {
+        pthread_mutex_lock(&out_lock);
+        clock_gettime(CLOCK_MONOTONIC, &sent_at);
+        send(CMD_WAIT_FOR_BUFFER);
+        pthread_mutex_unlock(&out_lock);
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += LOST_TIMEOUT_S;
+        pthread_mutex_lock(&cb_lock);
+        while (callbacks == i) {
+            if (pthread_cond_timedwait(&cb_cond, &cb_lock, &deadline) != 0)
+                break;
+        }
+        pthread_mutex_unlock(&cb_lock);
+        if (callbacks == i) {
+            printf("%s: no callback for send %d\n", name, i);
+            failures++;
+            break;
+        }
+    }
+    pthread_mutex_lock(&out_lock);
+    send(0);
+    pthread_mutex_unlock(&out_lock);
+    pthread_join(thread, NULL);
+    if (i < LATENCY_ROUNDS)
+        return;
+
+    qsort(latency_ns, LATENCY_ROUNDS, sizeof(latency_ns[0]), compare_long);
+    printf("%s: send to callback min %ld p50 %ld p90 %ld p99 %ld p99.9 %ld max %ld ns\n",
+           name, latency_ns[0], latency_ns[LATENCY_ROUNDS / 2],
+           latency_ns[LATENCY_ROUNDS * 9 / 10], latency_ns[LATENCY_ROUNDS * 99 / 100],
+           latency_ns[LATENCY_ROUNDS * 999 / 1000], latency_ns[LATENCY_ROUNDS - 1]);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long count = DEFAULT_SENDS;
+    unsigned long i, n;
+    pthread_t consumer;
+
+    if (argc > 1)
+        count = strtoul(argv[1], NULL, 0);
+    if (offload_cmd_queue_init(&queue) != 0) {
+        printf("can not create the queue\n");
+        return EXIT_FAILURE;
+    }
+    pthread_create(&consumer, NULL, consumer_loop, NULL);
+
+    for (i = 0; i < count && !failures; i += n) {
+        uint32_t r = next_random();
+
+        /* a writer retrying on a full DSP buffer, or any single command */
+        if (r % 4 == 0) {
+            for (n = 0; n < 1 + (r >> 8) % 64u; n++)
+                send_cmd(CMD_WAIT_FOR_BUFFER);
+        } else {
+            send_cmd(1 + (r >> 8) % NUM_CMDS);
+            n = 1;
+        }
+        if ((r >> 16) % 1024 == 0)
+            usleep(100); /* lets the consumer go back to sleep */
+        if (i / SYNC_INTERVAL != (i + n) / SYNC_INTERVAL)
+            wait_all_run();
+    }
+    wait_all_run();
+
+    /* exit while the consumer sleeps, it must still wake up */
+    usleep(1000);
+    offload_cmd_queue_exit(&queue);
+    pthread_join(consumer, NULL);
+    offload_cmd_queue_release(&queue);
+    printf("%lu sends, %lu runs\n", sends, runs);
+
+    measure_latency("list + condvar", list_loop, list_send);
+    if (offload_cmd_queue_init(&queue) != 0) {
+        printf("can not create the queue\n");
+        return EXIT_FAILURE;
+    }
+    measure_latency("queue", queue_loop, queue_send);
+    offload_cmd_queue_release(&queue);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * PCM kernel microbenchmark. Times each kernel and the scalar loop it
+ * replaced on a 20 ms buffer at 48 kHz and prints CPU cycles per frame,
+ * read from the perf cycle counter. Where perf events are not available
+ * (perf_event_paranoid) nanoseconds per frame are printed instead.
+ *
+ *   audio_hal_pcm_kernels_bench [iterations]
+ */
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audio_pcm_kernels.h"
+#include "pcm_kernels_ref.h"
+
+#define DEFAULT_ITERATIONS 10000
+#define FRAMES 960
+
+/* sizes the compiler can not specialize the inlined scalar loops for */
+static volatile size_t frames = FRAMES;
+static volatile size_t audio_frame_size = 4, haptic_frame_size = 2, sample_size = 2;
+
+static int cycles_fd = -1;
+
+static void open_cycle_counter(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cycles_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* cycles, or nanoseconds without a cycle counter */
+static uint64_t now(void)
+{
+    struct timespec ts;
+    uint64_t count;
+
+    if (cycles_fd >= 0 && read(cycles_fd, &count, sizeof(count)) == sizeof(count))
+        return count;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const char *kernel, uint64_t ref, uint64_t opt, unsigned long iterations)
+{
+    double frames = (double)FRAMES * iterations;
+
+    printf("%-24s scalar %6.2f  kernel %6.2f %s per frame  (x%.1f)\n", kernel,
+           ref / frames, opt / frames, cycles_fd >= 0 ? "cycles" : "ns",
+           opt ? (double)ref / opt : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    static int16_t pcm16[2 * FRAMES];
+    static int32_t pcm32[2 * FRAMES];
+    static uint8_t buf[FRAMES * 6];
+    static uint8_t haptic[FRAMES * 2];
+    unsigned long iterations = DEFAULT_ITERATIONS;
+    unsigned long i;
+    uint64_t t0, t1, t2;
+
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 0);
+    if (iterations == 0)
+        return EXIT_FAILURE;
+    for (i = 0; i < sizeof(buf); i++)
+        buf[i] = (uint8_t)(i * 37);
+    memcpy(pcm16, buf, sizeof(pcm16) < sizeof(buf) ? sizeof(pcm16) : sizeof(buf));
+    memcpy(pcm32, buf, sizeof(pcm32) < sizeof(buf) ? sizeof(pcm32) : sizeof(buf));
+    open_cycle_counter();
+    if (cycles_fd < 0)
+        printf("no cycle counter, timing in ns\n");
+
+    /* the kernels run in place, repeated runs keep the data moving */
+    t0 = now();
+    for (i = 0; i < iterations; i++)
+        ref_downmix_stereo_to_mono_16(pcm16, pcm16, frames);
+    t1 = now();
+    for (i = 0; i < iterations; i++)
+        pcm_downmix_stereo_to_mono_16(pcm16, pcm16, frames);
+    t2 = now();
+    report("downmix stereo to mono", t1 - t0, t2 - t1, iterations);
+
+    /* a stereo frame is two samples */
+    t0 = now();
+    for (i = 0; i < iterations; i++)
+        ref_convert_24_8_to_8_24(pcm32, 2 * frames);
+    t1 = now();
+    for (i = 0; i < iterations; i++)
+        pcm_convert_24_8_to_8_24(pcm32, 2 * frames);
+    t2 = now();
+    report("24_8 to 8_24 stereo", t1 - t0, t2 - t1, iterations);
+
+    t0 = now();
+    for (i = 0; i < iterations; i++)
+        ref_deinterleave_haptics(buf, haptic, frames, audio_frame_size,
+                                 haptic_frame_size);
+    t1 = now();
+    for (i = 0; i < iterations; i++)
+        pcm_deinterleave_haptics(buf, haptic, frames, audio_frame_size,
+                                 haptic_frame_size);
+    t2 = now();
+    report("haptics 16 bit 2 + 1", t1 - t0, t2 - t1, iterations);
+
+    t0 = now();
+    for (i = 0; i < iterations; i++)
+        ref_deinterleave_haptics(buf, haptic, frames, sample_size, sample_size);
+    t1 = now();
+    for (i = 0; i < iterations; i++)
+        pcm_deinterleave_haptics(buf, haptic, frames, sample_size, sample_size);
+    t2 = now();
+    report("haptics test split", t1 - t0, t2 - t1, iterations);
+
+    if (cycles_fd >= 0)
+        close(cycles_fd);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_KERNELS_REF_H
+#define PCM_KERNELS_REF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The per-sample loops out_write() and in_read() ran before
+ * audio_pcm_kernels.c, kept as the scalar reference for its tests.
+ */
+
+static inline void ref_downmix_stereo_to_mono_16(int16_t *dst, const int16_t *src,
+                                                 size_t frames)
+{
+    for (size_t i = 0; i < frames ; i++, dst++, src += 2) {
+        *dst = (int16_t)(((int32_t)src[0] + (int32_t)src[1]) >> 1);
+    }
+}
+
+static inline void ref_convert_24_8_to_8_24(int32_t *buf, size_t samples)
+{
+    for (size_t itt=0; itt < samples ; itt++) {
+        buf[itt] >>= 8;
+    }
+}
+
+static inline void ref_deinterleave_haptics(uint8_t *buf, uint8_t *haptic, size_t frames,
+                                            size_t audio_frame_size,
+                                            size_t haptic_frame_size)
+{
+    size_t src_index = 0, aud_index = 0, hap_index = 0;
+
+    for (size_t i = 0; i < frames; i++) {
+        for (size_t j = 0; j < audio_frame_size; j++)
+            buf[aud_index++] = buf[src_index++];
+
+        for (size_t j = 0; j < haptic_frame_size; j++)
+            haptic[hap_index++] = buf[src_index++];
+    }
+}
+
+#endif /* PCM_KERNELS_REF_H */
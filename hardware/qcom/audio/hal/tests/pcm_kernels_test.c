@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the PCM kernels against the scalar loops they replaced. Each kernel
+ * runs on the same random input as its reference, in place as the HAL calls
+ * it, for every length up to a few vector blocks and for odd buffer sizes,
+ * so both the vector loops and their scalar tails are covered. Whole buffers
+ * are compared, so a write past the last frame fails too. Built for a NEON
+ * target this compares the NEON paths, otherwise the C fallbacks.
+ *
+ *   audio_hal_pcm_kernels_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_pcm_kernels.h"
+#include "pcm_kernels_ref.h"
+
+#define MAX_FRAMES 4801
+#define MAX_FRAME_SIZE 16
+
+/* every length up to and past a few 8 frame blocks, then odd buffer sizes */
+#define SHORT_LENGTHS 40
+static const size_t long_lengths[] = { 63, 64, 65, 127, 479, 480, 481, 959, 4801 };
+
+/* audio and haptic frame sizes in bytes; 4 + 2 is the vectorized layout */
+static const struct {
+    size_t audio;
+    size_t haptic;
+} haptic_layouts[] = {
+    { 4, 2 },   /* 16 bit stereo + mono haptic */
+    { 2, 2 },   /* 16 bit vendor.audio.test_haptic split */
+    { 4, 4 },   /* 16 bit stereo + stereo haptic */
+    { 6, 3 },   /* 24 bit packed stereo + mono haptic */
+    { 8, 4 },   /* 32 bit stereo + mono haptic */
+};
+
+static int failures;
+static uint32_t seed = 1;
+
+static uint32_t next_random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/* random bytes, with full scale samples mixed in to catch overflow */
+static void fill(void *buf, size_t size)
+{
+    uint8_t *p = buf;
+
+    for (size_t i = 0; i < size; i++) {
+        switch (next_random() % 8) {
+        case 0: p[i] = 0x80; break;
+        case 1: p[i] = 0x7f; break;
+        case 2: p[i] = 0xff; break;
+        default: p[i] = (uint8_t)next_random(); break;
+        }
+    }
+}
+
+static void check(int ok, const char *kernel, size_t frames, size_t offset)
+{
+    if (!ok) {
+        printf("%s: %zu frames at offset %zu differs from the scalar loop\n",
+               kernel, frames, offset);
+        failures++;
+    }
+}
+
+static void test_length(size_t frames, size_t offset)
+{
+    static int16_t pcm16[2][2 * MAX_FRAMES + 8];
+    static int32_t pcm32[2][MAX_FRAMES + 8];
+    static uint8_t buf[2][MAX_FRAMES * MAX_FRAME_SIZE + 16];
+    static uint8_t haptic[2][MAX_FRAMES * MAX_FRAME_SIZE + 16];
+    size_t i;
+
+    fill(pcm16[0], sizeof(pcm16[0]));
+    memcpy(pcm16[1], pcm16[0], sizeof(pcm16[0]));
+    ref_downmix_stereo_to_mono_16(pcm16[0] + offset, pcm16[0] + offset, frames);
+    pcm_downmix_stereo_to_mono_16(pcm16[1] + offset, pcm16[1] + offset, frames);
+    check(!memcmp(pcm16[0], pcm16[1], sizeof(pcm16[0])), "downmix", frames, offset);
+
+    fill(pcm32[0], sizeof(pcm32[0]));
+    memcpy(pcm32[1], pcm32[0], sizeof(pcm32[0]));
+    ref_convert_24_8_to_8_24(pcm32[0] + offset, frames);
+    pcm_convert_24_8_to_8_24(pcm32[1] + offset, frames);
+    check(!memcmp(pcm32[0], pcm32[1], sizeof(pcm32[0])), "24_8 to 8_24", frames, offset);
+
+    for (i = 0; i < sizeof(haptic_layouts) / sizeof(haptic_layouts[0]); i++) {
+        size_t audio = haptic_layouts[i].audio;
+        size_t hap = haptic_layouts[i].haptic;
+        char name[32];
+
+        fill(buf[0], sizeof(buf[0]));
+        fill(haptic[0], sizeof(haptic[0]));
+        memcpy(buf[1], buf[0], sizeof(buf[0]));
+        memcpy(haptic[1], haptic[0], sizeof(haptic[0]));
+        ref_deinterleave_haptics(buf[0] + 2 * offset, haptic[0] + 2 * offset, frames,
+                                 audio, hap);
+        pcm_deinterleave_haptics(buf[1] + 2 * offset, haptic[1] + 2 * offset, frames,
+                                 audio, hap);
+        snprintf(name, sizeof(name), "haptics %zu + %zu", audio, hap);
+        check(!memcmp(buf[0], buf[1], sizeof(buf[0])) &&
+              !memcmp(haptic[0], haptic[1], sizeof(haptic[0])), name, frames, offset);
+    }
+}
+
+int main(void)
+{
+    size_t frames, i, offset;
+
+    /* offset 1 leaves the buffers only sample aligned */
+    for (offset = 0; offset < 2; offset++) {
+        for (frames = 0; frames < SHORT_LENGTHS; frames++)
+            test_length(frames, offset);
+        for (i = 0; i < sizeof(long_lengths) / sizeof(long_lengths[0]); i++)
+            test_length(long_lengths[i], offset);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tests the sound card state debounce of sndmonitor.c, which is built into
+ * the test to reach its state. The card state file is a temp file the test
+ * rewrites; regular files can not be polled, so the test runs the state
+ * updates itself and the monitor thread only has to report what the
+ * debounce window held back:
+ *  - the first change is reported at once, changes inside the window are
+ *    held and a flap back to the reported state is dropped;
+ *  - a held change is reported when the window closes, from the first pass
+ *    of the monitor loop and while signals keep interrupting epoll_wait().
+ *
+ *   audio_hal_sndmonitor_debounce_test
+ */
+
+#ifndef SND_MONITOR_ENABLED
+#define SND_MONITOR_ENABLED
+#endif
+
+#include "../audio_extn/sndmonitor.c"
+
+#include <signal.h>
+#include <stdio.h>
+
+#define DEBOUNCE_MS 100
+/* how late the monitor thread may report a held change */
+#define REPORT_SLACK_MS 50
+#define SIGNAL_INTERVAL_US 10000
+
+static pthread_mutex_t events_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t events_cond = PTHREAD_COND_INITIALIZER;
+static int num_events;
+static card_status_t last_status;
+static nsecs_t last_event_ns;
+
+static int failures;
+
+#define CHECK(x) do { if (!(x)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __func__, __LINE__, #x); \
+        failures++; \
+    } } while (0)
+
+static void on_event(void * stream __unused, const snd_mon_event_t * event)
+{
+    pthread_mutex_lock(&events_lock);
+    if (event->type == SND_MON_EVENT_CARD) {
+        num_events++;
+        last_status = event->status;
+        last_event_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+        pthread_cond_signal(&events_cond);
+    }
+    pthread_mutex_unlock(&events_lock);
+}
+
+static int events(void)
+{
+    pthread_mutex_lock(&events_lock);
+    int n = num_events;
+    pthread_mutex_unlock(&events_lock);
+    return n;
+}
+
+static void on_signal(int sig __unused)
+{
+}
+
+static sndcard_t * card;
+
+static void set_state(const char * state)
+{
+    CHECK(pwrite(card->src.fd, state, strlen(state), 0) == (ssize_t)strlen(state));
+    CHECK(ftruncate(card->src.fd, strlen(state)) == 0);
+    on_sndcard_state_update(card, systemTime(SYSTEM_TIME_MONOTONIC));
+}
+
+static int setup(void)
+{
+    char path[] = "/data/local/tmp/sndmonitor_test_XXXXXX";
+    int fd = mkstemp(path);
+
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    CHECK(pwrite(fd, "ONLINE", 6, 0) == 6);
+
+    list_init(&sndmonitor.cards);
+    list_init(&sndmonitor.dev_events);
+    sndmonitor.debounce_ns = (nsecs_t)DEBOUNCE_MS * 1000000;
+    sndmonitor.quit.type = SRC_QUIT;
+    sndmonitor.quit.fd = eventfd(0, EFD_CLOEXEC);
+    sndmonitor.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sndmonitor.quit.fd < 0 || sndmonitor.epoll_fd < 0 ||
+            add_new_sndcard(0, fd) < 0 || listeners_init() < 0 ||
+            add_epoll_src(&sndmonitor.quit) < 0)
+        return -1;
+    add_listener(&card, on_event);
+    card = node_to_item(list_head(&sndmonitor.cards), sndcard_t, node);
+    return 0;
+}
+
+/* a flap inside the window is dropped, a change after it is reported at once */
+static void test_flap(void)
+{
+    int timeout_ms;
+
+    set_state("OFFLINE");
+    CHECK(events() == 1);
+    CHECK(last_status == CARD_STATUS_OFFLINE);
+
+    set_state("ONLINE");
+    set_state("OFFLINE");
+    CHECK(events() == 1);
+    timeout_ms = flush_pending_sndcards();
+    CHECK(timeout_ms > 0 && timeout_ms <= DEBOUNCE_MS);
+
+    usleep((DEBOUNCE_MS + 10) * 1000);
+    CHECK(flush_pending_sndcards() == -1);
+    CHECK(events() == 1);
+
+    set_state("ONLINE");
+    CHECK(events() == 2);
+    CHECK(last_status == CARD_STATUS_ONLINE);
+}
+
+/* the monitor loop reports a held change on time despite signals */
+static void test_held_change_reported(void)
+{
+    struct sigaction sa = { .sa_handler = on_signal };
+    struct timespec deadline;
+    pthread_t thread;
+    nsecs_t window_end;
+    int reported = 0;
+
+    /* the window of the last report is over, so OFFLINE goes out at once */
+    usleep((DEBOUNCE_MS + 10) * 1000);
+    set_state("OFFLINE");
+    CHECK(events() == 3);
+    set_state("ONLINE");
+    CHECK(events() == 3);
+    window_end = card->quiet_until_ns;
+
+    /* no SA_RESTART, every signal interrupts epoll_wait() */
+    sigaction(SIGUSR1, &sa, NULL);
+    CHECK(pthread_create(&thread, NULL, monitor_thread_loop, NULL) == 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += 1;
+    while (!reported) {
+        struct timespec now;
+
+        pthread_kill(thread, SIGUSR1);
+        usleep(SIGNAL_INTERVAL_US);
+        reported = events() == 4;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline.tv_sec ||
+                (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec))
+            break;
+    }
+
+    CHECK(reported);
+    if (reported) {
+        CHECK(last_status == CARD_STATUS_ONLINE);
+        CHECK(last_event_ns >= window_end);
+        CHECK(last_event_ns - window_end <= (nsecs_t)REPORT_SLACK_MS * 1000000);
+    }
+
+    eventfd_write(sndmonitor.quit.fd, 1);
+    pthread_join(thread, NULL);
+}
+
+int main(void)
+{
+    if (setup() < 0) {
+        printf("setup failed: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    test_flap();
+    test_held_change_reported();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
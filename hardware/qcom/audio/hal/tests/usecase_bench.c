@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2013-2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Usecase lookup microbenchmark. Loads the audio HAL and times its
+ * get_usecase_from_list() against the usecase_list walk it replaced, on a
+ * device with a typical set of streams open. add_usecase_to_list() and
+ * remove_usecase_from_list() are timed too, as they now maintain the
+ * indexes. Every usecase id is also checked to resolve to the same usecase
+ * both ways.
+ *
+ * It then times how long a device switch holds adev->lock. With 1 to
+ * NUM_STREAMS streams started, the low latency one is routed from speaker to
+ * headphones and back SWITCHES times through set_parameters(). The bench
+ * exports the audio_route calls and platform_send_audio_calibration(), so
+ * the HAL calls these wrappers. They skip the mixer and calibration writes
+ * during the switches, leaving the HAL's own routing work. pthread_mutex_lock()
+ * and pthread_mutex_unlock() are wrapped too, to add up the time adev->lock
+ * is held. adev->lock directly follows the hw device in every build, so a
+ * HAL built without the usecase index can be measured as well; it only
+ * skips the lookup part. Running the bench against both builds gives the
+ * hold times with and without the index.
+ *
+ *   audio_hal_usecase_bench [lookups] [hal path]
+ */
+
+#include <dlfcn.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <hardware/audio.h>
+#include <hardware/hardware.h>
+
+#include "audio_hw.h"
+#include "platform.h"
+
+#define DEFAULT_LOOKUPS 1000000
+#define SWITCHES 200
+
+#ifdef __LP64__
+#define HAL_DIR "/vendor/lib64/hw/"
+#else
+#define HAL_DIR "/vendor/lib/hw/"
+#endif
+
+static struct audio_usecase *(*hal_get_usecase_from_list)(struct audio_device *,
+                                                          audio_usecase_t);
+static void (*hal_add_usecase_to_list)(struct audio_device *, struct audio_usecase *);
+static void (*hal_remove_usecase_from_list)(struct audio_device *, struct audio_usecase *);
+
+/* the lookup before the index: first listed usecase with the id */
+static struct audio_usecase *walk_usecase_list(struct audio_device *adev,
+                                               audio_usecase_t uc_id)
+{
+    struct audio_usecase *usecase;
+    struct listnode *node;
+
+    list_for_each(node, &adev->usecase_list) {
+        usecase = node_to_item(node, struct audio_usecase, list);
+        if (usecase->id == uc_id)
+            return usecase;
+    }
+    return NULL;
+}
+
+/* music, notifications, a voip call with its capture, and a recording */
+static const struct {
+    audio_usecase_t id;
+    usecase_type_t type;
+    snd_device_t out_snd_device;
+    snd_device_t in_snd_device;
+} open_usecases[] = {
+    { USECASE_AUDIO_PLAYBACK_DEEP_BUFFER, PCM_PLAYBACK, SND_DEVICE_OUT_SPEAKER, SND_DEVICE_NONE },
+    { USECASE_AUDIO_PLAYBACK_LOW_LATENCY, PCM_PLAYBACK, SND_DEVICE_OUT_SPEAKER, SND_DEVICE_NONE },
+    { USECASE_AUDIO_PLAYBACK_OFFLOAD, PCM_PLAYBACK, SND_DEVICE_OUT_SPEAKER, SND_DEVICE_NONE },
+    { USECASE_AUDIO_PLAYBACK_VOIP, PCM_PLAYBACK, SND_DEVICE_OUT_VOICE_SPEAKER, SND_DEVICE_NONE },
+    { USECASE_AUDIO_RECORD_VOIP, PCM_CAPTURE, SND_DEVICE_NONE, SND_DEVICE_IN_SPEAKER_MIC },
+    { USECASE_AUDIO_RECORD, PCM_CAPTURE, SND_DEVICE_NONE, SND_DEVICE_IN_HANDSET_MIC },
+};
+
+#define NUM_OPEN (sizeof(open_usecases) / sizeof(open_usecases[0]))
+
+/* the ids routing code looks up on a device switch, listed or not */
+static const audio_usecase_t lookups[] = {
+    USECASE_AUDIO_PLAYBACK_VOIP, USECASE_AUDIO_RECORD_VOIP,
+    USECASE_AUDIO_PLAYBACK_DEEP_BUFFER, USECASE_AUDIO_RECORD,
+    USECASE_AUDIO_HFP_SCO, USECASE_AUDIO_SPKR_CALIB_RX,
+    USECASE_AUDIO_PLAYBACK_OFFLOAD, USECASE_VOICE_CALL,
+};
+
+#define NUM_LOOKUPS (sizeof(lookups) / sizeof(lookups[0]))
+
+/* streams started for the device switches, the first one is switched */
+static const struct {
+    bool input;
+    int flags;
+} streams[] = {
+    { false, AUDIO_OUTPUT_FLAG_PRIMARY },
+    { false, AUDIO_OUTPUT_FLAG_DEEP_BUFFER },
+    { false, AUDIO_OUTPUT_FLAG_FAST | AUDIO_OUTPUT_FLAG_RAW },
+    { true, AUDIO_INPUT_FLAG_NONE },
+    { true, AUDIO_INPUT_FLAG_FAST },
+};
+
+#define NUM_STREAMS (sizeof(streams) / sizeof(streams[0]))
+
+static void *hal;
+
+static int (*real_apply_path)(struct audio_route *, const char *);
+static int (*real_apply_and_update_path)(struct audio_route *, const char *);
+static int (*real_reset_path)(struct audio_route *, const char *);
+static int (*real_reset_and_update_path)(struct audio_route *, const char *);
+static int (*real_update_mixer)(struct audio_route *);
+static int (*real_send_audio_calibration)(void *, snd_device_t);
+static int (*real_mutex_lock)(pthread_mutex_t *);
+static int (*real_mutex_unlock)(pthread_mutex_t *);
+
+/* set for the switches: no mixer writes, adev->lock hold time added up */
+static bool stubbed;
+static pthread_mutex_t *timed_lock;
+static pthread_t timed_thread;
+static struct timespec locked_at;
+static double held_ns;
+
+static double elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+int audio_route_apply_path(struct audio_route *ar, const char *name)
+{
+    return stubbed ? 0 : real_apply_path(ar, name);
+}
+
+int audio_route_reset_path(struct audio_route *ar, const char *name)
+{
+    return stubbed ? 0 : real_reset_path(ar, name);
+}
+
+int audio_route_apply_and_update_path(struct audio_route *ar, const char *name)
+{
+    return stubbed ? 0 : real_apply_and_update_path(ar, name);
+}
+
+int audio_route_reset_and_update_path(struct audio_route *ar, const char *name)
+{
+    return stubbed ? 0 : real_reset_and_update_path(ar, name);
+}
+
+int audio_route_update_mixer(struct audio_route *ar)
+{
+    return stubbed ? 0 : real_update_mixer(ar);
+}
+
+int platform_send_audio_calibration(void *platform, snd_device_t snd_device)
+{
+    return stubbed ? 0 : real_send_audio_calibration(platform, snd_device);
+}
+
+/* resolved on first use, libraries may lock before main() runs */
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    int ret;
+
+    if (real_mutex_lock == NULL)
+        real_mutex_lock = dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    ret = real_mutex_lock(mutex);
+    if (mutex == timed_lock && pthread_equal(pthread_self(), timed_thread))
+        clock_gettime(CLOCK_MONOTONIC, &locked_at);
+    return ret;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *mutex)
+{
+    struct timespec now;
+
+    if (real_mutex_unlock == NULL)
+        real_mutex_unlock = dlsym(RTLD_NEXT, "pthread_mutex_unlock");
+    if (mutex == timed_lock && pthread_equal(pthread_self(), timed_thread)) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        held_ns += elapsed_ns(&locked_at, &now);
+    }
+    return real_mutex_unlock(mutex);
+}
+
+static int load_hal(const char *path)
+{
+    void *route = dlopen("libaudioroute.so", RTLD_NOW);
+
+    hal = dlopen(path, RTLD_NOW);
+    if (route == NULL || hal == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        return -1;
+    }
+    real_apply_path = dlsym(route, "audio_route_apply_path");
+    real_apply_and_update_path = dlsym(route, "audio_route_apply_and_update_path");
+    real_reset_path = dlsym(route, "audio_route_reset_path");
+    real_reset_and_update_path = dlsym(route, "audio_route_reset_and_update_path");
+    real_update_mixer = dlsym(route, "audio_route_update_mixer");
+    real_send_audio_calibration = dlsym(hal, "platform_send_audio_calibration");
+    if (real_send_audio_calibration == NULL) {
+        fprintf(stderr, "%s does not export platform_send_audio_calibration\n", path);
+        return -1;
+    }
+
+    /* the index exports, missing from a HAL built without it */
+    hal_get_usecase_from_list = dlsym(hal, "get_usecase_from_list");
+    hal_add_usecase_to_list = dlsym(hal, "add_usecase_to_list");
+    hal_remove_usecase_from_list = dlsym(hal, "remove_usecase_from_list");
+    return 0;
+}
+
+static int bench_lookups(unsigned long count)
+{
+    struct audio_usecase usecases[NUM_OPEN];
+    struct audio_device *adev;
+    struct timespec t0, t1, t2, t3;
+    unsigned long i, found = 0;
+    int id;
+
+    if (hal_get_usecase_from_list == NULL || hal_add_usecase_to_list == NULL ||
+            hal_remove_usecase_from_list == NULL) {
+        printf("no usecase index in this HAL, lookups not timed\n");
+        return 0;
+    }
+
+    adev = calloc(1, sizeof(*adev));
+    adev->snd_dev_usecase_cnt = calloc(SND_DEVICE_MAX, sizeof(int));
+    list_init(&adev->usecase_list);
+
+    for (i = 0; i < NUM_OPEN; i++) {
+        usecases[i] = (struct audio_usecase) {
+            .id = open_usecases[i].id,
+            .type = open_usecases[i].type,
+            .out_snd_device = open_usecases[i].out_snd_device,
+            .in_snd_device = open_usecases[i].in_snd_device,
+        };
+        hal_add_usecase_to_list(adev, &usecases[i]);
+    }
+
+    for (id = 0; id < AUDIO_USECASE_MAX; id++) {
+        if (hal_get_usecase_from_list(adev, id) != walk_usecase_list(adev, id)) {
+            fprintf(stderr, "usecase %d resolves differently\n", id);
+            return -1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < count; i++)
+        found += walk_usecase_list(adev, lookups[i % NUM_LOOKUPS]) != NULL;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (i = 0; i < count; i++)
+        found += hal_get_usecase_from_list(adev, lookups[i % NUM_LOOKUPS]) != NULL;
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    /* a stream open/close: remove the oldest usecase and add it back */
+    for (i = 0; i < count / NUM_OPEN; i++) {
+        hal_remove_usecase_from_list(adev, &usecases[i % NUM_OPEN]);
+        hal_add_usecase_to_list(adev, &usecases[i % NUM_OPEN]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+
+    printf("%zu usecases listed: list walk %.1f ns, index %.1f ns per lookup, "
+           "%.1f ns per remove/add (%lu found)\n",
+           NUM_OPEN, elapsed_ns(&t0, &t1) / count, elapsed_ns(&t1, &t2) / count,
+           elapsed_ns(&t2, &t3) / (count / NUM_OPEN), found);
+
+    for (id = 0; id < AUDIO_USECASE_MAX; id++) {
+        if (hal_get_usecase_from_list(adev, id) != walk_usecase_list(adev, id)) {
+            fprintf(stderr, "usecase %d resolves differently after reordering\n", id);
+            return -1;
+        }
+    }
+
+    free(adev->snd_dev_usecase_cnt);
+    free(adev);
+    return 0;
+}
+
+static struct audio_hw_device *open_device(void)
+{
+    struct hw_module_t *module = dlsym(hal, HAL_MODULE_INFO_SYM_AS_STR);
+    struct hw_device_t *device;
+
+    if (module == NULL ||
+            module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device) != 0) {
+        fprintf(stderr, "can not open the audio device\n");
+        return NULL;
+    }
+    return (struct audio_hw_device *)device;
+}
+
+/* opens the stream and starts it with a first write or read */
+static struct audio_stream *start_stream(struct audio_hw_device *dev, int i)
+{
+    struct audio_config config = AUDIO_CONFIG_INITIALIZER;
+    struct audio_stream_out *out;
+    struct audio_stream_in *in;
+    size_t size;
+    void *buf;
+
+    config.sample_rate = 48000;
+    config.format = AUDIO_FORMAT_PCM_16_BIT;
+    if (streams[i].input) {
+        config.channel_mask = AUDIO_CHANNEL_IN_MONO;
+        if (dev->open_input_stream(dev, i + 1, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in,
+                                   streams[i].flags, "", AUDIO_SOURCE_MIC) != 0)
+            return NULL;
+        size = in->common.get_buffer_size(&in->common);
+        buf = calloc(1, size);
+        in->read(in, buf, size);
+        free(buf);
+        return &in->common;
+    }
+    config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+    if (dev->open_output_stream(dev, i + 1, AUDIO_DEVICE_OUT_SPEAKER, streams[i].flags,
+                                &config, &out, "") != 0)
+        return NULL;
+    size = out->common.get_buffer_size(&out->common);
+    buf = calloc(1, size);
+    out->write(out, buf, size);
+    free(buf);
+    return &out->common;
+}
+
+static void close_stream(struct audio_hw_device *dev, int i, struct audio_stream *stream)
+{
+    if (streams[i].input)
+        dev->close_input_stream(dev, (struct audio_stream_in *)stream);
+    else
+        dev->close_output_stream(dev, (struct audio_stream_out *)stream);
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* adev->lock hold time of each switch of 'stream', sorted */
+static void time_switches(struct audio_stream *stream, double *hold_ns)
+{
+    char kvpairs[32];
+    int i;
+
+    timed_thread = pthread_self();
+    stubbed = true;
+    for (i = 0; i < 2 * SWITCHES; i++) {
+        snprintf(kvpairs, sizeof(kvpairs), "%s=%d", AUDIO_PARAMETER_STREAM_ROUTING,
+                 i % 2 ? AUDIO_DEVICE_OUT_SPEAKER : AUDIO_DEVICE_OUT_WIRED_HEADPHONE);
+        held_ns = 0;
+        stream->set_parameters(stream, kvpairs);
+        hold_ns[i] = held_ns;
+    }
+    stubbed = false;
+    qsort(hold_ns, 2 * SWITCHES, sizeof(hold_ns[0]), compare_double);
+}
+
+static int bench_switches(void)
+{
+    struct audio_stream *started[NUM_STREAMS];
+    static double hold_ns[2 * SWITCHES];
+    struct audio_hw_device *dev;
+    double sum;
+    int i, j, active = 0;
+
+    dev = open_device();
+    if (dev == NULL)
+        return -1;
+    timed_lock = &((struct audio_device *)dev)->lock;
+
+    for (i = 0; i < (int)NUM_STREAMS; i++) {
+        started[i] = start_stream(dev, i);
+        if (started[i] == NULL) {
+            if (i == 0) {
+                fprintf(stderr, "can not start the low latency output\n");
+                break;
+            }
+            printf("stream %d did not start, skipped\n", i);
+            continue;
+        }
+        active++;
+
+        time_switches(started[0], hold_ns);
+        for (j = 0, sum = 0; j < 2 * SWITCHES; j++)
+            sum += hold_ns[j];
+        printf("%d streams active: adev->lock held %.1f us mean, %.1f us p50, "
+               "%.1f us p99, %.1f us max per switch\n", active,
+               sum / (2 * SWITCHES) / 1000, hold_ns[SWITCHES] / 1000,
+               hold_ns[2 * SWITCHES * 99 / 100] / 1000, hold_ns[2 * SWITCHES - 1] / 1000);
+    }
+    timed_lock = NULL;
+
+    while (i-- > 0) {
+        if (started[i] != NULL)
+            close_stream(dev, i, started[i]);
+    }
+    dev->common.close(&dev->common);
+    return active ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long count = DEFAULT_LOOKUPS;
+    char path[PATH_MAX];
+
+    if (argc > 1)
+        count = strtoul(argv[1], NULL, 0);
+    if (argc > 2)
+        snprintf(path, sizeof(path), "%s", argv[2]);
+    else
+        snprintf(path, sizeof(path), HAL_DIR "audio.primary.%s.so", AUDIO_PLATFORM_NAME);
+    if (load_hal(path) || bench_lookups(count) || bench_switches())
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
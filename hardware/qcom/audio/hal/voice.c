@@ -146,7 +146,7 @@ int voice_stop_usecase(struct audio_device *adev, audio_usecase_t usecase_id)
         ALOGD("%s: unMute voice Tx", __func__);
     }
 
-    list_remove(&uc_info->list);
+    remove_usecase_from_list(adev, uc_info);
     free(uc_info);
 
     ALOGD("%s: exit: status(%d)", __func__, ret);
@@ -173,7 +173,7 @@ int voice_start_usecase(struct audio_device *adev, audio_usecase_t usecase_id)
     uc_info->out_snd_device = SND_DEVICE_NONE;
     adev->use_voice_device_mute = false;
 
-    list_add_tail(&adev->usecase_list, &uc_info->list);
+    add_usecase_to_list(adev, uc_info);
 
     select_devices(adev, usecase_id);
 
@@ -568,6 +568,9 @@ void voice_update_devices_for_all_voice_usecases(struct audio_device *adev)
     struct listnode *node;
     struct audio_usecase *usecase;
 
+    if (adev->usecase_type_cnt[VOICE_CALL] == 0)
+        return;
+
     list_for_each(node, &adev->usecase_list) {
         usecase = node_to_item(node, struct audio_usecase, list);
         if (usecase->type == VOICE_CALL) {
@@ -17,7 +17,8 @@ LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:= \
-	offload_visualizer.c
+	offload_visualizer.c \
+	visualizer_kernels.c
 
 LOCAL_CFLAGS+= -O2 -fvisibility=hidden
 
@@ -45,3 +46,5 @@ LOCAL_C_INCLUDES := \
 
 LOCAL_HEADER_LIBRARIES += libsystem_headers
 include $(BUILD_SHARED_LIBRARY)
+
+include $(LOCAL_PATH)/tests/Android.mk
@@ -32,6 +32,8 @@
 #include <tinyalsa/asoundlib.h>
 #include <audio_effects/effect_visualizer.h>
 
+#include "visualizer_kernels.h"
+
 #define LIB_ACDB_LOADER "libacdbloader.so"
 #define ACDB_DEV_TYPE_OUT 1
 #define AFE_PROXY_ACDB_ID 45
@@ -731,24 +733,24 @@ int visualizer_process(effect_context_t *context,
         return -EINVAL;
     }
 
+    const uint32_t frames = inBuffer->frameCount;
+    const uint32_t meas_count = frames * visu_ctxt->channel_count;
+    const bool measure = visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS;
+    const bool normalize = visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED;
+    sample_scan_t scan;
+
+    /* one pass serves both when the measured and captured samples are the same */
+    if (measure || normalize)
+        scan_samples(inBuffer->s16, measure ? meas_count : frames * 2, &scan);
+
     // perform measurements if needed
-    if (visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS) {
-        // find the peak and RMS squared for the new buffer
-        uint32_t inIdx;
-        int16_t max_sample = 0;
-        float rms_squared_acc = 0;
-        for (inIdx = 0 ; inIdx < inBuffer->frameCount * visu_ctxt->channel_count ; inIdx++) {
-            if (inBuffer->s16[inIdx] > max_sample) {
-                max_sample = inBuffer->s16[inIdx];
-            } else if (-inBuffer->s16[inIdx] > max_sample) {
-                max_sample = -inBuffer->s16[inIdx];
-            }
-            rms_squared_acc += (inBuffer->s16[inIdx] * inBuffer->s16[inIdx]);
-        }
+    if (measure) {
         // store the measurement
-        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].peak_u16 = (uint16_t)max_sample;
+        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].peak_u16 =
+                scan.min == INT16_MIN ? peak_with_int16_min(inBuffer->s16, meas_count)
+                                      : scan.max_abs;
         visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].rms_squared =
-                rms_squared_acc / (inBuffer->frameCount * visu_ctxt->channel_count);
+                (float)((double)scan.sum_squares / meas_count);
         visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].is_valid = true;
         if (++visu_ctxt->meas_buffer_idx >= visu_ctxt->meas_wndw_size_in_buffers) {
             visu_ctxt->meas_buffer_idx = 0;
@@ -758,18 +760,13 @@ int visualizer_process(effect_context_t *context,
     /* all code below assumes stereo 16 bit PCM output and input */
     int32_t shift;
 
-    if (visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED) {
+    if (normalize) {
         /* derive capture scaling factor from peak value in current buffer
          * this gives more interesting captures for display. */
-        shift = 32;
-        int len = inBuffer->frameCount * 2;
-        int i;
-        for (i = 0; i < len; i++) {
-            int32_t smp = inBuffer->s16[i];
-            if (smp < 0) smp = -smp - 1; /* take care to keep the max negative in range */
-            int32_t clz = __builtin_clz(smp);
-            if (shift > clz) shift = clz;
-        }
+        if (measure && meas_count != frames * 2)
+            scan_samples(inBuffer->s16, frames * 2, &scan);
+        /* negative samples were folded to -smp - 1 to keep the max negative in range */
+        shift = scan.folded_or != 0 ? __builtin_clz(scan.folded_or) : 32;
         /* A maximum amplitude signal will have 17 leading zeros, which we want to
          * translate to a shift of 8 (for converting 16 bit to 8 bit) */
         shift = 25 - shift;
@@ -785,19 +782,21 @@ int visualizer_process(effect_context_t *context,
         shift = 9;
     }
 
-    uint32_t capt_idx;
-    uint32_t in_idx;
-    uint8_t *buf = visu_ctxt->capture_buf;
-    for (in_idx = 0, capt_idx = visu_ctxt->capture_idx;
-         in_idx < inBuffer->frameCount;
-         in_idx++, capt_idx++) {
+    uint32_t capt_idx = visu_ctxt->capture_idx;
+    const int16_t *smp = inBuffer->s16;
+    uint32_t remaining = frames;
+    while (remaining > 0) {
         if (capt_idx >= CAPTURE_BUF_SIZE) {
             /* wrap around */
             capt_idx = 0;
         }
-        int32_t smp = inBuffer->s16[2 * in_idx] + inBuffer->s16[2 * in_idx + 1];
-        smp = smp >> shift;
-        buf[capt_idx] = ((uint8_t)smp)^0x80;
+        uint32_t n = CAPTURE_BUF_SIZE - capt_idx;
+        if (n > remaining)
+            n = remaining;
+        capture_stereo_to_u8(visu_ctxt->capture_buf + capt_idx, smp, n, shift);
+        smp += 2 * n;
+        capt_idx += n;
+        remaining -= n;
     }
 
     /* XXX the following two should really be atomic, though it probably doesn't
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Visualizer kernel microbenchmark. Times a visualizer_process() buffer of
+ * 1024 stereo frames both ways: the old measurement, normalize and capture
+ * loops against one scan plus the capture kernel. Prints CPU cycles per
+ * frame from the perf cycle counter, or nanoseconds per frame where perf
+ * events are not available (perf_event_paranoid).
+ *
+ *   visualizer_kernels_bench [iterations]
+ */
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "visualizer_kernels.h"
+#include "visualizer_kernels_ref.h"
+
+#define DEFAULT_ITERATIONS 10000
+#define FRAMES 1024
+
+/* a size the compiler can not specialize the inlined old loops for */
+static volatile uint32_t frames = FRAMES;
+
+static int cycles_fd = -1;
+
+static void open_cycle_counter(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cycles_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* cycles, or nanoseconds without a cycle counter */
+static uint64_t now(void)
+{
+    struct timespec ts;
+    uint64_t count;
+
+    if (cycles_fd >= 0 && read(cycles_fd, &count, sizeof(count)) == sizeof(count))
+        return count;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const char *mode, uint64_t ref, uint64_t opt, unsigned long iterations)
+{
+    double total = (double)FRAMES * iterations;
+
+    printf("%-22s old loops %6.2f  kernels %6.2f %s per frame  (x%.1f)\n", mode,
+           ref / total, opt / total, cycles_fd >= 0 ? "cycles" : "ns",
+           opt ? (double)ref / opt : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    static int16_t smp[2 * FRAMES];
+    static uint8_t capture[FRAMES];
+    unsigned long iterations = DEFAULT_ITERATIONS;
+    unsigned long i;
+    uint64_t t0, t1, t2;
+    sample_scan_t scan;
+    uint16_t peak = 0;
+    float rms = 0;
+    int32_t shift = 0;
+
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 0);
+    if (iterations == 0)
+        return EXIT_FAILURE;
+    for (i = 0; i < 2 * FRAMES; i++)
+        smp[i] = (int16_t)(i * 7919);
+    open_cycle_counter();
+    if (cycles_fd < 0)
+        printf("no cycle counter, timing in ns\n");
+
+    /* measurement on, normalized capture: the most work per buffer */
+    t0 = now();
+    for (i = 0; i < iterations; i++) {
+        ref_measure(smp, 2 * frames, &peak, &rms);
+        shift = ref_normalize_shift(smp, frames);
+        ref_capture(capture, smp, frames, shift);
+    }
+    t1 = now();
+    for (i = 0; i < iterations; i++) {
+        scan_samples(smp, 2 * frames, &scan);
+        peak = scan.min == INT16_MIN ? peak_with_int16_min(smp, 2 * frames) : scan.max_abs;
+        shift = 25 - (scan.folded_or ? __builtin_clz(scan.folded_or) : 32);
+        capture_stereo_to_u8(capture, smp, frames, (shift < 3 ? 3 : shift) + 1);
+    }
+    t2 = now();
+    report("measure + normalized", t1 - t0, t2 - t1, iterations);
+
+    /* the default: capture as played only */
+    t0 = now();
+    for (i = 0; i < iterations; i++)
+        ref_capture(capture, smp, frames, 9);
+    t1 = now();
+    for (i = 0; i < iterations; i++)
+        capture_stereo_to_u8(capture, smp, frames, 9);
+    t2 = now();
+    report("as played", t1 - t0, t2 - t1, iterations);
+
+    /* keep the results live */
+    printf("peak %u shift %d capture[0] %u\n", peak, shift, capture[0]);
+
+    if (cycles_fd >= 0)
+        close(cycles_fd);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VISUALIZER_KERNELS_REF_H
+#define VISUALIZER_KERNELS_REF_H
+
+#include <stdint.h>
+
+/*
+ * The loops visualizer_process() ran before visualizer_kernels.c, kept as the
+ * scalar reference for its tests.
+ */
+
+/* peak and float RMS squared, as measured for MEASUREMENT_MODE_PEAK_RMS */
+static inline void ref_measure(const int16_t *s16, uint32_t count, uint16_t *peak,
+                               float *rms_squared)
+{
+    uint32_t inIdx;
+    int16_t max_sample = 0;
+    float rms_squared_acc = 0;
+    for (inIdx = 0 ; inIdx < count ; inIdx++) {
+        if (s16[inIdx] > max_sample) {
+            max_sample = s16[inIdx];
+        } else if (-s16[inIdx] > max_sample) {
+            max_sample = -s16[inIdx];
+        }
+        rms_squared_acc += (s16[inIdx] * s16[inIdx]);
+    }
+    *peak = (uint16_t)max_sample;
+    *rms_squared = rms_squared_acc / count;
+}
+
+/* capture shift for VISUALIZER_SCALING_MODE_NORMALIZED */
+static inline int32_t ref_normalize_shift(const int16_t *s16, uint32_t frames)
+{
+    int32_t shift = 32;
+    int len = frames * 2;
+    int i;
+    for (i = 0; i < len; i++) {
+        int32_t smp = s16[i];
+        if (smp < 0) smp = -smp - 1; /* take care to keep the max negative in range */
+        /* __builtin_clz(0) is undefined, ARM clz returns 32 */
+        int32_t clz = smp ? __builtin_clz(smp) : 32;
+        if (shift > clz) shift = clz;
+    }
+    shift = 25 - shift;
+    if (shift < 3) {
+        shift = 3;
+    }
+    shift++;
+    return shift;
+}
+
+static inline void ref_capture(uint8_t *buf, const int16_t *s16, uint32_t frames,
+                               int32_t shift)
+{
+    uint32_t in_idx;
+    for (in_idx = 0; in_idx < frames; in_idx++) {
+        int32_t smp = s16[2 * in_idx] + s16[2 * in_idx + 1];
+        smp = smp >> shift;
+        buf[in_idx] = ((uint8_t)smp)^0x80;
+    }
+}
+
+#endif /* VISUALIZER_KERNELS_REF_H */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the visualizer kernels against the loops visualizer_process() ran
+ * before them. For every length up to a few vector blocks and for odd buffer
+ * sizes, on random, quiet, silent and INT16_MIN holding buffers:
+ *  - the peak, the exact sum of squares and the normalize shift derived from
+ *    one scan match the old measurement and shift loops;
+ *  - the capture bytes match the old capture loop for every shift, and
+ *    nothing past the last frame is written.
+ * The old RMS was summed in a float; the exact one must stay within that
+ * accumulator's rounding error. Built for a NEON target this compares the
+ * NEON paths, otherwise the C fallbacks.
+ *
+ *   visualizer_kernels_test
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "visualizer_kernels.h"
+#include "visualizer_kernels_ref.h"
+
+#define MAX_FRAMES 4801
+#define SHORT_LENGTHS 40
+
+static const uint32_t long_lengths[] = { 63, 64, 65, 127, 479, 480, 481, 1023, 1024, 4801 };
+
+enum { RANDOM, QUIET, SILENT, WITH_INT16_MIN, NUM_KINDS };
+static const char *kind_names[] = { "random", "quiet", "silent", "INT16_MIN" };
+
+static int failures;
+static uint32_t seed = 1;
+
+static uint32_t next_random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static void fill(int16_t *smp, uint32_t count, int kind)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        switch (kind) {
+        case RANDOM: smp[i] = (int16_t)next_random(); break;
+        case QUIET: smp[i] = (int16_t)(next_random() % 64) - 32; break;
+        case SILENT: smp[i] = 0; break;
+        default: smp[i] = next_random() % 16 ? (int16_t)next_random() : INT16_MIN; break;
+        }
+    }
+}
+
+static void fail(const char *what, uint32_t frames, int kind)
+{
+    printf("%s: %u frames of %s samples differs from the old loop\n",
+           what, frames, kind_names[kind]);
+    failures++;
+}
+
+/* the shift visualizer_process() derives from the scan */
+static int32_t scan_shift(const sample_scan_t *scan)
+{
+    int32_t shift = scan->folded_or != 0 ? __builtin_clz(scan->folded_or) : 32;
+
+    shift = 25 - shift;
+    if (shift < 3)
+        shift = 3;
+    return shift + 1;
+}
+
+static void test_length(uint32_t frames, int kind)
+{
+    static int16_t smp[2 * MAX_FRAMES];
+    static uint8_t capture[2][MAX_FRAMES + 16];
+    uint32_t count = 2 * frames, i;
+    sample_scan_t scan;
+    uint64_t sum_squares = 0;
+    uint16_t peak, ref_peak;
+    float ref_rms;
+    int32_t shift;
+
+    fill(smp, count, kind);
+    scan_samples(smp, count, &scan);
+
+    for (i = 0; i < count; i++)
+        sum_squares += (uint32_t)(smp[i] * smp[i]);
+    if (scan.sum_squares != sum_squares)
+        fail("sum of squares", frames, kind);
+
+    if (frames > 0) {
+        ref_measure(smp, count, &ref_peak, &ref_rms);
+        peak = scan.min == INT16_MIN ? peak_with_int16_min(smp, count) : scan.max_abs;
+        if (peak != ref_peak)
+            fail("peak", frames, kind);
+        /* each float add rounds by at most 2^-24 of the running sum */
+        if (fabs((double)scan.sum_squares / count - ref_rms) >
+                (double)scan.sum_squares / count * count * 0x1p-24 + 1e-6)
+            fail("rms", frames, kind);
+    }
+
+    if (scan_shift(&scan) != ref_normalize_shift(smp, frames))
+        fail("normalize shift", frames, kind);
+
+    /* as played is 9, normalized 4 to 9 */
+    for (shift = 4; shift <= 9; shift++) {
+        memset(capture[0], 0x5a, sizeof(capture[0]));
+        memset(capture[1], 0x5a, sizeof(capture[1]));
+        ref_capture(capture[0], smp, frames, shift);
+        capture_stereo_to_u8(capture[1], smp, frames, shift);
+        if (memcmp(capture[0], capture[1], sizeof(capture[0])))
+            fail("capture", frames, kind);
+    }
+}
+
+int main(void)
+{
+    uint32_t frames, i;
+    int kind;
+
+    for (kind = 0; kind < NUM_KINDS; kind++) {
+        for (frames = 0; frames < SHORT_LENGTHS; frames++)
+            test_length(frames, kind);
+        for (i = 0; i < sizeof(long_lengths) / sizeof(long_lengths[0]); i++)
+            test_length(long_lengths[i], kind);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VISUALIZER_NEON
+#endif
+
+#include "visualizer_kernels.h"
+
+void scan_samples(const int16_t *smp, uint32_t count, sample_scan_t *scan)
+{
+    uint32_t i = 0;
+    int32_t min = 0;
+    int32_t max_abs = 0;
+    uint32_t folded_or = 0;
+    uint64_t sum_squares = 0;
+
+#ifdef VISUALIZER_NEON
+    if (count >= 8) {
+        int16x8_t v_min = vdupq_n_s16(0);
+        int16x8_t v_max = vdupq_n_s16(0);
+        int16x8_t v_or = vdupq_n_s16(0);
+        int64x2_t v_sum = vdupq_n_s64(0);
+        int16_t lanes_min[8], lanes_max[8], lanes_or[8];
+        int64_t lanes_sum[2];
+        int j;
+
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t s = vld1q_s16(smp + i);
+            int16x4_t lo = vget_low_s16(s);
+            int16x4_t hi = vget_high_s16(s);
+
+            v_min = vminq_s16(v_min, s);
+            v_max = vmaxq_s16(v_max, vqabsq_s16(s));
+            v_or = vorrq_s16(v_or, veorq_s16(s, vshrq_n_s16(s, 15)));
+            /* each square is at most 2^30, so pairs fit before widening */
+            v_sum = vpadalq_s32(v_sum, vmull_s16(lo, lo));
+            v_sum = vpadalq_s32(v_sum, vmull_s16(hi, hi));
+        }
+        vst1q_s16(lanes_min, v_min);
+        vst1q_s16(lanes_max, v_max);
+        vst1q_s16(lanes_or, v_or);
+        vst1q_s64(lanes_sum, v_sum);
+        for (j = 0; j < 8; j++) {
+            if (lanes_min[j] < min)
+                min = lanes_min[j];
+            if (lanes_max[j] > max_abs)
+                max_abs = lanes_max[j];
+            folded_or |= (uint16_t)lanes_or[j];
+        }
+        sum_squares = lanes_sum[0] + lanes_sum[1];
+    }
+#endif
+    for (; i < count; i++) {
+        int32_t s = smp[i];
+        int32_t mag = s < 0 ? -s : s;
+
+        if (s < min)
+            min = s;
+        if (mag > INT16_MAX)
+            mag = INT16_MAX;
+        if (mag > max_abs)
+            max_abs = mag;
+        folded_or |= s < 0 ? -s - 1 : s;
+        sum_squares += (uint32_t)(s * s);
+    }
+
+    scan->min = min;
+    scan->max_abs = max_abs;
+    scan->folded_or = folded_or;
+    scan->sum_squares = sum_squares;
+}
+
+uint16_t peak_with_int16_min(const int16_t *smp, uint32_t count)
+{
+    int16_t max_sample = 0;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        if (smp[i] > max_sample) {
+            max_sample = smp[i];
+        } else if (-smp[i] > max_sample) {
+            max_sample = -smp[i];
+        }
+    }
+    return (uint16_t)max_sample;
+}
+
+void capture_stereo_to_u8(uint8_t *buf, const int16_t *smp, uint32_t frames,
+                          int32_t shift)
+{
+    uint32_t i = 0;
+
+#ifdef VISUALIZER_NEON
+    /* (l + r) >> shift == ((l + r) >> 1) >> (shift - 1), and the halving add
+     * keeps the first step in 16 bits */
+    const int16x8_t v_shift = vdupq_n_s16(-(shift - 1));
+    const uint8x8_t v_bias = vdup_n_u8(0x80);
+
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t lr = vld2q_s16(smp + 2 * i);
+        int16x8_t sum = vshlq_s16(vhaddq_s16(lr.val[0], lr.val[1]), v_shift);
+        vst1_u8(buf + i, veor_u8(vreinterpret_u8_s8(vmovn_s16(sum)), v_bias));
+    }
+#endif
+    for (; i < frames; i++) {
+        int32_t s = smp[2 * i] + smp[2 * i + 1];
+        buf[i] = ((uint8_t)(s >> shift)) ^ 0x80;
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VISUALIZER_KERNELS_H
+#define VISUALIZER_KERNELS_H
+
+#include <stdint.h>
+
+/*
+ * Per-buffer sample loops of visualizer_process(). Each has a NEON
+ * implementation when the target supports it and a plain C one otherwise;
+ * both produce identical output.
+ */
+
+/* Sample statistics of a buffer, gathered by scan_samples() in a single pass */
+typedef struct sample_scan_s {
+    int16_t min;            /* smallest sample, or 0 */
+    uint16_t max_abs;       /* largest magnitude, INT16_MIN counted as 32767 */
+    uint32_t folded_or;     /* OR of (smp < 0 ? -smp - 1 : smp), sets the normalize shift */
+    uint64_t sum_squares;   /* exact, unlike a float accumulator */
+} sample_scan_t;
+
+void scan_samples(const int16_t *smp, uint32_t count, sample_scan_t *scan);
+
+/*
+ * Peak as historically reported. Its int16_t running maximum wraps on
+ * INT16_MIN, so buffers holding that sample keep the original sequential
+ * loop to report the same value.
+ */
+uint16_t peak_with_int16_min(const int16_t *smp, uint32_t count);
+
+/* buf[i] = (uint8_t)((smp[2i] + smp[2i + 1]) >> shift) ^ 0x80, shift >= 1 */
+void capture_stereo_to_u8(uint8_t *buf, const int16_t *smp, uint32_t frames,
+                          int32_t shift);
+
+#endif /* VISUALIZER_KERNELS_H */
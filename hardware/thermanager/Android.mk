@@ -18,11 +18,15 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES := \
 	src/configuration.c \
+	src/forecast.c \
 	src/control.c \
 	src/mitigation.c \
+	src/pid.c \
 	src/resource.c \
+	src/telemetry.c \
 	src/threshold.c \
 	src/dom.c \
+	src/bindom.c \
 	src/libxml2parser.c \
 	src/watch.c \
 	src/thermal_zone.c \
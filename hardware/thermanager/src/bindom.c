@@ -0,0 +1,285 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "dom.h"
+
+/*
+ * Precompiled DOM image, written by 'thermanager --compile'.  Objects are
+ * stored in pre-order and refer to their parent and attributes by index,
+ * all strings live in a trailing pool and are referenced by offset.
+ */
+#define BINDOM_MAGIC "TMDOM\0\0\1"
+#define BINDOM_NONE 0xffffffffU
+
+typedef unsigned int u32;
+
+struct bindom_header {
+	char magic[8];
+	u32 nobjs;
+	u32 nattrs;
+	u32 strings_size;
+};
+
+struct bindom_obj {
+	u32 name;
+	u32 content;
+	u32 parent;
+	u32 first_attr;
+	u32 nattrs;
+};
+
+struct bindom_attr {
+	u32 name;
+	u32 value;
+};
+
+struct bindom_writer {
+	struct bindom_obj *objs;
+	struct bindom_attr *attrs;
+	char *strings;
+	u32 nobjs;
+	u32 nattrs;
+	u32 strings_size;
+};
+
+#define STR2ARRAY(_array, _string) \
+  do { \
+    strncpy(_array, _string, sizeof(_array)); \
+    _array[sizeof(_array) - 1] = 0; \
+  } while (0)
+
+int bindom_probe(const char *path)
+{
+	char magic[sizeof(BINDOM_MAGIC) - 1];
+	int fd;
+	int rc;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return 0;
+	rc = read(fd, magic, sizeof(magic));
+	close(fd);
+
+	return rc == sizeof(magic) && !memcmp(magic, BINDOM_MAGIC, sizeof(magic));
+}
+
+static void bindom_count(const struct dom_obj *obj, struct bindom_writer *w)
+{
+	const struct list_node *node;
+	const struct dom_attr *attr;
+
+	w->nobjs++;
+	w->strings_size += strlen(obj->name) + 1;
+	if (obj->content)
+		w->strings_size += strlen(obj->content) + 1;
+
+	for_list_node(&obj->attributes, node) {
+		attr = list_entry(node, const struct dom_attr, list_node);
+		w->nattrs++;
+		w->strings_size += strlen(attr->name) + strlen(attr->value) + 2;
+	}
+
+	for_list_node(&obj->children, node)
+		bindom_count(list_entry(node, const struct dom_obj, list_node), w);
+}
+
+static u32 bindom_add_string(struct bindom_writer *w, const char *str)
+{
+	u32 offset = w->strings_size;
+	size_t len = strlen(str) + 1;
+
+	memcpy(w->strings + offset, str, len);
+	w->strings_size += len;
+
+	return offset;
+}
+
+static void bindom_fill(const struct dom_obj *obj, u32 parent,
+		struct bindom_writer *w)
+{
+	const struct list_node *node;
+	const struct dom_attr *attr;
+	struct bindom_obj *bobj;
+	u32 idx;
+
+	idx = w->nobjs++;
+	bobj = &w->objs[idx];
+	bobj->name = bindom_add_string(w, obj->name);
+	bobj->content = obj->content ?
+			bindom_add_string(w, obj->content) : BINDOM_NONE;
+	bobj->parent = parent;
+	bobj->first_attr = w->nattrs;
+	bobj->nattrs = 0;
+
+	for_list_node(&obj->attributes, node) {
+		attr = list_entry(node, const struct dom_attr, list_node);
+		w->attrs[w->nattrs].name = bindom_add_string(w, attr->name);
+		w->attrs[w->nattrs].value = bindom_add_string(w, attr->value);
+		w->nattrs++;
+		bobj->nattrs++;
+	}
+
+	for_list_node(&obj->children, node)
+		bindom_fill(list_entry(node, const struct dom_obj, list_node),
+				idx, w);
+}
+
+int bindom_savedom(const struct dom_obj *root, const char *path)
+{
+	struct bindom_header hdr;
+	struct bindom_writer w;
+	FILE *fp;
+	int rc;
+
+	memset(&w, 0, sizeof(w));
+	bindom_count(root, &w);
+
+	w.objs = calloc(w.nobjs, sizeof(w.objs[0]));
+	w.attrs = calloc(w.nattrs ? w.nattrs : 1, sizeof(w.attrs[0]));
+	w.strings = malloc(w.strings_size ? w.strings_size : 1);
+	if (w.objs == NULL || w.attrs == NULL || w.strings == NULL) {
+		rc = -1;
+		goto out;
+	}
+
+	w.nobjs = w.nattrs = w.strings_size = 0;
+	bindom_fill(root, BINDOM_NONE, &w);
+
+	memcpy(hdr.magic, BINDOM_MAGIC, sizeof(hdr.magic));
+	hdr.nobjs = w.nobjs;
+	hdr.nattrs = w.nattrs;
+	hdr.strings_size = w.strings_size;
+
+	rc = -1;
+	fp = fopen(path, "wb");
+	if (fp == NULL)
+		goto out;
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+			fwrite(w.objs, sizeof(w.objs[0]), w.nobjs, fp) == w.nobjs &&
+			fwrite(w.attrs, sizeof(w.attrs[0]), w.nattrs, fp) == w.nattrs &&
+			fwrite(w.strings, 1, w.strings_size, fp) == w.strings_size)
+		rc = 0;
+	if (fclose(fp))
+		rc = -1;
+
+out:
+	free(w.objs);
+	free(w.attrs);
+	free(w.strings);
+	return rc;
+}
+
+static int bindom_valid_string(const struct bindom_header *hdr,
+		const char *strings, u32 offset)
+{
+	return offset < hdr->strings_size &&
+			memchr(strings + offset, 0, hdr->strings_size - offset);
+}
+
+struct dom_obj *bindom_loaddom(const char *path)
+{
+	const struct bindom_header *hdr;
+	const struct bindom_attr *battrs;
+	const struct bindom_obj *bobjs;
+	struct dom_obj **objs = NULL;
+	struct dom_obj *root = NULL;
+	const char *strings;
+	struct stat st;
+	size_t size;
+	void *map;
+	u32 i, j;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof(*hdr)) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	hdr = (const struct bindom_header *)map;
+	size = sizeof(*hdr) + (size_t)hdr->nobjs * sizeof(*bobjs) +
+			(size_t)hdr->nattrs * sizeof(*battrs) + hdr->strings_size;
+	if (memcmp(hdr->magic, BINDOM_MAGIC, sizeof(hdr->magic)) ||
+			hdr->nobjs == 0 || size != (size_t)st.st_size) {
+		LOGE("invalid precompiled configuration \"%s\"\n", path);
+		goto out;
+	}
+	bobjs = (const struct bindom_obj *)(hdr + 1);
+	battrs = (const struct bindom_attr *)(bobjs + hdr->nobjs);
+	strings = (const char *)(battrs + hdr->nattrs);
+
+	objs = calloc(hdr->nobjs, sizeof(objs[0]));
+	if (objs == NULL)
+		goto out;
+
+	for (i = 0; i < hdr->nobjs; ++i) {
+		const struct bindom_obj *bobj = &bobjs[i];
+		struct dom_obj *obj;
+
+		if (!bindom_valid_string(hdr, strings, bobj->name) ||
+				(bobj->content != BINDOM_NONE &&
+				 !bindom_valid_string(hdr, strings, bobj->content)) ||
+				(i == 0) != (bobj->parent == BINDOM_NONE) ||
+				(i != 0 && bobj->parent >= i) ||
+				bobj->first_attr > hdr->nattrs ||
+				bobj->nattrs > hdr->nattrs - bobj->first_attr) {
+			LOGE("corrupt object %u in \"%s\"\n", i, path);
+			goto err;
+		}
+
+		obj = calloc(1, sizeof(*obj));
+		if (obj == NULL)
+			goto err;
+		objs[i] = obj;
+		list_init(&obj->children);
+		list_init(&obj->attributes);
+
+		/* pre-order, so appending keeps the children in order */
+		if (i != 0)
+			list_append(&objs[bobj->parent]->children, &obj->list_node);
+
+		STR2ARRAY(obj->name, strings + bobj->name);
+		if (bobj->content != BINDOM_NONE)
+			obj->content = strdup(strings + bobj->content);
+
+		for (j = bobj->first_attr; j < bobj->first_attr + bobj->nattrs; ++j) {
+			struct dom_attr *attr;
+
+			if (!bindom_valid_string(hdr, strings, battrs[j].name) ||
+					!bindom_valid_string(hdr, strings, battrs[j].value)) {
+				LOGE("corrupt attribute %u in \"%s\"\n", j, path);
+				goto err;
+			}
+			attr = calloc(1, sizeof(*attr));
+			if (attr == NULL)
+				goto err;
+			STR2ARRAY(attr->name, strings + battrs[j].name);
+			STR2ARRAY(attr->value, strings + battrs[j].value);
+			list_append(&obj->attributes, &attr->list_node);
+		}
+	}
+
+	root = objs[0];
+	goto out;
+
+err:
+	/* the tree is linked as it is built, freeing the root frees it all */
+	if (objs[0] != NULL)
+		dom_obj_destroy(objs[0]);
+out:
+	free(objs);
+	munmap(map, st.st_size);
+	return root;
+}
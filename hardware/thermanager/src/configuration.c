@@ -1,10 +1,17 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <stdio.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
 
 #include "log.h"
+#include "util.h"
 #include "watch.h"
 #include "configuration.h"
+#include "pid.h"
+#include "telemetry.h"
 
 static LIST(g_configuration_manager_list);
 
@@ -15,17 +22,96 @@ void configuration_manager_add(struct configuration *cfg)
 
 static void configuration_run(struct configuration *cfg, int value);
 
-void configuration_manager_run(void)
+#define WAKEUP_REPORT_PERIOD 3600
+
+static void configuration_report_wakeups(void)
 {
-	struct configuration *cfg;
-	struct list_node *node;
-	struct watch *watch;
+	static unsigned long last_wakeups;
+	static time_t last_report;
+	struct timespec ts;
+	unsigned long wakeups;
 
-	if (list_first(&g_configuration_manager_list) == NULL) {
-		LOGE("no configurations to run, exiting\n");
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	if (last_report == 0)
+		last_report = ts.tv_sec;
+	if (ts.tv_sec - last_report < WAKEUP_REPORT_PERIOD)
 		return;
+
+	wakeups = watch_manager_wakeups();
+	LOGI("%lu wakeups in the last %ld seconds\n", wakeups - last_wakeups,
+			(long)(ts.tv_sec - last_report));
+	last_wakeups = wakeups;
+	last_report = ts.tv_sec;
+}
+
+static int g_configuration_reload_pending;
+static int g_configuration_signal_fd = -1;
+
+/*
+ * SIGHUP is blocked and read from a signalfd in the watch, so a reload
+ * request wakes the loop like any other event instead of racing the
+ * check before the wait.
+ */
+static void configuration_signal_cb(void *data __attribute__ ((__unused__)),
+		struct watch_ticket *ticket)
+{
+	struct signalfd_siginfo si;
+
+	watch_ticket_clear(ticket);
+
+	while (read(g_configuration_signal_fd, &si, sizeof(si)) == sizeof(si)) {
+		if (si.ssi_signo == SIGHUP)
+			g_configuration_reload_pending = 1;
+	}
+}
+
+static struct watch_ticket *configuration_signal_start(void)
+{
+	struct watch_ticket *ticket;
+	sigset_t mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGHUP);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL))
+		return NULL;
+
+	g_configuration_signal_fd = signalfd(-1, &mask,
+			SFD_NONBLOCK | SFD_CLOEXEC);
+	if (g_configuration_signal_fd == -1) {
+		LOGE("failed to open signalfd, reload disabled\n");
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+		return NULL;
 	}
 
+	ticket = watch_manager_add_input(g_configuration_signal_fd);
+	if (ticket != NULL)
+		watch_ticket_callback(ticket, configuration_signal_cb, NULL);
+	return ticket;
+}
+
+static void configuration_signal_stop(struct watch_ticket *ticket)
+{
+	if (ticket != NULL)
+		watch_ticket_delete(ticket);
+	if (g_configuration_signal_fd != -1)
+		close(g_configuration_signal_fd);
+	g_configuration_signal_fd = -1;
+}
+
+void configuration_manager_swap(struct list *list)
+{
+	struct list tmp;
+
+	tmp = g_configuration_manager_list;
+	g_configuration_manager_list = *list;
+	*list = tmp;
+}
+
+static void configuration_manager_start(struct watch *watch)
+{
+	struct configuration *cfg;
+	struct list_node *node;
+
 	/* group configurations by sensor */
 	for_list_node(&g_configuration_manager_list, node) {
 		struct configuration *ocfg;
@@ -42,45 +128,95 @@ void configuration_manager_run(void)
 		}
 	}
 
-	watch = watch_create();
-	if (watch == NULL)
-		return;
-	watch_manager_set_watch(watch);
-
 	for_list_node(&g_configuration_manager_list, node) {
 		cfg = list_entry(node, struct configuration, list_node);
 		resource_enable(cfg->sensor);
+		if (cfg->forecast != NULL)
+			cfg->ticket = watch_manager_add_timeout(cfg->interval);
 	}
 
+	pid_manager_enable();
+
 	watch_synchronize(watch);
+}
+
+static void configuration_manager_stop(void)
+{
+	struct configuration *cfg;
+	struct list_node *node;
+
+	for_list_node(&g_configuration_manager_list, node) {
+		cfg = list_entry(node, struct configuration, list_node);
+		resource_disable(cfg->sensor);
+		if (cfg->ticket != NULL) {
+			watch_ticket_delete(cfg->ticket);
+			cfg->ticket = NULL;
+		}
+	}
+
+	pid_manager_disable();
+}
+
+void configuration_manager_run(int (* reload)(void))
+{
+	struct watch_ticket *signal_ticket = NULL;
+	struct configuration *cfg;
+	struct list_node *node;
+	struct watch *watch;
+
+	if (list_first(&g_configuration_manager_list) == NULL &&
+			pid_manager_empty()) {
+		LOGE("no configurations to run, exiting\n");
+		return;
+	}
+
+	watch = watch_create();
+	if (watch == NULL)
+		return;
+	watch_manager_set_watch(watch);
+
+	telemetry_start();
+	if (reload != NULL)
+		signal_ticket = configuration_signal_start();
+	configuration_manager_start(watch);
 
 	for (;;) {
 		struct resource *res = NULL;
-		char buf[32];
 		int value;
 		int rc;
 
-		rc = value = 0;
+		/*
+		 * The watch survives a reload.  Stopping drops the tickets of
+		 * the sensors, starting the new configuration adds them back.
+		 */
+		if (g_configuration_reload_pending) {
+			g_configuration_reload_pending = 0;
+			configuration_manager_stop();
+			reload();
+			configuration_manager_start(watch);
+		}
+
+		rc = -1;
+		value = 0;
 		for_list_node(&g_configuration_manager_list, node) {
 			cfg = list_entry(node, struct configuration, list_node);
 			if (cfg->sensor != res) {
 				res = cfg->sensor;
-				rc = resource_read_value(cfg->sensor, buf, sizeof(buf));
-				if (rc > 0) {
-					buf[rc] = 0;
-					value = strtol(buf, 0, 0);
-				}
+				rc = resource_sample(cfg->sensor, &value);
+				if (rc == 0)
+					telemetry_record(TELEMETRY_SAMPLE,
+							res->name, value, 0);
 			}
-			if (rc > 0)
+			if (rc == 0)
 				configuration_run(cfg, value);
 		}
 		watch_manager_wait();
+		configuration_report_wakeups();
 	}
 
-	for_list_node(&g_configuration_manager_list, node) {
-		cfg = list_entry(node, struct configuration, list_node);
-		resource_disable(cfg->sensor);
-	}
+	configuration_manager_stop();
+	configuration_signal_stop(signal_ticket);
+	telemetry_stop();
 
 	watch_manager_set_watch(NULL);
 	watch_destroy(watch);
@@ -99,6 +235,7 @@ struct configuration *configuration_create(const char *sensor)
 		free(cfg);
 		return NULL;
 	}
+	cfg->sensor = resource_resolve(cfg->sensor);
 	cfg->last_value = -1;
 
 	list_init(&cfg->unsatisfied);
@@ -120,9 +257,27 @@ void configuration_destroy(struct configuration *cfg)
 		threshold_destroy(t);
 	}
 
+	if (cfg->forecast != NULL)
+		forecast_destroy(cfg->forecast);
 	free(cfg);
 }
 
+int configuration_set_predictive(struct configuration *cfg,
+		unsigned int horizon, unsigned int interval, unsigned int samples)
+{
+	if (cfg->forecast != NULL)
+		forecast_destroy(cfg->forecast);
+
+	cfg->forecast = forecast_create(samples);
+	if (cfg->forecast == NULL)
+		return -1;
+
+	cfg->horizon = horizon;
+	cfg->interval = interval;
+
+	return 0;
+}
+
 int configuration_add_threshold(struct configuration *cfg, struct threshold *n)
 {
 	struct list_node *node;
@@ -154,6 +309,30 @@ static void configuration_run(struct configuration *cfg, int value)
 	low_edge = INT_MIN;
 	high_edge = INT_MAX;
 
+	/*
+	 * In predictive mode thresholds are evaluated against the temperature
+	 * forecast 'horizon' ms ahead, so mitigation starts once the sensor is
+	 * on course to hit a trigger and is held until the trend reverses.
+	 */
+	if (cfg->forecast != NULL) {
+		unsigned long long now = util_time_ms();
+		int fired;
+
+		/*
+		 * The loop also wakes up for unrelated tickets, only feed the
+		 * fit on the interval tick or once a full interval has passed.
+		 */
+		fired = cfg->ticket != NULL && !watch_ticket_clear(cfg->ticket);
+		if (fired || forecast_sample_due(cfg->forecast, now,
+				cfg->interval)) {
+			forecast_add_sample(cfg->forecast, now, value);
+			cfg->predicted_valid = !forecast_value(cfg->forecast,
+					cfg->horizon, &cfg->predicted);
+		}
+		if (cfg->predicted_valid && cfg->predicted > value)
+			value = cfg->predicted;
+	}
+
 	if (value == cfg->last_value) {
 		return;
 	} else if (value > cfg->last_value) {
@@ -179,6 +358,8 @@ static void configuration_run(struct configuration *cfg, int value)
 	if (node != NULL) {
 		t = list_entry(node, struct threshold, list_node);
 		if (cfg->current != t) {
+			telemetry_record(TELEMETRY_THRESHOLD, cfg->sensor->name,
+					t->trigger, value);
 			threshold_activate(t);
 			if (cfg->current != NULL)
 				threshold_deactivate(cfg->current);
@@ -3,11 +3,22 @@
 
 #include "resource.h"
 #include "threshold.h"
+#include "forecast.h"
+#include "watch.h"
 #include "list.h"
 
 struct configuration {
 	int last_value;
 	struct resource *sensor;
+
+	/* predictive mode, NULL forecast when purely reactive */
+	struct forecast *forecast;
+	unsigned int horizon;
+	unsigned int interval;
+	struct watch_ticket *ticket;
+	int predicted;
+	int predicted_valid;
+
 	struct threshold *current;
 	struct list unsatisfied;
 	struct list satisfied;
@@ -15,10 +26,13 @@ struct configuration {
 };
 
 void configuration_manager_add(struct configuration *cfg);
-void configuration_manager_run(void);
+void configuration_manager_run(int (* reload)(void));
+void configuration_manager_swap(struct list *list);
 
 struct configuration *configuration_create(const char *sensor);
 void configuration_destroy(struct configuration *cfg);
 int configuration_add_threshold(struct configuration *cfg, struct threshold *n);
+int configuration_set_predictive(struct configuration *cfg,
+		unsigned int horizon, unsigned int interval, unsigned int samples);
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "log.h"
 #include "control.h"
+#include "telemetry.h"
 
 struct mitigation_level {
 	struct mitigation *mitigation;
@@ -12,6 +13,8 @@ struct mitigation_level {
 
 static LIST(g_control_manager_list);
 
+static void control_update_level(struct control *ctrl);
+
 struct control *control_manager_find(const char *name)
 {
 	struct list_node *node;
@@ -35,6 +38,63 @@ void control_manager_remove(struct control *ctrl)
 	list_remove(&g_control_manager_list, &ctrl->list_node);
 }
 
+void control_manager_swap(struct list *list)
+{
+	struct list tmp;
+
+	tmp = g_control_manager_list;
+	g_control_manager_list = *list;
+	*list = tmp;
+}
+
+static int control_same_levels(struct control *a, struct control *b)
+{
+	struct mitigation_level *la;
+	struct mitigation_level *lb;
+	struct list_node *na;
+	struct list_node *nb;
+
+	na = list_first(&a->mitigation_levels);
+	nb = list_first(&b->mitigation_levels);
+	while (na != NULL && nb != NULL) {
+		la = list_entry(na, struct mitigation_level, list_node);
+		lb = list_entry(nb, struct mitigation_level, list_node);
+		if (!mitigation_equal(la->mitigation, lb->mitigation))
+			return 0;
+		na = na->next;
+		nb = nb->next;
+	}
+	return na == NULL && nb == NULL;
+}
+
+/*
+ * Take over the active level of same-named controls from a previous
+ * configuration, so a reload doesn't rewrite mitigations already in place.
+ * Only controls with an identical mitigation table are taken over, the
+ * others are released when the old configuration is destroyed.
+ */
+void control_manager_inherit(struct list *old)
+{
+	struct control *octrl;
+	struct control *ctrl;
+	struct list_node *onode;
+	struct list_node *node;
+
+	for_list_node(&g_control_manager_list, node) {
+		ctrl = list_entry(node, struct control, list_node);
+		for_list_node(old, onode) {
+			octrl = list_entry(onode, struct control, list_node);
+			if (strcmp(ctrl->name, octrl->name))
+				continue;
+			if (control_same_levels(ctrl, octrl)) {
+				ctrl->current_level = octrl->current_level;
+				octrl->current_level = -1;
+			}
+			break;
+		}
+	}
+}
+
 struct control *control_create(const char *name)
 {
 	struct control *ctrl;
@@ -57,6 +117,15 @@ void control_destroy(struct control *ctrl)
 	struct list_node *node;
 	struct mitigation_level *l;
 
+	/* drop the votes and fall back to the "off" level */
+	if (ctrl->current_level > 0) {
+		for_list_node(&ctrl->mitigation_levels, node) {
+			l = list_entry(node, struct mitigation_level, list_node);
+			l->nvotes = 0;
+		}
+		control_update_level(ctrl);
+	}
+
 	while ((node = list_pop(&ctrl->mitigation_levels)) != NULL) {
 		l = list_entry(node, struct mitigation_level, list_node);
 		mitigation_destroy(l->mitigation);
@@ -95,6 +164,8 @@ static void control_update_level(struct control *ctrl)
 		return;
 
 	LOGI("\"%s\" set to level %d\n", ctrl->name, level);
+	telemetry_record(TELEMETRY_MITIGATION, ctrl->name,
+			level, ctrl->current_level);
 
 	for_list_node(&ctrl->mitigation_levels, node) {
 		l = list_entry(node, struct mitigation_level, list_node);
@@ -14,6 +14,8 @@ struct control {
 struct control *control_manager_find(const char *name);
 void control_manager_add(struct control *ctrl);
 void control_manager_remove(struct control *ctrl);
+void control_manager_swap(struct list *list);
+void control_manager_inherit(struct list *old);
 
 struct control *control_create(const char *name);
 void control_destroy(struct control *ctrl);
@@ -5,6 +5,7 @@
 #include <limits.h>
 #include <stdio.h>
 
+#include "util.h"
 #include "cpufreq.h"
 
 struct cpufreq {
@@ -84,14 +85,14 @@ int cpufreq_read_max(struct cpufreq *cf, unsigned int *value)
 	if (rc)
 		return -1;
 
-	rc = read(cf->max_freq_fd, buf, sizeof(buf));
-	lseek(cf->max_freq_fd, 0, SEEK_SET);
+	rc = pread(cf->max_freq_fd, buf, sizeof(buf) - 1, 0);
 	if (rc <= 0) {
 		close(cf->max_freq_fd);
 		cf->max_freq_fd = -1;
 		return -1;
 	}
 
+	buf[rc] = 0;
 	*value = strtoul(buf, 0, 0);
 	return 0;
 }
@@ -105,8 +106,7 @@ int cpufreq_write_max(struct cpufreq *cf, unsigned int value)
 	if (rc)
 		return -1;
 	rc = snprintf(buf, sizeof(buf), "%u", value);
-	rc = write(cf->max_freq_fd, buf, rc);
-	lseek(cf->max_freq_fd, 0, SEEK_SET);
+	rc = pwrite(cf->max_freq_fd, buf, rc, 0);
 	if (rc <= 0) {
 		close(cf->max_freq_fd);
 		cf->max_freq_fd = -1;
@@ -128,14 +128,51 @@ int cpufreq_read_cur(struct cpufreq *cf, unsigned int *value)
 	if (rc)
 		return -1;
 
-	rc = read(cf->cur_freq_fd, buf, sizeof(buf));
-	lseek(cf->cur_freq_fd, 0, SEEK_SET);
+	rc = pread(cf->cur_freq_fd, buf, sizeof(buf), 0);
 	if (rc <= 0) {
 		close(cf->cur_freq_fd);
 		cf->cur_freq_fd = -1;
 		return -1;
 	}
 
-	*value = strtol(buf, 0, 0);
-	return 0;
+	return util_parse_int(buf, rc, (int *)value);
+}
+
+static int cpufreq_compare(const void *a, const void *b)
+{
+	unsigned int fa = *(const unsigned int *)a;
+	unsigned int fb = *(const unsigned int *)b;
+	return (fa > fb) - (fa < fb);
+}
+
+/* Fill 'freqs' with the available frequencies in ascending order. */
+int cpufreq_read_available(struct cpufreq *cf,
+		unsigned int *freqs, unsigned int max)
+{
+	char buf[1024];
+	unsigned int count;
+	char *p, *end;
+	int fd;
+	int rc;
+
+	fd = cpufreq_open_file(cf->dir, "scaling_available_frequencies",
+			O_RDONLY);
+	if (fd == -1)
+		return -1;
+	rc = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (rc <= 0)
+		return -1;
+	buf[rc] = 0;
+
+	count = 0;
+	for (p = buf; count < max; p = end) {
+		unsigned long freq = strtoul(p, &end, 10);
+		if (end == p)
+			break;
+		freqs[count++] = freq;
+	}
+
+	qsort(freqs, count, sizeof(freqs[0]), cpufreq_compare);
+	return count;
 }
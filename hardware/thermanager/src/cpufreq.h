@@ -9,5 +9,7 @@ void cpufreq_close(struct cpufreq *cf);
 int cpufreq_read_cur(struct cpufreq *cf, unsigned int *value);
 int cpufreq_read_max(struct cpufreq *cf, unsigned int *value);
 int cpufreq_write_max(struct cpufreq *cf, unsigned int value);
+int cpufreq_read_available(struct cpufreq *cf,
+		unsigned int *freqs, unsigned int max);
 
 #endif
@@ -4,6 +4,9 @@
 #include "dom.h"
 
 extern struct dom_obj *libxml_loaddom(const char *path);
+extern int bindom_probe(const char *path);
+extern struct dom_obj *bindom_loaddom(const char *path);
+extern int bindom_savedom(const struct dom_obj *root, const char *path);
 
 const struct dom_obj *dom_obj_child(const struct dom_obj *obj, const char *name)
 {
@@ -46,7 +49,7 @@ const char *dom_obj_attribute_value(const struct dom_obj *obj,
 	return attr->value;
 }
 
-static void dom_obj_destroy(struct dom_obj *obj)
+void dom_obj_destroy(struct dom_obj *obj)
 {
 	struct list_node *node;
 	struct list_node *safe;
@@ -84,7 +87,10 @@ struct dom *dom_load(const char *path)
 	if (dom == NULL)
 		return NULL;
 
-	dom->root = libxml_loaddom(path);
+	if (bindom_probe(path))
+		dom->root = bindom_loaddom(path);
+	else
+		dom->root = libxml_loaddom(path);
 	if (dom->root == NULL) {
 		free(dom);
 		return NULL;
@@ -93,6 +99,13 @@ struct dom *dom_load(const char *path)
 	return dom;
 }
 
+int dom_save(const struct dom *dom, const char *path)
+{
+	if (dom->root == NULL)
+		return -1;
+	return bindom_savedom(dom->root, path);
+}
+
 const struct dom_obj *dom_root(const struct dom *dom)
 {
 	return dom->root;
@@ -29,7 +29,9 @@ const char *dom_obj_attribute_value(const struct dom_obj *obj,
 		const char *name);
 
 struct dom *dom_load(const char *path);
+int dom_save(const struct dom *dom, const char *path);
 void dom_destroy(struct dom *dom);
+void dom_obj_destroy(struct dom_obj *obj);
 
 const struct dom_obj *dom_root(const struct dom *dom);
 const struct dom_obj *dom_object(const struct dom *dom, const char *path);
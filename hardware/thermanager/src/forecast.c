@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <limits.h>
+
+#include "forecast.h"
+
+#define FORECAST_MIN_SAMPLES 3
+
+struct forecast_sample {
+	unsigned long long ms;
+	int value;
+};
+
+/* ring buffer of the most recent sensor samples */
+struct forecast {
+	unsigned int depth;
+	unsigned int count;
+	unsigned int head;
+	struct forecast_sample samples[];
+};
+
+struct forecast *forecast_create(unsigned int depth)
+{
+	struct forecast *fc;
+
+	if (depth < FORECAST_MIN_SAMPLES)
+		depth = FORECAST_MIN_SAMPLES;
+
+	fc = calloc(1, sizeof(*fc) + depth * sizeof(fc->samples[0]));
+	if (fc == NULL)
+		return NULL;
+
+	fc->depth = depth;
+
+	return fc;
+}
+
+void forecast_destroy(struct forecast *fc)
+{
+	free(fc);
+}
+
+/*
+ * Whether a sample taken at 'ms' is at least 'interval' after the newest
+ * one.  Samples bunched closer than that only add noise to the fit.
+ */
+int forecast_sample_due(struct forecast *fc,
+		unsigned long long ms, unsigned int interval)
+{
+	const struct forecast_sample *newest;
+
+	if (fc->count == 0)
+		return 1;
+
+	newest = &fc->samples[(fc->head + fc->depth - 1) % fc->depth];
+	return ms - newest->ms >= interval;
+}
+
+void forecast_add_sample(struct forecast *fc,
+		unsigned long long ms, int value)
+{
+	fc->samples[fc->head].ms = ms;
+	fc->samples[fc->head].value = value;
+	fc->head = (fc->head + 1) % fc->depth;
+	if (fc->count < fc->depth)
+		fc->count++;
+}
+
+/*
+ * Least squares fit of the buffered samples, extrapolated 'horizon' ms past
+ * the newest sample.  Returns -1 until enough samples have been collected.
+ */
+int forecast_value(struct forecast *fc, unsigned int horizon, int *value)
+{
+	const struct forecast_sample *newest;
+	const struct forecast_sample *s;
+	double st, sv, stt, stv;
+	double slope;
+	double denom;
+	double t;
+	double v;
+	unsigned int i;
+
+	if (fc->count < FORECAST_MIN_SAMPLES)
+		return -1;
+
+	newest = &fc->samples[(fc->head + fc->depth - 1) % fc->depth];
+
+	st = sv = stt = stv = 0;
+	for (i = 0; i < fc->count; ++i) {
+		s = &fc->samples[i];
+		/* time relative to the newest sample, keeps the sums small */
+		t = -(double)(newest->ms - s->ms);
+		st += t;
+		sv += s->value;
+		stt += t * t;
+		stv += t * s->value;
+	}
+
+	denom = fc->count * stt - st * st;
+	if (denom <= 0)
+		return -1;
+	slope = (fc->count * stv - st * sv) / denom;
+
+	v = newest->value + slope * horizon;
+	if (v > INT_MAX)
+		v = INT_MAX;
+	else if (v < INT_MIN)
+		v = INT_MIN;
+	*value = (int)v;
+
+	return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef _FORECAST_H_
+#define _FORECAST_H_
+
+struct forecast;
+
+struct forecast *forecast_create(unsigned int depth);
+void forecast_destroy(struct forecast *fc);
+
+int forecast_sample_due(struct forecast *fc,
+		unsigned long long ms, unsigned int interval);
+void forecast_add_sample(struct forecast *fc,
+		unsigned long long ms, int value);
+int forecast_value(struct forecast *fc, unsigned int horizon, int *value);
+
+#endif
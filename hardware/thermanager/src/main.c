@@ -6,8 +6,10 @@
 #include "control.h"
 #include "threshold.h"
 #include "mitigation.h"
+#include "pid.h"
 #include "resource.h"
 #include "log.h"
+#include "util.h"
 
 #include "dom.h"
 
@@ -61,10 +63,101 @@ static int parse_multi_X(const struct dom_obj *obj, const char *name,
 	return 0;
 }
 
+static const char *g_config_path;
+static int g_generation;
+
+/* resources of the running configuration while a reload is parsed */
+static struct list *g_reload_resources;
+
+static size_t resource_spec_put(char *buf, size_t len, const char *str)
+{
+	size_t n = strlen(str);
+
+	if (buf != NULL) {
+		memcpy(buf + len, str, n);
+		buf[len + n] = '\x1f';
+	}
+	return len + n + 1;
+}
+
+static size_t resource_spec_text(const struct dom_obj *obj, char *buf)
+{
+	const struct list_node *node;
+	const struct dom_attr *attr;
+	const struct dom_obj *child;
+	const char *name;
+	size_t len = 0;
+
+	for_list_node(&obj->attributes, node) {
+		attr = list_entry(node, const struct dom_attr, list_node);
+		len = resource_spec_put(buf, len, attr->name);
+		len = resource_spec_put(buf, len, attr->value);
+	}
+	for_list_node(&obj->children, node) {
+		child = list_entry(node, const struct dom_obj, list_node);
+		name = dom_obj_attribute_value(child, "name");
+		len = resource_spec_put(buf, len, name ? name : "");
+	}
+	return resource_spec_put(buf, len, obj->content ? obj->content : "");
+}
+
+/*
+ * Flatten a resource declaration into a string, fields separated by 0x1f,
+ * along with its hash for a quick reject when matching across a reload.
+ */
+static char *parse_resource_spec(const struct dom_obj *obj,
+		unsigned long *hash)
+{
+	size_t len;
+	char *spec;
+
+	len = resource_spec_text(obj, NULL);
+	spec = malloc(len + 1);
+	if (spec == NULL)
+		return NULL;
+	resource_spec_text(obj, spec);
+	spec[len] = 0;
+
+	*hash = util_hash(5381, spec);
+	return spec;
+}
+
+/*
+ * Take an unchanged resource over from the running configuration, keeping
+ * its open files.  Its watch tickets are dropped when the old configuration
+ * is stopped and recreated when the new one is started.  Only resources
+ * which don't reference other resources are carried over, wrappers are
+ * cheap to recreate.
+ */
+static struct resource *reload_take_resource(const char *name,
+		const char *spec, unsigned long hash)
+{
+	struct list_node *node;
+	struct resource *res;
+
+	if (g_reload_resources == NULL || spec == NULL)
+		return NULL;
+
+	for_list_node(g_reload_resources, node) {
+		res = list_entry(node, struct resource, list_node);
+		if (res->spec_hash != hash || res->spec == NULL ||
+				res->prepare != NULL ||
+				strcmp(res->name, name) ||
+				strcmp(res->spec, spec))
+			continue;
+		list_remove(g_reload_resources, node);
+		return res;
+	}
+	return NULL;
+}
+
 static int parse_one_resource(void *data __attribute__ ((__unused__)),
 		const struct dom_obj *obj)
 {
 	struct resource *res;
+	unsigned long hash;
+	const char *slack;
+	char *spec;
 	const char *type;
 	const char *name;
 
@@ -79,16 +172,25 @@ static int parse_one_resource(void *data __attribute__ ((__unused__)),
 		return -1;
 	}
 
+	spec = parse_resource_spec(obj, &hash);
+	res = reload_take_resource(name, spec, hash);
+	if (res != NULL) {
+		LOGV("kept resource \"%s\" [%s]\n", name, type);
+		resource_manager_add(res);
+		free(spec);
+		return 0;
+	}
+
 	res = NULL;
 	if (!strcmp(type, "tz")) {
 		if (obj->content == NULL)
-			return -1;
+			goto err;
 		res = resource_tz_open(name, obj->content);
 	} else if (!strcmp(type, "alias")) {
 		const char *alias;
 		alias = dom_obj_attribute_value(obj, "resource");
 		if (alias == NULL)
-			return -1;
+			goto err;
 		res = resource_alias_open(name, alias);
 	} else if (!strcmp(type, "union")) {
 		const struct list_node *node;
@@ -101,30 +203,30 @@ static int parse_one_resource(void *data __attribute__ ((__unused__)),
 		for_list_node(&obj->children, node) {
 			child = list_entry(node, const struct dom_obj, list_node);
 			if (strcmp("resource", child->name))
-				return -1;
+				goto err;
 			which = dom_obj_attribute_value(child, "name");
 			if (which == NULL)
-				return -1;
+				goto err;
 			cnames[count++] = which;
 		}
 		res = resource_union_open(name, count, cnames);
 	} else if (!strcmp(type, "sysfs")) {
 		if (obj->content == NULL)
-			return -1;
+			goto err;
 		res = resource_sysfs_open(name, obj->content, RESOURCE_SYSFS_RDWR);
 	} else if (!strcmp(type, "sysfs-ro")) {
 		if (obj->content == NULL)
-			return -1;
+			goto err;
 		res = resource_sysfs_open(name, obj->content, RESOURCE_SYSFS_RDONLY);
 	} else if (!strcmp(type, "deadband")) {
 		const char *alias;
 		const char *ssize;
 		alias = dom_obj_attribute_value(obj, "resource");
 		if (alias == NULL)
-			return -1;
+			goto err;
 		ssize = dom_obj_attribute_value(obj, "size");
 		if (ssize == NULL)
-			return -1;
+			goto err;
 		res = resource_deadband_open(name, alias, strtol(ssize, 0, 0));
 	} else if (!strcmp(type, "halt")) {
 		const char *delay;
@@ -140,28 +242,41 @@ static int parse_one_resource(void *data __attribute__ ((__unused__)),
 		res = resource_echo_open(name);
 	} else if (!strcmp(type, "msm-adc")) {
 		if (obj->content == NULL)
-			return -1;
+			goto err;
 		res = resource_msmadc_open(name, obj->content);
 	} else if (!strcmp(type, "intent")) {
 		if (obj->content == NULL)
-			return -1;
+			goto err;
 		res = resource_intent_open(name, obj->content);
 	} else if (!strcmp(type, "cpufreq")) {
 		if (obj->content == NULL)
-			return -1;
+			goto err;
 		res = resource_cpufreq_open(name, obj->content);
 	}
 
 	if (res == NULL) {
 		LOGW("failed to attach resource \"%s\""
 				" [%s], ignoring\n", name, type);
+		free(spec);
 		return 0;
 	}
 	LOGV("attached resource \"%s\" [%s]\n", name, type);
 
+	slack = dom_obj_attribute_value(obj, "slack");
+	if (slack != NULL)
+		resource_set_slack(res, strtoul(slack, 0, 0));
+
+	res->spec_hash = hash;
+	res->spec = spec;
+	res->generation = g_generation;
+
 	resource_manager_add(res);
 
 	return 0;
+
+err:
+	free(spec);
+	return -1;
 }
 
 static int parse_resources(const struct dom_obj *obj)
@@ -221,10 +336,53 @@ static int parse_one_mitigation(void *data, const struct dom_obj *obj)
 	return 0;
 }
 
+static int parse_pid_control(const struct dom_obj *obj, const char *name)
+{
+	struct pid_control *pid;
+	const char *resource;
+	const char *interval;
+	const char *sensor;
+	const char *target;
+	const char *kp, *ki, *kd;
+
+	sensor = dom_obj_attribute_value(obj, "sensor");
+	target = dom_obj_attribute_value(obj, "target");
+	resource = dom_obj_attribute_value(obj, "resource");
+	if (sensor == NULL || target == NULL || resource == NULL) {
+		LOGE("pid control missing 'sensor', 'target' or 'resource'"
+				" attribute\n");
+		return -1;
+	}
+
+	pid = pid_control_create(name, sensor, resource,
+			strtol(target, 0, 0));
+	if (pid == NULL) {
+		LOGW("failed to attach pid control \"%s\", ignoring\n", name);
+		return 0;
+	}
+
+	kp = dom_obj_attribute_value(obj, "kp");
+	ki = dom_obj_attribute_value(obj, "ki");
+	kd = dom_obj_attribute_value(obj, "kd");
+	pid_control_set_gains(pid,
+			kp ? strtod(kp, 0) : 0,
+			ki ? strtod(ki, 0) : 0,
+			kd ? strtod(kd, 0) : 0);
+
+	interval = dom_obj_attribute_value(obj, "interval");
+	if (interval != NULL)
+		pid_control_set_interval(pid, strtoul(interval, 0, 0));
+
+	pid_manager_add(pid);
+
+	return 0;
+}
+
 static int parse_control(const struct dom_obj *obj)
 {
 	struct control *ctrl;
 	const char *name;
+	const char *type;
 	int rc;
 
 	name = dom_obj_attribute_value(obj, "name");
@@ -233,6 +391,10 @@ static int parse_control(const struct dom_obj *obj)
 		return -1;
 	}
 
+	type = dom_obj_attribute_value(obj, "type");
+	if (type != NULL && !strcmp(type, "pid"))
+		return parse_pid_control(obj, name);
+
 	ctrl = control_create(name);
 	if (ctrl == NULL)
 		return -1;
@@ -311,6 +473,7 @@ static int parse_config(const struct dom_obj *obj)
 {
 	struct configuration *cfg;
 	const char *sensor;
+	const char *mode;
 	int rc;
 
 	sensor = dom_obj_attribute_value(obj, "sensor");
@@ -326,6 +489,31 @@ static int parse_config(const struct dom_obj *obj)
 		return -1;
 	}
 
+	mode = dom_obj_attribute_value(obj, "mode");
+	if (mode != NULL && !strcmp(mode, "predictive")) {
+		const char *horizon;
+		const char *interval;
+		const char *samples;
+
+		horizon = dom_obj_attribute_value(obj, "horizon");
+		interval = dom_obj_attribute_value(obj, "interval");
+		samples = dom_obj_attribute_value(obj, "samples");
+
+		rc = configuration_set_predictive(cfg,
+				horizon ? strtoul(horizon, 0, 0) : 10000,
+				interval ? strtoul(interval, 0, 0) : 1000,
+				samples ? strtoul(samples, 0, 0) : 8);
+		if (rc) {
+			LOGE("failed to enable predictive mode\n");
+			configuration_destroy(cfg);
+			return rc;
+		}
+	} else if (mode != NULL && strcmp(mode, "reactive")) {
+		LOGE("unknown configuration mode '%s'\n", mode);
+		configuration_destroy(cfg);
+		return -1;
+	}
+
 	rc = parse_multi_X(obj, "threshold", parse_one_threshold, cfg);
 	if (rc) {
 		LOGE("failed to parse thresholds\n");
@@ -348,35 +536,181 @@ static int parse(const char *file)
 
 	if (parse_only_X(dom->root, "resources", parse_resources)) {
 		LOGE("failed to parse resource sections\n");
-		return -1;
+		goto err;
 	}
 	resource_manager_prepare();
 
 	if (parse_only_X(dom->root, "control", parse_control)) {
 		LOGE("failed to parse control sections\n");
-		return -1;
+		goto err;
 	}
 	if (parse_only_X(dom->root, "configuration", parse_config)) {
 		LOGE("failed to parse configuration sections\n");
-		return -1;
+		goto err;
 	}
 
 	dom_destroy(dom);
 
 	return 0;
+
+err:
+	dom_destroy(dom);
+	return -1;
+}
+
+static void destroy_configurations(struct list *list)
+{
+	struct list_node *node;
+
+	while ((node = list_pop(list)) != NULL)
+		configuration_destroy(list_entry(node,
+				struct configuration, list_node));
+}
+
+static void destroy_controls(struct list *list)
+{
+	struct list_node *node;
+
+	while ((node = list_pop(list)) != NULL)
+		control_destroy(list_entry(node, struct control, list_node));
+}
+
+static void destroy_pid_controls(struct list *list)
+{
+	struct list_node *node;
+
+	while ((node = list_pop(list)) != NULL)
+		pid_control_destroy(list_entry(node,
+				struct pid_control, list_node));
+}
+
+static void destroy_resources(struct list *list)
+{
+	struct list_node *node;
+
+	while ((node = list_pop(list)) != NULL)
+		resource_close(list_entry(node, struct resource, list_node));
+}
+
+/*
+ * Build the new configuration next to the running one, then drop whatever
+ * the new one didn't take over.  Resources whose declaration is unchanged
+ * keep their file descriptors and controls with an unchanged mitigation
+ * table keep their active level.  Removed or changed controls release
+ * their mitigations.  If the new configuration fails to parse the running
+ * one is left untouched.
+ */
+static int reload(void)
+{
+	struct list configurations;
+	struct list resources;
+	struct list controls;
+	struct list pids;
+	struct list_node *node;
+	struct list failed;
+	unsigned long long start;
+	struct resource *res;
+	int rc;
+
+	start = util_time_ms();
+
+	list_init(&configurations);
+	list_init(&resources);
+	list_init(&controls);
+	list_init(&pids);
+	configuration_manager_swap(&configurations);
+	control_manager_swap(&controls);
+	pid_manager_swap(&pids);
+	resource_manager_swap(&resources);
+
+	g_generation++;
+	g_reload_resources = &resources;
+	rc = parse(g_config_path);
+	g_reload_resources = NULL;
+
+	if (rc) {
+		LOGE("failed to reload \"%s\", keeping current"
+				" configuration\n", g_config_path);
+
+		list_init(&failed);
+		configuration_manager_swap(&failed);
+		destroy_configurations(&failed);
+		control_manager_swap(&failed);
+		destroy_controls(&failed);
+		pid_manager_swap(&failed);
+		destroy_pid_controls(&failed);
+
+		/* hand carried over resources back before closing the rest */
+		resource_manager_swap(&failed);
+		while ((node = list_pop(&failed)) != NULL) {
+			res = list_entry(node, struct resource, list_node);
+			if (res->generation != g_generation)
+				list_append(&resources, node);
+			else
+				resource_close(res);
+		}
+
+		configuration_manager_swap(&configurations);
+		control_manager_swap(&controls);
+		pid_manager_swap(&pids);
+		resource_manager_swap(&resources);
+		return -1;
+	}
+
+	control_manager_inherit(&controls);
+	pid_manager_inherit(&pids);
+
+	destroy_configurations(&configurations);
+	destroy_controls(&controls);
+	destroy_pid_controls(&pids);
+	destroy_resources(&resources);
+
+	LOGI("reloaded \"%s\" in %llu ms\n", g_config_path,
+			util_time_ms() - start);
+
+	return 0;
+}
+
+/*
+ * Write a precompiled image of the configuration, which dom_load() picks up
+ * in place of the XML to skip XML parsing at boot.
+ */
+static int compile(const char *in, const char *out)
+{
+	struct dom *dom;
+	int rc;
+
+	dom = dom_load(in);
+	if (dom == NULL) {
+		LOGE("failed to load \"%s\"\n", in);
+		return -1;
+	}
+
+	rc = dom_save(dom, out);
+	if (rc)
+		LOGE("failed to write \"%s\"\n", out);
+	dom_destroy(dom);
+
+	return rc;
 }
 
 int main(int argc, char **argv)
 {
+	if (argc == 4 && !strcmp(argv[1], "--compile"))
+		return compile(argv[2], argv[3]);
+
 	if (argc != 2) {
 		LOGE("Usage: %s <config>\n", argv[0]);
+		LOGE("       %s --compile <config> <image>\n", argv[0]);
 		return -1;
 	}
 
-	if (parse(argv[1]))
+	g_config_path = argv[1];
+	if (parse(g_config_path))
 		return -1;
 
-	configuration_manager_run();
+	/* SIGHUP reloads the configuration */
+	configuration_manager_run(reload);
 
 	return 0;
 }
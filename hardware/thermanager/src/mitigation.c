@@ -57,6 +57,30 @@ void mitigation_add_resource(struct mitigation *m, const char *name, const char
 	list_append(&m->resources, &r->list_node);
 }
 
+int mitigation_equal(struct mitigation *a, struct mitigation *b)
+{
+	struct mitigation_resource *ra;
+	struct mitigation_resource *rb;
+	struct list_node *na;
+	struct list_node *nb;
+
+	if (a->level != b->level)
+		return 0;
+
+	na = list_first(&a->resources);
+	nb = list_first(&b->resources);
+	while (na != NULL && nb != NULL) {
+		ra = list_entry(na, struct mitigation_resource, list_node);
+		rb = list_entry(nb, struct mitigation_resource, list_node);
+		if (strcmp(ra->resource->name, rb->resource->name) ||
+				strcmp(ra->target_value, rb->target_value))
+			return 0;
+		na = na->next;
+		nb = nb->next;
+	}
+	return na == NULL && nb == NULL;
+}
+
 void mitigation_activate(struct mitigation *m)
 {
 	struct mitigation_resource *r;
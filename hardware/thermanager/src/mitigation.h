@@ -14,6 +14,7 @@ void mitigation_destroy(struct mitigation *m);
 
 void mitigation_add_resource(struct mitigation *m,
 		const char *name, const char *target_value);
+int mitigation_equal(struct mitigation *a, struct mitigation *b);
 void mitigation_activate(struct mitigation *m);
 void mitigation_deactivate(struct mitigation *m);
 
@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "log.h"
+#include "pid.h"
+#include "telemetry.h"
+
+static LIST(g_pid_manager_list);
+
+void pid_manager_add(struct pid_control *pid)
+{
+	list_append(&g_pid_manager_list, &pid->list_node);
+}
+
+int pid_manager_empty(void)
+{
+	return list_first(&g_pid_manager_list) == NULL;
+}
+
+static int pid_control_snap(struct pid_control *pid, double value)
+{
+	int best;
+	int i;
+
+	best = pid->steps[0];
+	for (i = 1; i < pid->nsteps; ++i) {
+		if (abs(pid->steps[i] - (int)value) < abs(best - (int)value))
+			best = pid->steps[i];
+	}
+	return best;
+}
+
+static void pid_control_step(void *data, struct watch_ticket *ticket)
+{
+	struct pid_control *pid = (struct pid_control *)data;
+	double integral;
+	double output;
+	double dt;
+	int error;
+	int value;
+	int lo;
+	int hi;
+
+	watch_ticket_clear(ticket);
+
+	value = resource_read_int(pid->sensor);
+	if (value == -1)
+		return;
+	lo = pid->steps[0];
+	hi = pid->steps[pid->nsteps - 1];
+	dt = pid->interval / 1000.0;
+
+	/* positive error is thermal headroom, which allows a higher output */
+	error = pid->target - value;
+	integral = pid->integral + error * dt;
+	output = hi + pid->kp * error + pid->ki * integral +
+			pid->kd * (error - pid->last_error) / dt;
+	pid->last_error = error;
+
+	/* anti-windup, stop integrating while saturated in the same direction */
+	if (!(output > hi && error > 0) && !(output < lo && error < 0))
+		pid->integral = integral;
+
+	if (output > hi)
+		output = hi;
+	else if (output < lo)
+		output = lo;
+
+	value = pid_control_snap(pid, output);
+	if (value == pid->current)
+		return;
+
+	LOGV("\"%s\" output set to %d\n", pid->name, value);
+	resource_write_int(pid->output, value);
+	telemetry_record(TELEMETRY_OUTPUT, pid->name, value, 0);
+	pid->current = value;
+}
+
+static void pid_control_enable(struct pid_control *pid)
+{
+	pid->ticket = watch_manager_add_timeout(pid->interval);
+	if (pid->ticket == NULL)
+		return;
+	watch_ticket_callback(pid->ticket, pid_control_step, pid);
+	resource_enable(pid->sensor);
+}
+
+static void pid_control_disable(struct pid_control *pid)
+{
+	if (pid->ticket == NULL)
+		return;
+
+	watch_ticket_delete(pid->ticket);
+	pid->ticket = NULL;
+	resource_disable(pid->sensor);
+}
+
+void pid_manager_swap(struct list *list)
+{
+	struct list tmp;
+
+	tmp = g_pid_manager_list;
+	g_pid_manager_list = *list;
+	*list = tmp;
+}
+
+/* Carry controller state over a reload, keeping the current cap in place. */
+void pid_manager_inherit(struct list *old)
+{
+	struct pid_control *opid;
+	struct pid_control *pid;
+	struct list_node *onode;
+	struct list_node *node;
+
+	for_list_node(&g_pid_manager_list, node) {
+		pid = list_entry(node, struct pid_control, list_node);
+		for_list_node(old, onode) {
+			opid = list_entry(onode, struct pid_control, list_node);
+			if (strcmp(pid->name, opid->name))
+				continue;
+			pid->integral = opid->integral;
+			pid->last_error = opid->last_error;
+			pid->current = opid->current;
+			opid->current = INT_MIN;
+			break;
+		}
+	}
+}
+
+void pid_manager_enable(void)
+{
+	struct pid_control *pid;
+	struct list_node *node;
+
+	for_list_node(&g_pid_manager_list, node) {
+		pid = list_entry(node, struct pid_control, list_node);
+		pid_control_enable(pid);
+	}
+}
+
+void pid_manager_disable(void)
+{
+	struct pid_control *pid;
+	struct list_node *node;
+
+	for_list_node(&g_pid_manager_list, node) {
+		pid = list_entry(node, struct pid_control, list_node);
+		pid_control_disable(pid);
+	}
+}
+
+struct pid_control *pid_control_create(const char *name, const char *sensor,
+		const char *output, int target)
+{
+	struct pid_control *pid;
+
+	pid = calloc(1, sizeof(*pid));
+	if (pid == NULL)
+		return NULL;
+
+	pid->sensor = resource_manager_find(sensor);
+	pid->output = resource_manager_find(output);
+	if (pid->sensor == NULL || pid->output == NULL) {
+		free(pid);
+		return NULL;
+	}
+
+	/* the output is snapped to the steps (OPPs) the resource supports */
+	pid->nsteps = resource_read_steps(pid->output, pid->steps,
+			PID_MAX_STEPS);
+	if (pid->nsteps <= 0) {
+		LOGE("resource \"%s\" has no output steps\n", output);
+		free(pid);
+		return NULL;
+	}
+
+	pid->target = target;
+	pid->interval = 1000;
+	pid->current = INT_MIN;
+
+	strncpy(pid->name, name, sizeof(pid->name));
+	pid->name[sizeof(pid->name) - 1] = 0;
+
+	return pid;
+}
+
+void pid_control_destroy(struct pid_control *pid)
+{
+	pid_control_disable(pid);
+
+	/* release the cap */
+	if (pid->current != INT_MIN)
+		resource_write_int(pid->output, pid->steps[pid->nsteps - 1]);
+	free(pid);
+}
+
+void pid_control_set_gains(struct pid_control *pid,
+		double kp, double ki, double kd)
+{
+	pid->kp = kp;
+	pid->ki = ki;
+	pid->kd = kd;
+}
+
+void pid_control_set_interval(struct pid_control *pid, unsigned int ms)
+{
+	if (ms == 0)
+		ms = 1;
+	pid->interval = ms;
+}
@@ -0,0 +1,44 @@
+#ifndef _PID_H_
+#define _PID_H_
+
+#include "resource.h"
+#include "watch.h"
+#include "list.h"
+
+#define PID_MAX_STEPS 64
+
+struct pid_control {
+	char name[256];
+	struct resource *sensor;
+	struct resource *output;
+	int target;
+	double kp;
+	double ki;
+	double kd;
+	unsigned int interval;
+
+	int steps[PID_MAX_STEPS];
+	int nsteps;
+
+	double integral;
+	int last_error;
+	int current;
+	struct watch_ticket *ticket;
+	struct list_node list_node;
+};
+
+void pid_manager_add(struct pid_control *pid);
+int pid_manager_empty(void);
+void pid_manager_enable(void);
+void pid_manager_disable(void);
+void pid_manager_swap(struct list *list);
+void pid_manager_inherit(struct list *old);
+
+struct pid_control *pid_control_create(const char *name, const char *sensor,
+		const char *output, int target);
+void pid_control_destroy(struct pid_control *pid);
+void pid_control_set_gains(struct pid_control *pid,
+		double kp, double ki, double kd);
+void pid_control_set_interval(struct pid_control *pid, unsigned int ms);
+
+#endif
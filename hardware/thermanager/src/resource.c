@@ -42,6 +42,15 @@ void resource_manager_remove(struct resource *res)
 	list_remove(&g_resource_manager_list, &res->list_node);
 }
 
+void resource_manager_swap(struct list *list)
+{
+	struct list tmp;
+
+	tmp = g_resource_manager_list;
+	g_resource_manager_list = *list;
+	*list = tmp;
+}
+
 void resource_manager_prepare(void)
 {
 	struct list_node *safe;
@@ -57,10 +66,23 @@ void resource_manager_prepare(void)
 			resource_close(res);
 		}
 	}
+
+	/*
+	 * Once every reference is resolved, let wrappers flatten alias and
+	 * union chains so sampling goes straight to the backing resources.
+	 */
+	for_list_node(&g_resource_manager_list, iter) {
+		struct resource *res =
+				list_entry(iter, struct resource, list_node);
+		if (res->compile != NULL)
+			res->compile(res);
+	}
 }
 
 void resource_close(struct resource *res)
 {
+	free(res->spec);
+	res->spec = NULL;
 	if (res->close == NULL)
 		return;
 	res->close(res);
@@ -94,11 +116,21 @@ int resource_read_value(struct resource *res, char *buf, unsigned int len)
 	return res->read_value(res, buf, len);
 }
 
-int resource_read_int(struct resource *res)
+int resource_read_steps(struct resource *res, int *steps, unsigned int max)
+{
+	if (res->read_steps == NULL)
+		return -1;
+	return res->read_steps(res, steps, max);
+}
+
+int resource_sample(struct resource *res, int *value)
 {
 	char buf[13];
 	int rc;
 
+	if (res->sample != NULL)
+		return res->sample(res, value);
+
 	if (res->read_value == NULL)
 		return -1;
 
@@ -106,8 +138,16 @@ int resource_read_int(struct resource *res)
 	if (rc <= 0)
 		return -1;
 
-	buf[rc] = 0;
-	return strtol(buf, 0, 0);
+	return util_parse_int(buf, rc, value);
+}
+
+int resource_read_int(struct resource *res)
+{
+	int value;
+
+	if (resource_sample(res, &value))
+		return -1;
+	return value;
 }
 
 int resource_write_int(struct resource *res, int value)
@@ -136,6 +176,11 @@ void resource_set_edges(struct resource *res, int lower, int upper)
 	res->set_edges(res, lower, upper);
 }
 
+void resource_set_slack(struct resource *res, unsigned int ms)
+{
+	res->slack = ms;
+}
+
 struct tz_resource {
 	struct resource resource;
 	struct thermal_zone *zone;
@@ -194,11 +239,21 @@ static int resource_tz_read_value(struct resource *res, char *buf, unsigned int
 	if (rc <= 0)
 		return rc;
 
-	buf[rc] = 0;
-	tres->value = strtol(buf, 0, 0);
+	util_parse_int(buf, rc, &tres->value);
 	return rc;
 }
 
+static int resource_tz_sample(struct resource *res, int *value)
+{
+	struct tz_resource *tres =
+			container_of(res, struct tz_resource, resource);
+
+	if (thermal_zone_read_int(tres->zone, &tres->value))
+		return -1;
+	*value = tres->value;
+	return 0;
+}
+
 struct resource *resource_tz_open(const char *name, const char *file)
 {
 	struct tz_resource *res;
@@ -213,6 +268,7 @@ struct resource *resource_tz_open(const char *name, const char *file)
 		return NULL;
 	}
 	res->resource.read_value = resource_tz_read_value;
+	res->resource.sample = resource_tz_sample;
 	res->resource.close = resource_tz_close;
 	res->resource.enable = resource_tz_enable;
 	res->resource.disable = resource_tz_disable;
@@ -231,6 +287,7 @@ struct sysfs_resource {
 	struct resource resource;
 	struct watch_ticket *ticket;
 	int fd;
+	char sample[16];
 };
 
 static void resource_sysfs_enable(struct resource *res)
@@ -238,6 +295,8 @@ static void resource_sysfs_enable(struct resource *res)
 	struct sysfs_resource *sres =
 			container_of(res, struct sysfs_resource, resource);
 	sres->ticket = watch_manager_add_timeout(5000);
+	if (sres->ticket != NULL)
+		watch_ticket_set_slack(sres->ticket, res->slack);
 }
 
 static void resource_sysfs_disable(struct resource *res)
@@ -275,18 +334,29 @@ static int resource_sysfs_read_value(struct resource *res,
 			return -1;
 	}
 #endif
-	rc = read(sres->fd, buf, len);
-	lseek(sres->fd, 0, SEEK_SET);
+	rc = pread(sres->fd, buf, len, 0);
 	return rc;
 }
 
+static int resource_sysfs_sample(struct resource *res, int *value)
+{
+	struct sysfs_resource *sres =
+			container_of(res, struct sysfs_resource, resource);
+	int rc;
+
+	rc = pread(sres->fd, sres->sample, sizeof(sres->sample), 0);
+	if (rc <= 0)
+		return -1;
+	return util_parse_int(sres->sample, rc, value);
+}
+
 static int resource_sysfs_write_value(struct resource *res,
 		const char *val, unsigned int len)
 {
 	struct sysfs_resource *sres =
 			container_of(res, struct sysfs_resource, resource);
 	int rc;
-	rc = write(sres->fd, val, len);
+	rc = pwrite(sres->fd, val, len, 0);
 	return -(rc <= 0);
 }
 
@@ -325,6 +395,7 @@ struct resource *resource_sysfs_open(const char *name, const char *file,
 	}
 
 	res->resource.read_value = resource_sysfs_read_value;
+	res->resource.sample = resource_sysfs_sample;
 	res->resource.close = resource_sysfs_close;
 
 	strncpy(res->resource.name, name, sizeof(res->resource.name));
@@ -338,31 +409,75 @@ struct union_resource {
 	struct resource **members;
 	char **member_names;
 	int nmembers;
+	int nnames;
 };
 
 static int resource_union_prepare(struct resource *res)
 {
 	struct union_resource *ures =
 			container_of(res, struct union_resource, resource);
+	struct resource *member;
 	int i;
 
-	if (ures->members != NULL || ures->nmembers == 0)
+	if (ures->members != NULL || ures->nnames == 0)
 		return -1;
 
-	ures->members = calloc(1, sizeof(ures->members[0]) * ures->nmembers);
+	ures->members = calloc(1, sizeof(ures->members[0]) * ures->nnames);
 	if (ures->members == NULL)
 		return -1;
 
+	ures->nmembers = 0;
+	for (i = 0; i < ures->nnames; ++i) {
+		member = resource_manager_find(ures->member_names[i]);
+		if (member != NULL)
+			ures->members[ures->nmembers++] = member;
+	}
+	return 0;
+}
+
+static int resource_union_read_value(struct resource *res, char *buf, unsigned int len);
+
+static int resource_union_flatten(struct resource *res,
+		struct resource **leaves, int count, int max, int depth)
+{
+	struct union_resource *ures =
+			container_of(res, struct union_resource, resource);
+	struct resource *member;
+	int i, j;
+
 	for (i = 0; i < ures->nmembers; ++i) {
-		ures->members[i] = resource_manager_find(ures->member_names[i]);
-		if (ures->members[i] == 0) {
-			memmove(ures->member_names[i], ures->member_names[i + 1],
-					(ures->nmembers - (i + 1)) * sizeof(ures->member_names[0]));
-			--i;
-			--ures->nmembers;
+		member = resource_resolve(ures->members[i]);
+		if (member->read_value == resource_union_read_value && depth < 8) {
+			count = resource_union_flatten(member, leaves,
+					count, max, depth + 1);
+			continue;
 		}
+		for (j = 0; j < count; ++j)
+			if (leaves[j] == member)
+				break;
+		if (j == count && count < max)
+			leaves[count++] = member;
 	}
-	return -(ures->members == 0);
+	return count;
+}
+
+static void resource_union_compile(struct resource *res)
+{
+	struct union_resource *ures =
+			container_of(res, struct union_resource, resource);
+	struct resource *leaves[256];
+	struct resource **members;
+	int count;
+
+	count = resource_union_flatten(res, leaves, 0, 256, 0);
+	members = calloc(1, sizeof(members[0]) * (count ? count : 1));
+	if (members == NULL)
+		return;
+	memcpy(members, leaves, sizeof(members[0]) * count);
+
+	free(ures->members);
+	ures->members = members;
+	ures->nmembers = count;
 }
 
 static void resource_union_set_edges(struct resource *res, int lo, int hi)
@@ -406,7 +521,7 @@ static void resource_union_close(struct resource *res)
 
 	if (ures->members)
 		free(ures->members);
-	for (i = 0; i < ures->nmembers; ++i)
+	for (i = 0; i < ures->nnames; ++i)
 		free(ures->member_names[i]);
 	free(ures->member_names);
 
@@ -414,20 +529,36 @@ static void resource_union_close(struct resource *res)
 }
 
 static int resource_union_read_value(struct resource *res, char *buf, unsigned int len)
+{
+	int max;
+
+	if (resource_sample(res, &max))
+		max = -1;
+
+	return snprintf(buf, len, "%d", max);
+}
+
+static int resource_union_sample(struct resource *res, int *value)
 {
 	struct union_resource *ures =
 			container_of(res, struct union_resource, resource);
 	int max = INT_MIN;
+	int found = 0;
 	int i;
 
 	for (i = 0; i < ures->nmembers; ++i) {
-		int value;
-		value = resource_read_int(ures->members[i]);
-		if (value > max)
-			max = value;
+		int v;
+		if (resource_sample(ures->members[i], &v))
+			continue;
+		if (v > max)
+			max = v;
+		found = 1;
 	}
+	if (!found)
+		return -1;
 
-	return snprintf(buf, len, "%d", max);
+	*value = max;
+	return 0;
 }
 
 static int resource_union_write_value(struct resource *res, const char *val, unsigned int len)
@@ -442,6 +573,21 @@ static int resource_union_write_value(struct resource *res, const char *val, uns
 	return 0;
 }
 
+static int resource_union_read_steps(struct resource *res, int *steps, unsigned int max)
+{
+	struct union_resource *ures =
+			container_of(res, struct union_resource, resource);
+	int rc;
+	int i;
+
+	for (i = 0; i < ures->nmembers; ++i) {
+		rc = resource_read_steps(ures->members[i], steps, max);
+		if (rc > 0)
+			return rc;
+	}
+	return -1;
+}
+
 struct resource *resource_union_open(const char *name, int count, const char **names)
 {
 	struct union_resource *res;
@@ -458,7 +604,11 @@ struct resource *resource_union_open(const char *name, int count, const char **n
 	res->resource.close = resource_union_close;
 	res->resource.read_value = resource_union_read_value;
 	res->resource.write_value = resource_union_write_value;
+	res->resource.sample = resource_union_sample;
+	res->resource.compile = resource_union_compile;
+	res->resource.read_steps = resource_union_read_steps;
 	res->nmembers = count;
+	res->nnames = count;
 
 	res->member_names = calloc(1, sizeof(res->member_names[0]) * count);
 	if (res->member_names == NULL) {
@@ -500,6 +650,20 @@ static int resource_alias_prepare(struct resource *res)
 	return -(ares->aliased == NULL);
 }
 
+static void resource_alias_compile(struct resource *res)
+{
+	struct alias_resource *ares =
+			container_of(res, struct alias_resource, resource);
+	ares->aliased = resource_resolve(ares->aliased);
+}
+
+static int resource_alias_sample(struct resource *res, int *value)
+{
+	struct alias_resource *ares =
+			container_of(res, struct alias_resource, resource);
+	return resource_sample(ares->aliased, value);
+}
+
 static void resource_alias_set_edges(struct resource *res, int lo, int hi)
 {
 	struct alias_resource *ares =
@@ -542,6 +706,13 @@ static int resource_alias_write_value(struct resource *res, const char *val, uns
 	return resource_write_value(ares->aliased, val, len);
 }
 
+static int resource_alias_read_steps(struct resource *res, int *steps, unsigned int max)
+{
+	struct alias_resource *ares =
+			container_of(res, struct alias_resource, resource);
+	return resource_read_steps(ares->aliased, steps, max);
+}
+
 struct resource *resource_alias_open(const char *name, const char *aliased)
 {
 	struct alias_resource *res;
@@ -557,6 +728,9 @@ struct resource *resource_alias_open(const char *name, const char *aliased)
 	res->resource.close = resource_alias_close;
 	res->resource.read_value = resource_alias_read_value;
 	res->resource.write_value = resource_alias_write_value;
+	res->resource.sample = resource_alias_sample;
+	res->resource.compile = resource_alias_compile;
+	res->resource.read_steps = resource_alias_read_steps;
 	strncpy(res->alias_name, aliased, sizeof(res->alias_name));
 	res->alias_name[sizeof(res->alias_name) - 1] = 0;
 
@@ -566,6 +740,23 @@ struct resource *resource_alias_open(const char *name, const char *aliased)
 	return &res->resource;
 }
 
+/* Follow alias chains down to the resource which does the actual I/O. */
+struct resource *resource_resolve(struct resource *res)
+{
+	struct alias_resource *ares;
+	int depth;
+
+	for (depth = 0; depth < 8; ++depth) {
+		if (res->read_value != resource_alias_read_value)
+			break;
+		ares = container_of(res, struct alias_resource, resource);
+		if (ares->aliased == NULL)
+			break;
+		res = ares->aliased;
+	}
+	return res;
+}
+
 struct halt_resource {
 	struct resource resource;
 	struct watch_ticket *ticket;
@@ -713,17 +904,34 @@ static void resource_deadband_close(struct resource *res)
 }
 
 static int resource_deadband_read_value(struct resource *res, char *buf, unsigned int len)
+{
+	int ival;
+
+	if (resource_sample(res, &ival))
+		ival = -1;
+	return snprintf(buf, len, "%d", ival);
+}
+
+static int resource_deadband_sample(struct resource *res, int *value)
 {
 	struct deadband_resource *ares =
 			container_of(res, struct deadband_resource, resource);
 	int ival;
 
-	ival = resource_read_int(ares->aliased);
-	if (ABS(ival - ares->lrv) <= ares->deadband)
-		return snprintf(buf, len, "%d", ares->lrv);
+	if (resource_sample(ares->aliased, &ival))
+		ival = -1;
+	if (ABS(ival - ares->lrv) > ares->deadband)
+		ares->lrv = ival;
 
-	ares->lrv = ival;
-	return snprintf(buf, len, "%d", ival);
+	*value = ares->lrv;
+	return 0;
+}
+
+static void resource_deadband_compile(struct resource *res)
+{
+	struct deadband_resource *ares =
+			container_of(res, struct deadband_resource, resource);
+	ares->aliased = resource_resolve(ares->aliased);
 }
 
 static int resource_deadband_write_value(struct resource *res, const char *val, unsigned int len)
@@ -756,6 +964,8 @@ struct resource *resource_deadband_open(const char *name,
 	res->resource.close = resource_deadband_close;
 	res->resource.read_value = resource_deadband_read_value;
 	res->resource.write_value = resource_deadband_write_value;
+	res->resource.sample = resource_deadband_sample;
+	res->resource.compile = resource_deadband_compile;
 	strncpy(res->alias_name, resource, sizeof(res->alias_name));
 	res->alias_name[sizeof(res->alias_name) - 1] = 0;
 
@@ -792,6 +1002,7 @@ static void resource_msmadc_enable(struct resource *res)
 {
 	struct msmadc_resource *ares =
 			container_of(res, struct msmadc_resource, resource);
+	resource_set_slack(ares->sysfs, res->slack);
 	resource_enable(ares->sysfs);
 }
 
@@ -937,6 +1148,8 @@ static void resource_cpufreq_enable(struct resource *res)
 	struct cpufreq_resource *sres =
 			container_of(res, struct cpufreq_resource, resource);
 	sres->ticket = watch_manager_add_timeout(5000);
+	if (sres->ticket != NULL)
+		watch_ticket_set_slack(sres->ticket, res->slack);
 }
 
 static void resource_cpufreq_disable(struct resource *res)
@@ -977,6 +1190,18 @@ static int resource_cpufreq_read_value(struct resource *res,
 	return snprintf(buf, len, "%u", value);
 }
 
+static int resource_cpufreq_sample(struct resource *res, int *value)
+{
+	struct cpufreq_resource *sres =
+			container_of(res, struct cpufreq_resource, resource);
+	unsigned int freq;
+
+	if (cpufreq_read_cur(sres->cpufreq, &freq))
+		freq = 0;
+	*value = freq;
+	return 0;
+}
+
 static int resource_cpufreq_write_value(struct resource *res,
 		const char *val, unsigned int len)
 {
@@ -995,6 +1220,15 @@ static int resource_cpufreq_write_value(struct resource *res,
 	return len;
 }
 
+static int resource_cpufreq_read_steps(struct resource *res,
+		int *steps, unsigned int max)
+{
+	struct cpufreq_resource *sres =
+			container_of(res, struct cpufreq_resource, resource);
+	return cpufreq_read_available(sres->cpufreq,
+			(unsigned int *)steps, max);
+}
+
 struct resource *resource_cpufreq_open(const char *name, const char *file)
 {
 	struct cpufreq_resource *res;
@@ -1012,6 +1246,8 @@ struct resource *resource_cpufreq_open(const char *name, const char *file)
 	res->resource.enable = resource_cpufreq_enable;
 	res->resource.disable = resource_cpufreq_disable;
 	res->resource.read_value = resource_cpufreq_read_value;
+	res->resource.read_steps = resource_cpufreq_read_steps;
+	res->resource.sample = resource_cpufreq_sample;
 	res->resource.close = resource_cpufreq_close;
 
 	strncpy(res->resource.name, name, sizeof(res->resource.name));
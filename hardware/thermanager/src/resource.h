@@ -10,6 +10,12 @@ enum resource_sysfs_t {
 
 struct resource {
 	char name[256];
+	unsigned int slack;
+
+	/* declaration and its hash, used to carry resources over a reload */
+	unsigned long spec_hash;
+	char *spec;
+	int generation;
 
 	int (* prepare)(struct resource *);
 	void (* set_edges)(struct resource *, int upper, int lower);
@@ -19,14 +25,19 @@ struct resource {
 
 	int (* read_value)(struct resource *, char *, unsigned int len);
 	int (* write_value)(struct resource *, const char *, unsigned int len);
+	int (* read_steps)(struct resource *, int *steps, unsigned int max);
+	int (* sample)(struct resource *, int *value);
+	void (* compile)(struct resource *);
 
 	struct list_node list_node;
 };
 
 struct resource *resource_manager_find(const char *name);
+struct resource *resource_resolve(struct resource *res);
 void resource_manager_add(struct resource *res);
 void resource_manager_remove(struct resource *res);
 void resource_manager_prepare(void);
+void resource_manager_swap(struct list *list);
 
 struct resource *resource_tz_open(const char *name, const char *file);
 struct resource *resource_sysfs_open(const char *name, const char *file,
@@ -44,6 +55,7 @@ struct resource *resource_cpufreq_open(const char *name, const char *file);
 
 void resource_close(struct resource *res);
 void resource_set_edges(struct resource *, int lower, int upper);
+void resource_set_slack(struct resource *res, unsigned int ms);
 int resource_prepare(struct resource *res);
 void resource_enable(struct resource *res);
 void resource_disable(struct resource *res);
@@ -51,6 +63,9 @@ int resource_read_value(struct resource *res, char *buf, unsigned int len);
 int resource_write_value(struct resource *res,
 		const char *val, unsigned int len);
 
+int resource_read_steps(struct resource *res, int *steps, unsigned int max);
+
+int resource_sample(struct resource *res, int *value);
 int resource_read_int(struct resource *res);
 int resource_write_int(struct resource *res, int value);
 
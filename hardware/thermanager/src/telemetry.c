@@ -0,0 +1,220 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "log.h"
+#include "util.h"
+#include "watch.h"
+#include "telemetry.h"
+
+#define TELEMETRY_RING_SIZE 1024
+#define TELEMETRY_MAX_CLIENTS 4
+
+struct telemetry_client {
+	int fd;
+	struct watch_ticket *ticket;
+	/* sequence number of the next record to send */
+	unsigned int next;
+	/* socket buffer full, waiting for it to become writable */
+	int blocked;
+};
+
+/*
+ * Records go to a fixed size ring owned by the daemon thread, so recording
+ * never allocates or locks.  Each subscriber has a cursor into the ring,
+ * starting at the oldest record so the backlog is replayed first.  When a
+ * subscriber's socket buffer fills up the rest is sent as it becomes
+ * writable again; a subscriber which falls a whole ring behind skips the
+ * records it missed rather than stalling the daemon.
+ */
+static struct telemetry_record g_telemetry_ring[TELEMETRY_RING_SIZE];
+static unsigned int g_telemetry_head;
+static struct telemetry_client g_telemetry_clients[TELEMETRY_MAX_CLIENTS];
+static struct watch_ticket *g_telemetry_ticket;
+static int g_telemetry_fd = -1;
+
+static void telemetry_drop_client(struct telemetry_client *client)
+{
+	if (client->ticket != NULL)
+		watch_ticket_delete(client->ticket);
+	close(client->fd);
+	client->ticket = NULL;
+	client->fd = -1;
+}
+
+/* send what the client hasn't seen yet, until its socket buffer is full */
+static int telemetry_flush(struct telemetry_client *client)
+{
+	const struct telemetry_record *rec;
+	int blocked = 0;
+	ssize_t rc;
+
+	if (g_telemetry_head - client->next > TELEMETRY_RING_SIZE)
+		client->next = g_telemetry_head > TELEMETRY_RING_SIZE ?
+			g_telemetry_head - TELEMETRY_RING_SIZE : 0;
+
+	while (client->next != g_telemetry_head) {
+		rec = &g_telemetry_ring[client->next % TELEMETRY_RING_SIZE];
+		rc = send(client->fd, rec, sizeof(*rec),
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (rc == sizeof(*rec)) {
+			client->next++;
+			continue;
+		}
+		if (rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			blocked = 1;
+			break;
+		}
+		telemetry_drop_client(client);
+		return -1;
+	}
+
+	if (blocked != client->blocked && client->ticket != NULL) {
+		if (blocked)
+			watch_ticket_set_output(client->ticket, client->fd);
+		else
+			watch_ticket_set_input(client->ticket, client->fd);
+	}
+	client->blocked = blocked;
+	return 0;
+}
+
+static void telemetry_client_cb(void *data, struct watch_ticket *ticket)
+{
+	struct telemetry_client *client = (struct telemetry_client *)data;
+	char buf[16];
+	ssize_t rc;
+
+	watch_ticket_clear(ticket);
+
+	/* subscribers don't talk, readable means hung up */
+	rc = recv(client->fd, buf, sizeof(buf), MSG_DONTWAIT);
+	if (rc == 0 || (rc == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+		telemetry_drop_client(client);
+		return;
+	}
+
+	if (client->blocked)
+		telemetry_flush(client);
+}
+
+static void telemetry_accept_cb(void *data __attribute__ ((__unused__)),
+		struct watch_ticket *ticket)
+{
+	struct telemetry_client *client = NULL;
+	unsigned int i;
+	int fd;
+
+	watch_ticket_clear(ticket);
+
+	fd = accept(g_telemetry_fd, NULL, NULL);
+	if (fd == -1)
+		return;
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	for (i = 0; i < TELEMETRY_MAX_CLIENTS; ++i) {
+		if (g_telemetry_clients[i].fd == -1) {
+			client = &g_telemetry_clients[i];
+			break;
+		}
+	}
+	if (client == NULL) {
+		close(fd);
+		return;
+	}
+
+	client->fd = fd;
+	client->ticket = watch_manager_add_input(fd);
+	if (client->ticket != NULL)
+		watch_ticket_callback(client->ticket, telemetry_client_cb, client);
+
+	/* replay the backlog, starting from the oldest record written */
+	client->next = g_telemetry_head > TELEMETRY_RING_SIZE ?
+		g_telemetry_head - TELEMETRY_RING_SIZE : 0;
+	client->blocked = 0;
+	telemetry_flush(client);
+}
+
+int telemetry_start(void)
+{
+	struct sockaddr_un addr;
+	socklen_t len;
+	int i;
+
+	if (g_telemetry_fd != -1)
+		return 0;
+
+	for (i = 0; i < TELEMETRY_MAX_CLIENTS; ++i)
+		g_telemetry_clients[i].fd = -1;
+
+	g_telemetry_fd = socket(AF_UNIX,
+			SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (g_telemetry_fd == -1)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path + 1, TELEMETRY_SOCKET, sizeof(addr.sun_path) - 2);
+	len = offsetof(struct sockaddr_un, sun_path) + 1 +
+			strlen(TELEMETRY_SOCKET);
+
+	if (bind(g_telemetry_fd, (struct sockaddr *)&addr, len) ||
+			listen(g_telemetry_fd, TELEMETRY_MAX_CLIENTS)) {
+		LOGW("failed to open telemetry socket\n");
+		close(g_telemetry_fd);
+		g_telemetry_fd = -1;
+		return -1;
+	}
+
+	g_telemetry_ticket = watch_manager_add_input(g_telemetry_fd);
+	if (g_telemetry_ticket != NULL)
+		watch_ticket_callback(g_telemetry_ticket, telemetry_accept_cb, NULL);
+
+	return 0;
+}
+
+void telemetry_stop(void)
+{
+	int i;
+
+	if (g_telemetry_fd == -1)
+		return;
+
+	for (i = 0; i < TELEMETRY_MAX_CLIENTS; ++i) {
+		if (g_telemetry_clients[i].fd != -1)
+			telemetry_drop_client(&g_telemetry_clients[i]);
+	}
+	if (g_telemetry_ticket != NULL)
+		watch_ticket_delete(g_telemetry_ticket);
+	g_telemetry_ticket = NULL;
+	close(g_telemetry_fd);
+	g_telemetry_fd = -1;
+}
+
+void telemetry_record(enum telemetry_type type, const char *name,
+		int value, int arg)
+{
+	struct telemetry_record *rec;
+	int i;
+
+	rec = &g_telemetry_ring[g_telemetry_head++ % TELEMETRY_RING_SIZE];
+	rec->time = util_time_ms();
+	rec->type = type;
+	rec->value = value;
+	rec->arg = arg;
+	strncpy(rec->name, name, sizeof(rec->name));
+	rec->name[sizeof(rec->name) - 1] = 0;
+
+	/* blocked clients catch up once their socket is writable */
+	for (i = 0; i < TELEMETRY_MAX_CLIENTS; ++i) {
+		if (g_telemetry_clients[i].fd != -1 &&
+				!g_telemetry_clients[i].blocked)
+			telemetry_flush(&g_telemetry_clients[i]);
+	}
+}
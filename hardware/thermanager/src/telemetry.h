@@ -0,0 +1,34 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+/* abstract UNIX socket streaming telemetry records to subscribers */
+#define TELEMETRY_SOCKET "thermanager-telemetry"
+
+enum telemetry_type {
+	TELEMETRY_SAMPLE,
+	TELEMETRY_THRESHOLD,
+	TELEMETRY_MITIGATION,
+	TELEMETRY_OUTPUT,
+};
+
+/*
+ * One record per SOCK_SEQPACKET message.
+ *   SAMPLE:     name = sensor, value = reading
+ *   THRESHOLD:  name = sensor, value = new threshold trigger, arg = reading
+ *   MITIGATION: name = control, value = new level, arg = previous level
+ *   OUTPUT:     name = pid control, value = written value
+ */
+struct telemetry_record {
+	unsigned long long time;
+	int type;
+	int value;
+	int arg;
+	char name[28];
+};
+
+int telemetry_start(void);
+void telemetry_stop(void);
+void telemetry_record(enum telemetry_type type, const char *name,
+		int value, int arg);
+
+#endif
@@ -6,6 +6,7 @@
 #include <stdio.h>
 
 #include "log.h"
+#include "util.h"
 #include "watch.h"
 #include "thermal_zone.h"
 
@@ -22,6 +23,8 @@ struct thermal_zone {
 
 	int force_enabled;
 	struct thermal_trip trips[2];
+
+	char sample[16];
 };
 
 static int thermal_trip_init(struct thermal_trip *trip,
@@ -87,8 +90,7 @@ static int thermal_trip_set(struct thermal_trip *trip, int temp)
 		return -1;
 
 	rc = snprintf(buf, sizeof(buf), "%d", temp);
-	write(trip->temp_fd, buf, rc);
-	lseek(trip->temp_fd, 0, SEEK_SET);
+	pwrite(trip->temp_fd, buf, rc, 0);
 	trip->temp = temp;
 	return 0;
 }
@@ -98,8 +100,7 @@ static void thermal_trip_cb(void *data, struct watch_ticket *ticket)
 	struct thermal_trip *trip = (struct thermal_trip *)data;
 	if (trip->type_fd != -1) {
 		char buf[PATH_MAX];
-		read(trip->type_fd, buf, sizeof(buf));
-		lseek(trip->type_fd, 0, SEEK_SET);
+		pread(trip->type_fd, buf, sizeof(buf), 0);
 	}
 
 	watch_ticket_clear(ticket);
@@ -169,14 +170,12 @@ void thermal_zone_enable(struct thermal_zone *tz)
 	char buf[10];
 	int rc;
 
-	rc = read(tz->mode_fd, buf, sizeof(buf));
+	rc = pread(tz->mode_fd, buf, sizeof(buf), 0);
 	if (rc <= 0)
 		return;
 
-	lseek(tz->mode_fd, 0, SEEK_SET);
 	if (rc < 7 || strncmp(buf, "enabled", 7)) {
-		write(tz->mode_fd, "enabled", 7);
-		lseek(tz->mode_fd, 0, SEEK_SET);
+		pwrite(tz->mode_fd, "enabled", 7, 0);
 		tz->force_enabled = 1;
 	}
 	thermal_trip_enable(&tz->trips[0]);
@@ -191,18 +190,23 @@ void thermal_zone_disable(struct thermal_zone *tz)
 	if (!tz->force_enabled)
 		return;
 
-	write(tz->mode_fd, "disabled", 8);
-	lseek(tz->mode_fd, 0, SEEK_SET);
+	pwrite(tz->mode_fd, "disabled", 8, 0);
 }
 
 int thermal_zone_read(struct thermal_zone *tz, char *buf, unsigned int blen)
+{
+	return pread(tz->temp_fd, buf, blen, 0);
+}
+
+int thermal_zone_read_int(struct thermal_zone *tz, int *value)
 {
 	int rc;
-	rc = read(tz->temp_fd, buf, blen);
 
-	lseek(tz->temp_fd, 0, SEEK_SET);
+	rc = pread(tz->temp_fd, tz->sample, sizeof(tz->sample), 0);
+	if (rc <= 0)
+		return -1;
 
-	return rc;
+	return util_parse_int(tz->sample, rc, value);
 }
 
 int thermal_zone_set_trip(struct thermal_zone *tz, int lower, int upper)
@@ -10,6 +10,7 @@ void thermal_zone_enable(struct thermal_zone *tz);
 void thermal_zone_disable(struct thermal_zone *tz);
 
 int thermal_zone_read(struct thermal_zone *tz, char *buf, unsigned int blen);
+int thermal_zone_read_int(struct thermal_zone *tz, int *value);
 int thermal_zone_set_trip(struct thermal_zone *tz, int lower, int upper);
 
 #endif
@@ -1,4 +1,7 @@
 #include <unistd.h>
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
 #ifdef ANDROID
 #include <sys/reboot.h>
 #endif
@@ -14,3 +17,60 @@ void util_halt(void)
 #endif
 	_exit(1);
 }
+
+unsigned long long util_time_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/*
+ * Parse a decimal integer as found in sysfs, stopping at the first non-digit.
+ * Anything with a radix prefix is handed to strtol().
+ */
+int util_parse_int(const char *buf, int len, int *value)
+{
+	const char *p = buf;
+	const char *end = buf + len;
+	int negative = 0;
+	long long v = 0;
+
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	if (p == end || *p < '0' || *p > '9')
+		return -1;
+
+	if (*p == '0' && p + 1 < end && (p[1] == 'x' || p[1] == 'X' ||
+			(p[1] >= '0' && p[1] <= '7'))) {
+		char tmp[32];
+		if (len >= (int)sizeof(tmp))
+			len = sizeof(tmp) - 1;
+		memcpy(tmp, buf, len);
+		tmp[len] = 0;
+		*value = strtol(tmp, 0, 0);
+		return 0;
+	}
+
+	while (p < end && *p >= '0' && *p <= '9') {
+		v = v * 10 + (*p++ - '0');
+		if (v > 0x80000000LL)
+			v = 0x80000000LL;
+	}
+	if (negative)
+		v = -v;
+	else if (v > 0x7fffffffLL)
+		v = 0x7fffffffLL;
+
+	*value = (int)v;
+	return 0;
+}
+
+unsigned long util_hash(unsigned long hash, const char *str)
+{
+	while (*str)
+		hash = hash * 33 + (unsigned char)*str++;
+	return hash * 33;
+}
@@ -2,5 +2,8 @@
 #define _UTIL_H_
 
 void util_halt(void);
+unsigned long long util_time_ms(void);
+int util_parse_int(const char *buf, int len, int *value);
+unsigned long util_hash(unsigned long hash, const char *str);
 
 #endif
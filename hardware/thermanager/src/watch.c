@@ -1,12 +1,30 @@
 #include <stdlib.h>
-#include <limits.h>
-#include <poll.h>
-#include <sys/time.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "log.h"
 #include "watch.h"
 #include "list.h"
 
 typedef unsigned long long u64;
 
+/*
+ * Timeouts are kept in a hierarchical timer wheel with a 1ms tick.  Level 0
+ * covers the next 64ms with one slot per tick, every following level covers
+ * 64 times the range of the previous one, so four levels reach roughly 4.6
+ * hours.  Timers beyond that are parked on the last level and re-queued
+ * from there when it cascades.
+ */
+#define WHEEL_BITS	6
+#define WHEEL_SIZE	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SIZE - 1)
+#define WHEEL_LEVELS	4
+#define WHEEL_MAX	((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+#define WATCH_MAX_EVENTS 16
+
 enum watch_type {
 	WATCH_TYPE_NULL,
 	WATCH_TYPE_FD,
@@ -24,34 +42,300 @@ struct watch_ticket {
 		void *data;
 	} callback;
 
-	u64 start;
+	u64 expires;
+	unsigned int slack;
+	unsigned int events;
 	int updated;
 	struct watch *watch;
 	struct list_node list_node;
+
+	/* wheel slot (or dispatch list) the ticket is queued on */
+	struct list *queue;
+	struct list_node queue_node;
+};
+
+struct watch_wheel {
+	u64 now;
+	u64 pending[WHEEL_LEVELS];
+	struct list slots[WHEEL_LEVELS][WHEEL_SIZE];
 };
 
 struct watch {
 	struct list tickets;
 	int count;
+
+	int epoll_fd;
+	int timer_fd;
+	u64 armed;
+	unsigned long wakeups;
+
+	struct watch_wheel wheel;
 };
 
-u64 time_ms(void)
+static u64 time_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/*
+ * Pick the expiry within [expires, expires + slack] with the most trailing
+ * zero bits, so that timers with overlapping slack windows land on the same
+ * tick and get serviced by a single wakeup.
+ */
+static u64 watch_apply_slack(u64 expires, unsigned int slack)
+{
+	u64 limit;
+	u64 mask;
+
+	if (slack == 0)
+		return expires;
+
+	/* highest bit that differs anywhere in the window */
+	limit = expires + slack;
+	mask = limit ^ (expires - 1);
+	mask = (1ULL << (63 - __builtin_clzll(mask))) - 1;
+
+	return limit & ~mask;
+}
+
+static void watch_queue_remove(struct watch_ticket *ticket)
+{
+	struct watch_wheel *wheel = &ticket->watch->wheel;
+	struct list *queue = ticket->queue;
+	int level;
+	int idx;
+
+	if (queue == NULL)
+		return;
+
+	list_remove(queue, &ticket->queue_node);
+	ticket->queue = NULL;
+
+	if (list_first(queue) != NULL)
+		return;
+
+	/* keep the occupancy bitmap in sync with the emptied slot */
+	for (level = 0; level < WHEEL_LEVELS; ++level) {
+		if (queue < &wheel->slots[level][0] ||
+				queue > &wheel->slots[level][WHEEL_MASK])
+			continue;
+		idx = queue - &wheel->slots[level][0];
+		wheel->pending[level] &= ~(1ULL << idx);
+		break;
+	}
+}
+
+static void watch_wheel_insert(struct watch_wheel *wheel,
+		struct watch_ticket *ticket)
+{
+	u64 expires;
+	u64 delta;
+	int level;
+	int idx;
+
+	expires = ticket->expires;
+	if (expires <= wheel->now)
+		expires = wheel->now + 1;
+	delta = expires - wheel->now;
+	if (delta > WHEEL_MAX) {
+		delta = WHEEL_MAX;
+		expires = wheel->now + delta;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; ++level) {
+		if (delta < (1ULL << (WHEEL_BITS * (level + 1))))
+			break;
+	}
+
+	idx = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	ticket->queue = &wheel->slots[level][idx];
+	list_append(ticket->queue, &ticket->queue_node);
+	wheel->pending[level] |= 1ULL << idx;
+}
+
+static void watch_wheel_cascade(struct watch_wheel *wheel, int level, int idx)
+{
+	struct list *slot = &wheel->slots[level][idx];
+	struct watch_ticket *ticket;
+	struct list_node *node;
+
+	wheel->pending[level] &= ~(1ULL << idx);
+	while ((node = list_pop(slot)) != NULL) {
+		ticket = list_entry(node, struct watch_ticket, queue_node);
+		ticket->queue = NULL;
+		if (ticket->expires > wheel->now) {
+			watch_wheel_insert(wheel, ticket);
+			continue;
+		}
+
+		/*
+		 * Due on the tick being cascaded, which the caller runs right
+		 * after this, so queue it on the current level 0 slot rather
+		 * than letting watch_wheel_insert() push it one tick out.
+		 */
+		idx = wheel->now & WHEEL_MASK;
+		ticket->queue = &wheel->slots[0][idx];
+		list_append(ticket->queue, &ticket->queue_node);
+		wheel->pending[0] |= 1ULL << idx;
+	}
+}
+
+/*
+ * First tick after wheel->now which either has level 0 work queued or where
+ * level 0 wraps around and the upper levels need cascading.
+ */
+static u64 watch_wheel_next_tick(struct watch_wheel *wheel)
+{
+	u64 pending;
+	int idx;
+
+	idx = wheel->now & WHEEL_MASK;
+	pending = idx == WHEEL_MASK ? 0 :
+			wheel->pending[0] & ~((2ULL << idx) - 1);
+	if (pending)
+		return (wheel->now & ~(u64)WHEEL_MASK) + __builtin_ctzll(pending);
+
+	return (wheel->now | WHEEL_MASK) + 1;
+}
+
+/*
+ * Advance the wheel up to 'target', moving every expired ticket to 'expired'.
+ * Empty stretches of the wheel are skipped using the occupancy bitmaps.
+ */
+static void watch_wheel_advance(struct watch_wheel *wheel, u64 target,
+		struct list *expired)
+{
+	struct watch_ticket *ticket;
+	struct list_node *node;
+	struct list *slot;
+	u64 tick;
+	int level;
+	int idx;
+
+	while (wheel->now < target) {
+		tick = watch_wheel_next_tick(wheel);
+		if (tick > target) {
+			wheel->now = target;
+			break;
+		}
+		wheel->now = tick;
+
+		idx = tick & WHEEL_MASK;
+		for (level = 1; idx == 0 && level < WHEEL_LEVELS; ++level) {
+			idx = (tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+			watch_wheel_cascade(wheel, level, idx);
+		}
+
+		idx = tick & WHEEL_MASK;
+		slot = &wheel->slots[0][idx];
+		wheel->pending[0] &= ~(1ULL << idx);
+		while ((node = list_pop(slot)) != NULL) {
+			ticket = list_entry(node, struct watch_ticket, queue_node);
+			ticket->queue = expired;
+			list_append(expired, &ticket->queue_node);
+		}
+	}
+}
+
+/* Earliest expiry queued on the wheel, or (u64)-1 when it is empty. */
+static u64 watch_wheel_next_expiry(struct watch_wheel *wheel)
+{
+	struct watch_ticket *ticket;
+	struct list_node *node;
+	u64 next = (u64)-1;
+	u64 pending;
+	int level;
+	int idx;
+	int cur;
+
+	for (level = 0; level < WHEEL_LEVELS; ++level) {
+		if (wheel->pending[level] == 0)
+			continue;
+
+		/* slots after the current one hold the nearest timers */
+		cur = (wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+		pending = cur == WHEEL_MASK ? 0 :
+				wheel->pending[level] & ~((2ULL << cur) - 1);
+		if (pending == 0)
+			pending = wheel->pending[level];
+		idx = __builtin_ctzll(pending);
+
+		for_list_node(&wheel->slots[level][idx], node) {
+			ticket = list_entry(node, struct watch_ticket, queue_node);
+			if (ticket->expires < next)
+				next = ticket->expires;
+		}
+	}
+
+	return next;
+}
+
+static void watch_arm_timer(struct watch *w)
 {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return (u64)tv.tv_sec*1000 + tv.tv_usec/1000;
+	struct itimerspec its;
+	u64 next;
+
+	next = watch_wheel_next_expiry(&w->wheel);
+	if (next == w->armed)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	if (next != (u64)-1) {
+		if (next <= w->wheel.now)
+			next = w->wheel.now + 1;
+		its.it_value.tv_sec = next / 1000;
+		its.it_value.tv_nsec = (next % 1000) * 1000000;
+	}
+	if (timerfd_settime(w->timer_fd, TFD_TIMER_ABSTIME, &its, NULL))
+		LOGE("failed to arm watch timer\n");
+	w->armed = next;
 }
 
 struct watch *watch_create(void)
 {
+	struct epoll_event ev;
 	struct watch *w;
+	int level;
+	int idx;
 
 	w = calloc(1, sizeof(*w));
 	if (w == NULL)
 		return NULL;
 
+	w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (w->epoll_fd == -1)
+		goto err_free;
+
+	w->timer_fd = timerfd_create(CLOCK_MONOTONIC,
+			TFD_NONBLOCK | TFD_CLOEXEC);
+	if (w->timer_fd == -1)
+		goto err_epoll;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->timer_fd, &ev))
+		goto err_timer;
+
 	list_init(&w->tickets);
+	for (level = 0; level < WHEEL_LEVELS; ++level)
+		for (idx = 0; idx < WHEEL_SIZE; ++idx)
+			list_init(&w->wheel.slots[level][idx]);
+	w->wheel.now = time_ms();
+	w->armed = (u64)-1;
+
 	return w;
+
+err_timer:
+	close(w->timer_fd);
+err_epoll:
+	close(w->epoll_fd);
+err_free:
+	LOGE("failed to create watch\n");
+	free(w);
+	return NULL;
 }
 
 void watch_destroy(struct watch *w)
@@ -65,6 +349,8 @@ void watch_destroy(struct watch *w)
 		free(ticket);
 	}
 
+	close(w->timer_fd);
+	close(w->epoll_fd);
 	free(w);
 }
 
@@ -87,114 +373,151 @@ void watch_synchronize(struct watch *w)
 				continue;
 
 			if (oticket->interval == ticket->interval) {
-				oticket->start = ticket->start;
+				watch_queue_remove(oticket);
+				oticket->expires = ticket->expires;
+				watch_wheel_insert(&w->wheel, oticket);
 				break;
 			}
 		}
 	}
 }
 
+static void watch_ticket_fire(struct watch_ticket *ticket)
+{
+	if (ticket->updated)
+		return;
+
+	ticket->updated = 1;
+	if (ticket->callback.fn)
+		(* ticket->callback.fn)(ticket->callback.data, ticket);
+}
+
 void watch_wait(struct watch *w)
 {
-	struct pollfd pfds[w->count];
+	struct epoll_event events[WATCH_MAX_EVENTS];
 	struct watch_ticket *ticket;
 	struct list_node *node;
-	u64 term_time;
-	int count;
-	int idx;
-	u64 now;
+	struct list expired;
+	u64 expirations;
 	int rc;
+	int i;
 
-	idx = 0;
-	term_time = (u64)-1;
-	for_list_node(&w->tickets, node) {
-		ticket = list_entry(node, struct watch_ticket, list_node);
-		switch (ticket->type) {
-		case WATCH_TYPE_TIMEOUT:
-			if (ticket->start + ticket->interval < term_time)
-				term_time = ticket->start + ticket->interval;
-			break;
-		case WATCH_TYPE_FD:
-			pfds[idx].fd = ticket->filedes;
-			pfds[idx].events = POLLERR | POLLPRI;
-			idx++;
-			break;
-		case WATCH_TYPE_NULL:
-			break;
-		}
-	}
-	count = idx;
-
-	if (term_time == (u64)-1) { /* wait forever */
-		rc = poll(pfds, count, -1);
-	} else {
-		now = time_ms();
-		if (now >= term_time) { /* already past timeout, skip poll */
-			rc = 0;
-		} else {
-			u64 delta;
-
-			delta = term_time - now;
-			if (delta > INT_MAX)
-				delta = INT_MAX;
-			rc = poll(pfds, count, (int)delta);
-		}
-	}
+	watch_arm_timer(w);
 
+	rc = epoll_wait(w->epoll_fd, events, WATCH_MAX_EVENTS, -1);
 	if (rc < 0)
 		return;
+	w->wakeups++;
 
-	idx = 0;
-	now = time_ms();
-	for_list_node(&w->tickets, node) {
-		int fresh = 0;
-
-		ticket = list_entry(node, struct watch_ticket, list_node);
-		switch (ticket->type) {
-		case WATCH_TYPE_TIMEOUT:
-			if (now >= ticket->start + ticket->interval) {
-				ticket->start = now;
-				fresh = !ticket->updated;
-			}
-			break;
-		case WATCH_TYPE_FD:
-			if (rc == 0) /* timed-out */
-				break;
-			if (pfds[idx].revents & (POLLERR | POLLPRI)) {
-				fresh = !ticket->updated;
-			}
-			idx++;
-			break;
-		case WATCH_TYPE_NULL:
-			break;
-		}
-		if (fresh) {
-			ticket->updated = 1;
-			if (ticket->callback.fn)
-				(* ticket->callback.fn)(
-						ticket->callback.data,
-						ticket
-				);
+	for (i = 0; i < rc; ++i) {
+		ticket = (struct watch_ticket *)events[i].data.ptr;
+		if (ticket == NULL) {
+			read(w->timer_fd, &expirations, sizeof(expirations));
+			w->armed = (u64)-1;
+			continue;
 		}
+		if (events[i].events & ticket->events)
+			watch_ticket_fire(ticket);
+	}
+
+	/*
+	 * Expired timeouts are re-queued for their next period before the
+	 * callback runs, so callbacks are free to reset or delete tickets.
+	 */
+	list_init(&expired);
+	watch_wheel_advance(&w->wheel, time_ms(), &expired);
+	while ((node = list_pop(&expired)) != NULL) {
+		ticket = list_entry(node, struct watch_ticket, queue_node);
+		ticket->queue = NULL;
+		ticket->expires = watch_apply_slack(
+				w->wheel.now + ticket->interval, ticket->slack);
+		watch_wheel_insert(&w->wheel, ticket);
+		watch_ticket_fire(ticket);
 	}
 }
 
-void watch_ticket_set_null(struct watch_ticket *ticket)
+unsigned long watch_wakeups(struct watch *w)
+{
+	return w->wakeups;
+}
+
+static void watch_ticket_unset(struct watch_ticket *ticket)
 {
+	switch (ticket->type) {
+	case WATCH_TYPE_TIMEOUT:
+		watch_queue_remove(ticket);
+		break;
+	case WATCH_TYPE_FD:
+		epoll_ctl(ticket->watch->epoll_fd, EPOLL_CTL_DEL,
+				ticket->filedes, NULL);
+		break;
+	case WATCH_TYPE_NULL:
+		break;
+	}
 	ticket->type = WATCH_TYPE_NULL;
 }
 
-void watch_ticket_set_fd(struct watch_ticket *ticket, int fd)
+void watch_ticket_set_null(struct watch_ticket *ticket)
 {
+	watch_ticket_unset(ticket);
+}
+
+static void watch_ticket_set_fd_events(struct watch_ticket *ticket, int fd,
+		unsigned int events)
+{
+	struct epoll_event ev;
+
+	watch_ticket_unset(ticket);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.ptr = ticket;
+	if (epoll_ctl(ticket->watch->epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+		LOGE("failed to watch fd %d\n", fd);
+		return;
+	}
+
 	ticket->type = WATCH_TYPE_FD;
 	ticket->filedes = fd;
+	ticket->events = events;
+}
+
+/* sysfs style notification, the fd is flagged with an exceptional condition */
+void watch_ticket_set_fd(struct watch_ticket *ticket, int fd)
+{
+	watch_ticket_set_fd_events(ticket, fd, EPOLLERR | EPOLLPRI);
+}
+
+/* the fd became readable, or was hung up */
+void watch_ticket_set_input(struct watch_ticket *ticket, int fd)
+{
+	watch_ticket_set_fd_events(ticket, fd, EPOLLIN | EPOLLERR | EPOLLHUP);
+}
+
+/* the fd became writable or readable, or was hung up */
+void watch_ticket_set_output(struct watch_ticket *ticket, int fd)
+{
+	watch_ticket_set_fd_events(ticket, fd,
+			EPOLLIN | EPOLLOUT | EPOLLERR | EPOLLHUP);
 }
 
 void watch_ticket_set_timeout(struct watch_ticket *ticket, unsigned int ms)
 {
+	struct watch *w = ticket->watch;
+
+	watch_ticket_unset(ticket);
+
 	ticket->type = WATCH_TYPE_TIMEOUT;
 	ticket->interval = ms;
-	ticket->start = time_ms();
+	ticket->expires = watch_apply_slack(time_ms() + ms, ticket->slack);
+	watch_wheel_insert(&w->wheel, ticket);
+}
+
+void watch_ticket_set_slack(struct watch_ticket *ticket, unsigned int ms)
+{
+	ticket->slack = ms;
+	if (ticket->type == WATCH_TYPE_TIMEOUT)
+		watch_ticket_set_timeout(ticket, ticket->interval);
 }
 
 struct watch_ticket *watch_add_null(struct watch *w)
@@ -205,12 +528,11 @@ struct watch_ticket *watch_add_null(struct watch *w)
 	if (ticket == NULL)
 		return NULL;
 	ticket->watch = w;
+	ticket->type = WATCH_TYPE_NULL;
 
 	list_append(&w->tickets, &ticket->list_node);
 	w->count++;
 
-	watch_ticket_set_null(ticket);
-
 	return ticket;
 }
 
@@ -227,6 +549,19 @@ struct watch_ticket *watch_add_fd(struct watch *w, int fd)
 	return ticket;
 }
 
+struct watch_ticket *watch_add_input(struct watch *w, int fd)
+{
+	struct watch_ticket *ticket;
+
+	ticket = watch_add_null(w);
+	if (ticket == NULL)
+		return NULL;
+
+	watch_ticket_set_input(ticket, fd);
+
+	return ticket;
+}
+
 struct watch_ticket *watch_add_timeout(struct watch *w, unsigned int ms)
 {
 	struct watch_ticket *ticket;
@@ -243,6 +578,9 @@ struct watch_ticket *watch_add_timeout(struct watch *w, unsigned int ms)
 void watch_ticket_delete(struct watch_ticket *ticket)
 {
 	struct watch *w = ticket->watch;
+
+	watch_ticket_unset(ticket);
+	watch_queue_remove(ticket);
 	list_remove(&w->tickets, &ticket->list_node);
 	w->count--;
 	free(ticket);
@@ -291,6 +629,13 @@ struct watch_ticket *watch_manager_add_fd(int fd)
 	return watch_add_fd(g_watch_manager_watch, fd);
 }
 
+struct watch_ticket *watch_manager_add_input(int fd)
+{
+	if (g_watch_manager_watch == NULL)
+		return NULL;
+	return watch_add_input(g_watch_manager_watch, fd);
+}
+
 struct watch_ticket *watch_manager_add_timeout(unsigned int ms)
 {
 	if (g_watch_manager_watch == NULL)
@@ -304,3 +649,10 @@ void watch_manager_wait(void)
 		return;
 	watch_wait(g_watch_manager_watch);
 }
+
+unsigned long watch_manager_wakeups(void)
+{
+	if (g_watch_manager_watch == NULL)
+		return 0;
+	return watch_wakeups(g_watch_manager_watch);
+}
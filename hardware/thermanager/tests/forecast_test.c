@@ -0,0 +1,311 @@
+/*
+ * Replay harness for the predictive configuration mode.
+ *
+ *   forecast_test                 built-in checks and a simulated replay
+ *   forecast_test <trace>         also replay a recorded trace, one
+ *                                 "<ms> <millidegrees>" sample per line,
+ *                                 and report when each level engages
+ *                                 (-1 when it never does)
+ *
+ * The closed loop replay drives a thermal RC model of the SoC through a
+ * three level cpufreq ladder, once reacting to the sensor and once to the
+ * forecast, and reports the sustained frequency and peak temperature of each.
+ * On that trace the predictive mode buys headroom, not frequency: it caps
+ * earlier in every load period, for a lower peak at a lower sustained
+ * frequency, and the load cycle sets the number of cap changes in both modes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "forecast.h"
+#include "test.h"
+
+#define SAMPLE_INTERVAL	1000
+#define SAMPLE_DEPTH	8
+#define HORIZON		10000
+
+static unsigned int rand_state = 1;
+
+static int rand_range(int range)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (int)((rand_state >> 8) % (2 * range + 1)) - range;
+}
+
+static long long abs_ll(long long v)
+{
+	return v < 0 ? -v : v;
+}
+
+/*
+ * Mirrors configuration_run(): sample on the interval tick, or when a full
+ * interval passed since the newest sample, and act on the higher of the
+ * reading and the forecast made at the last sample.
+ */
+struct engine {
+	struct forecast *fc;
+	int gated;
+	int predicted;
+	int predicted_valid;
+};
+
+static void engine_init(struct engine *e, int gated)
+{
+	e->fc = forecast_create(SAMPLE_DEPTH);
+	e->gated = gated;
+	e->predicted_valid = 0;
+}
+
+static int engine_run(struct engine *e, unsigned long long ms, int value,
+		int tick)
+{
+	if (!e->gated || tick ||
+			forecast_sample_due(e->fc, ms, SAMPLE_INTERVAL)) {
+		forecast_add_sample(e->fc, ms, value);
+		e->predicted_valid = !forecast_value(e->fc, HORIZON,
+				&e->predicted);
+	}
+	if (e->predicted_valid && e->predicted > value)
+		return e->predicted;
+	return value;
+}
+
+static void engine_destroy(struct engine *e)
+{
+	forecast_destroy(e->fc);
+}
+
+static void test_linear_fit(void)
+{
+	struct forecast *fc = forecast_create(SAMPLE_DEPTH);
+	int value;
+	int i;
+
+	CHECK(forecast_value(fc, HORIZON, &value) < 0);
+	for (i = 0; i < 20; ++i)
+		forecast_add_sample(fc, 5000 + i * 1000ULL, 40000 + i * 100);
+
+	/* 100 mC/s, newest 41900, 10s ahead */
+	CHECK(forecast_value(fc, HORIZON, &value) == 0);
+	CHECK_EQ(value, 42900);
+
+	CHECK(!forecast_sample_due(fc, 24999, 1000));
+	CHECK(forecast_sample_due(fc, 25000, 1000));
+
+	forecast_destroy(fc);
+}
+
+/*
+ * A steady 50 mC/s ramp read with +-300 mC of noise.  Besides the interval
+ * tick the loop wakes up at random for unrelated tickets; without gating
+ * those bursts crowd the ring and the extrapolated slope becomes noise.
+ */
+static void test_burst_gating(void)
+{
+	struct engine gated, ungated;
+	long long err_gated = 0, err_ungated = 0;
+	unsigned long long ms;
+	int truth, reading, n = 0;
+	int burst;
+
+	engine_init(&gated, 1);
+	engine_init(&ungated, 0);
+
+	for (ms = 1000; ms < 600000; ms += SAMPLE_INTERVAL) {
+		for (burst = 0; burst < 6; ++burst) {
+			unsigned long long t = ms + 20 + burst * 3;
+
+			reading = 40000 + (int)(t * 50 / 1000) +
+					rand_range(300);
+			engine_run(&gated, t, reading, 0);
+			engine_run(&ungated, t, reading, 0);
+		}
+
+		ms += 100;
+		reading = 40000 + (int)(ms * 50 / 1000) + rand_range(300);
+		engine_run(&gated, ms, reading, 1);
+		engine_run(&ungated, ms, reading, 1);
+		ms -= 100;
+
+		if (ms < 20000 || !gated.predicted_valid ||
+				!ungated.predicted_valid)
+			continue;
+		truth = 40000 + (int)((ms + 100 + HORIZON) * 50 / 1000);
+		err_gated += abs_ll(gated.predicted - truth);
+		err_ungated += abs_ll(ungated.predicted - truth);
+		n++;
+	}
+
+	fprintf(stderr, "  mean forecast error %lld mC gated, %lld mC ungated\n",
+			err_gated / n, err_ungated / n);
+	CHECK(err_gated / n < 1000);
+	CHECK(err_gated * 2 < err_ungated);
+
+	engine_destroy(&gated);
+	engine_destroy(&ungated);
+}
+
+/* threshold ladder shared by both modes: trigger, clear, cap in MHz */
+static const struct {
+	int trigger;
+	int clear;
+	int cap;
+} ladder[] = {
+	{ INT_MIN, INT_MIN, 1800 },
+	{ 60000, 55000, 1500 },
+	{ 66000, 61000, 1200 },
+	{ 72000, 67000, 960 },
+};
+#define LADDER_LEVELS (int)(sizeof(ladder) / sizeof(ladder[0]))
+
+static int ladder_level(int level, int value)
+{
+	while (level + 1 < LADDER_LEVELS && value >= ladder[level + 1].trigger)
+		level++;
+	while (level > 0 && value < ladder[level].clear)
+		level--;
+	return level;
+}
+
+struct replay_result {
+	long long freq_sum;
+	long long busy_ms;
+	int peak;
+	int cap_changes;
+};
+
+/*
+ * Lumped RC model: dT/dt = (ambient + R * P - T) / tau with the dynamic
+ * power scaling with the cube of the frequency, sampled once per tick.
+ */
+static void replay_closed_loop(int predictive, struct replay_result *res)
+{
+	const double ambient = 35.0, r = 8.0, tau = 30.0;
+	struct engine e;
+	unsigned long long ms;
+	double temp = ambient;
+	double f, load, power;
+	int level = 0, prev_level = 0;
+	int value;
+
+	engine_init(&e, 1);
+	res->freq_sum = res->busy_ms = res->cap_changes = 0;
+	res->peak = INT_MIN;
+
+	for (ms = 0; ms < 30 * 60 * 1000; ms += 100) {
+		/* 90 s of sustained load then 30 s idle */
+		load = (ms / 1000) % 120 < 90 ? 1.0 : 0.05;
+		f = ladder[level].cap / 1000.0;
+		power = 0.4 + load * f * f * f;
+		temp += (ambient + r * power - temp) * 0.1 / tau;
+
+		if ((int)(temp * 1000) > res->peak)
+			res->peak = (int)(temp * 1000);
+		if (load == 1.0) {
+			res->freq_sum += ladder[level].cap * 100LL;
+			res->busy_ms += 100;
+		}
+
+		if (ms % SAMPLE_INTERVAL)
+			continue;
+		value = (int)(temp * 1000);
+		if (predictive)
+			value = engine_run(&e, ms, value, 1);
+		level = ladder_level(level, value);
+		if (level != prev_level)
+			res->cap_changes++;
+		prev_level = level;
+	}
+
+	engine_destroy(&e);
+}
+
+static void test_closed_loop_replay(void)
+{
+	struct replay_result reactive, predictive;
+
+	replay_closed_loop(0, &reactive);
+	replay_closed_loop(1, &predictive);
+
+	fprintf(stderr, "  reactive:   %lld MHz sustained, peak %d mC, "
+			"%d cap changes\n",
+			reactive.freq_sum / reactive.busy_ms,
+			reactive.peak, reactive.cap_changes);
+	fprintf(stderr, "  predictive: %lld MHz sustained, peak %d mC, "
+			"%d cap changes\n",
+			predictive.freq_sum / predictive.busy_ms,
+			predictive.peak, predictive.cap_changes);
+
+	/*
+	 * No horizon, depth or shift of the ladder gives both more frequency
+	 * and fewer cap changes here, so check the trade stays the documented
+	 * one: lower peak, no extra cap changes, at most 2% frequency lost.
+	 */
+	CHECK(predictive.peak < reactive.peak);
+	CHECK(predictive.cap_changes <= reactive.cap_changes);
+	CHECK(predictive.freq_sum / predictive.busy_ms * 50 >=
+			reactive.freq_sum / reactive.busy_ms * 49);
+}
+
+/* forecast accuracy and trigger lead time over a recorded trace */
+static int replay_trace(const char *path)
+{
+	struct engine e;
+	FILE *fp;
+	unsigned long long ms, first_ms = 0;
+	long long reactive_at[LADDER_LEVELS];
+	long long predictive_at[LADDER_LEVELS];
+	int value, acted;
+	int reactive_level = 0, predictive_level = 0;
+	int i, n = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	for (i = 0; i < LADDER_LEVELS; ++i)
+		reactive_at[i] = predictive_at[i] = -1;
+
+	engine_init(&e, 1);
+	while (fscanf(fp, "%llu %d", &ms, &value) == 2) {
+		if (n++ == 0)
+			first_ms = ms;
+		acted = engine_run(&e, ms, value, 0);
+
+		reactive_level = ladder_level(reactive_level, value);
+		predictive_level = ladder_level(predictive_level, acted);
+		for (i = 1; i < LADDER_LEVELS; ++i) {
+			if (reactive_level >= i && reactive_at[i] < 0)
+				reactive_at[i] = ms - first_ms;
+			if (predictive_level >= i && predictive_at[i] < 0)
+				predictive_at[i] = ms - first_ms;
+		}
+	}
+	fclose(fp);
+	engine_destroy(&e);
+
+	printf("%s: %d samples over %llu ms\n", path, n, ms - first_ms);
+	for (i = 1; i < LADDER_LEVELS; ++i) {
+		if (reactive_at[i] < 0 && predictive_at[i] < 0)
+			continue;
+		printf("  level %d (%d mC): reactive at %lld ms, "
+				"predictive at %lld ms\n", i, ladder[i].trigger,
+				reactive_at[i], predictive_at[i]);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	TEST_RUN(test_linear_fit);
+	TEST_RUN(test_burst_gating);
+	TEST_RUN(test_closed_loop_replay);
+
+	if (argc > 1 && replay_trace(argv[1]))
+		return EXIT_FAILURE;
+
+	return TEST_EXIT();
+}
@@ -0,0 +1,194 @@
+/*
+ * Configuration load benchmark.  Writes a device sized configuration,
+ * compiles it into an image like 'thermanager --compile' does, and
+ * compares loading the XML through libxml2 with loading the image: time
+ * per load and the peak RSS of a process which loads the configuration
+ * once, over that of one which doesn't.
+ *
+ *   load_bench [loads]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "dom.h"
+#include "test.h"
+
+#define NUM_ZONES 32
+#define NUM_LEVELS 8
+#define DEFAULT_LOADS 500
+
+static char tmpdir[] = "/tmp/thermanager-loadXXXXXX";
+static char xml_path[128];
+static char image_path[128];
+
+/* one sensor, control and configuration per zone, like a large SoC */
+static void write_config(const char *path)
+{
+	FILE *fp;
+	int i, l;
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(fp, "<thermanager>\n\t<resources>\n");
+	for (i = 0; i < NUM_ZONES; ++i) {
+		fprintf(fp, "\t\t<resource name=\"zone%d\" type=\"tz\">"
+				"/sys/class/thermal/thermal_zone%d</resource>\n",
+				i, i);
+		fprintf(fp, "\t\t<resource name=\"freq%d\" type=\"cpufreq\">"
+				"/sys/devices/system/cpu/cpu%d/cpufreq"
+				"</resource>\n", i, i);
+	}
+	fprintf(fp, "\t</resources>\n");
+
+	for (i = 0; i < NUM_ZONES; ++i) {
+		fprintf(fp, "\t<control name=\"ctrl%d\">\n", i);
+		fprintf(fp, "\t\t<mitigation level=\"off\"><value "
+				"resource=\"freq%d\">1958400</value></mitigation>\n",
+				i);
+		for (l = 1; l <= NUM_LEVELS; ++l)
+			fprintf(fp, "\t\t<mitigation level=\"%d\"><value "
+					"resource=\"freq%d\">%d</value>"
+					"</mitigation>\n",
+					l, i, 1958400 - l * 153600);
+		fprintf(fp, "\t</control>\n");
+	}
+
+	for (i = 0; i < NUM_ZONES; ++i) {
+		fprintf(fp, "\t<configuration sensor=\"zone%d\">\n", i);
+		fprintf(fp, "\t\t<threshold>\n\t\t\t<mitigation "
+				"name=\"ctrl%d\" level=\"off\" />\n"
+				"\t\t</threshold>\n", i);
+		for (l = 1; l <= NUM_LEVELS; ++l)
+			fprintf(fp, "\t\t<threshold trigger=\"%d\" "
+					"clear=\"%d\">\n\t\t\t<mitigation "
+					"name=\"ctrl%d\" level=\"%d\" />\n"
+					"\t\t</threshold>\n",
+					60000 + l * 5000, 57000 + l * 5000,
+					i, l);
+		fprintf(fp, "\t</configuration>\n");
+	}
+	fprintf(fp, "</thermanager>\n");
+	fclose(fp);
+}
+
+static void setup(void)
+{
+	struct dom *dom;
+
+	if (mkdtemp(tmpdir) == NULL) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+	snprintf(xml_path, sizeof(xml_path), "%s/thermanager.xml", tmpdir);
+	snprintf(image_path, sizeof(image_path), "%s/thermanager.img", tmpdir);
+
+	write_config(xml_path);
+	dom = dom_load(xml_path);
+	CHECK(dom != NULL);
+	CHECK_EQ(dom_save(dom, image_path), 0);
+	dom_destroy(dom);
+}
+
+static void teardown(void)
+{
+	unlink(xml_path);
+	unlink(image_path);
+	rmdir(tmpdir);
+}
+
+/* objects and attributes of the tree, to check both loads agree */
+static int dom_count(const struct dom_obj *obj)
+{
+	const struct list_node *node;
+	int n = 1;
+
+	for_list_node(&obj->attributes, node)
+		n++;
+	for_list_node(&obj->children, node)
+		n += dom_count(list_entry(node, const struct dom_obj, list_node));
+	return n;
+}
+
+struct load_stats {
+	double ns;
+	long rss_kb;
+	int nodes;
+};
+
+/* peak RSS of a child which loads 'path' once, NULL loads nothing */
+static long child_rss(const char *path)
+{
+	struct rusage ru;
+	struct dom *dom;
+	int status;
+	pid_t pid;
+
+	pid = fork();
+	if (pid == 0) {
+		dom = path ? dom_load(path) : NULL;
+		_exit(path && dom == NULL);
+	}
+	if (pid == -1 || wait4(pid, &status, 0, &ru) != pid ||
+			!WIFEXITED(status) || WEXITSTATUS(status))
+		return -1;
+	return ru.ru_maxrss;
+}
+
+static void measure(const char *path, unsigned long loads,
+		struct load_stats *st)
+{
+	struct timespec t0, t1;
+	struct dom *dom;
+	unsigned long i;
+
+	dom = dom_load(path);
+	CHECK(dom != NULL);
+	st->nodes = dom ? dom_count(dom_root(dom)) : 0;
+	dom_destroy(dom);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < loads; ++i)
+		dom_destroy(dom_load(path));
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	st->ns = ((t1.tv_sec - t0.tv_sec) * 1e9 +
+			(t1.tv_nsec - t0.tv_nsec)) / loads;
+
+	st->rss_kb = child_rss(path);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long loads = DEFAULT_LOADS;
+	struct load_stats xml, image;
+	long base_kb;
+
+	if (argc > 1)
+		loads = strtoul(argv[1], NULL, 0);
+
+	setup();
+
+	measure(xml_path, loads, &xml);
+	measure(image_path, loads, &image);
+	base_kb = child_rss(NULL);
+
+	printf("%d nodes: xml %.0f us, +%ld kB peak RSS; "
+			"image %.0f us, +%ld kB peak RSS\n",
+			xml.nodes, xml.ns / 1000, xml.rss_kb - base_kb,
+			image.ns / 1000, image.rss_kb - base_kb);
+
+	CHECK_EQ(image.nodes, xml.nodes);
+	CHECK(image.ns < xml.ns);
+	CHECK(image.rss_kb <= xml.rss_kb);
+
+	teardown();
+	return TEST_EXIT();
+}
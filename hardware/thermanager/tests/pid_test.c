@@ -0,0 +1,311 @@
+/*
+ * Host simulation of the pid control type.  The controller is stepped
+ * directly against a lumped thermal RC model of a SoC whose power scales
+ * with the cube of the cpufreq cap the controller writes.
+ */
+#include <stdio.h>
+#include <math.h>
+
+/* keep the per-step output logging of pid.c quiet */
+#define LOG_TAG "pid_test"
+#define LOGV(x, ...) do { } while (0)
+#define LOGE(x, ...) fprintf(stderr, x, ##__VA_ARGS__)
+
+#include "../src/pid.c"
+#include "test.h"
+
+static const int opps[] = {
+	300000, 422400, 652800, 729600, 883200, 960000, 1036800,
+	1190400, 1267200, 1497600, 1574400, 1728000, 1958400,
+};
+#define NUM_OPPS (int)(sizeof(opps) / sizeof(opps[0]))
+
+static struct resource fake_sensor = { .name = "soc-temp" };
+static struct resource fake_output = { .name = "cpu-freq" };
+
+struct plant {
+	double temp;		/* degrees C */
+	double load;		/* 0..1 */
+	int freq;		/* kHz, last cap written */
+	int bad_writes;
+	int writes;
+};
+
+static struct plant plant;
+
+/* ---- stubs for the daemon around pid.c ---- */
+
+struct resource *resource_manager_find(const char *name)
+{
+	if (!strcmp(name, fake_sensor.name))
+		return &fake_sensor;
+	if (!strcmp(name, fake_output.name))
+		return &fake_output;
+	return NULL;
+}
+
+int resource_read_steps(struct resource *res, int *steps, unsigned int max)
+{
+	int i;
+
+	if (res != &fake_output || max < NUM_OPPS)
+		return -1;
+	for (i = 0; i < NUM_OPPS; ++i)
+		steps[i] = opps[i];
+	return NUM_OPPS;
+}
+
+int resource_read_int(struct resource *res)
+{
+	return res == &fake_sensor ? (int)(plant.temp * 1000) : -1;
+}
+
+int resource_write_int(struct resource *res, int value)
+{
+	int i;
+
+	if (res != &fake_output)
+		return -1;
+	for (i = 0; i < NUM_OPPS && opps[i] != value; ++i)
+		;
+	if (i == NUM_OPPS)
+		plant.bad_writes++;
+	plant.writes++;
+	plant.freq = value;
+	return 0;
+}
+
+void resource_enable(struct resource *res) { (void)res; }
+void resource_disable(struct resource *res) { (void)res; }
+
+struct watch_ticket *watch_manager_add_timeout(unsigned int ms)
+{
+	(void)ms;
+	return NULL;
+}
+
+void watch_ticket_callback(struct watch_ticket *ticket,
+		void (* cb_fn)(void *, struct watch_ticket *), void *data)
+{
+	(void)ticket; (void)cb_fn; (void)data;
+}
+
+void watch_ticket_delete(struct watch_ticket *ticket) { (void)ticket; }
+int watch_ticket_clear(struct watch_ticket *ticket) { (void)ticket; return 0; }
+
+void telemetry_record(enum telemetry_type type, const char *name,
+		int value, int arg)
+{
+	(void)type; (void)name; (void)value; (void)arg;
+}
+
+/* ---- thermal RC plant ---- */
+
+#define AMBIENT		35.0
+#define R_THERMAL	9.0	/* C/W */
+#define TAU		20.0	/* s */
+
+static void plant_reset(double load)
+{
+	plant.temp = AMBIENT;
+	plant.load = load;
+	plant.freq = opps[NUM_OPPS - 1];
+	plant.bad_writes = 0;
+	plant.writes = 0;
+}
+
+/* advance the plant by 'ms' in 10ms steps */
+static void plant_run(unsigned int ms)
+{
+	double ghz, power;
+	unsigned int t;
+
+	for (t = 0; t < ms; t += 10) {
+		ghz = plant.freq / 1000000.0;
+		power = 0.3 + plant.load * 1.1 * ghz * ghz * ghz;
+		plant.temp += (AMBIENT + R_THERMAL * power - plant.temp) *
+				0.01 / TAU;
+	}
+}
+
+static struct pid_control *make_pid(int target)
+{
+	struct pid_control *pid;
+
+	pid = pid_control_create("cpu-pid", "soc-temp", "cpu-freq", target);
+	pid_control_set_gains(pid, 60, 12, 0);
+	pid_control_set_interval(pid, 1000);
+	return pid;
+}
+
+struct run_stats {
+	double peak;
+	double freq_sum;
+	int n;
+	double settled_min;
+	double settled_max;
+};
+
+/* run 'seconds' of closed loop, stats cover the last 'tail' seconds */
+static void run_loop(struct pid_control *pid, int seconds, int tail,
+		struct run_stats *st)
+{
+	int s;
+
+	st->peak = -1000;
+	st->freq_sum = 0;
+	st->n = 0;
+	st->settled_min = 1000;
+	st->settled_max = -1000;
+
+	for (s = 0; s < seconds; ++s) {
+		plant_run(1000);
+		pid_control_step(pid, NULL);
+		if (plant.temp > st->peak)
+			st->peak = plant.temp;
+		if (s >= seconds - tail) {
+			st->freq_sum += plant.freq;
+			st->n++;
+			st->settled_min = fmin(st->settled_min, plant.temp);
+			st->settled_max = fmax(st->settled_max, plant.temp);
+		}
+	}
+}
+
+/*
+ * Full load would settle far above the target; the controller must bring
+ * the SoC to 80C with a bounded overshoot and then hold it within the
+ * ripple the OPP spacing allows.
+ */
+static void test_settling(void)
+{
+	struct pid_control *pid = make_pid(80000);
+	struct run_stats st;
+
+	plant_reset(1.0);
+	run_loop(pid, 600, 300, &st);
+
+	fprintf(stderr, "  peak %.2fC, settled %.2f..%.2fC at %.0f kHz avg\n",
+			st.peak, st.settled_min, st.settled_max,
+			st.freq_sum / st.n);
+	CHECK(st.peak < 84.0);
+	CHECK(st.settled_min > 79.0);
+	CHECK(st.settled_max < 81.0);
+	CHECK_EQ(plant.bad_writes, 0);
+
+	pid_control_destroy(pid);
+}
+
+/*
+ * Ten minutes of light load keep the output pinned to the top OPP with
+ * positive error.  Without anti-windup the integral would grow by
+ * error * dt every second and the heavy load step afterwards would run
+ * far past the target before it unwound.
+ */
+static void test_anti_windup(void)
+{
+	struct pid_control *pid = make_pid(80000);
+	struct run_stats st;
+
+	plant_reset(0.2);
+	run_loop(pid, 600, 1, &st);
+	CHECK_EQ(plant.freq, opps[NUM_OPPS - 1]);
+	CHECK(fabs(pid->integral) < 1.0);
+
+	plant.load = 1.0;
+	run_loop(pid, 300, 120, &st);
+	fprintf(stderr, "  peak after load step %.2fC\n", st.peak);
+	CHECK(st.peak < 84.0);
+	CHECK(st.settled_max < 81.0);
+
+	/* and saturated low: the integral must not wind down either */
+	pid->target = 20000;
+	run_loop(pid, 300, 1, &st);
+	CHECK_EQ(plant.freq, opps[0]);
+	pid->target = 80000;
+	run_loop(pid, 120, 1, &st);
+	CHECK(plant.freq > opps[0]);
+
+	pid_control_destroy(pid);
+}
+
+static void test_quantization(void)
+{
+	struct pid_control *pid = make_pid(80000);
+	int i;
+
+	/* nearest OPP, ties go to the lower one */
+	CHECK_EQ(pid_control_snap(pid, 0), opps[0]);
+	CHECK_EQ(pid_control_snap(pid, 5000000), opps[NUM_OPPS - 1]);
+	CHECK_EQ(pid_control_snap(pid, 700000), 729600);
+	CHECK_EQ(pid_control_snap(pid, 691200), 652800);
+	for (i = 0; i < NUM_OPPS; ++i)
+		CHECK_EQ(pid_control_snap(pid, opps[i] + 1), opps[i]);
+
+	/* only OPPs are ever written, and only when the step changes */
+	plant_reset(1.0);
+	plant.freq = 0;
+	pid->current = INT_MIN;
+	for (i = 0; i < 600; ++i) {
+		int before = plant.writes;
+		int prev = pid->current;
+
+		plant_run(1000);
+		pid_control_step(pid, NULL);
+		if (plant.writes != before)
+			CHECK(pid->current != prev);
+	}
+	CHECK_EQ(plant.bad_writes, 0);
+	CHECK(plant.writes < 600);
+
+	pid_control_destroy(pid);
+}
+
+/*
+ * The same plant under a classic two level <control>: cap the cpu once
+ * 80C is triggered and lift the cap again below 75C.  The controller has
+ * to sustain a higher average frequency with a lower steady state peak.
+ */
+static void test_vs_mitigation_table(void)
+{
+	struct pid_control *pid = make_pid(80000);
+	struct run_stats st;
+	double table_sum = 0, table_peak = -1000;
+	int level = 0;
+	int s;
+
+	plant_reset(1.0);
+	for (s = 0; s < 600; ++s) {
+		plant_run(1000);
+		if (!level && plant.temp >= 80.0)
+			level = 1;
+		else if (level && plant.temp < 75.0)
+			level = 0;
+		plant.freq = level ? 1267200 : opps[NUM_OPPS - 1];
+		if (s >= 300) {
+			table_sum += plant.freq;
+			table_peak = fmax(table_peak, plant.temp);
+		}
+	}
+
+	plant_reset(1.0);
+	run_loop(pid, 600, 300, &st);
+
+	fprintf(stderr, "  table: %.0f kHz avg, peak %.2fC; "
+			"pid: %.0f kHz avg, peak %.2fC\n",
+			table_sum / 300, table_peak,
+			st.freq_sum / st.n, st.settled_max);
+	CHECK(st.freq_sum / st.n > table_sum / 300);
+	CHECK(st.settled_max <= table_peak);
+
+	pid_control_destroy(pid);
+}
+
+int main(void)
+{
+	TEST_RUN(test_settling);
+	TEST_RUN(test_anti_windup);
+	TEST_RUN(test_quantization);
+	TEST_RUN(test_vs_mitigation_table);
+	return TEST_EXIT();
+}
@@ -0,0 +1,177 @@
+/*
+ * Sampling microbenchmark.  Builds sysfs style sensors on temp files,
+ * wraps them in alias, deadband and union resources like a device
+ * configuration does, and measures full sensor sweeps through
+ * resource_sample().  The I/O and allocator entry points are wrapped at
+ * link time (-Wl,--wrap) to count what one sweep costs.
+ *
+ *   sample_bench [sweeps]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "resource.h"
+#include "test.h"
+
+#define NUM_FILES 8
+#define DEFAULT_SWEEPS 200000
+
+static unsigned long n_syscalls;
+static unsigned long n_allocs;
+
+ssize_t __real_read(int fd, void *buf, size_t count);
+ssize_t __real_pread(int fd, void *buf, size_t count, off_t offset);
+off_t __real_lseek(int fd, off_t offset, int whence);
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+char *__real_strdup(const char *s);
+
+ssize_t __wrap_read(int fd, void *buf, size_t count)
+{
+	n_syscalls++;
+	return __real_read(fd, buf, count);
+}
+
+ssize_t __wrap_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	n_syscalls++;
+	return __real_pread(fd, buf, count, offset);
+}
+
+off_t __wrap_lseek(int fd, off_t offset, int whence)
+{
+	n_syscalls++;
+	return __real_lseek(fd, offset, whence);
+}
+
+void *__wrap_malloc(size_t size)
+{
+	n_allocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	n_allocs++;
+	return __real_calloc(nmemb, size);
+}
+
+char *__wrap_strdup(const char *s)
+{
+	n_allocs++;
+	return __real_strdup(s);
+}
+
+static char tmpdir[] = "/tmp/thermanager-benchXXXXXX";
+static struct resource *sensors[NUM_FILES + 3];
+static int nsensors;
+
+static void setup(void)
+{
+	const char *members[4];
+	char path[128];
+	char name[16];
+	FILE *fp;
+	int i;
+
+	if (mkdtemp(tmpdir) == NULL) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < NUM_FILES; ++i) {
+		snprintf(path, sizeof(path), "%s/temp%d", tmpdir, i);
+		fp = fopen(path, "w");
+		fprintf(fp, "%d\n", 40000 + i * 1000);
+		fclose(fp);
+
+		snprintf(name, sizeof(name), "temp%d", i);
+		resource_manager_add(resource_sysfs_open(name, path,
+				RESOURCE_SYSFS_RDONLY));
+	}
+
+	/* typical wrappers: an alias chain, a deadband and a union */
+	resource_manager_add(resource_alias_open("alias0", "temp0"));
+	resource_manager_add(resource_alias_open("alias1", "alias0"));
+	resource_manager_add(resource_deadband_open("quiet", "temp1", 500));
+	for (i = 0; i < 4; ++i) {
+		snprintf(name, sizeof(name), "temp%d", i + 4);
+		members[i] = strdup(name);
+	}
+	resource_manager_add(resource_union_open("cluster", 4, members));
+	resource_manager_prepare();
+
+	for (i = 0; i < NUM_FILES; ++i) {
+		snprintf(name, sizeof(name), "temp%d", i);
+		sensors[nsensors++] = resource_manager_find(name);
+	}
+	sensors[nsensors++] = resource_resolve(resource_manager_find("alias1"));
+	sensors[nsensors++] = resource_resolve(resource_manager_find("quiet"));
+	sensors[nsensors++] = resource_resolve(resource_manager_find("cluster"));
+	for (i = 0; i < nsensors; ++i)
+		CHECK(sensors[i] != NULL);
+}
+
+static void teardown(void)
+{
+	char path[128];
+	int i;
+
+	for (i = 0; i < NUM_FILES; ++i) {
+		snprintf(path, sizeof(path), "%s/temp%d", tmpdir, i);
+		unlink(path);
+	}
+	rmdir(tmpdir);
+}
+
+static int sweep(void)
+{
+	int value, sum = 0;
+	int i;
+
+	for (i = 0; i < nsensors; ++i) {
+		if (resource_sample(sensors[i], &value))
+			return -1;
+		sum += value;
+	}
+	return sum;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long sweeps = DEFAULT_SWEEPS;
+	unsigned long syscalls, allocs, i;
+	struct timespec t0, t1;
+	double ns;
+
+	if (argc > 1)
+		sweeps = strtoul(argv[1], NULL, 0);
+
+	setup();
+	CHECK(sweep() > 0);
+
+	n_syscalls = n_allocs = 0;
+	CHECK(sweep() > 0);
+	syscalls = n_syscalls;
+	allocs = n_allocs;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < sweeps; ++i)
+		sweep();
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+	printf("%d sensors per sweep: %lu syscalls, %lu allocations, "
+			"%.0f ns per sweep\n", nsensors, syscalls, allocs,
+			ns / sweeps);
+
+	/* one pread per backing file read, nothing else */
+	CHECK_EQ(syscalls, NUM_FILES + 1 + 1 + 4);
+	CHECK_EQ(allocs, 0);
+
+	teardown();
+	return TEST_EXIT();
+}
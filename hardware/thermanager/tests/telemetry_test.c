@@ -0,0 +1,162 @@
+/*
+ * Host test for the telemetry socket.  The daemon side runs on a real
+ * watch; the subscriber is a plain socket in the same thread, so the test
+ * alternates between draining the subscriber and running the watch.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "watch.h"
+#include "telemetry.h"
+#include "test.h"
+
+#define RING_SIZE 1024
+
+static struct watch *w;
+static int next_value;
+
+static void record(int n)
+{
+	while (n--)
+		telemetry_record(TELEMETRY_SAMPLE, "zone0", next_value++, 0);
+}
+
+static int subscribe(void)
+{
+	struct sockaddr_un addr;
+	socklen_t len;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path + 1, TELEMETRY_SOCKET, sizeof(addr.sun_path) - 2);
+	len = offsetof(struct sockaddr_un, sun_path) + 1 +
+			strlen(TELEMETRY_SOCKET);
+	if (connect(fd, (struct sockaddr *)&addr, len)) {
+		perror("connect");
+		exit(EXIT_FAILURE);
+	}
+
+	/* let the daemon accept */
+	watch_wait(w);
+	return fd;
+}
+
+/*
+ * Read everything queued for the subscriber, running the watch whenever
+ * the socket runs dry until a record carrying 'last' arrives.  Values must
+ * be consecutive from 'first' on, or only increasing when 'first' is -1.
+ * Returns the number of records read, -1 once the daemon hung up.
+ */
+static int drain(int fd, int first, int last)
+{
+	struct telemetry_record rec;
+	int expect = first;
+	int n = 0;
+	ssize_t rc;
+
+	for (;;) {
+		rc = recv(fd, &rec, sizeof(rec), MSG_DONTWAIT);
+		if (rc == 0)
+			return -1;
+		if (rc == -1) {
+			CHECK(errno == EAGAIN);
+			if (errno != EAGAIN)
+				return -1;
+			watch_wait(w);
+			continue;
+		}
+		CHECK_EQ(rc, sizeof(rec));
+		/* never an unwritten slot */
+		CHECK(rec.time != 0);
+		CHECK(strcmp(rec.name, "zone0") == 0);
+		if (first < 0)
+			CHECK(rec.value >= expect);
+		else
+			CHECK_EQ(rec.value, expect);
+		expect = rec.value + 1;
+		n++;
+		if (rec.value == last)
+			return n;
+	}
+}
+
+/* before the ring fills up only the records written so far are replayed */
+static void test_replay_before_wrap(void)
+{
+	int fd;
+
+	record(5);
+	fd = subscribe();
+
+	CHECK_EQ(drain(fd, 0, next_value - 1), 5);
+
+	close(fd);
+	watch_wait(w);
+}
+
+/* the ring has wrapped several times before the subscriber connects */
+static void test_replay_after_wrap(void)
+{
+	int fd;
+
+	record(3 * RING_SIZE + 17);
+	fd = subscribe();
+
+	CHECK_EQ(drain(fd, next_value - RING_SIZE, next_value - 1), RING_SIZE);
+
+	/* still subscribed, live records keep coming */
+	record(10);
+	CHECK_EQ(drain(fd, next_value - 10, next_value - 1), 10);
+
+	close(fd);
+	watch_wait(w);
+}
+
+/* a subscriber a whole ring behind skips ahead instead of being dropped */
+static void test_slow_subscriber(void)
+{
+	int fd;
+
+	fd = subscribe();
+	CHECK_EQ(drain(fd, next_value - RING_SIZE, next_value - 1), RING_SIZE);
+
+	record(5 * RING_SIZE);
+	CHECK(drain(fd, -1, next_value - 1) > 0);
+
+	record(1);
+	CHECK_EQ(drain(fd, next_value - 1, next_value - 1), 1);
+
+	close(fd);
+	watch_wait(w);
+}
+
+int main(void)
+{
+	w = watch_create();
+	watch_manager_set_watch(w);
+	if (telemetry_start()) {
+		fprintf(stderr, "telemetry socket in use, skipping\n");
+		return EXIT_SUCCESS;
+	}
+
+	/* a lost wakeup would hang the test, not fail it */
+	alarm(10);
+
+	/* must run first, while the ring has not wrapped yet */
+	TEST_RUN(test_replay_before_wrap);
+	TEST_RUN(test_replay_after_wrap);
+	TEST_RUN(test_slow_subscriber);
+
+	telemetry_stop();
+	watch_manager_set_watch(NULL);
+	watch_destroy(w);
+	return TEST_EXIT();
+}
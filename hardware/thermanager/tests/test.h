@@ -0,0 +1,40 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Minimal host test support, every test is a standalone program which
+ * returns non-zero on failure.
+ */
+static int test_failures;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+				__FILE__, __LINE__, #cond); \
+		test_failures++; \
+	} \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+	long long _a = (long long)(a); \
+	long long _b = (long long)(b); \
+	if (_a != _b) { \
+		fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n", \
+				__FILE__, __LINE__, #a, #b, _a, _b); \
+		test_failures++; \
+	} \
+} while (0)
+
+#define TEST_RUN(fn) do { \
+	int _before = test_failures; \
+	fn(); \
+	fprintf(stderr, "%s %s\n", _before == test_failures ? \
+			"PASS" : "FAIL", #fn); \
+} while (0)
+
+#define TEST_EXIT() (test_failures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ * Host test for the watch timer wheel.  The wheel helpers are static, so the
+ * source is pulled in directly and driven with a synthetic clock.  The
+ * wakeup rate run uses the real clock and compares watch_wait() with the
+ * poll() loop it replaced.
+ */
+#include <poll.h>
+
+#include "../src/watch.c"
+#include "test.h"
+
+#define NUM_TICKETS 2000
+
+/* ticket mix of the wakeup rate run, at a tenth of the real intervals */
+#define RATE_POLLED	36
+#define RATE_POLL_MS	500
+#define RATE_SLACK_MS	100
+#define RATE_CONFIGS	4
+#define RATE_CONFIG_MS	100
+#define RATE_RUN_MS	2000
+
+static unsigned int rand_state = 1;
+
+static unsigned int next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+static struct watch_ticket *wheel_ticket(struct watch *w, u64 expires)
+{
+	struct watch_ticket *ticket;
+
+	ticket = watch_add_null(w);
+	ticket->type = WATCH_TYPE_TIMEOUT;
+	ticket->expires = expires;
+	watch_wheel_insert(&w->wheel, ticket);
+	return ticket;
+}
+
+static u64 queued_min(struct watch *w)
+{
+	struct watch_ticket *ticket;
+	struct list_node *node;
+	u64 min = (u64)-1;
+
+	for_list_node(&w->tickets, node) {
+		ticket = list_entry(node, struct watch_ticket, list_node);
+		if (ticket->queue != NULL && ticket->expires < min)
+			min = ticket->expires;
+	}
+	return min;
+}
+
+/*
+ * Tickets spread over every level, starting just below the point where
+ * levels 0, 1 and 2 all wrap, must expire exactly on their tick and in order.
+ */
+static void test_wheel_wrap_and_order(void)
+{
+	struct watch_ticket *ticket;
+	struct list_node *node;
+	struct list expired;
+	struct watch *w;
+	u64 start, next, last = 0;
+	int fired = 0;
+	int i;
+
+	w = watch_create();
+	start = (1ULL << (WHEEL_BITS * 3)) - 37;
+	w->wheel.now = start;
+
+	for (i = 0; i < NUM_TICKETS; ++i) {
+		switch (i % 4) {
+		case 0:
+			wheel_ticket(w, start + 1 + next_rand() % 64);
+			break;
+		case 1:
+			wheel_ticket(w, start + 1 + next_rand() % 4096);
+			break;
+		case 2:
+			wheel_ticket(w, start + 1 + next_rand() % 262144);
+			break;
+		default:
+			wheel_ticket(w, start + 1 + next_rand() % 2000000);
+			break;
+		}
+	}
+
+	while ((next = watch_wheel_next_expiry(&w->wheel)) != (u64)-1) {
+		CHECK_EQ(next, queued_min(w));
+		CHECK(next > w->wheel.now);
+
+		/* nothing may fire before its tick... */
+		list_init(&expired);
+		watch_wheel_advance(&w->wheel, next - 1, &expired);
+		CHECK(list_first(&expired) == NULL);
+
+		/* ...and everything due must fire on it */
+		watch_wheel_advance(&w->wheel, next, &expired);
+		CHECK(list_first(&expired) != NULL);
+		while ((node = list_pop(&expired)) != NULL) {
+			ticket = list_entry(node, struct watch_ticket, queue_node);
+			ticket->queue = NULL;
+			CHECK_EQ(ticket->expires, next);
+			CHECK(ticket->expires >= last);
+			last = ticket->expires;
+			fired++;
+		}
+	}
+	CHECK_EQ(fired, NUM_TICKETS);
+	CHECK_EQ(w->wheel.pending[0] | w->wheel.pending[1] |
+			w->wheel.pending[2] | w->wheel.pending[3], 0);
+
+	watch_destroy(w);
+}
+
+/* Large random steps must not skip any ticket or return one early. */
+static void test_wheel_coarse_advance(void)
+{
+	struct watch_ticket *ticket;
+	struct list_node *node;
+	struct list expired;
+	struct watch *w;
+	u64 start, prev, last = 0;
+	int fired = 0;
+	int i;
+
+	w = watch_create();
+	start = WHEEL_MAX - 5000;
+	w->wheel.now = start;
+
+	for (i = 0; i < NUM_TICKETS; ++i)
+		wheel_ticket(w, start + 1 + next_rand() % 500000);
+
+	while (fired < NUM_TICKETS && w->wheel.now < start + 600000) {
+		prev = w->wheel.now;
+		list_init(&expired);
+		watch_wheel_advance(&w->wheel, prev + 1 + next_rand() % 5000,
+				&expired);
+		while ((node = list_pop(&expired)) != NULL) {
+			ticket = list_entry(node, struct watch_ticket, queue_node);
+			ticket->queue = NULL;
+			CHECK(ticket->expires > prev);
+			CHECK(ticket->expires <= w->wheel.now);
+			CHECK(ticket->expires >= last);
+			last = ticket->expires;
+			fired++;
+		}
+	}
+	CHECK_EQ(fired, NUM_TICKETS);
+
+	watch_destroy(w);
+}
+
+/* Timers beyond the top level are parked there but still fire on time. */
+static void test_wheel_clamp(void)
+{
+	struct list expired;
+	struct watch *w;
+	u64 expires;
+
+	w = watch_create();
+	expires = w->wheel.now + WHEEL_MAX + 12345;
+	wheel_ticket(w, expires);
+
+	list_init(&expired);
+	watch_wheel_advance(&w->wheel, expires - 1, &expired);
+	CHECK(list_first(&expired) == NULL);
+	watch_wheel_advance(&w->wheel, expires, &expired);
+	CHECK(list_first(&expired) != NULL);
+
+	watch_destroy(w);
+}
+
+static void test_slack(void)
+{
+	u64 expires, best, t;
+	unsigned int slack;
+	int i;
+
+	for (i = 0; i < 1000; ++i) {
+		expires = 1000000 + next_rand() % 100000;
+		slack = next_rand() % 2000;
+		t = watch_apply_slack(expires, slack);
+		CHECK(t >= expires && t <= expires + slack);
+
+		/* no tick in the window is rounder */
+		best = expires;
+		for (t = expires; t <= expires + slack; ++t)
+			if (__builtin_ctzll(t) > __builtin_ctzll(best))
+				best = t;
+		CHECK_EQ(watch_apply_slack(expires, slack), best);
+	}
+}
+
+struct fire_log {
+	int order[3];
+	int count;
+};
+
+static void record_fire(void *data, struct watch_ticket *ticket)
+{
+	struct fire_log *log = data;
+	int id = (int)ticket->interval;
+	int i;
+
+	for (i = 0; i < log->count; ++i)
+		if (log->order[i] == id)
+			return;
+	log->order[log->count++] = id;
+}
+
+/* End to end through timerfd and epoll, shortest interval fires first. */
+static void test_wait_expiry_order(void)
+{
+	struct fire_log log = { .count = 0 };
+	struct watch_ticket *ticket;
+	struct watch *w;
+	u64 begin;
+	int loops = 0;
+
+	w = watch_create();
+	ticket = watch_add_timeout(w, 40);
+	watch_ticket_callback(ticket, record_fire, &log);
+	ticket = watch_add_timeout(w, 10);
+	watch_ticket_callback(ticket, record_fire, &log);
+	ticket = watch_add_timeout(w, 25);
+	watch_ticket_callback(ticket, record_fire, &log);
+
+	begin = time_ms();
+	while (log.count < 3 && loops++ < 100)
+		watch_wait(w);
+	CHECK_EQ(log.count, 3);
+	CHECK_EQ(log.order[0], 10);
+	CHECK_EQ(log.order[1], 25);
+	CHECK_EQ(log.order[2], 40);
+	CHECK(time_ms() - begin >= 40);
+
+	watch_destroy(w);
+}
+
+/* the timeouts of watch_wait() before the wheel: poll() to the earliest one */
+struct poll_ticket {
+	unsigned int interval;
+	u64 start;
+};
+
+static unsigned long poll_watch_run(struct poll_ticket *tickets, int count,
+		u64 end)
+{
+	unsigned long wakeups = 0;
+	u64 term_time;
+	u64 now;
+	int i;
+
+	while ((now = time_ms()) < end) {
+		term_time = (u64)-1;
+		for (i = 0; i < count; ++i)
+			if (tickets[i].start + tickets[i].interval < term_time)
+				term_time = tickets[i].start + tickets[i].interval;
+		if (now < term_time)
+			poll(NULL, 0, (int)(term_time - now));
+		wakeups++;
+
+		now = time_ms();
+		for (i = 0; i < count; ++i)
+			if (now >= tickets[i].start + tickets[i].interval)
+				tickets[i].start = now;
+	}
+	return wakeups;
+}
+
+static unsigned int rate_interval(int i, unsigned int *slack)
+{
+	*slack = i < RATE_POLLED ? RATE_SLACK_MS : 0;
+	return i < RATE_POLLED ? RATE_POLL_MS : RATE_CONFIG_MS;
+}
+
+/*
+ * Dozens of polled resources with slack, registered at scattered points of
+ * their period as configurations load, next to a few configurations polled
+ * without slack.  The wheel should batch the polls into fewer wakeups than
+ * the poll() loop, which woke up for every distinct deadline.
+ */
+static void test_wakeup_rate(void)
+{
+	struct poll_ticket old[RATE_POLLED + RATE_CONFIGS];
+	struct watch_ticket *ticket;
+	unsigned long old_wakeups, new_wakeups;
+	unsigned int interval, slack, phase;
+	struct watch *w;
+	u64 now;
+	int i;
+
+	now = time_ms();
+	for (i = 0; i < RATE_POLLED + RATE_CONFIGS; ++i) {
+		interval = rate_interval(i, &slack);
+		phase = next_rand() % interval;
+		old[i].interval = interval;
+		old[i].start = now - interval + phase;
+	}
+	old_wakeups = poll_watch_run(old, RATE_POLLED + RATE_CONFIGS,
+			now + RATE_RUN_MS);
+
+	w = watch_create();
+	now = time_ms();
+	for (i = 0; i < RATE_POLLED + RATE_CONFIGS; ++i) {
+		interval = rate_interval(i, &slack);
+		phase = next_rand() % interval;
+		ticket = watch_add_timeout(w, interval);
+		watch_ticket_set_slack(ticket, slack);
+		watch_queue_remove(ticket);
+		ticket->expires = watch_apply_slack(now + phase, slack);
+		watch_wheel_insert(&w->wheel, ticket);
+	}
+	while (time_ms() < now + RATE_RUN_MS)
+		watch_wait(w);
+	new_wakeups = watch_wakeups(w);
+
+	fprintf(stderr, "  %d polled tickets with %d ms slack, %d without, "
+			"intervals / 10: %lu wakeups/min poll, "
+			"%lu wakeups/min wheel\n",
+			RATE_POLLED, RATE_SLACK_MS, RATE_CONFIGS,
+			old_wakeups * 60000 / RATE_RUN_MS,
+			new_wakeups * 60000 / RATE_RUN_MS);
+	CHECK(new_wakeups < old_wakeups);
+
+	watch_destroy(w);
+}
+
+int main(void)
+{
+	TEST_RUN(test_wheel_wrap_and_order);
+	TEST_RUN(test_wheel_coarse_advance);
+	TEST_RUN(test_wheel_clamp);
+	TEST_RUN(test_slack);
+	TEST_RUN(test_wait_expiry_order);
+	TEST_RUN(test_wakeup_rate);
+	return TEST_EXIT();
+}
@@ -7,6 +7,11 @@
 #include <limits.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
+
+#include "src/telemetry.h"
 
 typedef unsigned char u8;
 typedef unsigned int u32;
@@ -263,6 +268,50 @@ int parse(const char *file)
 	return 0;
 }
 
+/* stream thermanager's telemetry instead of polling sysfs ourselves */
+int subscribe(void)
+{
+	static const char *types[] = {
+		[TELEMETRY_SAMPLE] = "sample",
+		[TELEMETRY_THRESHOLD] = "threshold",
+		[TELEMETRY_MITIGATION] = "mitigation",
+		[TELEMETRY_OUTPUT] = "output",
+	};
+	struct telemetry_record rec;
+	struct sockaddr_un addr;
+	socklen_t len;
+	int fd;
+	int rc;
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (fd == -1)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path + 1, TELEMETRY_SOCKET, sizeof(addr.sun_path) - 2);
+	len = offsetof(struct sockaddr_un, sun_path) + 1 +
+			strlen(TELEMETRY_SOCKET);
+	if (connect(fd, (struct sockaddr *)&addr, len)) {
+		perror(TELEMETRY_SOCKET);
+		close(fd);
+		return -1;
+	}
+
+	printf("time; event; name; value; arg\n");
+	while ((rc = recv(fd, &rec, sizeof(rec), 0)) == sizeof(rec)) {
+		rec.name[sizeof(rec.name) - 1] = 0;
+		printf("%llu; %s; %s; %d; %d\n", rec.time,
+				(unsigned)rec.type < ARRAY_SIZE(types) ?
+						types[rec.type] : "?",
+				rec.name, rec.value, rec.arg);
+		fflush(stdout);
+	}
+
+	close(fd);
+	return 0;
+}
+
 int daemonize(const char *file)
 {
 	switch (fork()) {
@@ -280,7 +329,10 @@ int main(int argc, char **argv)
 		return daemonize(argv[2]);
 	} else if (argc == 3 && !strcmp(argv[1], "parse")) {
 		return parse(argv[2]);
+	} else if (argc == 2 && !strcmp(argv[1], "subscribe")) {
+		return subscribe();
 	}
 	fprintf(stderr, "Usage: %s <daemon|monitor|parse> <file>\n", argv[0]);
+	fprintf(stderr, "       %s subscribe\n", argv[0]);
 	return -1;
 }